@@ -98,8 +98,10 @@
       'sources': [
         '<(gen_out_dir)/character_set.inc',
         'environ.cc',
+        'executor.cc',
         'file_stream.cc',
         'file_util.cc',
+        'hot_page_pinner.cc',
         'init_mozc.cc',
         'logging.cc',
         'mmap.cc',
@@ -103,6 +103,8 @@
       'type': 'executable',
       'sources': [
         'bitarray_test.cc',
+        'executor_test.cc',
+        'hot_page_pinner_test.cc',
         'logging_test.cc',
         'mmap_test.cc',
         'singleton_test.cc',
@@ -0,0 +1,332 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/executor.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/singleton.h"
+#include "base/thread.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+
+struct Executor::TaskHandle::State {
+  enum Status {
+    PENDING,
+    RUNNING,
+    DONE,
+  };
+
+  State(std::function<void()> task, Priority priority, absl::Duration interval)
+      : task(std::move(task)), priority(priority), interval(interval) {}
+
+  // The fields below are guarded by Executor::mutex_.
+  std::function<void()> task;
+  const Priority priority;
+  // Zero for one-shot tasks.
+  const absl::Duration interval;
+  absl::Time due;
+  Status status = PENDING;
+  bool cancelled = false;
+};
+
+class Executor::Worker : public Thread {
+ public:
+  explicit Worker(Executor *executor) : executor_(executor) {}
+
+  void Run() override { executor_->RunWorker(); }
+
+ private:
+  Executor *executor_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+bool Executor::TaskHandle::IsDone() const {
+  return state_ == nullptr || Executor::IsDone(mutex_.get(), state_);
+}
+
+bool Executor::TaskHandle::Cancel() {
+  return state_ != nullptr && Executor::Cancel(mutex_.get(), state_);
+}
+
+void Executor::TaskHandle::Wait() const {
+  if (state_ != nullptr) {
+    Executor::Wait(mutex_.get(), state_);
+  }
+}
+
+// static
+Executor *Executor::Get() { return Singleton<Executor>::get(); }
+
+Executor::Executor() : Executor(kDefaultNumWorkers) {}
+
+Executor::Executor(int num_workers)
+    : num_workers_(std::max(1, num_workers)),
+      mutex_(std::make_shared<absl::Mutex>()) {}
+
+Executor::~Executor() {
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::function<void()>> discarded;
+  {
+    absl::MutexLock l(mutex_.get());
+    stopped_ = true;
+    auto discard = [&discarded](const std::shared_ptr<State> &state) {
+      if (state->status == State::PENDING) {
+        state->status = State::DONE;
+        discarded.push_back(std::move(state->task));
+      }
+    };
+    for (; !timers_.empty(); timers_.pop()) {
+      discard(timers_.top().state);
+    }
+    for (auto &ready : ready_) {
+      for (const auto &state : ready) {
+        discard(state);
+      }
+      ready.clear();
+    }
+    workers.swap(workers_);
+    cond_.SignalAll();
+  }
+  for (auto &worker : workers) {
+    worker->Join();
+  }
+}
+
+Executor::TaskHandle Executor::Post(std::function<void()> task,
+                                    Priority priority) {
+  return PostInternal(std::move(task), absl::ZeroDuration(),
+                      absl::ZeroDuration(), priority);
+}
+
+Executor::TaskHandle Executor::PostDelayed(std::function<void()> task,
+                                           absl::Duration delay,
+                                           Priority priority) {
+  return PostInternal(std::move(task), delay, absl::ZeroDuration(), priority);
+}
+
+Executor::TaskHandle Executor::PostRepeating(std::function<void()> task,
+                                             absl::Duration delay,
+                                             absl::Duration interval,
+                                             Priority priority) {
+  DCHECK_GT(interval, absl::ZeroDuration());
+  return PostInternal(std::move(task), delay, interval, priority);
+}
+
+Executor::TaskHandle Executor::PostInternal(std::function<void()> task,
+                                            absl::Duration delay,
+                                            absl::Duration interval,
+                                            Priority priority) {
+  DCHECK(task);
+  auto state = std::make_shared<State>(std::move(task), priority, interval);
+  absl::MutexLock l(mutex_.get());
+  if (stopped_) {
+    LOG(ERROR) << "Executor is already stopped";
+    state->status = State::DONE;
+    state->task = nullptr;
+    return TaskHandle(mutex_, std::move(state));
+  }
+  StartWorkers();
+  Schedule(state, absl::Now() + delay);
+  return TaskHandle(mutex_, std::move(state));
+}
+
+void Executor::BeginInteractive() {
+  absl::MutexLock l(mutex_.get());
+  ++interactive_count_;
+}
+
+void Executor::EndInteractive() {
+  absl::MutexLock l(mutex_.get());
+  DCHECK_GT(interactive_count_, 0);
+  if (--interactive_count_ == 0 && !ready_[LOW].empty()) {
+    cond_.SignalAll();
+  }
+}
+
+void Executor::Schedule(std::shared_ptr<State> state, absl::Time due) {
+  state->due = due;
+  if (due <= absl::Now()) {
+    ready_[state->priority].push_back(std::move(state));
+  } else {
+    timers_.push({due, next_seq_++, std::move(state)});
+  }
+  cond_.Signal();
+}
+
+void Executor::MoveDueTasks(absl::Time now) {
+  while (!timers_.empty() && timers_.top().due <= now) {
+    const std::shared_ptr<State> &state = timers_.top().state;
+    if (state->status == State::PENDING) {
+      ready_[state->priority].push_back(state);
+    }
+    timers_.pop();
+  }
+}
+
+std::shared_ptr<Executor::State> Executor::PopReadyTask() {
+  for (int priority = HIGH; priority <= LOW; ++priority) {
+    if (priority == LOW && interactive_count_ > 0) {
+      break;
+    }
+    auto &ready = ready_[priority];
+    while (!ready.empty()) {
+      std::shared_ptr<State> state = std::move(ready.front());
+      ready.pop_front();
+      // Cancelled tasks and the tasks run by Wait() are left in the queue.
+      if (state->status == State::PENDING) {
+        return state;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void Executor::StartWorkers() {
+  while (static_cast<int>(workers_.size()) < num_workers_) {
+    workers_.push_back(std::make_unique<Worker>(this));
+    workers_.back()->Start(absl::StrCat("Executor", workers_.size()));
+  }
+}
+
+void Executor::RunWorker() {
+  while (true) {
+    std::shared_ptr<State> state;
+    std::function<void()> task, released;
+    {
+      absl::MutexLock l(mutex_.get());
+      while (true) {
+        if (stopped_) {
+          return;
+        }
+        MoveDueTasks(absl::Now());
+        state = PopReadyTask();
+        if (state != nullptr) {
+          break;
+        }
+        const absl::Time deadline =
+            timers_.empty() ? absl::InfiniteFuture() : timers_.top().due;
+        cond_.WaitWithDeadline(mutex_.get(), deadline);
+      }
+      state->status = State::RUNNING;
+      if (state->interval > absl::ZeroDuration()) {
+        task = state->task;
+      } else {
+        task.swap(state->task);
+      }
+    }
+
+    task();
+
+    {
+      absl::MutexLock l(mutex_.get());
+      if (state->interval > absl::ZeroDuration() && !state->cancelled &&
+          !stopped_) {
+        state->status = State::PENDING;
+        Schedule(state, absl::Now() + state->interval);
+        continue;
+      }
+      state->status = State::DONE;
+      released.swap(state->task);
+    }
+    // The task and its bound arguments are destructed out of the lock.
+  }
+}
+
+// static
+void Executor::Wait(absl::Mutex *mutex, const std::shared_ptr<State> &state) {
+  auto is_not_pending = +[](State *state) {
+    return state->status != State::PENDING;
+  };
+  auto is_not_running = +[](State *state) {
+    return state->status != State::RUNNING;
+  };
+
+  mutex->Lock();
+  while (state->status != State::DONE) {
+    if (state->status == State::RUNNING) {
+      mutex->Await(absl::Condition(is_not_running, state.get()));
+      continue;
+    }
+    if (state->interval > absl::ZeroDuration()) {
+      mutex->Await(absl::Condition(is_not_pending, state.get()));
+      continue;
+    }
+    if (state->due > absl::Now()) {
+      mutex->AwaitWithDeadline(absl::Condition(is_not_pending, state.get()),
+                               state->due);
+      continue;
+    }
+    // The task is due but no worker has picked it up.  Runs it here so that
+    // waiting on a throttled or queued task doesn't block the caller.
+    state->status = State::RUNNING;
+    std::function<void()> task = std::move(state->task);
+    mutex->Unlock();
+    task();
+    task = nullptr;
+    mutex->Lock();
+    state->status = State::DONE;
+  }
+  mutex->Unlock();
+}
+
+// static
+bool Executor::Cancel(absl::Mutex *mutex,
+                       const std::shared_ptr<State> &state) {
+  std::function<void()> task;
+  absl::MutexLock l(mutex);
+  state->cancelled = true;
+  if (state->status != State::PENDING) {
+    return false;
+  }
+  state->status = State::DONE;
+  task.swap(state->task);
+  return true;
+}
+
+// static
+bool Executor::IsDone(absl::Mutex *mutex,
+                       const std::shared_ptr<State> &state) {
+  absl::MutexLock l(mutex);
+  return state->status == State::DONE;
+}
+
+}  // namespace mozc
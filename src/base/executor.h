@@ -0,0 +1,204 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_EXECUTOR_H_
+#define MOZC_BASE_EXECUTOR_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "base/port.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+
+// Process-wide pool of background workers.
+//
+// Background jobs (syncing the user history, reloading the user dictionary,
+// building the engine, the watch dog, scheduler jobs, ...) are posted to the
+// shared executor instead of creating a dedicated thread for each of them, so
+// the number of threads and wakeups of the server stays constant.
+//
+// Usage:
+//   Executor::TaskHandle handle = Executor::Get()->Post(
+//       [this]() { Save(); }, Executor::LOW);
+//   ...
+//   handle.Wait();
+//
+// Tasks are run in the order of priority and then the order of posting.
+// LOW tasks are held back while interactive work (see ScopedInteractive) is
+// in progress.
+class Executor {
+ public:
+  enum Priority {
+    HIGH = 0,
+    NORMAL = 1,
+    LOW = 2,
+  };
+
+  static constexpr int kDefaultNumWorkers = 2;
+
+  // Handle to a posted task.  The handle can be copied; all the copies refer
+  // to the same task.  A default constructed handle refers to no task and
+  // behaves as a finished task.  The handle may outlive the executor, e.g. in
+  // another singleton destroyed later.  The task is finished then.
+  class TaskHandle {
+   public:
+    TaskHandle() = default;
+
+    // Returns true if the task has finished or has been cancelled.  A
+    // repeating task is done only after it is cancelled.
+    bool IsDone() const;
+
+    // Cancels the task.  Returns true if the task had not started yet and
+    // will never run.  When the task is running, this call doesn't wait for
+    // it but stops its further repetitions.
+    bool Cancel();
+
+    // Waits for the task to finish.  A one-shot task whose due time has come
+    // is run on the calling thread instead of waiting for a worker.  Waiting
+    // for a repeating task blocks until it is cancelled.
+    void Wait() const;
+
+   private:
+    friend class Executor;
+    struct State;
+
+    TaskHandle(std::shared_ptr<absl::Mutex> mutex,
+               std::shared_ptr<State> state)
+        : mutex_(std::move(mutex)), state_(std::move(state)) {}
+
+    // The mutex of the executor, which guards |state_|.
+    std::shared_ptr<absl::Mutex> mutex_;
+    std::shared_ptr<State> state_;
+  };
+
+  // Marks interactive work during its lifetime.
+  class ScopedInteractive {
+   public:
+    ScopedInteractive() : ScopedInteractive(Executor::Get()) {}
+    explicit ScopedInteractive(Executor *executor) : executor_(executor) {
+      executor_->BeginInteractive();
+    }
+    ~ScopedInteractive() { executor_->EndInteractive(); }
+
+   private:
+    Executor *executor_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedInteractive);
+  };
+
+  // Returns the process-wide executor.
+  static Executor *Get();
+
+  Executor();
+  explicit Executor(int num_workers);
+  // Stops the workers.  Running tasks are waited for and pending tasks are
+  // discarded.
+  ~Executor();
+
+  // Runs |task| on a worker as soon as possible.
+  TaskHandle Post(std::function<void()> task, Priority priority = NORMAL);
+
+  // Runs |task| on a worker after |delay|.
+  TaskHandle PostDelayed(std::function<void()> task, absl::Duration delay,
+                         Priority priority = NORMAL);
+
+  // Runs |task| after |delay|, and then repeatedly with |interval| between
+  // the end of a run and the start of the next one, until cancelled.
+  TaskHandle PostRepeating(std::function<void()> task, absl::Duration delay,
+                           absl::Duration interval,
+                           Priority priority = NORMAL);
+
+  // While the interactive count is positive, LOW tasks are not started.  The
+  // calls must be balanced; prefer ScopedInteractive.
+  void BeginInteractive();
+  void EndInteractive();
+
+ private:
+  class Worker;
+  using State = TaskHandle::State;
+
+  struct TimerEntry {
+    absl::Time due;
+    uint64_t seq;
+    std::shared_ptr<State> state;
+  };
+  struct LaterThan {
+    bool operator()(const TimerEntry &lhs, const TimerEntry &rhs) const {
+      if (lhs.due != rhs.due) {
+        return lhs.due > rhs.due;
+      }
+      return lhs.seq > rhs.seq;
+    }
+  };
+
+  TaskHandle PostInternal(std::function<void()> task, absl::Duration delay,
+                          absl::Duration interval, Priority priority);
+  void Schedule(std::shared_ptr<State> state, absl::Time due)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(*mutex_);
+  void MoveDueTasks(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  std::shared_ptr<State> PopReadyTask()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(*mutex_);
+  void StartWorkers() ABSL_EXCLUSIVE_LOCKS_REQUIRED(*mutex_);
+  void RunWorker();
+  // These don't refer to the executor, so that the handles can use them
+  // after the executor is destroyed.
+  static void Wait(absl::Mutex *mutex, const std::shared_ptr<State> &state);
+  static bool Cancel(absl::Mutex *mutex, const std::shared_ptr<State> &state);
+  static bool IsDone(absl::Mutex *mutex, const std::shared_ptr<State> &state);
+
+  const int num_workers_;
+  // Shared with the task handles.
+  const std::shared_ptr<absl::Mutex> mutex_;
+  absl::CondVar cond_;
+  // Workers are started on the first post.
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // Pending tasks ordered by the due time.
+  std::priority_queue<TimerEntry, std::vector<TimerEntry>, LaterThan> timers_
+      ABSL_GUARDED_BY(*mutex_);
+  // Tasks whose due time has come, for each priority.
+  std::deque<std::shared_ptr<State>> ready_[LOW + 1] ABSL_GUARDED_BY(*mutex_);
+  uint64_t next_seq_ ABSL_GUARDED_BY(*mutex_) = 0;
+  int interactive_count_ ABSL_GUARDED_BY(*mutex_) = 0;
+  bool stopped_ ABSL_GUARDED_BY(*mutex_) = false;
+
+  DISALLOW_COPY_AND_ASSIGN(Executor);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_EXECUTOR_H_
@@ -0,0 +1,213 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/executor.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/util.h"
+#include "testing/base/public/gmock.h"
+#include "testing/base/public/gunit.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(ExecutorTest, Post) {
+  Executor executor(2);
+  std::atomic<int> count = 0;
+  std::vector<Executor::TaskHandle> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(executor.Post([&count]() { ++count; }));
+  }
+  for (const Executor::TaskHandle &handle : handles) {
+    handle.Wait();
+    EXPECT_TRUE(handle.IsDone());
+  }
+  EXPECT_EQ(10, count);
+
+  // Default constructed handle behaves as a finished task.
+  Executor::TaskHandle empty;
+  EXPECT_TRUE(empty.IsDone());
+  EXPECT_FALSE(empty.Cancel());
+  empty.Wait();
+}
+
+TEST(ExecutorTest, Priority) {
+  Executor executor(1);
+  absl::Notification blocked, release;
+  Executor::TaskHandle blocker = executor.Post([&]() {
+    blocked.Notify();
+    release.WaitForNotification();
+  });
+  blocked.WaitForNotification();
+
+  absl::Mutex mutex;
+  std::vector<std::string> order;
+  auto push = [&](const std::string &name) {
+    return [&, name]() {
+      absl::MutexLock l(&mutex);
+      order.push_back(name);
+    };
+  };
+  Executor::TaskHandle low1 = executor.Post(push("low1"), Executor::LOW);
+  Executor::TaskHandle normal = executor.Post(push("normal"), Executor::NORMAL);
+  Executor::TaskHandle low2 = executor.Post(push("low2"), Executor::LOW);
+  Executor::TaskHandle high = executor.Post(push("high"), Executor::HIGH);
+  release.Notify();
+
+  // Waits for the last task in the queue so that no task is run by Wait().
+  Util::Sleep(200);
+  low2.Wait();
+  absl::MutexLock l(&mutex);
+  EXPECT_THAT(order, ElementsAre("high", "normal", "low1", "low2"));
+}
+
+TEST(ExecutorTest, PostDelayed) {
+  Executor executor(1);
+  std::atomic<bool> invoked = false;
+  Executor::TaskHandle handle = executor.PostDelayed(
+      [&invoked]() { invoked = true; }, absl::Milliseconds(300));
+  Util::Sleep(100);
+  EXPECT_FALSE(invoked);
+  EXPECT_FALSE(handle.IsDone());
+  handle.Wait();
+  EXPECT_TRUE(invoked);
+  EXPECT_TRUE(handle.IsDone());
+}
+
+TEST(ExecutorTest, Cancel) {
+  Executor executor(1);
+  std::atomic<bool> invoked = false;
+  Executor::TaskHandle handle = executor.PostDelayed(
+      [&invoked]() { invoked = true; }, absl::Seconds(10));
+  EXPECT_TRUE(handle.Cancel());
+  EXPECT_TRUE(handle.IsDone());
+  handle.Wait();
+  EXPECT_FALSE(invoked);
+
+  // Already finished.
+  handle = executor.Post([]() {});
+  handle.Wait();
+  EXPECT_FALSE(handle.Cancel());
+}
+
+TEST(ExecutorTest, PostRepeating) {
+  Executor executor(1);
+  std::atomic<int> count = 0;
+  Executor::TaskHandle handle = executor.PostRepeating(
+      [&count]() { ++count; }, absl::ZeroDuration(), absl::Milliseconds(50));
+  Util::Sleep(500);
+  EXPECT_FALSE(handle.IsDone());
+  handle.Cancel();
+  handle.Wait();
+  EXPECT_TRUE(handle.IsDone());
+  const int last_count = count;
+  EXPECT_GE(last_count, 3);
+  Util::Sleep(200);
+  EXPECT_EQ(last_count, count);
+}
+
+TEST(ExecutorTest, Interactive) {
+  Executor executor(1);
+  std::atomic<bool> low_invoked = false;
+  std::atomic<bool> normal_invoked = false;
+  Executor::TaskHandle low, normal;
+  {
+    Executor::ScopedInteractive interactive(&executor);
+    low = executor.Post([&low_invoked]() { low_invoked = true; },
+                        Executor::LOW);
+    normal = executor.Post([&normal_invoked]() { normal_invoked = true; },
+                           Executor::NORMAL);
+    Util::Sleep(300);
+    // LOW tasks are held back during interactive work.
+    EXPECT_TRUE(normal_invoked);
+    EXPECT_FALSE(low_invoked);
+  }
+  Util::Sleep(300);
+  EXPECT_TRUE(low_invoked);
+  EXPECT_TRUE(low.IsDone());
+}
+
+TEST(ExecutorTest, WaitRunsPendingTask) {
+  Executor executor(1);
+  absl::Notification blocked, release;
+  Executor::TaskHandle blocker = executor.Post([&]() {
+    blocked.Notify();
+    release.WaitForNotification();
+  });
+  blocked.WaitForNotification();
+
+  // The only worker is busy, so Wait() runs the task by itself.
+  std::atomic<bool> invoked = false;
+  Executor::TaskHandle handle =
+      executor.Post([&invoked]() { invoked = true; });
+  handle.Wait();
+  EXPECT_TRUE(invoked);
+  EXPECT_FALSE(blocker.IsDone());
+
+  release.Notify();
+  blocker.Wait();
+}
+
+TEST(ExecutorTest, Destruct) {
+  std::atomic<bool> invoked = false;
+  Executor::TaskHandle handle;
+  {
+    Executor executor(1);
+    handle = executor.PostDelayed([&invoked]() { invoked = true; },
+                                  absl::Seconds(10));
+  }
+  // Pending tasks are discarded.
+  EXPECT_FALSE(invoked);
+}
+
+TEST(ExecutorTest, HandleOutlivesExecutor) {
+  Executor::TaskHandle handle;
+  {
+    Executor executor(1);
+    handle = executor.PostRepeating([]() {}, absl::ZeroDuration(),
+                                    absl::Milliseconds(1));
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  // The handle still works after the executor is destroyed.
+  EXPECT_TRUE(handle.IsDone());
+  EXPECT_FALSE(handle.Cancel());
+  handle.Wait();
+}
+
+}  // namespace
+}  // namespace mozc
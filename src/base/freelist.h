@@ -53,12 +53,18 @@ class FreeList {
 
   void Reset() { chunk_index_ = current_index_ = 0; }
 
-  void Free() {
-    for (size_t i = 1; i < pool_.size(); ++i) {
+  void Free() { Recycle(1); }
+
+  // Rewinds the list so that the allocated chunks are reused by the following
+  // Alloc() calls, and releases the chunks beyond |max_chunks|.  The objects
+  // are neither destructed nor constructed again; callers need to
+  // reinitialize them.
+  void Recycle(size_t max_chunks) {
+    for (size_t i = max_chunks; i < pool_.size(); ++i) {
       delete[] pool_[i];
     }
-    if (pool_.size() > 1) {
-      pool_.resize(1);
+    if (pool_.size() > max_chunks) {
+      pool_.resize(max_chunks);
     }
     current_index_ = 0;
     chunk_index_ = 0;
@@ -81,6 +87,9 @@ class FreeList {
 
   size_t size() const { return size_; }
 
+  // Returns the number of objects allocatable without a new chunk.
+  size_t capacity() const { return pool_.size() * (size_ - 1); }
+
  private:
   std::vector<T*> pool_;
   size_t current_index_;
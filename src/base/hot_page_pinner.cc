@@ -0,0 +1,433 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/hot_page_pinner.h"
+
+#ifdef OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // OS_LINUX
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "base/executor.h"
+#include "base/logging.h"
+#include "base/singleton.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+// An accessed page gains kHitScore and every score decays by 1/8 (rounded up
+// so that it reaches zero) per profile, so the score of a page accessed in
+// every period converges to 8 * kHitScore.
+constexpr uint16_t kHitScore = 1024;
+constexpr uint16_t kMaxScore = 8 * kHitScore;
+
+size_t GetPageSize() {
+#ifdef OS_LINUX
+  const long page_size = sysconf(_SC_PAGESIZE);  // NOLINT
+  if (page_size > 0) {
+    return static_cast<size_t>(page_size);
+  }
+#endif  // OS_LINUX
+  return 4096;
+}
+
+void *PageAddress(uintptr_t begin, size_t page, size_t page_size) {
+  return reinterpret_cast<void *>(begin + page * page_size);
+}
+
+}  // namespace
+
+std::atomic<int> HotPagePinner::num_active_regions_ = 0;
+
+HotPagePinner::HotPagePinner() : page_size_(GetPageSize()) {}
+
+HotPagePinner::~HotPagePinner() {
+  StopPinning();
+  UnpinAll();
+  absl::MutexLock lock(&mutex_);
+  num_active_regions_.fetch_sub(regions_.size(), std::memory_order_relaxed);
+  regions_.clear();
+}
+
+// static
+HotPagePinner *HotPagePinner::Get() { return Singleton<HotPagePinner>::get(); }
+
+// static
+bool HotPagePinner::IsSupported() {
+#ifdef OS_LINUX
+  return true;
+#else   // OS_LINUX
+  return false;
+#endif  // OS_LINUX
+}
+
+void HotPagePinner::set_max_pinned_bytes(size_t max_pinned_bytes) {
+  absl::MutexLock lock(&mutex_);
+  max_pinned_bytes_ = max_pinned_bytes;
+}
+
+HotPagePinner::RegionId HotPagePinner::AddRegion(absl::string_view name,
+                                                 absl::string_view data,
+                                                 bool advise_huge_pages) {
+  if (data.empty()) {
+    return 0;
+  }
+  const uintptr_t address = reinterpret_cast<uintptr_t>(data.data());
+  Region region;
+  region.name = std::string(name);
+  region.data_begin = address;
+  region.data_end = address + data.size();
+  region.begin = address - address % page_size_;
+  region.num_pages =
+      (region.data_end - region.begin + page_size_ - 1) / page_size_;
+  region.scores.resize(region.num_pages, 0);
+  region.accessed.resize(region.num_pages, false);
+  region.pinned.resize(region.num_pages, false);
+
+#if defined(OS_LINUX) && defined(MADV_HUGEPAGE)
+  if (advise_huge_pages &&
+      madvise(reinterpret_cast<void *>(region.begin),
+              region.num_pages * page_size_, MADV_HUGEPAGE) != 0) {
+    VLOG(1) << "MADV_HUGEPAGE is not applied to " << name;
+  }
+#endif  // OS_LINUX && MADV_HUGEPAGE
+
+  absl::MutexLock lock(&mutex_);
+  region.id = next_region_id_++;
+  regions_.push_back(std::move(region));
+  num_active_regions_.fetch_add(1, std::memory_order_relaxed);
+  return regions_.back().id;
+}
+
+void HotPagePinner::RemoveRegion(RegionId id) {
+  Executor::TaskHandle task;
+  {
+    absl::MutexLock pin_lock(&pin_mutex_);
+    std::vector<PageRun> runs;
+    {
+      absl::MutexLock lock(&mutex_);
+      auto it = std::find_if(
+          regions_.begin(), regions_.end(),
+          [id](const Region &region) { return region.id == id; });
+      if (it == regions_.end()) {
+        return;
+      }
+      UnpinLocked(it - regions_.begin(), &runs);
+      regions_.erase(it);
+      num_active_regions_.fetch_sub(1, std::memory_order_relaxed);
+      if (regions_.empty()) {
+        // Stops the task before the shared executor is shut down, as the
+        // engines are destroyed before it.
+        started_ = false;
+        task = task_;
+        task_ = Executor::TaskHandle();
+      }
+    }
+    // The data is valid until this function returns.
+    Munlock(runs);
+  }
+  task.Cancel();
+  task.Wait();
+}
+
+void HotPagePinner::RecordAccess(const void *address) {
+  const uintptr_t value = reinterpret_cast<uintptr_t>(address);
+  absl::MutexLock lock(&mutex_);
+  for (Region &region : regions_) {
+    if (region.data_begin <= value && value < region.data_end) {
+      region.accessed[(value - region.begin) / page_size_] = true;
+      return;
+    }
+  }
+}
+
+size_t HotPagePinner::RecordProfile() {
+  absl::MutexLock lock(&mutex_);
+  size_t num_accessed = 0;
+  for (Region &region : regions_) {
+    for (size_t i = 0; i < region.num_pages; ++i) {
+      // Pinned pages decay as well, so that they are unpinned when they are
+      // no longer accessed.
+      uint16_t &score = region.scores[i];
+      score -= (score + 7) >> 3;
+      if (region.accessed[i]) {
+        score += kHitScore;
+        ++num_accessed;
+      }
+    }
+    std::fill(region.accessed.begin(), region.accessed.end(), false);
+  }
+  return num_accessed;
+}
+
+size_t HotPagePinner::Pin() {
+#ifdef OS_LINUX
+  absl::MutexLock pin_lock(&pin_mutex_);
+  std::vector<PageRun> lock_runs, unlock_runs;
+  {
+    absl::MutexLock lock(&mutex_);
+
+    // (score, region index, page index) of the pages with positive scores.
+    std::vector<std::tuple<uint16_t, size_t, size_t>> pages;
+    for (size_t r = 0; r < regions_.size(); ++r) {
+      const Region &region = regions_[r];
+      for (size_t i = 0; i < region.num_pages; ++i) {
+        if (region.scores[i] > 0) {
+          pages.emplace_back(region.scores[i], r, i);
+        }
+      }
+    }
+    const size_t max_pages = max_pinned_bytes_ / page_size_;
+    if (pages.size() > max_pages) {
+      std::nth_element(pages.begin(), pages.begin() + max_pages, pages.end(),
+                       [](const auto &lhs, const auto &rhs) {
+                         return std::get<0>(lhs) > std::get<0>(rhs);
+                       });
+      pages.resize(max_pages);
+    }
+
+    std::vector<std::vector<bool>> selected(regions_.size());
+    for (size_t r = 0; r < regions_.size(); ++r) {
+      selected[r].resize(regions_[r].num_pages, false);
+    }
+    for (const auto &[score, r, i] : pages) {
+      selected[r][i] = true;
+    }
+
+    // Locks and unlocks runs of consecutive pages to reduce system calls.
+    for (size_t r = 0; r < regions_.size(); ++r) {
+      Region &region = regions_[r];
+      size_t i = 0;
+      while (i < region.num_pages) {
+        const bool lock = selected[r][i];
+        if (lock == region.pinned[i]) {
+          ++i;
+          continue;
+        }
+        size_t end = i + 1;
+        while (end < region.num_pages && selected[r][end] == lock &&
+               region.pinned[end] != lock) {
+          ++end;
+        }
+        const PageRun run = {r, i, end,
+                             PageAddress(region.begin, i, page_size_),
+                             (end - i) * page_size_};
+        if (lock) {
+          lock_runs.push_back(run);
+        } else {
+          std::fill(region.pinned.begin() + i, region.pinned.begin() + end,
+                    false);
+          num_pinned_pages_ -= end - i;
+          unlock_runs.push_back(run);
+        }
+        i = end;
+      }
+    }
+  }
+
+  // mlock faults the pages in, so it may take long.
+  Munlock(unlock_runs);
+  std::vector<PageRun> locked_runs;
+  for (const PageRun &run : lock_runs) {
+    if (mlock(run.address, run.length) == 0) {
+      locked_runs.push_back(run);
+    } else {
+      VLOG(1) << "mlock failed: " << strerror(errno);
+    }
+  }
+
+  absl::MutexLock lock(&mutex_);
+  for (const PageRun &run : locked_runs) {
+    Region &region = regions_[run.region_index];
+    std::fill(region.pinned.begin() + run.begin,
+              region.pinned.begin() + run.end, true);
+    num_pinned_pages_ += run.end - run.begin;
+  }
+  return num_pinned_pages_ * page_size_;
+#else   // OS_LINUX
+  return 0;
+#endif  // OS_LINUX
+}
+
+void HotPagePinner::StartPinning(absl::Duration interval) {
+  absl::MutexLock lock(&mutex_);
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  task_ = Executor::Get()->PostRepeating(
+      [this]() {
+        RecordProfile();
+        const size_t pinned_bytes = Pin();
+        VLOG(1) << "Pinned hot pages: " << pinned_bytes << " bytes";
+      },
+      interval, interval, Executor::LOW);
+}
+
+void HotPagePinner::StopPinning() {
+  Executor::TaskHandle task;
+  {
+    absl::MutexLock lock(&mutex_);
+    started_ = false;
+    task = task_;
+    task_ = Executor::TaskHandle();
+  }
+  task.Cancel();
+  task.Wait();
+}
+
+void HotPagePinner::UnpinAll() {
+  absl::MutexLock pin_lock(&pin_mutex_);
+  std::vector<PageRun> runs;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (size_t r = 0; r < regions_.size(); ++r) {
+      UnpinLocked(r, &runs);
+    }
+  }
+  Munlock(runs);
+}
+
+void HotPagePinner::UnpinLocked(size_t region_index,
+                                std::vector<PageRun> *runs) {
+  Region &region = regions_[region_index];
+  size_t i = 0;
+  while (i < region.num_pages) {
+    if (!region.pinned[i]) {
+      ++i;
+      continue;
+    }
+    size_t end = i + 1;
+    while (end < region.num_pages && region.pinned[end]) {
+      ++end;
+    }
+    std::fill(region.pinned.begin() + i, region.pinned.begin() + end, false);
+    num_pinned_pages_ -= end - i;
+    runs->push_back({region_index, i, end,
+                     PageAddress(region.begin, i, page_size_),
+                     (end - i) * page_size_});
+    i = end;
+  }
+}
+
+// static
+void HotPagePinner::Munlock(const std::vector<PageRun> &runs) {
+#ifdef OS_LINUX
+  for (const PageRun &run : runs) {
+    munlock(run.address, run.length);
+  }
+#endif  // OS_LINUX
+}
+
+size_t HotPagePinner::pinned_bytes() const {
+  absl::MutexLock lock(&mutex_);
+  return num_pinned_pages_ * page_size_;
+}
+
+// The profile has a line for each region:
+//   <name> TAB <number of pages> TAB <page>:<score>,<page>:<score>,...
+std::string HotPagePinner::SerializeProfile() const {
+  absl::MutexLock lock(&mutex_);
+  std::string profile;
+  for (const Region &region : regions_) {
+    absl::StrAppend(&profile, region.name, "\t", region.num_pages, "\t");
+    absl::string_view separator = "";
+    for (size_t i = 0; i < region.num_pages; ++i) {
+      if (region.scores[i] > 0) {
+        absl::StrAppend(&profile, separator, i, ":", region.scores[i]);
+        separator = ",";
+      }
+    }
+    profile.append("\n");
+  }
+  return profile;
+}
+
+bool HotPagePinner::ParseProfile(absl::string_view profile) {
+  absl::MutexLock lock(&mutex_);
+  for (absl::string_view line :
+       absl::StrSplit(profile, '\n', absl::SkipEmpty())) {
+    const std::vector<absl::string_view> fields = absl::StrSplit(line, '\t');
+    size_t num_pages = 0;
+    if (fields.size() != 3 || !absl::SimpleAtoi(fields[1], &num_pages)) {
+      LOG(WARNING) << "Broken hot page profile";
+      return false;
+    }
+    std::vector<std::pair<size_t, uint16_t>> page_scores;
+    for (absl::string_view entry :
+         absl::StrSplit(fields[2], ',', absl::SkipEmpty())) {
+      const std::pair<absl::string_view, absl::string_view> page_score =
+          absl::StrSplit(entry, ':');
+      size_t page = 0;
+      uint32_t score = 0;
+      if (!absl::SimpleAtoi(page_score.first, &page) ||
+          !absl::SimpleAtoi(page_score.second, &score) || page >= num_pages) {
+        LOG(WARNING) << "Broken hot page profile";
+        return false;
+      }
+      page_scores.emplace_back(
+          page, static_cast<uint16_t>(std::min<uint32_t>(score, kMaxScore)));
+    }
+    // The profile is applied to all the regions of the same data, e.g. of
+    // the engines before and after a reload.
+    bool applied = false;
+    for (Region &region : regions_) {
+      if (region.name != fields[0] || region.num_pages != num_pages) {
+        continue;
+      }
+      for (const auto &[page, score] : page_scores) {
+        region.scores[page] = score;
+      }
+      applied = true;
+    }
+    if (!applied) {
+      VLOG(1) << "Hot page profile for " << fields[0] << " is skipped";
+    }
+  }
+  return true;
+}
+
+}  // namespace mozc
@@ -0,0 +1,187 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_HOT_PAGE_PINNER_H_
+#define MOZC_BASE_HOT_PAGE_PINNER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/executor.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+
+// Keeps the frequently accessed pages of read-only data, e.g. the system
+// dictionary and the connection matrix, in memory so that the first key
+// event after an idle period doesn't wait for page faults.
+//
+// The readers of the data report their accesses with SampleAccess(), which
+// records one in kAccessSamplingInterval calls on each thread.  On every
+// RecordProfile(), each page decays its score by 1/8 and gains a fixed score
+// if it was accessed since the previous one.  Pin() mlocks the pages with the
+// highest scores within the byte budget, and unpins the pages which are no
+// longer among them, including pinned pages which are not accessed any more.
+// The profile can be saved and restored so that the hot pages are pinned
+// right after startup.
+//
+// The process-wide instance returned by Get() is shared by all the engines,
+// so that the budget is not multiplied by the number of the engines, e.g.
+// while a new engine is being built.
+//
+// Pinning is only implemented on Linux.  On other platforms Pin() does
+// nothing.
+class HotPagePinner {
+ public:
+  using RegionId = int;
+
+  static constexpr uint32_t kAccessSamplingInterval = 64;
+
+  HotPagePinner();
+  ~HotPagePinner();
+
+  HotPagePinner(const HotPagePinner &) = delete;
+  HotPagePinner &operator=(const HotPagePinner &) = delete;
+
+  // Returns the process-wide instance.
+  static HotPagePinner *Get();
+
+  static bool IsSupported();
+
+  // Records an access to |address| in the process-wide instance, sampling one
+  // in kAccessSamplingInterval calls on each thread.  This is cheap enough to
+  // be called on every lookup of the data.
+  static void SampleAccess(const void *address) {
+    thread_local uint32_t count = 0;
+    if ((++count % kAccessSamplingInterval) != 0 ||
+        num_active_regions_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    Get()->RecordAccess(address);
+  }
+
+  // Maximum number of bytes to pin.
+  void set_max_pinned_bytes(size_t max_pinned_bytes);
+
+  // Registers a region of read-only data.  |data| must be valid until the
+  // region is removed.  Transparent huge pages are advised for the region if
+  // |advise_huge_pages| is true, which only takes effect when the kernel
+  // supports huge pages for the backing memory.
+  RegionId AddRegion(absl::string_view name, absl::string_view data,
+                     bool advise_huge_pages = false);
+
+  // Unpins the pages of the region and removes it.  The task started by
+  // StartPinning() is stopped when no region remains.
+  void RemoveRegion(RegionId id);
+
+  // Records an access to |address| if it is in one of the regions.
+  void RecordAccess(const void *address);
+
+  // Updates the scores of the pages with the accesses recorded since the
+  // previous call.  Returns the number of the accessed pages.
+  size_t RecordProfile();
+
+  // Pins the hot pages and unpins the pages which are no longer hot.  Returns
+  // the number of pinned bytes.
+  size_t Pin();
+
+  // Runs RecordProfile() and Pin() every |interval| as a LOW priority task
+  // of the shared executor.  Does nothing if it is already started.
+  void StartPinning(absl::Duration interval);
+
+  // Cancels the task started by StartPinning() and waits for it.
+  void StopPinning();
+
+  void UnpinAll();
+
+  size_t pinned_bytes() const;
+
+  // Serializes the scores of the pages.  ParseProfile() ignores the regions
+  // whose names or sizes don't match, e.g. after the data is updated.
+  std::string SerializeProfile() const;
+  bool ParseProfile(absl::string_view profile);
+
+ private:
+  struct Region {
+    RegionId id = 0;
+    std::string name;
+    // Address range of the data, and the page aligned address and the number
+    // of pages of the region.
+    uintptr_t data_begin = 0;
+    uintptr_t data_end = 0;
+    uintptr_t begin = 0;
+    size_t num_pages = 0;
+    std::vector<uint16_t> scores;
+    std::vector<bool> accessed;
+    std::vector<bool> pinned;
+  };
+
+  // Pages [begin, end) of regions_[region_index] to lock or unlock, and
+  // their address range.
+  struct PageRun {
+    size_t region_index = 0;
+    size_t begin = 0;
+    size_t end = 0;
+    void *address = nullptr;
+    size_t length = 0;
+  };
+
+  // Marks the pages of regions_[region_index] unpinned, and appends the runs
+  // of the pages to munlock to |runs|.
+  void UnpinLocked(size_t region_index, std::vector<PageRun> *runs)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pin_mutex_, mutex_);
+  static void Munlock(const std::vector<PageRun> &runs);
+
+  // Total number of the regions of all the instances.  SampleAccess() does
+  // nothing while it is zero.
+  static std::atomic<int> num_active_regions_;
+
+  const size_t page_size_;
+  // Serializes mlock and munlock, which are called without |mutex_| so that
+  // RecordAccess() doesn't wait for them.  Regions are removed only while it
+  // is held, so that the indices of regions_ don't change meanwhile.
+  absl::Mutex pin_mutex_ ABSL_ACQUIRED_BEFORE(mutex_);
+  mutable absl::Mutex mutex_;
+  size_t max_pinned_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<Region> regions_ ABSL_GUARDED_BY(mutex_);
+  RegionId next_region_id_ ABSL_GUARDED_BY(mutex_) = 1;
+  size_t num_pinned_pages_ ABSL_GUARDED_BY(mutex_) = 0;
+  Executor::TaskHandle task_ ABSL_GUARDED_BY(mutex_);
+  bool started_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_HOT_PAGE_PINNER_H_
@@ -0,0 +1,198 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/hot_page_pinner.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "testing/base/public/gunit.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+constexpr size_t kPageSize = 4096;
+constexpr size_t kNumPages = 64;
+
+TEST(HotPagePinnerTest, PinAccessedPagesWithinBudget) {
+  std::unique_ptr<char[]> buffer(new char[kNumPages * kPageSize]);
+  const absl::string_view data(buffer.get(), kNumPages * kPageSize);
+
+  HotPagePinner pinner;
+  pinner.set_max_pinned_bytes(2 * kPageSize);
+  pinner.AddRegion("data", data);
+
+  // Pages 3 and 10 are accessed in every period, and page 20 only once.
+  pinner.RecordAccess(&buffer[3 * kPageSize]);
+  pinner.RecordAccess(&buffer[10 * kPageSize]);
+  pinner.RecordAccess(&buffer[20 * kPageSize]);
+  // Out of the region.
+  pinner.RecordAccess(buffer.get() + kNumPages * kPageSize);
+  EXPECT_EQ(3, pinner.RecordProfile());
+  for (int i = 0; i < 3; ++i) {
+    pinner.RecordAccess(&buffer[3 * kPageSize]);
+    pinner.RecordAccess(&buffer[10 * kPageSize]);
+    EXPECT_EQ(2, pinner.RecordProfile());
+  }
+
+  if (!HotPagePinner::IsSupported()) {
+    EXPECT_EQ(0, pinner.Pin());
+    return;
+  }
+  const size_t pinned_bytes = pinner.Pin();
+  EXPECT_LE(pinned_bytes, 2 * kPageSize);
+  EXPECT_EQ(pinned_bytes, pinner.pinned_bytes());
+
+  pinner.UnpinAll();
+  EXPECT_EQ(0, pinner.pinned_bytes());
+}
+
+TEST(HotPagePinnerTest, PinnedPagesDecay) {
+  if (!HotPagePinner::IsSupported()) {
+    return;
+  }
+  std::unique_ptr<char[]> buffer(new char[kNumPages * kPageSize]);
+  const absl::string_view data(buffer.get(), kNumPages * kPageSize);
+
+  HotPagePinner pinner;
+  pinner.set_max_pinned_bytes(kNumPages * kPageSize);
+  pinner.AddRegion("data", data);
+  pinner.RecordAccess(&buffer[5 * kPageSize]);
+  pinner.RecordProfile();
+  const size_t pinned_bytes = pinner.Pin();
+  if (pinned_bytes == 0) {
+    // mlock is not permitted in this environment.
+    return;
+  }
+  EXPECT_EQ(kPageSize, pinned_bytes);
+
+  // The page is unpinned when it is no longer accessed.
+  for (int i = 0; i < 100 && pinner.Pin() > 0; ++i) {
+    pinner.RecordProfile();
+  }
+  EXPECT_EQ(0, pinner.pinned_bytes());
+}
+
+TEST(HotPagePinnerTest, RemoveRegion) {
+  if (!HotPagePinner::IsSupported()) {
+    return;
+  }
+  std::unique_ptr<char[]> buffer(new char[kNumPages * kPageSize]);
+  const absl::string_view data(buffer.get(), kNumPages * kPageSize);
+
+  HotPagePinner pinner;
+  pinner.set_max_pinned_bytes(kNumPages * kPageSize);
+  const HotPagePinner::RegionId id = pinner.AddRegion("data", data);
+  pinner.StartPinning(absl::Hours(1));
+  pinner.RecordAccess(&buffer[5 * kPageSize]);
+  pinner.RecordAccess(&buffer[6 * kPageSize]);
+  pinner.RecordAccess(&buffer[9 * kPageSize]);
+  pinner.RecordProfile();
+  if (pinner.Pin() == 0) {
+    // mlock is not permitted in this environment.
+    return;
+  }
+  EXPECT_EQ(3 * kPageSize, pinner.pinned_bytes());
+
+  // Removing the last region unpins its pages and stops the task.
+  pinner.RemoveRegion(id);
+  EXPECT_EQ(0, pinner.pinned_bytes());
+  pinner.StopPinning();
+}
+
+TEST(HotPagePinnerTest, SharedBudget) {
+  if (!HotPagePinner::IsSupported()) {
+    return;
+  }
+  std::unique_ptr<char[]> buffer1(new char[kNumPages * kPageSize]);
+  std::unique_ptr<char[]> buffer2(new char[kNumPages * kPageSize]);
+
+  // The regions of two engines, e.g. before and after a reload, share the
+  // budget of one pinner.
+  HotPagePinner pinner;
+  pinner.set_max_pinned_bytes(4 * kPageSize);
+  const HotPagePinner::RegionId id1 = pinner.AddRegion(
+      "data", absl::string_view(buffer1.get(), kNumPages * kPageSize));
+  const HotPagePinner::RegionId id2 = pinner.AddRegion(
+      "data", absl::string_view(buffer2.get(), kNumPages * kPageSize));
+  EXPECT_NE(id1, id2);
+  for (size_t i = 0; i < kNumPages; i += 4) {
+    pinner.RecordAccess(&buffer1[i * kPageSize]);
+    pinner.RecordAccess(&buffer2[i * kPageSize]);
+  }
+  pinner.RecordProfile();
+  EXPECT_LE(pinner.Pin(), 4 * kPageSize);
+
+  pinner.RemoveRegion(id1);
+  pinner.RemoveRegion(id2);
+  EXPECT_EQ(0, pinner.pinned_bytes());
+}
+
+TEST(HotPagePinnerTest, SampleAccess) {
+  std::unique_ptr<char[]> buffer(new char[kNumPages * kPageSize]);
+  HotPagePinner *pinner = HotPagePinner::Get();
+  const HotPagePinner::RegionId id = pinner->AddRegion(
+      "data", absl::string_view(buffer.get(), kNumPages * kPageSize));
+  for (int i = 0; i < HotPagePinner::kAccessSamplingInterval; ++i) {
+    HotPagePinner::SampleAccess(&buffer[7 * kPageSize]);
+  }
+  EXPECT_EQ(1, pinner->RecordProfile());
+  pinner->RemoveRegion(id);
+}
+
+TEST(HotPagePinnerTest, SerializeProfile) {
+  std::unique_ptr<char[]> buffer(new char[kNumPages * kPageSize]);
+  const absl::string_view data(buffer.get(), kNumPages * kPageSize);
+
+  HotPagePinner pinner;
+  pinner.AddRegion("data", data);
+  pinner.RecordAccess(&buffer[5 * kPageSize]);
+  pinner.RecordProfile();
+  const std::string profile = pinner.SerializeProfile();
+
+  HotPagePinner restored;
+  restored.AddRegion("data", data);
+  EXPECT_TRUE(restored.ParseProfile(profile));
+  EXPECT_EQ(profile, restored.SerializeProfile());
+
+  // Regions with a different size are skipped.
+  HotPagePinner resized;
+  resized.AddRegion("data", data.substr(0, data.size() / 2));
+  const std::string empty_profile = resized.SerializeProfile();
+  EXPECT_TRUE(resized.ParseProfile(profile));
+  EXPECT_EQ(empty_profile, resized.SerializeProfile());
+
+  EXPECT_FALSE(restored.ParseProfile("data\tbroken\n"));
+}
+
+}  // namespace
+}  // namespace mozc
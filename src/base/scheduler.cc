@@ -31,106 +31,35 @@
 
 #include <cstdint>
 #include <cstdlib>
-#include <functional>
 #include <map>
 #include <string>
 #include <utility>
 
 #include "base/clock.h"
+#include "base/executor.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
-#include "base/thread.h"
-#include "base/unnamed_event.h"
 #include "base/util.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 namespace {
 
-class TimerThread final : public Thread {
- public:
-  TimerThread(std::function<void()> callback, uint32_t due_time,
-              uint32_t interval)
-      : callback_(callback), due_time_(due_time), interval_(interval) {
-    CHECK(due_time_ != 0 || interval_ != 0)
-        << "Either of due_time or interval must be non 0.";
-  }
-
-  ~TimerThread() override {
-    SignalQuit();
-    Join();
-  }
-
-  void Run() override {
-    if (event_.Wait(due_time_)) {
-      VLOG(1) << "Received notification event";
-      return;
-    }
-
-    VLOG(2) << "call TimerCallback()";
-    callback_();
-
-    if (interval_ == 0) {
-      VLOG(2) << "Run() end";
-      return;
-    }
-
-    while (true) {
-      if (event_.Wait(interval_)) {
-        VLOG(1) << "Received notification event";
-        return;
-      }
-      VLOG(2) << "call TimerCallback()";
-      callback_();
-    }
-  }
-
- private:
-  void SignalQuit() {
-    const bool result = event_.Notify();
-    DCHECK(result);
-  }
-
-  std::function<void()> callback_;
-
-  // The amount of time to elapse before the timer is to be set to the
-  // signaled state for the first time, in milliseconds.
-  uint32_t due_time_;
-
-  // The period of the timer, in milliseconds. If this is zero, the
-  // timer is one-shot timer. If this is greater than zero, the timer
-  // is periodic.
-  uint32_t interval_;
-
-  UnnamedEvent event_;
-
-  DISALLOW_COPY_AND_ASSIGN(TimerThread);
-};
-
-class QueueTimer final {
- public:
-  QueueTimer(std::function<void()> callback, uint32_t due_time, uint32_t period)
-      : timer_thread_(callback, due_time, period) {}
-
-  void Start() { timer_thread_.Start("QueueTimer"); }
-
- private:
-  TimerThread timer_thread_;
-
-  DISALLOW_COPY_AND_ASSIGN(QueueTimer);
-};
-
 class Job {
  public:
   explicit Job(const Scheduler::JobSetting &setting)
       : setting_(setting),
         skip_count_(0),
         backoff_count_(0),
-        timer_(nullptr),
         running_(false) {}
 
-  ~Job() { set_timer(nullptr); }
+  ~Job() {
+    // Waits for the running callback, as the callback refers to this job.
+    timer_.Cancel();
+    timer_.Wait();
+  }
 
   const Scheduler::JobSetting setting() const { return setting_; }
 
@@ -144,16 +73,7 @@ class Job {
 
   uint32_t backoff_count() const { return backoff_count_; }
 
-  void set_timer(QueueTimer *timer) {
-    if (timer_ != nullptr) {
-      delete timer_;
-    }
-    timer_ = timer;
-  }
-
-  const QueueTimer *timer() const { return timer_; }
-
-  QueueTimer *mutable_timer() { return timer_; }
+  void set_timer(Executor::TaskHandle timer) { timer_ = std::move(timer); }
 
   void set_running(bool running) { running_ = running; }
 
@@ -163,7 +83,7 @@ class Job {
   Scheduler::JobSetting setting_;
   uint32_t skip_count_;
   uint32_t backoff_count_;
-  QueueTimer *timer_;
+  Executor::TaskHandle timer_;
   bool running_;
 
   // TODO(hsumita): Use DISALLOW_COPY_AND_ASSIGN(Job).
@@ -209,15 +129,11 @@ class SchedulerImpl : public Scheduler::SchedulerInterface {
     DCHECK(job);
 
     const uint32_t delay = CalcDelay(job_setting);
-    // DON'T copy job instance after set_timer() not to delete timer twice.
+    // DON'T copy job instance after set_timer() as the timer refers to it.
     // TODO(hsumita): Make Job class uncopiable.
-    job->set_timer(new QueueTimer(std::bind(TimerCallback, job), delay,
-                                  job_setting.default_interval()));
-    if (job->timer() == nullptr) {
-      LOG(ERROR) << "failed to create QueueTimer";
-      return false;
-    }
-    job->mutable_timer()->Start();
+    job->set_timer(Executor::Get()->PostRepeating(
+        [job]() { TimerCallback(job); }, absl::Milliseconds(delay),
+        absl::Milliseconds(job_setting.default_interval()), Executor::LOW));
     return true;
   }
 
@@ -29,9 +29,12 @@
 
 #include "base/serialized_string_array.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/file_util.h"
@@ -45,6 +48,29 @@ namespace {
 
 constexpr uint32_t kEmptyArrayData = 0x00000000;
 
+size_t AlignTo4Bytes(size_t offset) { return (offset + 3) & ~size_t{3}; }
+
+// Returns the byte offset of the hash index, i.e., the first 4 byte boundary
+// after the strings chunk.  |data| must be a valid array image.
+size_t GetHashIndexOffset(absl::string_view data) {
+  const uint32_t *u32_array = reinterpret_cast<const uint32_t *>(data.data());
+  const uint32_t size = u32_array[0];
+  if (size == 0) {
+    return 4;
+  }
+  return AlignTo4Bytes(u32_array[2 * size - 1] + u32_array[2 * size] + 1);
+}
+
+// Returns the number of buckets for |size| strings.  The load factor is kept
+// at most 1/2 so that probing sequences are short.
+uint32_t GetNumBuckets(size_t size) {
+  uint32_t num_buckets = 2;
+  while (num_buckets < 2 * size) {
+    num_buckets *= 2;
+  }
+  return num_buckets;
+}
+
 }  // namespace
 
 SerializedStringArray::SerializedStringArray() {
@@ -58,6 +84,7 @@ bool SerializedStringArray::Init(
     absl::string_view data_aligned_at_4byte_boundary) {
   if (VerifyData(data_aligned_at_4byte_boundary)) {
     data_ = data_aligned_at_4byte_boundary;
+    InitHashIndex();
     return true;
   }
   clear();
@@ -68,11 +95,79 @@ void SerializedStringArray::Set(
     absl::string_view data_aligned_at_4byte_boundary) {
   DCHECK(VerifyData(data_aligned_at_4byte_boundary));
   data_ = data_aligned_at_4byte_boundary;
+  InitHashIndex();
 }
 
 void SerializedStringArray::clear() {
   data_ =
       absl::string_view(reinterpret_cast<const char *>(&kEmptyArrayData), 4);
+  hash_buckets_ = nullptr;
+  hash_mask_ = 0;
+}
+
+void SerializedStringArray::InitHashIndex() {
+  hash_buckets_ = nullptr;
+  hash_mask_ = 0;
+  // Set() may be given an empty block, e.g., for the data not in a data set.
+  if (data_.size() < 4 || data_.size() < 4 + 8 * size()) {
+    return;
+  }
+  const size_t offset = GetHashIndexOffset(data_);
+  if (data_.size() < offset + 8) {
+    return;
+  }
+  const uint32_t *header =
+      reinterpret_cast<const uint32_t *>(data_.data() + offset);
+  if (header[0] != kHashIndexMagic) {
+    return;
+  }
+  hash_buckets_ = header + 2;
+  hash_mask_ = header[1] - 1;
+}
+
+uint32_t SerializedStringArray::Hash(absl::string_view str) {
+  // 32-bit FNV-1a.
+  uint32_t hash = 2166136261u;
+  for (const char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+SerializedStringArray::const_iterator SerializedStringArray::find(
+    absl::string_view key) const {
+  if (hash_buckets_ == nullptr) {
+    const const_iterator iter = std::lower_bound(begin(), end(), key);
+    if (iter == end() || *iter != key) {
+      return end();
+    }
+    return iter;
+  }
+  for (uint32_t bucket = Hash(key) & hash_mask_;;
+       bucket = (bucket + 1) & hash_mask_) {
+    const uint32_t index = hash_buckets_[bucket];
+    if (index == kEmptyBucket) {
+      return end();
+    }
+    if ((*this)[index] == key) {
+      return const_iterator(this, index);
+    }
+  }
+}
+
+std::pair<SerializedStringArray::const_iterator,
+          SerializedStringArray::const_iterator>
+SerializedStringArray::equal_range(absl::string_view key) const {
+  if (hash_buckets_ == nullptr) {
+    return std::equal_range(begin(), end(), key);
+  }
+  const const_iterator first = find(key);
+  const_iterator last = first;
+  while (last != end() && *last == key) {
+    ++last;
+  }
+  return std::make_pair(first, last);
 }
 
 bool SerializedStringArray::VerifyData(absl::string_view data) {
@@ -111,12 +206,40 @@ bool SerializedStringArray::VerifyData(absl::string_view data) {
     prev_str_end = offset + len + 1;
   }
 
+  // Verify the hash index if exists.  Other trailing bytes are ignored.
+  const size_t index_offset = GetHashIndexOffset(data);
+  if (data.size() < index_offset + 8) {
+    return true;
+  }
+  const uint32_t *header =
+      reinterpret_cast<const uint32_t *>(data.data() + index_offset);
+  if (header[0] != kHashIndexMagic) {
+    return true;
+  }
+  const uint32_t num_buckets = header[1];
+  if (num_buckets == 0 || (num_buckets & (num_buckets - 1)) != 0 ||
+      num_buckets <= size) {
+    LOG(ERROR) << "Invalid number of hash buckets: " << num_buckets;
+    return false;
+  }
+  if ((data.size() - index_offset - 8) / 4 < num_buckets) {
+    LOG(ERROR) << "Lack of data for " << num_buckets << " hash buckets";
+    return false;
+  }
+  for (uint32_t i = 0; i < num_buckets; ++i) {
+    if (header[2 + i] != kEmptyBucket && header[2 + i] >= size) {
+      LOG(ERROR) << "Invalid index in hash bucket " << i << ": "
+                 << header[2 + i];
+      return false;
+    }
+  }
+
   return true;
 }
 
 absl::string_view SerializedStringArray::SerializeToBuffer(
     const std::vector<absl::string_view> &strs,
-    std::unique_ptr<uint32_t[]> *buffer) {
+    std::unique_ptr<uint32_t[]> *buffer, bool build_hash_index) {
   const size_t header_byte_size = 4 * (1 + 2 * strs.size());
 
   // Calculate the offsets of each string.
@@ -129,9 +252,17 @@ absl::string_view SerializedStringArray::SerializeToBuffer(
     current_offset += strs[i].size() + 1;
   }
 
-  // At this point, |current_offset| is the byte length of the whole binary
-  // image.  Allocate a necessary buffer as uint32 array.
-  buffer->reset(new uint32_t[(current_offset + 3) / 4]);
+  // At this point, |current_offset| is the byte length of the strings chunk.
+  // The hash index follows it at 4 byte boundary.
+  const size_t index_offset = AlignTo4Bytes(current_offset);
+  const uint32_t num_buckets = build_hash_index ? GetNumBuckets(strs.size()) : 0;
+  if (build_hash_index) {
+    current_offset = index_offset + 4 * (2 + num_buckets);
+  }
+
+  // Now |current_offset| is the byte length of the whole binary image.
+  // Allocate a necessary buffer as uint32 array.
+  buffer->reset(new uint32_t[(current_offset + 3) / 4]());
 
   (*buffer)[0] = static_cast<uint32_t>(strs.size());
   for (size_t i = 0; i < strs.size(); ++i) {
@@ -146,14 +277,36 @@ absl::string_view SerializedStringArray::SerializeToBuffer(
     dest[strs[i].size()] = '\0';
   }
 
+  if (build_hash_index) {
+    uint32_t *header = buffer->get() + index_offset / 4;
+    header[0] = kHashIndexMagic;
+    header[1] = num_buckets;
+    uint32_t *buckets = header + 2;
+    std::fill(buckets, buckets + num_buckets, kEmptyBucket);
+    const uint32_t mask = num_buckets - 1;
+    for (size_t i = 0; i < strs.size(); ++i) {
+      uint32_t bucket = Hash(strs[i]) & mask;
+      for (; buckets[bucket] != kEmptyBucket; bucket = (bucket + 1) & mask) {
+        if (strs[buckets[bucket]] == strs[i]) {
+          break;
+        }
+      }
+      if (buckets[bucket] == kEmptyBucket) {
+        buckets[bucket] = static_cast<uint32_t>(i);
+      }
+    }
+  }
+
   return absl::string_view(reinterpret_cast<const char *>(buffer->get()),
                            current_offset);
 }
 
 void SerializedStringArray::SerializeToFile(
-    const std::vector<absl::string_view> &strs, const std::string &filepath) {
+    const std::vector<absl::string_view> &strs, const std::string &filepath,
+    bool build_hash_index) {
   std::unique_ptr<uint32_t[]> buffer;
-  const absl::string_view data = SerializeToBuffer(strs, &buffer);
+  const absl::string_view data =
+      SerializeToBuffer(strs, &buffer, build_hash_index);
   CHECK_OK(FileUtil::SetContents(filepath, data));
 }
 
@@ -104,6 +104,30 @@ namespace mozc {
 // + - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - +
 // | '\0'           (1 byte)                                             |
 // +=====================================================================+
+//
+// * Hash index (optional)
+// The strings chunk may be followed by a hash index that finds the smallest
+// index of a given string in O(1); see find().  The hash index starts at the
+// first 4 byte boundary after the last '\0':
+//
+// +=====================================================================+
+// | Magic number kHashIndexMagic  (4 byte)                              |
+// +---------------------------------------------------------------------+
+// | Number of buckets B, a power of 2  (4 byte)                         |
+// +---------------------------------------------------------------------+
+// | Index of the string in bucket[0]  (4 byte, 0xFFFFFFFF if empty)    |
+// +---------------------------------------------------------------------+
+// |                      .                                              |
+// |                      .                                              |
+// |                      .                                              |
+// +---------------------------------------------------------------------+
+// | Index of the string in bucket[B - 1]  (4 byte)                      |
+// +=====================================================================+
+//
+// A string s is stored in the first empty bucket of Hash(s) % B, Hash(s) % B +
+// 1, ... (linear probing), where Hash() is 32-bit FNV-1a.  Only the first one
+// of equal strings is stored.  Since VerifyData() accepts trailing bytes, the
+// hash index is transparent to the code that doesn't use it.
 class SerializedStringArray {
  public:
   class iterator {
@@ -248,6 +272,18 @@ class SerializedStringArray {
   absl::string_view data() const { return data_; }
   void clear();
 
+  // Returns the iterator to the first string equal to |key|, or end() if not
+  // found.  Uses the hash index if the data has one; otherwise the array must
+  // be sorted, as binary search is performed.
+  const_iterator find(absl::string_view key) const;
+
+  // Returns the range of strings equal to |key|.  Equal strings need to be
+  // adjacent, and the same requirement as find() applies.
+  std::pair<const_iterator, const_iterator> equal_range(
+      absl::string_view key) const;
+
+  bool has_hash_index() const { return hash_buckets_ != nullptr; }
+
   iterator begin() { return iterator(this, 0); }
   iterator end() { return iterator(this, size()); }
   const_iterator begin() const { return const_iterator(this, 0); }
@@ -259,15 +295,28 @@ class SerializedStringArray {
   // Creates a byte image of |strs| in |buffer| and returns the memory block in
   // |buffer| pointing to the image.  Note that uint32 array is used for buffer
   // to align data at 4 byte boundary.
+  // If |build_hash_index| is true, the hash index is appended to the image.
   static absl::string_view SerializeToBuffer(
       const std::vector<absl::string_view> &strs,
-      std::unique_ptr<uint32_t[]> *buffer);
+      std::unique_ptr<uint32_t[]> *buffer, bool build_hash_index = false);
 
   static void SerializeToFile(const std::vector<absl::string_view> &strs,
-                              const std::string &filepath);
+                              const std::string &filepath,
+                              bool build_hash_index = false);
+
+  // The hash function used by the hash index.
+  static uint32_t Hash(absl::string_view str);
+
+  static constexpr uint32_t kHashIndexMagic = 0x58444948;  // "HIDX"
+  static constexpr uint32_t kEmptyBucket = 0xFFFFFFFF;
 
  private:
+  // Sets up |hash_buckets_| and |hash_mask_| from |data_|.
+  void InitHashIndex();
+
   absl::string_view data_;
+  const uint32_t *hash_buckets_ = nullptr;
+  uint32_t hash_mask_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(SerializedStringArray);
 };
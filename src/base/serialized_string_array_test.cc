@@ -35,6 +35,7 @@
 #include <iterator>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "testing/base/public/gunit.h"
@@ -145,5 +146,103 @@ TEST_F(SerializedStringArrayTest, Iterator) {
   EXPECT_FALSE(std::binary_search(a.begin(), a.end(), "Japan"));
 }
 
+TEST_F(SerializedStringArrayTest, FindWithoutHashIndex) {
+  std::unique_ptr<uint32_t[]> buf;
+  const absl::string_view data = SerializedStringArray::SerializeToBuffer(
+      {"a", "b", "b", "c"}, &buf);
+  SerializedStringArray a;
+  ASSERT_TRUE(a.Init(data));
+  EXPECT_FALSE(a.has_hash_index());
+  EXPECT_EQ(0, a.find("a").index());
+  EXPECT_EQ(1, a.find("b").index());
+  EXPECT_EQ(a.end(), a.find("d"));
+  const auto range = a.equal_range("b");
+  EXPECT_EQ(1, range.first.index());
+  EXPECT_EQ(3, range.second.index());
+}
+
+TEST_F(SerializedStringArrayTest, HashIndex) {
+  // The hash index doesn't require the array to be sorted.
+  const std::vector<absl::string_view> strs = {"Mozc", "google", "google",
+                                               "Hello", "", "Japan"};
+  std::unique_ptr<uint32_t[]> buf;
+  const absl::string_view data =
+      SerializedStringArray::SerializeToBuffer(strs, &buf, true);
+  ASSERT_TRUE(SerializedStringArray::VerifyData(data));
+
+  SerializedStringArray a;
+  ASSERT_TRUE(a.Init(data));
+  ASSERT_EQ(strs.size(), a.size());
+  EXPECT_TRUE(a.has_hash_index());
+  for (size_t i = 0; i < strs.size(); ++i) {
+    EXPECT_EQ(strs[i], a[i]);
+  }
+  EXPECT_EQ(0, a.find("Mozc").index());
+  EXPECT_EQ(1, a.find("google").index());
+  EXPECT_EQ(3, a.find("Hello").index());
+  EXPECT_EQ(4, a.find("").index());
+  EXPECT_EQ(5, a.find("Japan").index());
+  EXPECT_EQ(a.end(), a.find("mozc"));
+  EXPECT_EQ(a.end(), a.find("Google"));
+
+  const auto range = a.equal_range("google");
+  EXPECT_EQ(1, range.first.index());
+  EXPECT_EQ(3, range.second.index());
+  const auto empty_range = a.equal_range("Tokyo");
+  EXPECT_EQ(empty_range.first, empty_range.second);
+
+  // Set() also recognizes the hash index.
+  SerializedStringArray b;
+  b.Set(data);
+  EXPECT_TRUE(b.has_hash_index());
+  EXPECT_EQ(5, b.find("Japan").index());
+
+  a.clear();
+  EXPECT_FALSE(a.has_hash_index());
+  EXPECT_EQ(a.end(), a.find("Mozc"));
+}
+
+TEST_F(SerializedStringArrayTest, HashIndexOfEmptyArray) {
+  std::unique_ptr<uint32_t[]> buf;
+  const absl::string_view data =
+      SerializedStringArray::SerializeToBuffer({}, &buf, true);
+  SerializedStringArray a;
+  ASSERT_TRUE(a.Init(data));
+  EXPECT_TRUE(a.has_hash_index());
+  EXPECT_EQ(a.end(), a.find(""));
+}
+
+TEST_F(SerializedStringArrayTest, InvalidHashIndex) {
+  std::unique_ptr<uint32_t[]> buf;
+  const absl::string_view data = SerializedStringArray::SerializeToBuffer(
+      {"Hello", "Mozc", "google"}, &buf, true);
+  std::string image(data);
+  // The strings chunk ends at 46 = 4 + 8 * 3 + 18, so the hash index starts
+  // at 48.
+  ASSERT_EQ(SerializedStringArray::kHashIndexMagic,
+            *reinterpret_cast<const uint32_t *>(image.data() + 48));
+
+  // Index out of range.
+  std::string broken = image;
+  for (size_t i = 56; i < broken.size(); ++i) {
+    broken[i] = 0x7f;
+  }
+  EXPECT_FALSE(SerializedStringArray::VerifyData(AlignString(broken)));
+
+  // Truncated buckets.
+  EXPECT_FALSE(SerializedStringArray::VerifyData(
+      AlignString(image.substr(0, image.size() - 4))));
+
+  // Unknown trailing data is ignored.
+  broken = image;
+  broken[48] = 'X';
+  const absl::string_view unknown = AlignString(broken);
+  EXPECT_TRUE(SerializedStringArray::VerifyData(unknown));
+  SerializedStringArray a;
+  ASSERT_TRUE(a.Init(unknown));
+  EXPECT_FALSE(a.has_hash_index());
+  EXPECT_EQ(1, a.find("Mozc").index());
+}
+
 }  // namespace
 }  // namespace mozc
@@ -33,7 +33,42 @@ import io
 import struct
 
 
-def SerializeToFile(strings, filename):
+_HASH_INDEX_MAGIC = 0x58444948  # "HIDX"
+_EMPTY_BUCKET = 0xFFFFFFFF
+
+
+def _Hash(data):
+  """32-bit FNV-1a, which must be the same as SerializedStringArray::Hash()."""
+  value = 2166136261
+  for byte in data:
+    value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+  return value
+
+
+def _BuildHashIndex(encoded_strings):
+  """Returns the buckets of the hash index for encoded_strings.
+
+  For the format, see base/serialized_string_array.h.
+
+  Args:
+    encoded_strings: A list of byte strings.
+  """
+  num_buckets = 2
+  while num_buckets < 2 * len(encoded_strings):
+    num_buckets *= 2
+  mask = num_buckets - 1
+  buckets = [_EMPTY_BUCKET] * num_buckets
+  for index, data in enumerate(encoded_strings):
+    bucket = _Hash(data) & mask
+    while (buckets[bucket] != _EMPTY_BUCKET and
+           encoded_strings[buckets[bucket]] != data):
+      bucket = (bucket + 1) & mask
+    if buckets[bucket] == _EMPTY_BUCKET:
+      buckets[bucket] = index
+  return buckets
+
+
+def SerializeToFile(strings, filename, build_hash_index=False):
   """Builds a binary image of strings.
 
   For file format, see base/serialized_string_array.h.
@@ -41,6 +76,7 @@ def SerializeToFile(strings, filename):
   Args:
     strings: A list of strings to be serialized.
     filename: Output binary file.
+    build_hash_index: If True, appends the hash index for O(1) lookup.
   """
   array_size = len(strings)
   str_data = io.BytesIO()
@@ -48,10 +84,12 @@ def SerializeToFile(strings, filename):
   # Precompute offsets and lengths.
   offsets = []
   lengths = []
+  encoded_strings = []
   offset = 4 + 8 * array_size  # The start offset of strings chunk
   for data in strings:
     if isinstance(data, str):
       data = data.encode('utf-8')
+    encoded_strings.append(data)
     offsets.append(offset)
     lengths.append(len(data))
     offset += len(data) + 1  # Include one byte for the trailing '\0'
@@ -68,3 +106,12 @@ def SerializeToFile(strings, filename):
 
     # Strings chunk.
     f.write(str_data.getvalue())
+
+    if build_hash_index:
+      # Padding to 4 byte boundary, followed by the hash index.
+      f.write(b'\0' * (-offset % 4))
+      buckets = _BuildHashIndex(encoded_strings)
+      f.write(struct.pack('<I', _HASH_INDEX_MAGIC))
+      f.write(struct.pack('<I', len(buckets)))
+      for index in buckets:
+        f.write(struct.pack('<I', index))
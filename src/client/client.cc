@@ -40,13 +40,16 @@
 #endif  // OS_WIN
 
 #include <cstddef>
+#include <functional>
 #include <ios>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/const.h"
+#include "base/executor.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
@@ -69,6 +72,7 @@
 #endif  // __APPLE__
 
 #include "absl/base/attributes.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 namespace client {
@@ -110,6 +114,8 @@ Client::Client()
 }
 
 Client::~Client() {
+  WaitForAsyncCalls();
+  async_executor_.reset();
   set_timeout(kDeleteSessionOnDestructorTimeout);
   DeleteSession();
 }
@@ -130,6 +136,7 @@ void Client::InitRequestForSvsJapanese(bool use_svs) {
 
 void Client::SetIPCClientFactory(IPCClientFactoryInterface *client_factory) {
   client_factory_ = client_factory;
+  ipc_client_.reset();
 }
 
 void Client::SetServerLauncher(ServerLauncherInterface *server_launcher) {
@@ -652,52 +659,68 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
   input.SerializeToString(&request);
 
   // Call IPC
-  std::unique_ptr<IPCClientInterface> client(client_factory_->NewClient(
-      kServerAddress, server_launcher_->server_program()));
-
-  // set client protocol version.
-  // When an error occurs inside Connected() function,
-  // the server_protocol_version_ may be set to
-  // the default value defined in .proto file.
-  // This caused an mis-version-detection.
-  // To avoid such situation, we set the client protocol version
-  // before calling IPC request.
-  server_protocol_version_ = IPC_PROTOCOL_VERSION;
-  server_product_version_ = Version::GetMozcVersion();
-  server_process_id_ = 0;
-
-  if (client == nullptr) {
-    LOG(ERROR) << "Cannot make client object";
-    server_status_ = SERVER_FATAL;
-    return false;
-  }
+  // Reuse the connection of the previous call if possible.  When the server
+  // has closed it since then (e.g. restarted), the call on the stale
+  // connection fails without sending the request, and is retried once on a
+  // new connection.  The request is never retried once it may have reached
+  // the server, since commands like SendKey are not idempotent.
+  const bool reused = ipc_client_ != nullptr && ipc_client_->IsReusable();
+  if (!reused) {
+    ipc_client_.reset(client_factory_->NewPersistentClient(
+        kServerAddress, server_launcher_->server_program()));
+
+    // set client protocol version.
+    // When an error occurs inside Connected() function,
+    // the server_protocol_version_ may be set to
+    // the default value defined in .proto file.
+    // This caused an mis-version-detection.
+    // To avoid such situation, we set the client protocol version
+    // before calling IPC request.
+    server_protocol_version_ = IPC_PROTOCOL_VERSION;
+    server_product_version_ = Version::GetMozcVersion();
+    server_process_id_ = 0;
+
+    if (ipc_client_ == nullptr) {
+      LOG(ERROR) << "Cannot make client object";
+      server_status_ = SERVER_FATAL;
+      return false;
+    }
 
-  if (!client->Connected()) {
-    LOG(ERROR) << "Connection failure to " << kServerAddress;
-    // if the status is not SERVER_UNKNOWN, it means that
-    // the server WAS working as correctly.
-    if (server_status_ != SERVER_UNKNOWN) {
-      server_status_ = SERVER_SHUTDOWN;
+    if (!ipc_client_->Connected()) {
+      LOG(ERROR) << "Connection failure to " << kServerAddress;
+      ipc_client_.reset();
+      // if the status is not SERVER_UNKNOWN, it means that
+      // the server WAS working as correctly.
+      if (server_status_ != SERVER_UNKNOWN) {
+        server_status_ = SERVER_SHUTDOWN;
+      }
+      return false;
     }
-    return false;
-  }
 
-  server_protocol_version_ = client->GetServerProtocolVersion();
-  server_product_version_ = client->GetServerProductVersion();
-  server_process_id_ = client->GetServerProcessId();
+    server_protocol_version_ = ipc_client_->GetServerProtocolVersion();
+    server_product_version_ = ipc_client_->GetServerProductVersion();
+    server_process_id_ = ipc_client_->GetServerProcessId();
 
-  if (server_protocol_version_ != IPC_PROTOCOL_VERSION) {
-    LOG(ERROR) << "Server version mismatch. skipped to update the status here";
-    return false;
+    if (server_protocol_version_ != IPC_PROTOCOL_VERSION) {
+      LOG(ERROR) << "Server version mismatch. skipped to update the status here";
+      ipc_client_.reset();
+      return false;
+    }
   }
 
   // Drop DebugString() as it raises segmentation fault.
   // http://b/2126375
   // TODO(taku): Investigate the error in detail.
-  if (!client->Call(request, &response_, timeout_)) {
+  if (!ipc_client_->Call(request, &response_, timeout_)) {
     LOG(ERROR) << "Call failure";
     //               << input.DebugString();
-    if (client->GetLastIPCError() == IPC_TIMEOUT_ERROR) {
+    const IPCErrorType error = ipc_client_->GetLastIPCError();
+    ipc_client_.reset();
+    if (reused && error == IPC_NO_CONNECTION) {
+      LOG(WARNING) << "The connection is lost. Reconnecting.";
+      return Call(input, output);
+    }
+    if (error == IPC_TIMEOUT_ERROR) {
       server_status_ = SERVER_TIMEOUT;
     } else {
       // server crash
@@ -819,10 +842,54 @@ bool Client::CheckVersionOrRestartServerInternal(const commands::Input &input,
   return false;
 }
 
+void Client::SendKeyAsync(const commands::KeyEvent &key,
+                          AsyncCallback callback) {
+  PostAsyncCall([this, key, callback = std::move(callback)]() {
+    commands::Output output;
+    const bool result = SendKey(key, &output);
+    callback(result, output);
+  });
+}
+
+void Client::SendCommandAsync(const commands::SessionCommand &command,
+                              AsyncCallback callback) {
+  PostAsyncCall([this, command, callback = std::move(callback)]() {
+    commands::Output output;
+    const bool result = SendCommand(command, &output);
+    callback(result, output);
+  });
+}
+
+void Client::PostAsyncCall(std::function<void()> call) {
+  if (async_executor_ == nullptr) {
+    // A single worker keeps the order of the requests.
+    async_executor_ = std::make_unique<Executor>(1);
+  }
+  {
+    absl::MutexLock l(&async_mutex_);
+    ++num_pending_async_calls_;
+  }
+  // Executor::TaskHandle::Wait() may run the task on the calling thread, so
+  // the completion is tracked by the counter instead of the task handles.
+  async_executor_->Post([this, call = std::move(call)]() {
+    call();
+    absl::MutexLock l(&async_mutex_);
+    --num_pending_async_calls_;
+  });
+}
+
+void Client::WaitForAsyncCalls() {
+  absl::MutexLock l(&async_mutex_);
+  async_mutex_.Await(absl::Condition(
+      +[](int *num_pending) { return *num_pending == 0; },
+      &num_pending_async_calls_));
+}
+
 void Client::Reset() {
   server_status_ = SERVER_UNKNOWN;
   server_protocol_version_ = 0;
   server_process_id_ = 0;
+  ipc_client_.reset();
 }
 
 bool Client::TranslateProtoBufToMozcToolArg(const commands::Output &output,
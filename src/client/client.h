@@ -33,19 +33,24 @@
 #define MOZC_CLIENT_CLIENT_H_
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/executor.h"
 #include "base/port.h"
 #include "client/client_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "testing/base/public/gunit_prod.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 // for FRIEND_TEST()
 
 namespace mozc {
 class IPCClientFactoryInterface;
+class IPCClientInterface;
 
 namespace config {
 class Config;
@@ -159,6 +164,23 @@ class Client : public ClientInterface {
 
   bool OpenBrowser(const std::string &url) override;
 
+  // Asynchronous variants of SendKey and SendCommand, so that the caller can
+  // render the previous output while the next request is processed.  The
+  // requests are issued in the order of submission on a worker thread owned
+  // by this client, and |callback| is invoked on that thread.  Other methods
+  // of this client must not be called until WaitForAsyncCalls() returns.
+  using AsyncCallback =
+      std::function<void(bool result, const commands::Output &output)>;
+  void SendKeyAsync(const commands::KeyEvent &key, AsyncCallback callback);
+  void SendCommandAsync(const commands::SessionCommand &command,
+                        AsyncCallback callback);
+
+  // Waits for all the asynchronous calls to finish.
+  void WaitForAsyncCalls();
+
+  // Returns the process ID of the connected server, or 0 if unknown.
+  uint32_t server_process_id() const { return server_process_id_; }
+
  private:
   FRIEND_TEST(SessionPlaybackTest, PushAndResetHistoryWithNoModeTest);
   FRIEND_TEST(SessionPlaybackTest, PushAndResetHistoryWithModeTest);
@@ -166,6 +188,7 @@ class Client : public ClientInterface {
   FRIEND_TEST(SessionPlaybackTest, PlaybackHistoryTest);
   FRIEND_TEST(SessionPlaybackTest, SetModeInitializerTest);
   FRIEND_TEST(SessionPlaybackTest, ConsumedTest);
+  FRIEND_TEST(ClientTest, RetryOnlyUnsentRequest);
 
   enum ServerStatus {
     SERVER_UNKNOWN,           // initial status
@@ -243,8 +266,12 @@ class Client : public ClientInterface {
   // copy the history inputs to |result|.
   void GetHistoryInputs(std::vector<commands::Input> *result) const;
 
+  void PostAsyncCall(std::function<void()> call);
+
   uint64_t id_;
   IPCClientFactoryInterface *client_factory_;
+  // The connection reused across calls if the IPC client supports it.
+  std::unique_ptr<IPCClientInterface> ipc_client_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<config::Config> preferences_;
   std::unique_ptr<commands::Request> request_;
@@ -258,6 +285,11 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+
+  // Created on the first asynchronous call.
+  std::unique_ptr<Executor> async_executor_;
+  absl::Mutex async_mutex_;
+  int num_pending_async_calls_ ABSL_GUARDED_BY(async_mutex_) = 0;
 };
 
 }  // namespace client
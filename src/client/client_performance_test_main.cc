@@ -46,6 +46,7 @@
 #include "base/util.h"
 #include "client/client.h"
 #include "config/config_handler.h"
+#include "ipc/ipc.h"
 #include "protocol/commands.pb.h"
 #include "session/random_keyevents_generator.h"
 #include "absl/flags/flag.h"
@@ -53,6 +54,8 @@
 
 ABSL_FLAG(std::string, server_path, "", "specify server path");
 ABSL_FLAG(std::string, log_path, "", "specify log output file path");
+ABSL_FLAG(bool, use_shared_memory, false,
+          "exchange the payloads with the server through shared memory");
 
 namespace mozc {
 namespace {
@@ -235,6 +238,41 @@ class PreeditWithSuggestion : public PreeditCommon {
   }
 };
 
+// Submits the keys of each sentence with SendKeyAsync() without waiting for
+// the outputs, as a frontend overlapping the rendering with the next request.
+// The time per key is recorded.
+class PreeditAsync : public TestScenarioInterface {
+ public:
+  void Run(Result *result) override {
+    result->test_name = "preedit_async";
+    ResetConfig();
+    IMEOn();
+    DisableSuggestion();
+
+    const std::vector<std::vector<commands::KeyEvent> > &keys =
+        Singleton<TestSentenceGenerator>::get()->GetTestKeys();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      Stopwatch stopwatch;
+      stopwatch.Start();
+      for (int j = 0; j < keys[i].size(); ++j) {
+        client_.SendKeyAsync(keys[i][j],
+                             [](bool result, const commands::Output &output) {
+                             });
+      }
+      client_.WaitForAsyncCalls();
+      stopwatch.Stop();
+      result->operations_times.push_back(stopwatch.GetElapsedMicroseconds() /
+                                         keys[i].size());
+      commands::SessionCommand command;
+      command.set_type(commands::SessionCommand::REVERT);
+      client_.SendCommand(command, &output_);
+    }
+
+    IMEOff();
+    ResetConfig();
+  }
+};
+
 enum PredictionRequestType { ONE_CHAR, TWO_CHARS };
 
 void CreatePredictionKeys(PredictionRequestType type,
@@ -360,12 +398,15 @@ class Conversion : public TestScenarioInterface {
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv);
+  mozc::IPCClientFactory::GetIPCClientFactory()->set_use_shared_memory(
+      absl::GetFlag(FLAGS_use_shared_memory));
 
   std::vector<mozc::TestScenarioInterface *> tests;
   std::vector<mozc::Result *> results;
 
   tests.push_back(new mozc::PreeditWithoutSuggestion);
   tests.push_back(new mozc::PreeditWithSuggestion);
+  tests.push_back(new mozc::PreeditAsync);
   tests.push_back(new mozc::Conversion);
   tests.push_back(new mozc::PredictionWithOneChar);
   tests.push_back(new mozc::PredictionWithTwoChars);
@@ -54,8 +54,8 @@
 #include "absl/flags/flag.h"
 
 // TODO(taku)
-// 1. multi-thread testing
-// 2. change/config the senario
+// 1. change/config the senario
+// For concurrent clients, see client_throughput_test_main.
 
 ABSL_FLAG(int32_t, max_keyevents, 100000,
           "test at most |max_keyevents| key sequences");
@@ -403,6 +403,85 @@ TEST_F(ClientTest, SendCommandWithContext) {
   EXPECT_EQ(kSuppressSuggestion, input.context().suppress_suggestion());
 }
 
+TEST_F(ClientTest, ReuseConnection) {
+  const int mock_id = 123;
+  client_factory_->SetReusable(true);
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  commands::KeyEvent key_event;
+  key_event.set_special_key(commands::KeyEvent::ENTER);
+  commands::Output output;
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  const int num_clients = client_factory_->GetNumNewClients();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(client_->SendKey(key_event, &output));
+  }
+  EXPECT_EQ(num_clients, client_factory_->GetNumNewClients());
+
+  // A new connection is made after Reset().
+  client_->Reset();
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  EXPECT_EQ(num_clients + 1, client_factory_->GetNumNewClients());
+}
+
+TEST_F(ClientTest, RetryOnlyUnsentRequest) {
+  const int mock_id = 123;
+  client_factory_->SetReusable(true);
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  commands::Input input;
+  input.set_type(commands::Input::SEND_KEY);
+  input.set_id(mock_id);
+  input.mutable_key()->set_special_key(commands::KeyEvent::ENTER);
+  commands::Output output;
+  EXPECT_TRUE(client_->Call(input, &output));
+
+  // The request may have been processed by the server.  It is not retried.
+  int num_clients = client_factory_->GetNumNewClients();
+  client_factory_->SetCallError(IPC_READ_ERROR);
+  EXPECT_FALSE(client_->Call(input, &output));
+  EXPECT_EQ(num_clients, client_factory_->GetNumNewClients());
+
+  // The connection was closed before the request was sent.  It is retried
+  // once on a new connection.
+  client_->Reset();
+  client_factory_->SetCallError(IPC_NO_ERROR);
+  EXPECT_TRUE(client_->Call(input, &output));
+  num_clients = client_factory_->GetNumNewClients();
+  client_factory_->SetCallError(IPC_NO_CONNECTION);
+  EXPECT_FALSE(client_->Call(input, &output));
+  EXPECT_EQ(num_clients + 1, client_factory_->GetNumNewClients());
+}
+
+TEST_F(ClientTest, SendKeyAsync) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_consumed(true);
+  SetMockOutput(mock_output);
+
+  commands::KeyEvent key_event;
+  key_event.set_special_key(commands::KeyEvent::ENTER);
+  std::vector<int> finished;
+  for (int i = 0; i < 10; ++i) {
+    client_->SendKeyAsync(key_event,
+                          [i, &finished](bool result,
+                                         const commands::Output &output) {
+                            EXPECT_TRUE(result);
+                            EXPECT_TRUE(output.consumed());
+                            finished.push_back(i);
+                          });
+  }
+  client_->WaitForAsyncCalls();
+  EXPECT_EQ(finished, std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+  commands::Input input;
+  GetGeneratedInput(&input);
+  EXPECT_EQ(commands::Input::SEND_KEY, input.type());
+}
+
 TEST_F(ClientTest, SetConfig) {
   const int mock_id = 0;
   EXPECT_TRUE(SetupConnection(mock_id));
@@ -0,0 +1,350 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Throughput benchmark of mozc_server shared by multiple clients.
+//
+// Spawns |num_clients| threads, each of which has its own client::Client and
+// session, and replays typing of test sentences against one server.  Reports
+// the aggregate throughput, latency percentiles per command and CPU load.
+//
+// Usage:
+//   client_throughput_test_main --num_clients=8 --sentences_per_client=200
+//   client_throughput_test_main
+//       --sentences_file=data/test/quality_regression_test/oss.tsv
+
+#ifdef OS_LINUX
+#include <unistd.h>
+#endif  // OS_LINUX
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/cpu_stats.h"
+#include "base/file_stream.h"
+#include "base/init_mozc.h"
+#include "base/japanese_util.h"
+#include "base/logging.h"
+#include "base/stopwatch.h"
+#include "base/thread.h"
+#include "base/util.h"
+#include "client/client.h"
+#include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
+#include "session/random_keyevents_generator.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+ABSL_FLAG(std::string, server_path, "", "specify server path");
+ABSL_FLAG(std::string, log_path, "", "specify log output file path");
+ABSL_FLAG(int32_t, num_clients, 4, "number of concurrent clients");
+ABSL_FLAG(int32_t, sentences_per_client, 100,
+          "number of sentences typed by each client");
+ABSL_FLAG(int32_t, key_duration, 0, "interval between key events (msec)");
+ABSL_FLAG(std::string, sentences_file, "",
+          "file of sentences in hiragana, one per line.  For TSV files like "
+          "the quality regression corpus, the second column is used.  The "
+          "built-in stress test sentences are used if empty.");
+ABSL_FLAG(bool, use_shared_memory, false,
+          "exchange the payloads with the server through shared memory");
+
+namespace mozc {
+namespace {
+
+// Latencies in microseconds.
+struct Latencies {
+  std::vector<int64_t> key;         // SendKey of the reading
+  std::vector<int64_t> conversion;  // SendKey of SPACE
+  std::vector<int64_t> command;     // SendCommand(REVERT)
+
+  void Append(const Latencies &other) {
+    key.insert(key.end(), other.key.begin(), other.key.end());
+    conversion.insert(conversion.end(), other.conversion.begin(),
+                      other.conversion.end());
+    command.insert(command.end(), other.command.begin(), other.command.end());
+  }
+
+  size_t size() const { return key.size() + conversion.size() + command.size(); }
+};
+
+std::vector<std::string> LoadSentences() {
+  std::vector<std::string> sentences;
+  const std::string filename = absl::GetFlag(FLAGS_sentences_file);
+  if (filename.empty()) {
+    size_t size = 0;
+    const char **test_sentences =
+        session::RandomKeyEventsGenerator::GetTestSentences(&size);
+    sentences.assign(test_sentences, test_sentences + size);
+    return sentences;
+  }
+
+  InputFileStream ifs(filename);
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    const std::vector<absl::string_view> columns = absl::StrSplit(line, '\t');
+    const absl::string_view sentence =
+        columns.size() >= 2 ? columns[1] : columns[0];
+    if (!sentence.empty()) {
+      sentences.emplace_back(sentence);
+    }
+  }
+  return sentences;
+}
+
+std::vector<std::vector<commands::KeyEvent>> GenerateKeys(
+    const std::vector<std::string> &sentences) {
+  std::vector<std::vector<commands::KeyEvent>> keys;
+  for (const std::string &sentence : sentences) {
+    std::string romanji;
+    japanese_util::HiraganaToRomanji(sentence, &romanji);
+    std::vector<commands::KeyEvent> sentence_keys;
+    for (const char c : romanji) {
+      if (c >= 'a' && c <= 'z') {
+        commands::KeyEvent key;
+        key.set_key_code(static_cast<int>(c));
+        sentence_keys.push_back(key);
+      }
+    }
+    if (!sentence_keys.empty()) {
+      keys.push_back(std::move(sentence_keys));
+    }
+  }
+  return keys;
+}
+
+class TypingThread : public Thread {
+ public:
+  TypingThread(const std::vector<std::vector<commands::KeyEvent>> &keys,
+               size_t offset)
+      : keys_(keys), offset_(offset) {
+    if (!absl::GetFlag(FLAGS_server_path).empty()) {
+      client_.set_server_program(absl::GetFlag(FLAGS_server_path));
+    }
+    // Sessions are created before the measurement.
+    CHECK(client_.EnsureSession()) << "EnsureSession failed";
+    CHECK(client_.NoOperation()) << "Server is not responding";
+  }
+
+  void Run() override {
+    commands::Output output;
+    commands::KeyEvent on_key;
+    on_key.set_special_key(commands::KeyEvent::ON);
+    client_.SendKey(on_key, &output);
+
+    commands::KeyEvent space_key;
+    space_key.set_special_key(commands::KeyEvent::SPACE);
+    commands::SessionCommand revert;
+    revert.set_type(commands::SessionCommand::REVERT);
+
+    const int key_duration = absl::GetFlag(FLAGS_key_duration);
+    const int num_sentences = absl::GetFlag(FLAGS_sentences_per_client);
+    for (int i = 0; i < num_sentences; ++i) {
+      const std::vector<commands::KeyEvent> &sentence =
+          keys_[(offset_ + i) % keys_.size()];
+      for (const commands::KeyEvent &key : sentence) {
+        if (key_duration > 0) {
+          Util::Sleep(key_duration);
+        }
+        latencies_.key.push_back(Measure(
+            [&]() { return client_.SendKey(key, &output); }));
+      }
+      latencies_.conversion.push_back(Measure(
+          [&]() { return client_.SendKey(space_key, &output); }));
+      latencies_.command.push_back(Measure(
+          [&]() { return client_.SendCommand(revert, &output); }));
+    }
+  }
+
+  const Latencies &latencies() const { return latencies_; }
+  int num_errors() const { return num_errors_; }
+  uint32_t server_process_id() const { return client_.server_process_id(); }
+
+ private:
+  template <typename Func>
+  int64_t Measure(Func func) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    if (!func()) {
+      ++num_errors_;
+    }
+    stopwatch.Stop();
+    return stopwatch.GetElapsedMicroseconds();
+  }
+
+  const std::vector<std::vector<commands::KeyEvent>> &keys_;
+  const size_t offset_;
+  client::Client client_;
+  Latencies latencies_;
+  int num_errors_ = 0;
+};
+
+// Returns the CPU time (user + system) of the process |pid| in seconds, or a
+// negative value if it is unknown.
+double GetProcessCPUTime(uint32_t pid) {
+#ifdef OS_LINUX
+  if (pid == 0) {
+    return -1.0;
+  }
+  InputFileStream ifs(absl::StrCat("/proc/", pid, "/stat"));
+  std::string stat;
+  if (!std::getline(ifs, stat)) {
+    return -1.0;
+  }
+  // The command name in parentheses may contain spaces.  The fields after it
+  // start with the state (3rd), and utime and stime are the 14th and 15th.
+  const size_t pos = stat.rfind(')');
+  if (pos == std::string::npos) {
+    return -1.0;
+  }
+  const std::vector<absl::string_view> fields = absl::StrSplit(
+      absl::string_view(stat).substr(pos + 1), ' ', absl::SkipEmpty());
+  constexpr size_t kUtimeIndex = 14 - 3;
+  constexpr size_t kStimeIndex = 15 - 3;
+  uint64_t utime = 0, stime = 0;
+  if (fields.size() <= kStimeIndex ||
+      !absl::SimpleAtoi(fields[kUtimeIndex], &utime) ||
+      !absl::SimpleAtoi(fields[kStimeIndex], &stime)) {
+    return -1.0;
+  }
+  return static_cast<double>(utime + stime) / ::sysconf(_SC_CLK_TCK);
+#else   // OS_LINUX
+  return -1.0;
+#endif  // OS_LINUX
+}
+
+std::string GetPercentiles(std::vector<int64_t> times) {
+  if (times.empty()) {
+    return "size=0";
+  }
+  std::sort(times.begin(), times.end());
+  auto percentile = [&times](double p) {
+    return times[std::min(times.size() - 1,
+                          static_cast<size_t>(p * times.size()))];
+  };
+  return absl::StrFormat("size=%d p50=%d p90=%d p99=%d max=%d (usec)",
+                         times.size(), percentile(0.5), percentile(0.9),
+                         percentile(0.99), times.back());
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+  mozc::IPCClientFactory::GetIPCClientFactory()->set_use_shared_memory(
+      absl::GetFlag(FLAGS_use_shared_memory));
+
+  const std::vector<std::vector<mozc::commands::KeyEvent>> keys =
+      mozc::GenerateKeys(mozc::LoadSentences());
+  CHECK(!keys.empty()) << "No sentences";
+
+  const int num_clients = std::max(absl::GetFlag(FLAGS_num_clients), 1);
+  std::vector<std::unique_ptr<mozc::TypingThread>> threads;
+  for (int i = 0; i < num_clients; ++i) {
+    // Each client starts typing from a different sentence.
+    threads.push_back(std::make_unique<mozc::TypingThread>(
+        keys, i * keys.size() / num_clients));
+  }
+
+  mozc::CPUStats cpu_stats;
+  // Resets the baseline of the CPU load.
+  cpu_stats.GetSystemCPULoad();
+  cpu_stats.GetCurrentProcessCPULoad();
+  // All the clients are connected to the same server.
+  const uint32_t server_pid = threads[0]->server_process_id();
+  const double server_cpu_start = mozc::GetProcessCPUTime(server_pid);
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+  for (auto &thread : threads) {
+    thread->SetJoinable(true);
+    thread->Start("TypingThread");
+  }
+  for (auto &thread : threads) {
+    thread->Join();
+  }
+  stopwatch.Stop();
+  const float system_load = cpu_stats.GetSystemCPULoad();
+  const float client_load = cpu_stats.GetCurrentProcessCPULoad() /
+                            cpu_stats.GetNumberOfProcessors();
+  const double server_cpu_end = mozc::GetProcessCPUTime(server_pid);
+
+  mozc::Latencies latencies;
+  int num_errors = 0;
+  for (const auto &thread : threads) {
+    latencies.Append(thread->latencies());
+    num_errors += thread->num_errors();
+  }
+
+  std::ostream *ofs = &std::cout;
+  std::unique_ptr<mozc::OutputFileStream> log_file;
+  if (!absl::GetFlag(FLAGS_log_path).empty()) {
+    log_file = std::make_unique<mozc::OutputFileStream>(
+        absl::GetFlag(FLAGS_log_path));
+    ofs = log_file.get();
+  }
+
+  const double elapsed_sec = stopwatch.GetElapsedMicroseconds() / 1e6;
+  (*ofs) << absl::StrFormat(
+                "clients=%d commands=%d errors=%d elapsed=%.3fs "
+                "throughput=%.1f commands/s keys=%.1f keys/s",
+                num_clients, latencies.size(), num_errors, elapsed_sec,
+                latencies.size() / elapsed_sec,
+                latencies.key.size() / elapsed_sec)
+         << std::endl;
+  (*ofs) << "key: " << mozc::GetPercentiles(latencies.key) << std::endl;
+  (*ofs) << "conversion: " << mozc::GetPercentiles(latencies.conversion)
+         << std::endl;
+  (*ofs) << "command: " << mozc::GetPercentiles(latencies.command)
+         << std::endl;
+  // The loads are normalized by the number of processors.
+  std::string server_load = "unknown";
+  if (server_cpu_start >= 0.0 && server_cpu_end >= 0.0) {
+    server_load = absl::StrFormat(
+        "%.1f%%", (server_cpu_end - server_cpu_start) / elapsed_sec /
+                      cpu_stats.GetNumberOfProcessors() * 100);
+  }
+  (*ofs) << absl::StrFormat(
+                "cpu: system=%.1f%% server=%s clients=%.1f%% processors=%d",
+                system_load * 100, server_load, client_load * 100,
+                cpu_stats.GetNumberOfProcessors())
+         << std::endl;
+
+  return num_errors == 0 ? 0 : 1;
+}
@@ -41,6 +41,7 @@
 #include "base/japanese_util.h"
 #include "base/logging.h"
 #include "base/util.h"
+#include "composer/internal/char_chunk.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
 #include "composer/internal/mode_switching_handler.h"
@@ -272,6 +273,13 @@ void Composer::Reset() {
   timeout_threshold_msec_ = config_->composing_timeout_threshold_msec();
 }
 
+size_t Composer::EstimateMemoryUsage() const {
+  // Each chunk is a node of std::list holding a CharChunk.
+  return sizeof(*this) + source_text_.capacity() +
+         composition_.chunks().size() *
+             (sizeof(CharChunk) + 3 * sizeof(void *));
+}
+
 void Composer::ResetInputMode() { SetInputMode(comeback_input_mode_); }
 
 void Composer::ReloadConfig() {
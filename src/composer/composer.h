@@ -248,6 +248,9 @@ class Composer final {
   int timeout_threshold_msec() const;
   void set_timeout_threshold_msec(int threshold_msec);
 
+  // Returns the estimated number of bytes held by this composer.
+  size_t EstimateMemoryUsage() const;
+
  private:
   FRIEND_TEST(ComposerTest, ApplyTemporaryInputMode);
 
@@ -144,8 +144,10 @@ inline bool IsConnectedWeakCompound(const std::vector<const Node *> &nodes,
 
 bool IsIsolatedWordOrGeneralSymbol(const dictionary::PosMatcher &pos_matcher,
                                    uint16_t pos_id) {
-  return pos_matcher.IsIsolatedWord(pos_id) ||
-         pos_matcher.IsGeneralSymbol(pos_id);
+  using PosMatcher = dictionary::PosMatcher;
+  static constexpr PosMatcher::RuleMask kMask = PosMatcher::MakeRuleMask(
+      {PosMatcher::kIsolatedWord, PosMatcher::kGeneralSymbol});
+  return pos_matcher.IsAnyOf(pos_id, kMask);
 }
 
 bool ContainsIsolatedWordOrGeneralSymbol(
@@ -36,6 +36,7 @@
 #include <string>
 #include <utility>
 
+#include "base/hot_page_pinner.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -53,6 +54,13 @@ using ::mozc::storage::louds::SimpleSuccinctBitVectorIndex;
 constexpr uint32_t kInvalidCacheKey = 0xFFFFFFFF;
 constexpr uint16_t kConnectorMagicNumber = 0xCDAB;
 constexpr uint8_t kInvalid1ByteCostValue = 255;
+constexpr uint16_t kHotPairMagicNumber = 0xCDAC;
+constexpr uint32_t kHotPairEmptyKey = 0xFFFFFFFF;
+// Stands for kInvalidCost in the hot pair table.  Must be the same as
+// HOT_PAIR_INVALID_COST in gen_connection_data.py.
+constexpr uint16_t kHotPairInvalidCost = 0xFFFF;
+// Must be the same as MAX_HOT_PAIR_PROBE in gen_connection_data.py.
+constexpr int kMaxHotPairProbe = 4;
 
 inline uint32_t GetHashValue(uint16_t rid, uint16_t lid, uint32_t hash_mask) {
   return (3 * static_cast<uint32_t>(rid) + lid) & hash_mask;
@@ -67,6 +75,11 @@ inline uint32_t EncodeKey(uint16_t rid, uint16_t lid) {
   return (static_cast<uint32_t>(rid) << 16) | lid;
 }
 
+// Must be the same as GetHotPairBucket() in gen_connection_data.py.
+inline uint32_t GetHotPairBucket(uint32_t key, int bucket_bits) {
+  return (key * 2654435761u) >> (32 - bucket_bits);
+}
+
 absl::Status IsMemoryAligned32(const void *ptr) {
   const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
   const auto alignment = addr % 4;
@@ -169,6 +182,8 @@ class Connector::Row final {
       return false;
     }
     int value_position = compact_bits_index_.Rank1(compact_bit_position);
+    HotPagePinner::SampleAccess(
+        values_ + (use_1byte_value_ ? 1 : 2) * value_position);
     if (use_1byte_value_) {
       *value = values_[value_position];
       if (*value == kInvalid1ByteCostValue) {
@@ -320,6 +335,10 @@ absl::Status Connector::Init(const char *connection_data,
                   values, metadata->Use1ByteValue());
   }
   VALIDATE_SIZE(ptr, 0, "Data end");
+  if (auto status = InitHotPairs(ptr, data_end); !status.ok()) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "connector.cc: ", gen_debug_info(ptr), ": ", status.message()));
+  }
   ClearCache();
   return absl::Status();
 
@@ -327,21 +346,97 @@ absl::Status Connector::Init(const char *connection_data,
 #undef VALIDATE_SIZE
 }
 
+absl::Status Connector::InitHotPairs(const char *ptr, const char *data_end) {
+  hot_pair_keys_ = nullptr;
+  hot_pair_costs_ = nullptr;
+  hot_pair_bucket_bits_ = 0;
+  hot_pair_size_ = 0;
+
+  // The hot pair table is optional and follows the rows.
+  // +--------+-------------+------------------+------------------+
+  // | uint16 |   uint16    |     uint32[]     |     uint16[]     |
+  // | magic  | bucket_bits |       keys       |      costs       |
+  // +--------+-------------+------------------+------------------+
+  // Both arrays have 2^bucket_bits elements.
+  if (data_end - ptr < 4 ||
+      *reinterpret_cast<const uint16_t *>(ptr) != kHotPairMagicNumber) {
+    return absl::Status();
+  }
+  const int bucket_bits = reinterpret_cast<const uint16_t *>(ptr)[1];
+  if (bucket_bits < 1 || bucket_bits > 20) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Invalid hot pair bucket bits: ", bucket_bits));
+  }
+  ptr += 4;
+  const size_t num_buckets = size_t{1} << bucket_bits;
+  const size_t table_size = num_buckets * (4 + 2);
+  if (static_cast<size_t>(data_end - ptr) < table_size) {
+    return absl::OutOfRangeError(
+        absl::StrCat("Hot pair table is truncated.  Required bytes: ",
+                     table_size, ", remaining: ", data_end - ptr));
+  }
+  if (auto status = IsMemoryAligned32(ptr); !status.ok()) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "Hot pair table is not 32-bit aligned: ", status.message()));
+  }
+  hot_pair_keys_ = reinterpret_cast<const uint32_t *>(ptr);
+  hot_pair_costs_ = reinterpret_cast<const uint16_t *>(ptr + num_buckets * 4);
+  hot_pair_bucket_bits_ = bucket_bits;
+  hot_pair_size_ = std::count_if(
+      hot_pair_keys_, hot_pair_keys_ + num_buckets,
+      [](uint32_t key) { return key != kHotPairEmptyKey; });
+  return absl::Status();
+}
+
 
 int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
+  // The frequent pairs don't pollute the cache.
+  int value;
+  if (LookupHotPair(rid, lid, &value)) {
+    ++stats_.hot_pair_hits;
+    return value;
+  }
   const uint32_t index = EncodeKey(rid, lid);
   const uint32_t bucket = GetHashValue(rid, lid, cache_hash_mask_);
   if (cache_key_[bucket] == index) {
+    ++stats_.cache_hits;
     return cache_value_[bucket];
   }
-  const int value = LookupCost(rid, lid);
+  ++stats_.cache_misses;
+  value = LookupCost(rid, lid);
   cache_key_[bucket] = index;
   cache_value_[bucket] = value;
   return value;
 }
 
+bool Connector::LookupHotPair(uint16_t rid, uint16_t lid, int *cost) const {
+  if (hot_pair_keys_ == nullptr) {
+    return false;
+  }
+  const uint32_t key = EncodeKey(rid, lid);
+  const uint32_t mask = (1u << hot_pair_bucket_bits_) - 1;
+  uint32_t bucket = GetHotPairBucket(key, hot_pair_bucket_bits_);
+  for (int probe = 0; probe < kMaxHotPairProbe; ++probe) {
+    const uint32_t stored = hot_pair_keys_[bucket];
+    if (stored == key) {
+      // Invalid cost is scaled by the resolution as in LookupCost().
+      const uint16_t value = hot_pair_costs_[bucket];
+      *cost = (value == kHotPairInvalidCost) ? kInvalidCost * resolution_
+                                             : value;
+      return true;
+    }
+    if (stored == kHotPairEmptyKey) {
+      return false;
+    }
+    bucket = (bucket + 1) & mask;
+  }
+  return false;
+}
+
 int Connector::GetResolution() const { return resolution_; }
 
+size_t Connector::GetHotPairSize() const { return hot_pair_size_; }
+
 void Connector::ClearCache() {
   std::fill(cache_key_.get(), cache_key_.get() + cache_size_, kInvalidCacheKey);
 }
@@ -46,6 +46,14 @@ class Connector final {
  public:
   static constexpr int16_t kInvalidCost = 30000;
 
+  // Counters of GetTransitionCost() to monitor the effectiveness of the hot
+  // pair table and the cache.
+  struct Stats {
+    uint64_t hot_pair_hits = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+  };
+
   static absl::StatusOr<std::unique_ptr<Connector>> CreateFromDataManager(
       const DataManagerInterface &data_manager);
 
@@ -61,6 +69,12 @@ class Connector final {
   int GetTransitionCost(uint16_t rid, uint16_t lid) const;
   int GetResolution() const;
 
+  // Returns the number of the (rid, lid) pairs in the hot pair table.
+  size_t GetHotPairSize() const;
+
+  Stats GetStats() const { return stats_; }
+  void ResetStats() { stats_ = Stats(); }
+
   void ClearCache();
 
  private:
@@ -69,6 +83,14 @@ class Connector final {
   absl::Status Init(const char *connection_data, size_t connection_size,
                     int cache_size);
 
+  // Reads the optional hot pair table at |ptr|.  Does nothing if the data
+  // doesn't have the table.
+  absl::Status InitHotPairs(const char *ptr, const char *data_end);
+
+  // Returns true and stores the cost to |cost| if (rid, lid) is in the hot
+  // pair table.
+  bool LookupHotPair(uint16_t rid, uint16_t lid, int *cost) const;
+
   int LookupCost(uint16_t rid, uint16_t lid) const;
 
   std::unique_ptr<Row[]> rows_;
@@ -78,6 +100,15 @@ class Connector final {
   uint32_t cache_hash_mask_ = 0;
   mutable std::unique_ptr<uint32_t[]> cache_key_;
   mutable std::unique_ptr<int[]> cache_value_;
+
+  // Open addressing hash table of the frequent (rid, lid) pairs precomputed
+  // at data build time.  Points to the connection data.
+  const uint32_t *hot_pair_keys_ = nullptr;
+  const uint16_t *hot_pair_costs_ = nullptr;
+  int hot_pair_bucket_bits_ = 0;
+  size_t hot_pair_size_ = 0;
+
+  mutable Stats stats_;
 };
 
 }  // namespace mozc
@@ -91,6 +91,117 @@ TEST(ConnectorTest, CompareWithRawData) {
   }
 }
 
+TEST(ConnectorTest, HotPairs) {
+  const std::string path = testing::GetSourceFileOrDie(
+      {"data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  auto status_or_connector =
+      Connector::Create(cmmap.begin(), cmmap.size(), 256);
+  ASSERT_TRUE(status_or_connector.ok()) << status_or_connector.status();
+  auto connector = std::move(status_or_connector).value();
+  ASSERT_LT(0, connector->GetHotPairSize());
+
+  // The transition from BOS is always in the hot pair table.
+  const int cost = connector->GetTransitionCost(0, 0);
+  Connector::Stats stats = connector->GetStats();
+  EXPECT_EQ(1, stats.hot_pair_hits);
+  EXPECT_EQ(0, stats.cache_hits);
+  EXPECT_EQ(0, stats.cache_misses);
+  EXPECT_EQ(cost, connector->GetTransitionCost(0, 0));
+  EXPECT_EQ(2, connector->GetStats().hot_pair_hits);
+
+  // Without the hot pair table, the same costs are returned via the cache.
+  // The table is at the end of the data: [magic][bucket bits][keys][costs].
+  std::string data(cmmap.begin(), cmmap.size());
+  size_t table_size = 0;
+  for (int bits = 1; bits <= 20; ++bits) {
+    const size_t size = 4 + (size_t{6} << bits);
+    if (size < data.size() &&
+        reinterpret_cast<const uint16_t *>(&data[data.size() - size])[1] ==
+            bits) {
+      table_size = size;
+      break;
+    }
+  }
+  ASSERT_LT(0, table_size);
+  data.resize(data.size() - table_size);
+  status_or_connector = Connector::Create(data.data(), data.size(), 256);
+  ASSERT_TRUE(status_or_connector.ok()) << status_or_connector.status();
+  auto plain_connector = std::move(status_or_connector).value();
+  EXPECT_EQ(0, plain_connector->GetHotPairSize());
+  for (uint16_t rid = 0; rid < 100; ++rid) {
+    for (uint16_t lid = 0; lid < 100; ++lid) {
+      EXPECT_EQ(plain_connector->GetTransitionCost(rid, lid),
+                connector->GetTransitionCost(rid, lid));
+    }
+  }
+  stats = plain_connector->GetStats();
+  EXPECT_EQ(0, stats.hot_pair_hits);
+  EXPECT_EQ(100 * 100, stats.cache_hits + stats.cache_misses);
+
+  connector->ResetStats();
+  stats = connector->GetStats();
+  EXPECT_EQ(0, stats.hot_pair_hits + stats.cache_hits + stats.cache_misses);
+}
+
+TEST(ConnectorTest, HotPairsWith1ByteCost) {
+  // The hot pair table of this data contains the pairs of the special POS,
+  // whose costs are invalid.
+  const std::string path = testing::GetSourceFileOrDie(
+      {"data_manager", "testing", "connection_1byte.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  auto status_or_connector =
+      Connector::Create(cmmap.begin(), cmmap.size(), 256);
+  ASSERT_TRUE(status_or_connector.ok()) << status_or_connector.status();
+  auto connector = std::move(status_or_connector).value();
+  ASSERT_EQ(64, connector->GetResolution());
+  ASSERT_LT(0, connector->GetHotPairSize());
+
+  // Collects the keys in the table: [magic][bucket bits][keys][costs].
+  std::string data(cmmap.begin(), cmmap.size());
+  std::vector<std::pair<uint16_t, uint16_t>> hot_pairs;
+  size_t table_size = 0;
+  for (int bits = 1; bits <= 20; ++bits) {
+    const size_t size = 4 + (size_t{6} << bits);
+    if (size < data.size() &&
+        reinterpret_cast<const uint16_t *>(&data[data.size() - size])[1] ==
+            bits) {
+      table_size = size;
+      const uint32_t *keys =
+          reinterpret_cast<const uint32_t *>(&data[data.size() - size + 4]);
+      for (size_t i = 0; i < (size_t{1} << bits); ++i) {
+        if (keys[i] != 0xFFFFFFFF) {
+          hot_pairs.emplace_back(keys[i] >> 16, keys[i] & 0xFFFF);
+        }
+      }
+      break;
+    }
+  }
+  ASSERT_LT(0, table_size);
+  ASSERT_EQ(connector->GetHotPairSize(), hot_pairs.size());
+
+  data.resize(data.size() - table_size);
+  status_or_connector = Connector::Create(data.data(), data.size(), 256);
+  ASSERT_TRUE(status_or_connector.ok()) << status_or_connector.status();
+  auto plain_connector = std::move(status_or_connector).value();
+  EXPECT_EQ(0, plain_connector->GetHotPairSize());
+
+  // The hot pairs have the same costs as the matrix, including the invalid
+  // ones of the special POS (2722).
+  EXPECT_NE(hot_pairs.end(),
+            std::find(hot_pairs.begin(), hot_pairs.end(),
+                      std::pair<uint16_t, uint16_t>(2722, 2722)));
+  for (const auto &[rid, lid] : hot_pairs) {
+    EXPECT_EQ(plain_connector->GetTransitionCost(rid, lid),
+              connector->GetTransitionCost(rid, lid))
+        << "rid=" << rid << ", lid=" << lid;
+  }
+  EXPECT_EQ(hot_pairs.size(), connector->GetStats().hot_pair_hits);
+  EXPECT_EQ(0, plain_connector->GetStats().hot_pair_hits);
+}
+
 TEST(ConnectorTest, BrokenData) {
   const std::string path = testing::GetSourceFileOrDie(
       {"data_manager", "testing", "connection.data"});
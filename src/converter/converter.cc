@@ -327,7 +327,13 @@ bool ConverterImpl::Convert(const ConversionRequest &request,
     VLOG(1) << "ConvertForRequest failed for key: "
             << segments->segment(0).key();
   }
+  if (request.IsCancelled()) {
+    return false;
+  }
   RewriteAndSuppressCandidates(request, segments);
+  if (request.IsCancelled()) {
+    return false;
+  }
   TrimCandidates(request, segments);
   return IsValidSegments(request, *segments);
 }
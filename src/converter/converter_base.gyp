@@ -64,6 +64,7 @@
       'target_name': 'lattice',
       'type': 'static_library',
       'sources': [
+        'key_corrector.cc',
         'lattice.cc',
         'node_allocator.h',
       ],
@@ -117,7 +118,6 @@
       'type': 'static_library',
       'sources': [
         'immutable_converter.cc',
-        'key_corrector.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
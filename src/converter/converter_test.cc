@@ -29,6 +29,7 @@
 
 #include "converter/converter.h"
 
+#include <atomic>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -1326,6 +1327,26 @@ TEST_F(ConverterTest, ComposerKeySelection) {
   }
 }
 
+TEST_F(ConverterTest, Cancelled) {
+  std::unique_ptr<EngineInterface> engine =
+      MockDataEngineFactory::Create().value();
+  ConverterInterface *converter = engine->GetConverter();
+  composer::Table table;
+  config::Config config;
+  composer::Composer composer(&table, &default_request(), &config);
+  composer.InsertCharacterPreedit("わたし");
+  ConversionRequest request(&composer, &default_request(), &config);
+  std::atomic<bool> cancelled(true);
+  request.set_cancel_flag(&cancelled);
+  Segments segments;
+  EXPECT_FALSE(converter->StartConversionForRequest(request, &segments));
+
+  cancelled = false;
+  segments.Clear();
+  ASSERT_TRUE(converter->StartConversionForRequest(request, &segments));
+  EXPECT_EQ("私", segments.conversion_segment(0).candidate(0).value);
+}
+
 TEST_F(ConverterTest, SuppressionDictionaryForRewriter) {
   std::unique_ptr<ConverterAndData> ret(
       CreateConverterAndDataWithInsertDummyWordsRewriter());
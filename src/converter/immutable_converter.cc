@@ -1662,14 +1662,18 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
       (request.request_type() == ConversionRequest::CONVERSION);
   // Do not use KeyCorrector if user changes the boundary.
   // http://b/issue?id=2804996
-  std::unique_ptr<KeyCorrector> key_corrector;
+  // The corrector kept in the lattice only corrects the part of the key
+  // changed since the last conversion.
+  const KeyCorrector *key_corrector = nullptr;
   if (is_conversion && !segments.resized()) {
     KeyCorrector::InputMode mode = KeyCorrector::ROMAN;
     if (request.config().preedit_method() != config::Config::ROMAN) {
       mode = KeyCorrector::KANA;
     }
-    key_corrector =
-        std::make_unique<KeyCorrector>(key, mode, history_key.size());
+    KeyCorrector *corrector = lattice->mutable_key_corrector();
+    if (corrector->CorrectKey(key, mode, history_key.size())) {
+      key_corrector = corrector;
+    }
   }
 
   const bool is_reverse =
@@ -1695,7 +1699,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
       }
       CHECK(rnode != nullptr);
       lattice->Insert(pos, rnode);
-      InsertCorrectedNodes(pos, key, request, key_corrector.get(), dictionary_,
+      InsertCorrectedNodes(pos, key, request, key_corrector, dictionary_,
                            lattice);
     }
   }
@@ -2085,6 +2089,9 @@ bool ImmutableConverterImpl::ConvertForRequest(const ConversionRequest &request,
     LOG(WARNING) << "could not make lattice";
     return false;
   }
+  if (request.IsCancelled()) {
+    return false;
+  }
 
   std::vector<uint16_t> group;
   MakeGroup(*segments, &group);
@@ -2101,6 +2108,10 @@ bool ImmutableConverterImpl::ConvertForRequest(const ConversionRequest &request,
     }
   }
 
+  if (request.IsCancelled()) {
+    return false;
+  }
+
   VLOG(2) << lattice->DebugString();
   if (!MakeSegments(request, *lattice, group, segments)) {
     LOG(WARNING) << "make segments failed";
@@ -29,6 +29,7 @@
 
 #include "converter/key_corrector.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
@@ -38,6 +39,7 @@
 #include "base/port.h"
 #include "base/util.h"
 #include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 namespace {
@@ -49,6 +51,10 @@ constexpr size_t kMaxSize = 128;
 // invalid alignment marker
 constexpr size_t kInvalidPos = static_cast<size_t>(-1);
 
+// The maximum number of characters a rewrite step looks at.  A step is not
+// affected by the characters after this window.
+constexpr size_t kMaxRewriteWindowSize = 4;
+
 // "ん" (few "n" pettern)
 // "んあ" -> "んな"
 // "んい" -> "んに"
@@ -364,11 +370,18 @@ bool RewriteYu(size_t key_pos, const char *begin, const char *end,
 
 KeyCorrector::KeyCorrector(const std::string &key, InputMode mode,
                            size_t history_size)
-    : available_(false), mode_(mode) {
+    : available_(false),
+      mode_(mode),
+      history_size_(0),
+      identical_suffix_pos_(0) {
   CorrectKey(key, mode, history_size);
 }
 
-KeyCorrector::KeyCorrector() : available_(false), mode_(ROMAN) {}
+KeyCorrector::KeyCorrector()
+    : available_(false),
+      mode_(ROMAN),
+      history_size_(0),
+      identical_suffix_pos_(0) {}
 
 KeyCorrector::~KeyCorrector() {}
 
@@ -399,32 +412,99 @@ size_t KeyCorrector::GetOriginalPosition(const size_t corrected_key_pos) const {
 
 void KeyCorrector::Clear() {
   available_ = false;
+  history_size_ = 0;
   original_key_.clear();
   corrected_key_.clear();
   alignment_.clear();
   rev_alignment_.clear();
+  step_begins_.clear();
+  identical_suffix_pos_ = 0;
+}
+
+size_t KeyCorrector::EstimateMemoryUsage() const {
+  return sizeof(*this) + original_key_.capacity() +
+         corrected_key_.capacity() +
+         (alignment_.capacity() + rev_alignment_.capacity() +
+          step_begins_.capacity()) *
+             sizeof(size_t);
+}
+
+size_t KeyCorrector::GetReusableStepsSize(const std::string &key) const {
+  const size_t common_prefix_len =
+      std::mismatch(original_key_.begin(), original_key_.end(), key.begin(),
+                    key.end())
+          .first -
+      original_key_.begin();
+
+  // Positions of the last kMaxRewriteWindowSize characters in the common
+  // prefix.
+  size_t window[kMaxRewriteWindowSize];
+  size_t num_chars = 0;
+  for (size_t pos = 0; pos < common_prefix_len;) {
+    const size_t len = Util::OneCharLen(key.data() + pos);
+    if (pos + len > common_prefix_len) {
+      break;
+    }
+    window[num_chars % kMaxRewriteWindowSize] = pos;
+    ++num_chars;
+    pos += len;
+  }
+  if (num_chars < kMaxRewriteWindowSize) {
+    return 0;
+  }
+
+  // A step beginning at or before this position reads only the characters in
+  // the common prefix.
+  const size_t last_stable_pos = window[num_chars % kMaxRewriteWindowSize];
+  return std::upper_bound(step_begins_.begin(), step_begins_.end(),
+                          last_stable_pos) -
+         step_begins_.begin();
+}
+
+void KeyCorrector::TruncateSteps(size_t steps_size) {
+  DCHECK_LE(steps_size, step_begins_.size());
+  if (steps_size == step_begins_.size()) {
+    return;
+  }
+  const size_t original_pos = step_begins_[steps_size];
+  const size_t corrected_pos = alignment_[original_pos];
+  DCHECK(IsValidPosition(corrected_pos));
+  original_key_.resize(original_pos);
+  corrected_key_.resize(corrected_pos);
+  alignment_.resize(original_pos);
+  rev_alignment_.resize(corrected_pos);
+  step_begins_.resize(steps_size);
 }
 
 bool KeyCorrector::CorrectKey(const std::string &key, InputMode mode,
                               size_t history_size) {
-  Clear();
+  mode_ = mode;
 
   // TODO(taku)  support KANA
   if (mode == KANA) {
+    Clear();
     return false;
   }
 
   if (key.empty() || key.size() >= kMaxSize) {
     VLOG(1) << "invalid key length";
+    Clear();
     return false;
   }
 
-  original_key_ = key;
+  if (available_ && history_size == history_size_) {
+    TruncateSteps(GetReusableStepsSize(key));
+  } else {
+    Clear();
+  }
+  available_ = false;
+  history_size_ = history_size;
 
-  const char *begin = key.data();
+  const char *begin = key.data() + original_key_.size();
   const char *end = key.data() + key.size();
   const char *input_begin = key.data() + history_size;
-  size_t key_pos = 0;
+  size_t key_pos = step_begins_.size();
+  original_key_ = key;
 
   while (begin < end) {
     size_t mblen = 0;
@@ -448,6 +528,8 @@ bool KeyCorrector::CorrectKey(const std::string &key, InputMode mode,
       return false;
     }
 
+    step_begins_.push_back(static_cast<size_t>(begin - key.data()));
+
     // one to one mapping
     if (mblen == corrected_mblen) {
       const size_t len = static_cast<size_t>(begin - key.data());
@@ -474,6 +556,25 @@ bool KeyCorrector::CorrectKey(const std::string &key, InputMode mode,
   DCHECK_EQ(original_key_.size(), alignment_.size());
   DCHECK_EQ(corrected_key_.size(), rev_alignment_.size());
 
+  // Find the steps at the end which don't rewrite the key.
+  identical_suffix_pos_ = original_key_.size();
+  size_t original_end = original_key_.size();
+  size_t corrected_end = corrected_key_.size();
+  for (size_t i = step_begins_.size(); i > 0; --i) {
+    const size_t original_pos = step_begins_[i - 1];
+    const size_t corrected_pos = alignment_[original_pos];
+    const absl::string_view original(original_key_.data() + original_pos,
+                                     original_end - original_pos);
+    const absl::string_view corrected(corrected_key_.data() + corrected_pos,
+                                      corrected_end - corrected_pos);
+    if (original != corrected) {
+      break;
+    }
+    identical_suffix_pos_ = original_pos;
+    original_end = original_pos;
+    corrected_end = corrected_pos;
+  }
+
   available_ = true;
   return true;
 }
@@ -496,6 +597,12 @@ const char *KeyCorrector::GetCorrectedPrefix(const size_t original_key_pos,
     return nullptr;
   }
 
+  // No rewrite after |original_key_pos|.
+  if (original_key_pos >= identical_suffix_pos_) {
+    *length = 0;
+    return nullptr;
+  }
+
   const char *corrected_substr = corrected_key_.data() + corrected_key_pos;
   const size_t corrected_length = corrected_key_.size() - corrected_key_pos;
   const char *original_substr = original_key_.data() + original_key_pos;
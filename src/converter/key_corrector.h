@@ -50,6 +50,10 @@ class KeyCorrector {
 
   InputMode mode() const;
 
+  // Corrects |key|.  When the previous call succeeded with the same mode and
+  // history size, the rewrites of the common prefix of the previous key and
+  // |key| are reused, so that only the characters appended (or changed) at
+  // the end are corrected again.
   bool CorrectKey(const std::string &key, InputMode mode, size_t history_size);
 
   // return corrected key;
@@ -150,13 +154,28 @@ class KeyCorrector {
   // clear internal data
   void Clear();
 
+  // Returns the estimated number of bytes held by this instance.
+  size_t EstimateMemoryUsage() const;
+
  private:
+  // Returns the number of the rewrite steps of the current key which are not
+  // affected by changing the key to |key|.
+  size_t GetReusableStepsSize(const std::string &key) const;
+
+  // Removes the rewrite steps after the first |steps_size| steps.
+  void TruncateSteps(size_t steps_size);
+
   bool available_;
   InputMode mode_;
+  size_t history_size_;
   std::string corrected_key_;
   std::string original_key_;
   std::vector<size_t> alignment_;
   std::vector<size_t> rev_alignment_;
+  // The positions in original_key_ where each rewrite step begins.
+  std::vector<size_t> step_begins_;
+  // original_key_ and corrected_key_ are the same after this position.
+  size_t identical_suffix_pos_;
 
   DISALLOW_COPY_AND_ASSIGN(KeyCorrector);
 };
@@ -30,8 +30,10 @@
 #include "converter/key_corrector.h"
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
+#include "base/util.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -534,5 +536,77 @@ TEST(KeyCorrectorTest, Bug3046266Test) {
   }
 }
 
+// Incremental correction should give the same result as correcting the whole
+// key from scratch.
+void ExpectSameCorrection(const KeyCorrector &expected,
+                          const KeyCorrector &actual) {
+  const std::string &key = expected.original_key();
+  ASSERT_EQ(expected.IsAvailable(), actual.IsAvailable()) << key;
+  EXPECT_EQ(expected.original_key(), actual.original_key());
+  EXPECT_EQ(expected.corrected_key(), actual.corrected_key()) << key;
+  for (size_t pos = 0; pos <= key.size(); ++pos) {
+    EXPECT_EQ(expected.GetCorrectedPosition(pos),
+              actual.GetCorrectedPosition(pos))
+        << key << " " << pos;
+    size_t expected_length = 0, actual_length = 0;
+    const char *expected_prefix =
+        expected.GetCorrectedPrefix(pos, &expected_length);
+    const char *actual_prefix = actual.GetCorrectedPrefix(pos, &actual_length);
+    EXPECT_EQ(expected_prefix == nullptr, actual_prefix == nullptr)
+        << key << " " << pos;
+    EXPECT_EQ(expected_length, actual_length) << key << " " << pos;
+    for (size_t offset = 0; offset <= key.size(); ++offset) {
+      EXPECT_EQ(expected.GetOriginalOffset(pos, offset),
+                actual.GetOriginalOffset(pos, offset))
+          << key << " " << pos << " " << offset;
+    }
+  }
+  for (size_t pos = 0; pos <= expected.corrected_key().size(); ++pos) {
+    EXPECT_EQ(expected.GetOriginalPosition(pos),
+              actual.GetOriginalPosition(pos))
+        << key << " " << pos;
+  }
+}
+
+TEST(KeyCorrectorTest, IncrementalCorrection) {
+  const std::vector<std::string> kKeys = {
+      "せかいじゅのはっぱ", "みんあのほん",     "かっっったかっっての",
+      "こんんにちは",       "かんんあんお",     "しゅmばにゃにょ",
+      "きゅしゅちゅにゅ",   "😁みんあにゅんい", "かんあか",
+  };
+  for (const std::string &key : kKeys) {
+    for (size_t history_size : {0, 3, 6}) {
+      KeyCorrector corrector;
+      std::vector<std::string> prefixes;
+      // Type the key character by character.
+      for (size_t pos = 0; pos < key.size();) {
+        pos += Util::OneCharLen(key.data() + pos);
+        const std::string prefix = key.substr(0, pos);
+        prefixes.push_back(prefix);
+        corrector.CorrectKey(prefix, KeyCorrector::ROMAN, history_size);
+        const KeyCorrector expected(prefix, KeyCorrector::ROMAN, history_size);
+        ExpectSameCorrection(expected, corrector);
+      }
+      // Delete the characters one by one.
+      for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
+        corrector.CorrectKey(*it, KeyCorrector::ROMAN, history_size);
+        const KeyCorrector expected(*it, KeyCorrector::ROMAN, history_size);
+        ExpectSameCorrection(expected, corrector);
+      }
+    }
+  }
+
+  // The correction is recomputed when the history size changes.
+  KeyCorrector corrector("かんあか", KeyCorrector::ROMAN, 0);
+  EXPECT_EQ("かんなか", corrector.corrected_key());
+  EXPECT_TRUE(corrector.CorrectKey("かんあかんあ", KeyCorrector::ROMAN, 6));
+  EXPECT_EQ("かんあかんな", corrector.corrected_key());
+
+  // KANA mode is not supported.
+  EXPECT_FALSE(corrector.CorrectKey("かんあか", KeyCorrector::KANA, 0));
+  EXPECT_EQ(KeyCorrector::KANA, corrector.mode());
+  EXPECT_FALSE(corrector.IsAvailable());
+}
+
 }  // namespace
 }  // namespace mozc
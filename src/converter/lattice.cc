@@ -208,6 +208,14 @@ const std::string &Lattice::key() const { return key_; }
 
 bool Lattice::has_lattice() const { return !begin_nodes_.empty(); }
 
+size_t Lattice::EstimateMemoryUsage() const {
+  return sizeof(*this) + key_.capacity() +
+         (begin_nodes_.capacity() + end_nodes_.capacity()) * sizeof(Node *) +
+         cache_info_.capacity() * sizeof(size_t) + sizeof(NodeAllocator) +
+         node_allocator_->capacity() * sizeof(Node) +
+         key_corrector_.EstimateMemoryUsage() - sizeof(KeyCorrector);
+}
+
 void Lattice::Clear() {
   key_.clear();
   begin_nodes_.clear();
@@ -341,6 +349,8 @@ void Lattice::SetCacheInfo(const size_t pos, const size_t len) {
   cache_info_[pos] = len;
 }
 
+KeyCorrector *Lattice::mutable_key_corrector() { return &key_corrector_; }
+
 void Lattice::ResetNodeCost() {
   for (size_t i = 0; i <= key_.size(); ++i) {
     if (begin_nodes_[i] != nullptr) {
@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "converter/key_corrector.h"
 #include "converter/node.h"
 #include "converter/node_allocator.h"
 #include "absl/strings/string_view.h"
@@ -85,6 +86,10 @@ class Lattice {
   // clear all lattice and nodes allocated with NewNode method.
   void Clear();
 
+  // Returns the estimated number of bytes held by this lattice, including the
+  // node chunks retained for reuse.
+  size_t EstimateMemoryUsage() const;
+
   // return true if this instance has a valid lattice.
   bool has_lattice() const;
 
@@ -103,6 +108,10 @@ class Lattice {
   // setter
   void SetCacheInfo(const size_t pos, const size_t len);
 
+  // Key corrector shared by the lookups for this lattice.  It is kept across
+  // Clear() and updates the correction incrementally as the key grows.
+  KeyCorrector *mutable_key_corrector();
+
   // revert the wcost of nodes if it has ENABLE_CACHE attribute.
   // This function is needed for wcost may be changed during conversion
   // process for some heuristic methods.
@@ -130,6 +139,8 @@ class Lattice {
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  KeyCorrector key_corrector_;
 };
 
 }  // namespace mozc
@@ -33,6 +33,7 @@
 #include <string>
 
 #include "base/port.h"
+#include "converter/key_corrector.h"
 #include "converter/node.h"
 #include "testing/base/public/gunit.h"
 #include "absl/container/btree_set.h"
@@ -68,6 +69,40 @@ TEST(LatticeTest, NewNodeTest) {
   EXPECT_EQ(0, node->rid);
 }
 
+TEST(LatticeTest, NodesAreReusedAfterClear) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  for (int i = 0; i < 3000; ++i) {
+    lattice.NewNode()->value = "ほげ";
+  }
+  const size_t capacity = lattice.node_allocator()->capacity();
+  EXPECT_LE(3000, capacity);
+
+  // The memory for the nodes is kept for the next request.
+  lattice.Clear();
+  EXPECT_EQ(0, lattice.node_allocator()->node_count());
+  EXPECT_EQ(capacity, lattice.node_allocator()->capacity());
+
+  // Reused nodes are initialized.
+  lattice.SetKey("test");
+  Node *node = lattice.NewNode();
+  EXPECT_TRUE(node->value.empty());
+  EXPECT_EQ(0, node->lid);
+}
+
+TEST(LatticeTest, KeyCorrectorIsKeptAfterClear) {
+  Lattice lattice;
+  KeyCorrector *corrector = lattice.mutable_key_corrector();
+  EXPECT_FALSE(corrector->IsAvailable());
+  EXPECT_TRUE(corrector->CorrectKey("みんあ", KeyCorrector::ROMAN, 0));
+
+  lattice.Clear();
+  EXPECT_EQ(corrector, lattice.mutable_key_corrector());
+  EXPECT_TRUE(corrector->IsAvailable());
+  EXPECT_TRUE(corrector->CorrectKey("みんあの", KeyCorrector::ROMAN, 0));
+  EXPECT_EQ("みんなの", corrector->corrected_key());
+}
+
 TEST(LatticeTest, InsertTest) {
   Lattice lattice;
 
@@ -51,6 +51,13 @@ namespace mozc {
 namespace {
 
 constexpr int kFreeListSize = 512;
+// The number of the chunks of the queue elements kept for the next segment.
+// The chunks allocated beyond this by a long conversion are released.
+#ifdef OS_ANDROID
+constexpr size_t kMaxRetainedChunks = 1;
+#else   // OS_ANDROID
+constexpr size_t kMaxRetainedChunks = 4;
+#endif  // OS_ANDROID
 constexpr int kCostDiff = 3453;  // log prob of 1/1000
 
 }  // namespace
@@ -135,7 +142,9 @@ NBestGenerator::~NBestGenerator() {}
 void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
                            const BoundaryCheckMode mode) {
   agenda_.Clear();
-  freelist_.Free();
+  // Keeps up to kMaxRetainedChunks chunks for the next segment; every element
+  // is initialized in CreateNewElement().
+  freelist_.Recycle(kMaxRetainedChunks);
   top_nodes_.clear();
   filter_->Reset();
   viterbi_result_checked_ = false;
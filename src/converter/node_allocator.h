@@ -39,6 +39,12 @@ namespace mozc {
 
 class NodeAllocator {
  public:
+#ifdef OS_ANDROID
+  static constexpr size_t kMaxRetainedChunks = 1;
+#else   // OS_ANDROID
+  static constexpr size_t kMaxRetainedChunks = 4;
+#endif  // OS_ANDROID
+
   NodeAllocator()
       : node_freelist_(1024), max_nodes_size_(8192), node_count_(0) {}
   ~NodeAllocator() {}
@@ -51,12 +57,18 @@ class NodeAllocator {
     return node;
   }
 
-  // Frees all nodes allocateed by NewNode().
+  // Frees all nodes allocateed by NewNode().  The memory for the nodes is
+  // kept up to kMaxRetainedChunks chunks and reused by the next request
+  // (including the buffers of the strings in the nodes), so the lattice of
+  // the next key stroke is mostly built without malloc.
   void Free() {
-    node_freelist_.Free();
+    node_freelist_.Recycle(kMaxRetainedChunks);
     node_count_ = 0;
   }
 
+  // Returns the number of nodes allocatable without a new memory chunk.
+  size_t capacity() const { return node_freelist_.capacity(); }
+
   size_t max_nodes_size() const { return max_nodes_size_; }
 
   void set_max_nodes_size(size_t max_nodes_size) {
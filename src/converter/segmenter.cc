@@ -30,6 +30,7 @@
 #include "converter/segmenter.h"
 
 #include <cstdint>
+#include <vector>
 
 #include "base/bitarray.h"
 #include "base/logging.h"
@@ -71,6 +72,19 @@ Segmenter::Segmenter(size_t l_num_elements, size_t r_num_elements,
   DCHECK(bitarray_data_);
   DCHECK(boundary_data_);
   CHECK_LE(l_num_elements_ * r_num_elements_, bitarray_num_bytes_ * 8);
+
+  // The compressed bitarray is indexed by (l + l_num_elements * r), i.e.,
+  // the bits for a left state are scattered.  Transposes it into rows.
+  words_per_row_ = (r_num_elements_ + 63) / 64;
+  rows_.assign(l_num_elements_ * words_per_row_, 0);
+  for (size_t l = 0; l < l_num_elements_; ++l) {
+    uint64_t *row = &rows_[l * words_per_row_];
+    for (size_t r = 0; r < r_num_elements_; ++r) {
+      if (BitArray::GetValue(bitarray_data_, l + l_num_elements_ * r)) {
+        row[r / 64] |= uint64_t{1} << (r % 64);
+      }
+    }
+  }
 }
 
 Segmenter::~Segmenter() {}
@@ -103,10 +117,8 @@ bool Segmenter::IsBoundary(const Node &lnode, const Node &rnode,
 }
 
 bool Segmenter::IsBoundary(uint16_t rid, uint16_t lid) const {
-  const uint32_t bitarray_index =
-      l_table_[rid] + l_num_elements_ * r_table_[lid];
-  return BitArray::GetValue(reinterpret_cast<const char *>(bitarray_data_),
-                            bitarray_index);
+  const uint32_t r = r_table_[lid];
+  return (GetRow(rid)[r / 64] >> (r % 64)) & 1;
 }
 
 int32_t Segmenter::GetPrefixPenalty(uint16_t lid) const {
@@ -31,6 +31,7 @@
 #define MOZC_CONVERTER_SEGMENTER_H_
 
 #include <cstdint>
+#include <vector>
 
 #include "base/port.h"
 
@@ -66,6 +67,17 @@ class Segmenter {
   const char *bitarray_data_;
   const uint16_t *boundary_data_;
 
+  // Returns the row of the boundary bitmap for |rid|.
+  const uint64_t *GetRow(uint16_t rid) const {
+    return &rows_[l_table_[rid] * words_per_row_];
+  }
+
+  // The boundary bitmap rearranged so that each compressed left state has a
+  // 64-bit aligned row over the compressed right states.  A lookup loads one
+  // word of the row and shifts it.
+  std::vector<uint64_t> rows_;
+  size_t words_per_row_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(Segmenter);
 };
 
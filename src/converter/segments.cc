@@ -49,6 +49,17 @@
 namespace mozc {
 namespace {
 constexpr size_t kMaxHistorySize = 32;
+
+size_t EstimateCandidateMemoryUsage(const Segment::Candidate &candidate) {
+  return sizeof(candidate) + candidate.key.capacity() +
+         candidate.value.capacity() + candidate.content_key.capacity() +
+         candidate.content_value.capacity() + candidate.prefix.capacity() +
+         candidate.suffix.capacity() + candidate.description.capacity() +
+         candidate.a11y_description.capacity() +
+         candidate.usage_title.capacity() +
+         candidate.usage_description.capacity() +
+         candidate.inner_segment_boundary.capacity() * sizeof(uint32_t);
+}
 }  // namespace
 
 absl::string_view Segment::Candidate::functional_key() const {
@@ -441,6 +452,25 @@ void Segment::Clear() {
   segment_type_ = FREE;
 }
 
+size_t Segment::EstimateMemoryUsage() const {
+  size_t size = sizeof(*this) + key_.capacity() +
+                candidates_.size() * sizeof(Candidate *) +
+                pool_.capacity() * sizeof(std::unique_ptr<Candidate>);
+  // |pool_| owns all the candidates in |candidates_| and the erased ones.
+  for (const std::unique_ptr<Candidate> &candidate : pool_) {
+    if (candidate != nullptr) {
+      size += EstimateCandidateMemoryUsage(*candidate);
+    }
+  }
+  for (const Candidate &candidate : meta_candidates_) {
+    size += EstimateCandidateMemoryUsage(candidate);
+  }
+  for (const Candidate &candidate : removed_candidates_for_debug_) {
+    size += EstimateCandidateMemoryUsage(candidate);
+  }
+  return size;
+}
+
 void Segment::DeepCopyCandidates(const std::deque<Candidate *> &candidates) {
   DCHECK(pool_.empty());
   pool_.reserve(candidates.size());
@@ -469,12 +499,14 @@ std::string Segment::DebugString() const {
 Segments::Segments()
     : max_history_segments_size_(0),
       resized_(false),
+      degraded_(false),
       pool_(32),
       cached_lattice_(new Lattice()) {}
 
 Segments::Segments(const Segments &x)
     : max_history_segments_size_(x.max_history_segments_size_),
       resized_(x.resized_),
+      degraded_(x.degraded_),
       pool_(32),
       revert_entries_(x.revert_entries_),
       cached_lattice_(new Lattice()) {
@@ -492,6 +524,7 @@ Segments &Segments::operator=(const Segments &x) {
 
   max_history_segments_size_ = x.max_history_segments_size_;
   resized_ = x.resized_;
+  degraded_ = x.degraded_;
   // Deep-copy segments.
   for (const Segment *segment : x.segments_) {
     *add_segment() = *segment;
@@ -606,6 +639,7 @@ void Segments::Clear() {
 void Segments::clear_segments() {
   pool_.Free();
   resized_ = false;
+  degraded_ = false;
   segments_.clear();
 }
 
@@ -626,6 +660,7 @@ void Segments::clear_conversion_segments() {
     pool_.Release(mutable_segment(i));
   }
   resized_ = false;
+  degraded_ = false;
   segments_.resize(size);
 }
 
@@ -643,6 +678,10 @@ void Segments::set_resized(bool resized) { resized_ = resized; }
 
 bool Segments::resized() const { return resized_; }
 
+void Segments::set_degraded(bool degraded) { degraded_ = degraded; }
+
+bool Segments::degraded() const { return degraded_; }
+
 void Segments::clear_revert_entries() { revert_entries_.clear(); }
 
 size_t Segments::revert_entries_size() const { return revert_entries_.size(); }
@@ -667,6 +706,20 @@ Segments::RevertEntry *Segments::mutable_revert_entry(size_t i) {
 
 Lattice *Segments::mutable_cached_lattice() { return cached_lattice_.get(); }
 
+void Segments::clear_cached_lattice() {
+  cached_lattice_ = std::make_unique<Lattice>();
+}
+
+size_t Segments::EstimateMemoryUsage() const {
+  size_t size = sizeof(*this) + segments_.size() * sizeof(Segment *) +
+                revert_entries_.capacity() * sizeof(RevertEntry) +
+                cached_lattice_->EstimateMemoryUsage();
+  for (const Segment *segment : segments_) {
+    size += segment->EstimateMemoryUsage();
+  }
+  return size;
+}
+
 std::string Segments::DebugString() const {
   std::stringstream os;
   os << "{" << std::endl;
@@ -352,6 +352,9 @@ class Segment final {
   // Keep clear() method as other modules are still using the old method
   void clear() { Clear(); }
 
+  // Returns the estimated number of bytes held by this segment.
+  size_t EstimateMemoryUsage() const;
+
   std::string DebugString() const;
 
   friend std::ostream &operator<<(std::ostream &os, const Segment &segment) {
@@ -462,6 +465,11 @@ class Segments final {
   bool resized() const;
   void set_resized(bool resized);
 
+  // True if the conversion segments are a best-effort result, i.e., some
+  // stages of prediction were skipped because of the deadline of the request.
+  bool degraded() const;
+  void set_degraded(bool degraded);
+
   // clear segments
   void Clear();
 
@@ -481,11 +489,18 @@ class Segments final {
 
   // setter
   Lattice *mutable_cached_lattice();
+  // Releases the memory of the cached lattice.
+  void clear_cached_lattice();
+
+  // Returns the estimated number of bytes held by this instance, including
+  // the cached lattice.
+  size_t EstimateMemoryUsage() const;
 
  private:
   // LINT.IfChange
   size_t max_history_segments_size_;
   bool resized_;
+  bool degraded_;
 
   ObjectPool<Segment> pool_;
   std::deque<Segment *> segments_;
@@ -345,6 +345,27 @@ TEST(SegmentsTest, RevertEntryTest) {
   EXPECT_EQ(0, segments.revert_entries_size());
 }
 
+TEST(SegmentsTest, EstimateMemoryUsage) {
+  Segments segments;
+  const size_t empty_size = segments.EstimateMemoryUsage();
+
+  Segment *segment = segments.add_segment();
+  segment->set_key("key");
+  for (int i = 0; i < 10; ++i) {
+    segment->add_candidate()->value = std::string(100, 'a');
+  }
+  const size_t size = segments.EstimateMemoryUsage();
+  EXPECT_GT(size, empty_size + 10 * 100);
+
+  Lattice *lattice = segments.mutable_cached_lattice();
+  lattice->SetKey("key");
+  lattice->NewNode();
+  EXPECT_GT(segments.EstimateMemoryUsage(), size);
+
+  segments.clear_cached_lattice();
+  EXPECT_EQ(size, segments.EstimateMemoryUsage());
+}
+
 TEST(SegmentsTest, CopyTest) {
   Segments src;
 
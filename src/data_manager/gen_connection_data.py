@@ -31,6 +31,7 @@
 """Generator script for connection data."""
 
 import codecs
+import heapq
 import io
 import logging
 import optparse
@@ -44,6 +45,15 @@ INVALID_COST = 30000
 INVALID_1BYTE_COST = 255
 RESOLUTION_FOR_1BYTE = 64
 FILE_MAGIC = b'\xAB\xCD'
+HOT_PAIR_MAGIC = b'\xAC\xCD'
+HOT_PAIR_EMPTY_KEY = 0xFFFFFFFF
+# Stands for INVALID_COST in the hot pair table, like INVALID_1BYTE_COST in
+# the matrix.  Must be the same as kHotPairInvalidCost in
+# converter/connector.cc.
+HOT_PAIR_INVALID_COST = 0xFFFF
+# Must be the same as kMaxHotPairProbe in converter/connector.cc.
+MAX_HOT_PAIR_PROBE = 4
+DEFAULT_NUM_HOT_PAIRS = 2048
 
 FALSE_VALUES = ['f', 'false', '0']
 TRUE_VALUES = ['t', 'true', '1']
@@ -250,6 +260,122 @@ def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
   return stream.getvalue()
 
 
+def CountPosFrequency(dictionary_files, mat_size):
+  """Counts the lid and rid occurrences in the dictionary files."""
+  lid_count = [0] * mat_size
+  rid_count = [0] * mat_size
+  for path in dictionary_files:
+    with codecs.open(path, 'r', encoding='utf-8') as stream:
+      for line in stream:
+        fields = line.rstrip('\n').split('\t')
+        if len(fields) < 5:
+          continue
+        lid = int(fields[1])
+        rid = int(fields[2])
+        if lid < mat_size:
+          lid_count[lid] += 1
+        if rid < mat_size:
+          rid_count[rid] += 1
+  return lid_count, rid_count
+
+
+def SelectHotPairs(lid_count, rid_count, num_hot_pairs):
+  """Returns the (rid, lid) pairs most likely to be looked up.
+
+  The converter computes the transition cost for every pair of adjacent nodes
+  in the lattice, so the lookup frequency of (rid, lid) is estimated by the
+  product of the number of words having the rid and the lid.  BOS/EOS (id 0)
+  is always looked up for the first and last nodes, so it is counted as
+  frequent as the most frequent POS.
+  """
+  rid_count = list(rid_count)
+  lid_count = list(lid_count)
+  rid_count[0] = max(rid_count)
+  lid_count[0] = max(lid_count)
+  rids = sorted((i for i, c in enumerate(rid_count) if c > 0),
+                key=lambda i: -rid_count[i])
+  lids = sorted((i for i, c in enumerate(lid_count) if c > 0),
+                key=lambda i: -lid_count[i])
+  if not rids or not lids:
+    return []
+
+  # Enumerates the pairs in the descending order of the product.
+  result = []
+  heap = [(-rid_count[rids[0]] * lid_count[lids[0]], 0, 0)]
+  visited = set([(0, 0)])
+  while heap and len(result) < num_hot_pairs:
+    _, i, j = heapq.heappop(heap)
+    result.append((rids[i], lids[j]))
+    for ni, nj in ((i + 1, j), (i, j + 1)):
+      if ni < len(rids) and nj < len(lids) and (ni, nj) not in visited:
+        visited.add((ni, nj))
+        heapq.heappush(heap, (-rid_count[rids[ni]] * lid_count[lids[nj]],
+                              ni, nj))
+  return result
+
+
+def GetHotPairBucket(rid, lid, bucket_bits):
+  # Must be the same as GetHotPairBucket() in converter/connector.cc.
+  key = (rid << 16) | lid
+  return ((key * 2654435761) & 0xFFFFFFFF) >> (32 - bucket_bits)
+
+
+def BuildHotPairData(matrix, mode_value_list, hot_pairs, use_1byte_cost):
+  """Builds the open addressing hash table of the hot pairs.
+
+  The table is appended to the connection data, so that the frequent
+  transitions are always looked up in O(1) regardless of the runtime cache.
+
+  The format is as follows:
+  HOT_PAIR_MAGIC (\xAC\xCD): 2bytes
+  Number of the bucket bits: 2bytes
+  Keys ((rid << 16) | lid): 4bytes * 2^bucket_bits
+  Costs: 2bytes * 2^bucket_bits (aligned to 32bits)
+
+  The costs are the ones returned by the connector, i.e., already multiplied
+  by the resolution.  INVALID_COST is stored as HOT_PAIR_INVALID_COST, which
+  the connector decodes to the same value as the matrix.
+  """
+  # Keeps the load factor at most 0.5.
+  bucket_bits = 1
+  while (1 << bucket_bits) < len(hot_pairs) * 2:
+    bucket_bits += 1
+  num_buckets = 1 << bucket_bits
+  resolution = RESOLUTION_FOR_1BYTE if use_1byte_cost else 1
+
+  keys = [HOT_PAIR_EMPTY_KEY] * num_buckets
+  costs = [0] * num_buckets
+  for rid, lid in hot_pairs:
+    cost = matrix[rid][lid]
+    if cost is None:
+      cost = mode_value_list[rid]
+    elif cost == INVALID_COST:
+      cost = HOT_PAIR_INVALID_COST
+    elif use_1byte_cost:
+      # Same quantization as the matrix.
+      cost = cost // resolution * resolution
+    bucket = GetHotPairBucket(rid, lid, bucket_bits)
+    for probe in range(MAX_HOT_PAIR_PROBE):
+      index = (bucket + probe) & (num_buckets - 1)
+      if keys[index] == HOT_PAIR_EMPTY_KEY:
+        keys[index] = (rid << 16) | lid
+        costs[index] = cost
+        break
+
+  stream = io.BytesIO()
+  stream.write(HOT_PAIR_MAGIC)
+  stream.write(struct.pack('<H', bucket_bits))
+  for key in keys:
+    stream.write(struct.pack('<I', key))
+  for cost in costs:
+    assert 0 <= cost <= 65535
+    stream.write(struct.pack('<H', cost))
+  # 4 bytes alignment.
+  if num_buckets % 2:
+    stream.write(b'\x00\x00')
+  return stream.getvalue()
+
+
 def ParseOptions():
   parser = optparse.OptionParser()
   parser.add_option('--text_connection_file', dest='text_connection_file')
@@ -259,6 +385,12 @@ def ParseOptions():
   parser.add_option('--use_1byte_cost', dest='use_1byte_cost')
   parser.add_option('--binary_output_file', dest='binary_output_file')
   parser.add_option('--header_output_file', dest='header_output_file')
+  parser.add_option('--dictionary_files', dest='dictionary_files',
+                    help='Space separated dictionary files to estimate the '
+                    'frequencies of the transitions.  If not specified, the '
+                    'hot pair table is not generated.')
+  parser.add_option('--num_hot_pairs', dest='num_hot_pairs', type='int',
+                    default=DEFAULT_NUM_HOT_PAIRS)
   return parser.parse_args()[0]
 
 
@@ -271,8 +403,15 @@ def main():
       options.text_connection_file, pos_size, special_pos_size)
   mode_value_list = CreateModeValueList(matrix)
   CompressMatrixByModeValue(matrix, mode_value_list)
-  binary = BuildBinaryData(
-      matrix, mode_value_list, ParseBoolFlag(options.use_1byte_cost))
+  use_1byte_cost = ParseBoolFlag(options.use_1byte_cost)
+  binary = BuildBinaryData(matrix, mode_value_list, use_1byte_cost)
+
+  if options.dictionary_files and options.num_hot_pairs > 0:
+    lid_count, rid_count = CountPosFrequency(
+        options.dictionary_files.split(), len(matrix))
+    hot_pairs = SelectHotPairs(lid_count, rid_count, options.num_hot_pairs)
+    binary += BuildHotPairData(
+        matrix, mode_value_list, hot_pairs, use_1byte_cost)
 
   if options.binary_output_file:
     dirpath = os.path.dirname(options.binary_output_file)
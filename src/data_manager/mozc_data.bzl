@@ -316,7 +316,7 @@ def mozc_dataset(
             name + "@connection_single_column",
             id_def,
             special_pos,
-        ],
+        ] + dictionary_srcs,
         outs = ["connection.data"],
         cmd = (
             "$(location //data_manager:gen_connection_data) " +
@@ -325,7 +325,8 @@ def mozc_dataset(
             "--id_file=$(location " + id_def + ") " +
             "--special_pos_file=$(location " + special_pos + ") " +
             "--binary_output_file=$@ " +
-            "--use_1byte_cost=" + use_1byte_cost
+            "--use_1byte_cost=" + use_1byte_cost + " " +
+            "--dictionary_files=\"" + " ".join(["$(locations %s)" % s for s in dictionary_srcs]) + "\""
         ),
         exec_tools = ["//data_manager:gen_connection_data"],
     )
@@ -99,9 +99,33 @@ SerializedDictionary::~SerializedDictionary() {}
 
 SerializedDictionary::IterRange SerializedDictionary::equal_range(
     absl::string_view key) const {
-  // TODO(noriyukit): Instead of comparing key as string, we can do binary
-  // search using key index to minimize string comparison cost.
-  return std::equal_range(begin(), end(), key);
+  if (!string_array_.has_hash_index()) {
+    return std::equal_range(begin(), end(), key);
+  }
+  // The string array with the hash index consists of unique strings in
+  // ascending order (see Compile()), so the tokens are sorted by key index too
+  // and the search needs no string comparison.
+  const auto str_iter = string_array_.find(key);
+  if (str_iter == string_array_.end()) {
+    return IterRange(end(), end());
+  }
+  const uint32_t key_index = str_iter.index();
+  const_iterator first = begin();
+  for (size_t count = size(); count > 0;) {
+    const size_t step = count / 2;
+    const const_iterator iter = first + step;
+    if (iter.key_index() < key_index) {
+      first = iter + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  const_iterator last = first;
+  while (last != end() && last.key_index() == key_index) {
+    ++last;
+  }
+  return IterRange(first, last);
 }
 
 std::pair<absl::string_view, absl::string_view> SerializedDictionary::Compile(
@@ -180,7 +204,7 @@ std::pair<absl::string_view, absl::string_view> SerializedDictionary::Compile(
       strings.emplace_back(kv.first);
     }
     string_array = SerializedStringArray::SerializeToBuffer(
-        strings, output_string_array_buf);
+        strings, output_string_array_buf, /*build_hash_index=*/true);
   }
 
   return std::pair<absl::string_view, absl::string_view>(token_array,
@@ -218,6 +242,7 @@ bool SerializedDictionary::VerifyData(absl::string_view token_array_data,
   if (!string_array.Init(string_array_data)) {
     return false;
   }
+  uint32_t prev_key_index = 0;
   for (const char *ptr = token_array_data.data();
        ptr != token_array_data.data() + token_array_data.size();
        ptr += kTokenByteLength) {
@@ -228,6 +253,12 @@ bool SerializedDictionary::VerifyData(absl::string_view token_array_data,
         u32_ptr[3] >= string_array.size()) {
       return false;
     }
+    // equal_range() relies on the order of key indices if the hash index is
+    // available.
+    if (string_array.has_hash_index() && u32_ptr[0] < prev_key_index) {
+      return false;
+    }
+    prev_key_index = u32_ptr[0];
   }
   return true;
 }
@@ -108,6 +108,11 @@ namespace mozc {
 // byte boundary by the insertion of padding.  String values of a token (key,
 // value, description, additional_description) can be retrieved from the string
 // array by index.
+//
+// If the string array has the hash index (see serialized_string_array.h), its
+// strings must be unique and sorted, as Compile() creates them.  Then
+// equal_range() finds the key index by hash and searches tokens by the index
+// without string comparison.
 class SerializedDictionary {
  public:
   struct CompilerToken {
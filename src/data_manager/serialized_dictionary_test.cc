@@ -72,6 +72,7 @@ TEST_F(SerializedDictionaryTest, Compile) {
   SerializedStringArray string_array;
   ASSERT_TRUE(string_array.Init(string_array_data_));
   ASSERT_EQ(10, string_array.size());
+  EXPECT_TRUE(string_array.has_hash_index());
   EXPECT_EQ("", string_array[0]);
   EXPECT_EQ("adesc1", string_array[1]);
   EXPECT_EQ("adesc2", string_array[2]);
@@ -60,6 +60,53 @@
         },
       ],
     },
+    {
+      # Connection data with 1-byte costs, to test the quantized costs.  The
+      # hot pair table contains the pairs of the special POS.
+      'target_name': 'install_test_connection_1byte_data',
+      'type': 'none',
+      'dependencies': [
+        'mock_data_manager.gyp:gen_connection_single_column_txt_for_mock#host',
+      ],
+      'actions': [
+        {
+          'action_name': 'gen_connection_1byte_data',
+          'variables': {
+            'text_connection_file': '<(gen_out_dir)/connection_single_column.txt',
+            'id_file': '../../data/test/dictionary/id.def',
+            'special_pos_file': '../../data/rules/special_pos.def',
+            'dictionary_file': 'hot_pair_dictionary.txt',
+          },
+          'inputs': [
+            '../gen_connection_data.py',
+            '<(text_connection_file)',
+            '<(id_file)',
+            '<(special_pos_file)',
+            '<(dictionary_file)',
+          ],
+          'outputs': [
+            '<(gen_out_dir)/connection_1byte.data',
+          ],
+          'action': [
+            '<(python)', '../gen_connection_data.py',
+            '--text_connection_file', '<(text_connection_file)',
+            '--id_file', '<(id_file)',
+            '--special_pos_file', '<(special_pos_file)',
+            '--binary_output_file', '<@(_outputs)',
+            '--use_1byte_cost', 'true',
+            '--dictionary_files=<(dictionary_file)',
+          ],
+        },
+      ],
+      'copies': [
+        {
+          'destination': '<(mozc_data_dir)/data_manager/testing/',
+          'files': [
+            '<(gen_out_dir)/connection_1byte.data',
+          ],
+        }
+      ],
+    },
     {
       'target_name': 'install_test_connection_txt',
       'type': 'none',
@@ -157,6 +157,20 @@ void DictionaryImpl::LookupPredictive(
   }
 }
 
+void DictionaryImpl::LookupPredictiveByCost(
+    absl::string_view key, const ConversionRequest &conversion_request,
+    size_t max_tokens, Callback *callback) const {
+  CallbackWithFilter callback_with_filter(
+      conversion_request.config().use_spelling_correction(),
+      conversion_request.config().use_zip_code_conversion(),
+      conversion_request.config().use_t13n_conversion(), pos_matcher_,
+      suppression_dictionary_, callback);
+  for (size_t i = 0; i < dics_.size(); ++i) {
+    dics_[i]->LookupPredictiveByCost(key, conversion_request, max_tokens,
+                                     &callback_with_filter);
+  }
+}
+
 void DictionaryImpl::LookupPrefix(absl::string_view key,
                                   const ConversionRequest &conversion_request,
                                   Callback *callback) const {
@@ -69,6 +69,10 @@ class DictionaryImpl : public DictionaryInterface {
   void LookupPredictive(absl::string_view key,
                         const ConversionRequest &conversion_request,
                         Callback *callback) const override;
+  void LookupPredictiveByCost(absl::string_view key,
+                              const ConversionRequest &conversion_request,
+                              size_t max_tokens,
+                              Callback *callback) const override;
   void LookupPrefix(absl::string_view key,
                     const ConversionRequest &conversion_request,
                     Callback *callback) const override;
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_DICTIONARY_INTERFACE_H_
 #define MOZC_DICTIONARY_DICTIONARY_INTERFACE_H_
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -123,6 +124,15 @@ class DictionaryInterface {
                                 const ConversionRequest &conversion_request,
                                 Callback *callback) const = 0;
 
+  // Looks up at most |max_tokens| values whose keys start from the key,
+  // preferring the ones of lower cost to the ones of shorter keys.  The
+  // default implementation is LookupPredictive().
+  virtual void LookupPredictiveByCost(
+      absl::string_view key, const ConversionRequest &conversion_request,
+      size_t max_tokens, Callback *callback) const {
+    LookupPredictive(key, conversion_request, callback);
+  }
+
   // Looks up values whose keys are prefixes of the key.
   // (e.g. key = "abc" -> {"abc": "ABC", "a": "A"})
   virtual void LookupPrefix(absl::string_view key,
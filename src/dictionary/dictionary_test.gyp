@@ -39,7 +39,9 @@
       'sources': [
         'dictionary_impl_test.cc',
         'dictionary_mock_test.cc',
+        'pos_matcher_test.cc',
         'suffix_dictionary_test.cc',
+        'user_dictionary_cache_test.cc',
         'user_dictionary_importer_test.cc',
         'user_dictionary_session_handler_test.cc',
         'user_dictionary_session_test.cc',
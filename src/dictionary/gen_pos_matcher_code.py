@@ -40,15 +40,22 @@ This class has two methods for each POS matching rule:
 - IsXXX(uint16 id): checks if the given POS ID is XXX or not.
 Here, XXX is replaced by rule names; see data/rules/pos_matcher_rule.def.
 
+Each rule also has an enum value kXXX.  RuleMask, created by MakeRuleMask(),
+combines several rules so that IsAnyOf() can test all of them for one POS ID at
+once.
+
 PosMathcer is created from the data generated by this script.
 The binary format is as follows.
 
 * Binary format
 
-Support there are N matching rules.  Then, the first 2*N bytes is the array of
-uint16 that contains the results for GetXXXId() methods.  The latter part
-contains the ranges of POS IDs for each IsXXX(uint16 id) methods (IsXXX should
-return true if id is in one of the ranges).  See the following figure:
+Support there are N matching rules and M POS IDs (i.e., the max POS ID is
+M - 1).  Then, the first 2*N bytes is the array of uint16 that contains the
+results for GetXXXId() methods.  It is followed by M and the table of rule
+bitmasks indexed by POS ID.  The bitmask of each POS ID consists of
+W = ceil(N / 16) words of uint16, where the bit (i % 16) of the word (i / 16) is
+set iff the POS ID matches rule i.  Thus IsXXX() is a single load-and-test.
+See the following figure:
 
 +===========================================+=============================
 | POS ID for rule 0 (2 bytes)               |   For GetXXXID() methods
@@ -59,30 +66,20 @@ return true if id is in one of the ranges).  See the following figure:
 +-------------------------------------------+
 | POS ID for rule N - 1 (2 bytes)           |
 +===========================================+=============================
-| POS range for rule 0: start 0 (2 bytes)   |   For IsXXX() for rule 0
+| The number of POS IDs M (2 bytes)         |
++===========================================+=============================
+| Rules 0-15 for POS ID 0 (2 bytes)         |   For IsXXX() for POS ID 0
 + - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end 0 (2 bytes)     |
-+-------------------------------------------+
-| POS range for rule 0: start 1 (2 bytes)   |
+| Rules 16-31 for POS ID 0 (2 bytes)        |
 + - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end 1 (2 bytes)     |
-|-------------------------------------------+
 | ....                                      |
-|-------------------------------------------+
-| POS range for rule 0: start M (2 bytes)   |
 + - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end M (2 bytes)     |
-|-------------------------------------------+
-| Sentinel element 0xFFFF (2 bytes)         |
+| Rules 16*(W-1)- for POS ID 0 (2 bytes)    |
 +===========================================+=============================
-| POS range for rule 1: start 0 (2 bytes)   |   For IsXXX() for rule 1
+| Rules 0-15 for POS ID 1 (2 bytes)         |   For IsXXX() for POS ID 1
 + - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 1: end 0 (2 bytes)     |
-+-------------------------------------------+
 | ....                                      |
-+-------------------------------------------+
-| Sentinel element 0xFFFF (2 bytes)         |
-+===========================================+
++===========================================+=============================
 | ....                                      |
 |                                           |
 """
@@ -94,21 +91,29 @@ import struct
 from dictionary import pos_util
 
 
+def _GetRuleMaskWords(num_rules):
+  """Returns the number of uint16 words to hold one bit per rule."""
+  return max(1, (num_rules + 15) // 16)
+
+
 def OutputPosMatcherData(pos_matcher, output):
+  rule_name_list = pos_matcher.GetRuleNameList()
   data = []
-  for rule_name in pos_matcher.GetRuleNameList():
+  for rule_name in rule_name_list:
     data.append(pos_matcher.GetId(rule_name))
 
-  offset = 2 * len(pos_matcher.GetRuleNameList())
-  for rule_name in pos_matcher.GetRuleNameList():
-    data.append(offset)
-    offset += 2 * len(pos_matcher.GetRange(rule_name)) + 1
+  num_ids = pos_matcher.GetPosIdSize()
+  assert num_ids < 0xFFFF, 'Too many POS IDs: %d' % num_ids
+  data.append(num_ids)
 
-  for rule_name in pos_matcher.GetRuleNameList():
-    for id_range in pos_matcher.GetRange(rule_name):
-      data.append(id_range[0])
-      data.append(id_range[1])
-    data.append(0xFFFF)
+  num_words = _GetRuleMaskWords(len(rule_name_list))
+  masks = [0] * (num_ids * num_words)
+  for index, rule_name in enumerate(rule_name_list):
+    word, bit = divmod(index, 16)
+    for start, end in pos_matcher.GetRange(rule_name):
+      for pos_id in range(start, end + 1):
+        masks[pos_id * num_words + word] |= 1 << bit
+  data.extend(masks)
 
   for u16 in data:
     output.write(struct.pack('<H', u16))
@@ -122,17 +127,73 @@ def OutputPosMatcherHeader(pos_matcher, output):
   generated by OutputPosMatcherData() above.
   """
 
-  lid_table_size = len(pos_matcher.GetRuleNameList())
+  rule_name_list = pos_matcher.GetRuleNameList()
+  lid_table_size = len(rule_name_list)
+  num_words = _GetRuleMaskWords(lid_table_size)
 
   output.write(
       '#ifndef MOZC_DICTIONARY_POS_MATCHER_H_\n'
       '#define MOZC_DICTIONARY_POS_MATCHER_H_\n'
+      '#include <initializer_list>\n'
       '#include "./base/port.h"\n'
       'namespace mozc {\n'
       'namespace dictionary {\n'
       'class PosMatcher {\n'
       ' public:\n')
 
+  # Rule indices and the bitmask type to test many rules at once.
+  output.write('  enum Rule {\n')
+  for i, rule_name in enumerate(rule_name_list):
+    output.write('    k%s = %d,\n' % (rule_name, i))
+  output.write(
+      '    kNumRules = %(num_rules)d,\n'
+      '  };\n'
+      '  static constexpr int kRuleMaskWords = %(num_words)d;\n'
+      '  // Set of rules in the same layout as the per POS ID bitmask.\n'
+      '  struct RuleMask {\n'
+      '    uint16 words[kRuleMaskWords];\n'
+      '  };\n'
+      '  static constexpr RuleMask MakeRuleMask(\n'
+      '      std::initializer_list<Rule> rules) {\n'
+      '    RuleMask mask = {};\n'
+      '    for (const Rule rule : rules) {\n'
+      '      mask.words[rule / 16] |= static_cast<uint16>(1 << (rule %% 16));\n'
+      '    }\n'
+      '    return mask;\n'
+      '  }\n' % {
+          'num_rules': lid_table_size,
+          'num_words': num_words,
+      })
+
+  # Generates the code of IsAnyOf(): AND-ing the bitmask of id with the given
+  # mask word by word.
+  any_terms = ' |\n            '.join(
+      '(bits[%d] & mask.words[%d])' % (w, w) for w in range(num_words))
+  output.write(
+      '  // Returns true if the given POS ID matches one of the rules in mask.\n'
+      '  inline bool IsAnyOf(uint16 id, const RuleMask &mask) const {\n'
+      '    if (id >= num_ids_) {\n'
+      '      return false;\n'
+      '    }\n'
+      '    const uint16 *bits = rule_masks_ + id * kRuleMaskWords;\n'
+      '    return (%(any_terms)s) != 0;\n'
+      '  }\n'
+      '  // Returns the set of rules matching the given POS ID.\n'
+      '  inline RuleMask GetRuleMask(uint16 id) const {\n'
+      '    RuleMask mask = {};\n'
+      '    if (id < num_ids_) {\n'
+      '      for (int i = 0; i < kRuleMaskWords; ++i) {\n'
+      '        mask.words[i] = rule_masks_[id * kRuleMaskWords + i];\n'
+      '      }\n'
+      '    }\n'
+      '    return mask;\n'
+      '  }\n'
+      '  inline bool Is(uint16 id, Rule rule) const {\n'
+      '    return id < num_ids_ &&\n'
+      '           (rule_masks_[id * kRuleMaskWords + rule / 16] &\n'
+      '            (1 << (rule %% 16))) != 0;\n'
+      '  }\n' % {'any_terms': any_terms})
+
   # Helper function to generate Get<RuleName>Id() method from rule name and its
   # corresponding index.
   def _GenerateGetMethod(rule_name, index):
@@ -144,26 +205,21 @@ def OutputPosMatcherHeader(pos_matcher, output):
             })
 
   # Helper function to generate Is<RuleName>(uint16 id) method from rule name
-  # and its corresponding index. The generated function checks if the given id
-  # belongs to some range in kRangeTable[index] = kRangeTable_RuleName[].
+  # and its corresponding index. The generated function tests the bit of the
+  # rule in the bitmask of the given id.
   def _GenerateIsMethod(rule_name, index):
     return ('  inline bool Is%(rule_name)s(uint16 id) const {\n'
-            '    const uint16 offset = data_[%(lid_table_size)d + %(index)d];\n'
-            '    for (const uint16 *ptr = data_ + offset;\n'
-            '         *ptr != static_cast<uint16>(0xFFFF); ptr += 2) {\n'
-            '      if (id >= *ptr && id <= *(ptr + 1)) {\n'
-            '        return true;\n'
-            '      }\n'
-            '    }\n'
-            '    return false;\n'
+            '    return id < num_ids_ &&\n'
+            '           (rule_masks_[id * kRuleMaskWords + %(word)d] &\n'
+            '            0x%(bit)04X) != 0;\n'
             '  }' % {
                 'rule_name': rule_name,
-                'index': index,
-                'lid_table_size': lid_table_size,
+                'word': index // 16,
+                'bit': 1 << (index % 16),
             })
 
   # Generate Get<RuleName>Id() and Is<RuleName>(uint16 id) for each rule.
-  for i, rule_name in enumerate(pos_matcher.GetRuleNameList()):
+  for i, rule_name in enumerate(rule_name_list):
     output.write(
         '  // %(rule_name)s "%(original_pattern)s"\n'
         '%(get_method)s\n'
@@ -173,19 +229,27 @@ def OutputPosMatcherHeader(pos_matcher, output):
             'get_method': _GenerateGetMethod(rule_name, i),
             'is_method': _GenerateIsMethod(rule_name, i)})
 
-  # Constructor takes two pointers to arrays generated by OutputPosMatcherData()
-  # function.
+  # Constructor takes a pointer to the array generated by
+  # OutputPosMatcherData() function.
   output.write(
       ' public:\n'
-      '  PosMatcher() : data_(nullptr) {}\n'
-      '  explicit PosMatcher(const uint16 *data) : data_(data) {}\n'
-      '  void Set(const uint16 *data) { data_ = data; }\n'
+      '  PosMatcher() = default;\n'
+      '  explicit PosMatcher(const uint16 *data) { Set(data); }\n'
+      '  void Set(const uint16 *data) {\n'
+      '    data_ = data;\n'
+      '    num_ids_ = data[%(lid_table_size)d];\n'
+      '    rule_masks_ = data + %(lid_table_size)d + 1;\n'
+      '  }\n'
       ' private:\n'
-      '  const uint16 *data_;\n'
+      '  const uint16 *data_ = nullptr;\n'
+      '  const uint16 *rule_masks_ = nullptr;\n'
+      '  uint16 num_ids_ = 0;\n'
       '};\n'
       '}  // namespace dictionary\n'
       '}  // namespace mozc\n'
-      '#endif  // MOZC_DICTIONARY_POS_MATCHER_H_\n')
+      '#endif  // MOZC_DICTIONARY_POS_MATCHER_H_\n' % {
+          'lid_table_size': lid_table_size,
+      })
 
 
 def ParseOptions():
@@ -62,7 +62,7 @@ def OutputUserPosData(user_pos_data, output_token_array, output_string_array):
         f.write(struct.pack('<H', conjugation_id))
 
   serialized_string_array_builder.SerializeToFile(
-      sorted(string_index.keys()), output_string_array)
+      sorted(string_index.keys()), output_string_array, build_hash_index=True)
 
 
 def ParseOptions():
@@ -0,0 +1,128 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/pos_matcher.h"
+
+#include <cstdint>
+
+#include "data_manager/testing/mock_data_manager.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+TEST(PosMatcherTest, GetIdMatchesItsOwnRule) {
+  const testing::MockDataManager data_manager;
+  const PosMatcher pos_matcher(data_manager.GetPosMatcherData());
+  EXPECT_TRUE(pos_matcher.IsFunctional(pos_matcher.GetFunctionalId()));
+  EXPECT_TRUE(pos_matcher.IsNumber(pos_matcher.GetNumberId()));
+  EXPECT_TRUE(pos_matcher.IsGeneralNoun(pos_matcher.GetGeneralNounId()));
+  EXPECT_TRUE(pos_matcher.IsIsolatedWord(pos_matcher.GetIsolatedWordId()));
+  EXPECT_TRUE(pos_matcher.IsVerbSuffix(pos_matcher.GetVerbSuffixId()));
+  EXPECT_TRUE(pos_matcher.IsWagyoRenyoConnectionVerb(
+      pos_matcher.GetWagyoRenyoConnectionVerbId()));
+  EXPECT_FALSE(pos_matcher.IsNumber(pos_matcher.GetFunctionalId()));
+}
+
+TEST(PosMatcherTest, RuleMask) {
+  const testing::MockDataManager data_manager;
+  const PosMatcher pos_matcher(data_manager.GetPosMatcherData());
+
+  // POS IDs of data/test/dictionary/id.def followed by
+  // data/rules/special_pos.def.
+  struct TestCase {
+    uint16_t pos_id;
+    bool isolated_word;           // 特殊,短縮よみ
+    bool general_symbol;          // 記号,一般,
+    bool wagyo_renyo_connection;  // 動詞,*,*,*,五段・ワ行促音便,連用形
+    bool general_noun;            // 名詞,一般,*,*,*,*,*
+  };
+  constexpr TestCase kTestCases[] = {
+      {0, false, false, false, false},
+      {935, false, false, false, false},
+      {936, false, false, true, false},
+      {939, false, false, true, false},
+      {940, false, false, false, false},
+      {1917, false, false, false, false},
+      {1918, false, false, true, false},
+      {1928, false, false, true, false},
+      {1929, false, false, false, false},
+      {1939, false, false, false, true},
+      {2704, false, true, false, false},
+      {2722, false, false, false, false},
+      {2723, true, false, false, false},
+      {2724, false, false, false, false},
+  };
+
+  constexpr PosMatcher::RuleMask kMask = PosMatcher::MakeRuleMask(
+      {PosMatcher::kIsolatedWord, PosMatcher::kGeneralSymbol,
+       PosMatcher::kWagyoRenyoConnectionVerb});
+  for (const TestCase &test_case : kTestCases) {
+    const uint16_t pos_id = test_case.pos_id;
+    EXPECT_EQ(test_case.isolated_word, pos_matcher.IsIsolatedWord(pos_id))
+        << pos_id;
+    EXPECT_EQ(test_case.isolated_word,
+              pos_matcher.Is(pos_id, PosMatcher::kIsolatedWord))
+        << pos_id;
+    EXPECT_EQ(test_case.general_symbol, pos_matcher.IsGeneralSymbol(pos_id))
+        << pos_id;
+    EXPECT_EQ(test_case.wagyo_renyo_connection,
+              pos_matcher.IsWagyoRenyoConnectionVerb(pos_id))
+        << pos_id;
+    EXPECT_EQ(test_case.isolated_word || test_case.general_symbol ||
+                  test_case.wagyo_renyo_connection,
+              pos_matcher.IsAnyOf(pos_id, kMask))
+        << pos_id;
+
+    const PosMatcher::RuleMask mask = pos_matcher.GetRuleMask(pos_id);
+    EXPECT_EQ(test_case.general_noun,
+              (mask.words[PosMatcher::kGeneralNoun / 16] >>
+               (PosMatcher::kGeneralNoun % 16)) & 1)
+        << pos_id;
+  }
+}
+
+TEST(PosMatcherTest, OutOfRangeId) {
+  const testing::MockDataManager data_manager;
+  const PosMatcher pos_matcher(data_manager.GetPosMatcherData());
+  EXPECT_FALSE(pos_matcher.IsFunctional(0xFFFF));
+  EXPECT_FALSE(pos_matcher.IsAnyOf(
+      0xFFFF, PosMatcher::MakeRuleMask({PosMatcher::kFunctional})));
+
+  const PosMatcher empty;
+  EXPECT_FALSE(empty.IsFunctional(0));
+  EXPECT_FALSE(
+      empty.IsAnyOf(0, PosMatcher::MakeRuleMask({PosMatcher::kFunctional})));
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
@@ -86,6 +86,10 @@ class PosDataBase(object):
     return [(id_range[0], id_range[-1])
             for id_range in PosDataBase._GroupConsecutiveId(id_list)]
 
+  def GetPosIdSize(self):
+    """Returns the max POS id plus one, or 0 if no POS is loaded."""
+    return max((pos_id for _, pos_id in self.id_list), default=-1) + 1
+
 
 class PosMatcher(object):
 
@@ -113,6 +117,9 @@ class PosMatcher(object):
   def GetId(self, name):
     return self.pos_database.GetRange(self._match_rule_map[name][1])[0][0]
 
+  def GetPosIdSize(self):
+    return self.pos_database.GetPosIdSize()
+
   def GetOriginalPattern(self, name):
     return self._match_rule_map[name][0]
 
@@ -80,6 +80,7 @@ constexpr char kKeySectionName[] = "k";
 constexpr char kValueSectionName[] = "v";
 constexpr char kTokensSectionName[] = "t";
 constexpr char kPosSectionName[] = "p";
+constexpr char kSubtreeMinCostSectionName[] = "c";
 
 //// Constants for validation ////
 // 12 bits
@@ -217,6 +218,11 @@ const std::string SystemDictionaryCodec::GetSectionNameForPos() const {
   return kPosSectionName;
 }
 
+const std::string SystemDictionaryCodec::GetSectionNameForSubtreeMinCost()
+    const {
+  return kSubtreeMinCostSectionName;
+}
+
 void SystemDictionaryCodec::EncodeKey(const absl::string_view src,
                                       std::string *dst) const {
   EncodeDecodeKeyImpl(src, dst);
@@ -61,6 +61,10 @@ class SystemDictionaryCodec : public SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   const std::string GetSectionNameForPos() const override;
 
+  // Return section name for the per-node minimum token cost of key trie
+  // subtrees
+  const std::string GetSectionNameForSubtreeMinCost() const override;
+
   // Compresses key string into small bytes.
   void EncodeKey(const absl::string_view src, std::string *dst) const override;
 
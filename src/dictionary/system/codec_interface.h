@@ -60,6 +60,10 @@ class SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   virtual const std::string GetSectionNameForPos() const = 0;
 
+  // Return section name for the per-node minimum token cost of key trie
+  // subtrees.  This section is optional.
+  virtual const std::string GetSectionNameForSubtreeMinCost() const = 0;
+
   // Encode value(word) string
   virtual void EncodeValue(const absl::string_view src,
                            std::string *dst) const = 0;
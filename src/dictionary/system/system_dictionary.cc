@@ -43,6 +43,9 @@
 //       Frequenty appearing POSs are stored as POS ids in token info for
 //       reducing binary size. This table is the map from the id to the
 //       actual ids.
+//  (5) Subtree minimum cost (optional)
+//       Minimum token cost in the subtree of each shallow key trie node.
+//       Used to prune the search in LookupPredictiveByCost().
 
 #include "dictionary/system/system_dictionary.h"
 
@@ -58,6 +61,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/hot_page_pinner.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
 #include "base/mmap.h"
@@ -154,7 +158,9 @@ void BuildHiraganaExpansionTable(const SystemDictionaryCodecInterface &codec,
 inline const uint8_t *GetTokenArrayPtr(const BitVectorBasedArray &token_array,
                                        int key_id) {
   size_t length = 0;
-  return reinterpret_cast<const uint8_t *>(token_array.Get(key_id, &length));
+  const char *ptr = token_array.Get(key_id, &length);
+  HotPagePinner::SampleAccess(ptr);
+  return reinterpret_cast<const uint8_t *>(ptr);
 }
 
 // Iterator for scanning token array.
@@ -486,6 +492,8 @@ SystemDictionary::SystemDictionary(
     const SystemDictionaryCodecInterface *codec,
     const DictionaryFileCodecInterface *file_codec)
     : frequent_pos_(nullptr),
+      subtree_min_cost_(nullptr),
+      subtree_min_cost_size_(0),
       codec_(codec),
       dictionary_file_(new DictionaryFile(file_codec)) {}
 
@@ -526,6 +534,13 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     return false;
   }
 
+  // Dictionaries built by older versions don't have this section.
+  subtree_min_cost_ =
+      reinterpret_cast<const uint16_t *>(dictionary_file_->GetSection(
+          codec_->GetSectionNameForSubtreeMinCost(), &len));
+  subtree_min_cost_size_ =
+      subtree_min_cost_ == nullptr ? 0 : len / sizeof(uint16_t);
+
   if (enable_reverse_lookup_index) {
     InitReverseLookupIndex();
   }
@@ -768,6 +783,226 @@ void SystemDictionary::LookupPredictive(
 
 namespace {
 
+// A key trie node to be explored by LookupPredictiveByCost().
+struct CostBoundedSearchState {
+  int cost_bound;
+  LoudsTrie::Node node;
+  int num_expanded;
+
+  // For std::priority_queue to pop the smallest bound first.
+  friend bool operator<(const CostBoundedSearchState &x,
+                        const CostBoundedSearchState &y) {
+    return x.cost_bound > y.cost_bound;
+  }
+};
+
+struct CostBoundedKey {
+  std::string key;
+  std::string actual_key;
+  int num_expanded;
+  int min_cost;
+};
+
+struct CostBoundedToken {
+  Token token;
+  size_t key_index;
+
+  // For std::priority_queue to pop the most expensive token first.
+  friend bool operator<(const CostBoundedToken &x, const CostBoundedToken &y) {
+    return x.token.cost < y.token.cost;
+  }
+};
+
+}  // namespace
+
+void SystemDictionary::LookupPredictiveByCost(
+    absl::string_view key, const ConversionRequest &conversion_request,
+    size_t max_tokens, Callback *callback) const {
+  if (key.empty() || max_tokens == 0) {
+    return;
+  }
+  if (subtree_min_cost_size_ == 0) {
+    LookupPredictive(key, conversion_request, callback);
+    return;
+  }
+
+  std::string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+  if (encoded_key.size() > LoudsTrie::kMaxDepth) {
+    return;
+  }
+
+  const KeyExpansionTable &table =
+      conversion_request.IsKanaModifierInsensitiveConversion()
+          ? hiragana_expansion_table_
+          : KeyExpansionTable::GetDefaultInstance();
+
+  // Find the nodes for |encoded_key| and its expanded keys.
+  std::vector<CostBoundedSearchState> matched = {
+      {GetSubtreeMinCost(LoudsTrie::Node(), 0), LoudsTrie::Node(), 0}};
+  std::vector<CostBoundedSearchState> next;
+  for (const char target_char : encoded_key) {
+    const ExpandedKey &chars = table.ExpandKey(target_char);
+    next.clear();
+    for (CostBoundedSearchState state : matched) {
+      const int parent_bound = state.cost_bound;
+      for (key_trie_.MoveToFirstChild(&state.node);
+           key_trie_.IsValidNode(state.node);
+           key_trie_.MoveToNextSibling(&state.node)) {
+        const char c = key_trie_.GetEdgeLabelToParentNode(state.node);
+        if (!chars.IsHit(c)) {
+          continue;
+        }
+        const int num_expanded =
+            state.num_expanded + static_cast<int>(c != target_char);
+        next.push_back({GetSubtreeMinCost(state.node, parent_bound),
+                        state.node, num_expanded});
+      }
+    }
+    matched.swap(next);
+  }
+
+  // Best-first search from the matched nodes.  Since the popped bound is
+  // monotonically non-decreasing, the search stops once it cannot beat the
+  // most expensive one of the current top |max_tokens|.
+  std::priority_queue<CostBoundedSearchState> queue(matched.begin(),
+                                                    matched.end());
+  std::priority_queue<CostBoundedToken> top_tokens;
+  std::vector<CostBoundedKey> keys;
+  auto can_beat_top_tokens = [&top_tokens, max_tokens](int cost) {
+    return top_tokens.size() < max_tokens || cost < top_tokens.top().token.cost;
+  };
+  char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  while (!queue.empty()) {
+    CostBoundedSearchState state = queue.top();
+    queue.pop();
+    if (!can_beat_top_tokens(state.cost_bound)) {
+      break;
+    }
+
+    if (key_trie_.IsTerminalNode(state.node)) {
+      const absl::string_view encoded_actual_key =
+          key_trie_.RestoreKeyString(state.node, encoded_actual_key_buffer);
+      CostBoundedKey entry;
+      entry.key.assign(key.data(), key.size());
+      codec_->DecodeKey(absl::ClippedSubstr(encoded_actual_key,
+                                            encoded_key.size()),
+                        &entry.key);
+      if (state.num_expanded > 0) {
+        codec_->DecodeKey(encoded_actual_key, &entry.actual_key);
+      } else {
+        entry.actual_key = entry.key;
+      }
+      entry.num_expanded = state.num_expanded;
+      entry.min_cost = std::numeric_limits<int>::max();
+
+      const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
+      for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
+                                    entry.actual_key,
+                                    GetTokenArrayPtr(token_array_, key_id));
+           !iter.Done(); iter.Next()) {
+        const Token &token = *iter.Get().token;
+        if (!can_beat_top_tokens(token.cost)) {
+          continue;
+        }
+        top_tokens.push({token, keys.size()});
+        if (top_tokens.size() > max_tokens) {
+          top_tokens.pop();
+        }
+        entry.min_cost = std::min(entry.min_cost, token.cost);
+      }
+      if (entry.min_cost != std::numeric_limits<int>::max()) {
+        keys.push_back(std::move(entry));
+      }
+    }
+
+    const int parent_bound = state.cost_bound;
+    for (key_trie_.MoveToFirstChild(&state.node);
+         key_trie_.IsValidNode(state.node);
+         key_trie_.MoveToNextSibling(&state.node)) {
+      const int bound = GetSubtreeMinCost(state.node, parent_bound);
+      if (can_beat_top_tokens(bound)) {
+        queue.push({bound, state.node, state.num_expanded});
+      }
+    }
+  }
+
+  // Group the tokens by key.  Note that |keys| may contain tokens that were
+  // evicted later, so the order uses the surviving tokens only.
+  std::vector<CostBoundedToken> results;
+  results.reserve(top_tokens.size());
+  for (; !top_tokens.empty(); top_tokens.pop()) {
+    results.push_back(top_tokens.top());
+  }
+  for (CostBoundedKey &entry : keys) {
+    entry.min_cost = std::numeric_limits<int>::max();
+  }
+  for (const CostBoundedToken &result : results) {
+    CostBoundedKey &entry = keys[result.key_index];
+    entry.min_cost = std::min(entry.min_cost, result.token.cost);
+  }
+  std::sort(results.begin(), results.end(),
+            [&keys](const CostBoundedToken &x, const CostBoundedToken &y) {
+              const int x_key_cost = keys[x.key_index].min_cost;
+              const int y_key_cost = keys[y.key_index].min_cost;
+              if (x_key_cost != y_key_cost) {
+                return x_key_cost < y_key_cost;
+              }
+              if (x.key_index != y.key_index) {
+                return x.key_index < y.key_index;
+              }
+              return x.token.cost < y.token.cost;
+            });
+
+  for (size_t i = 0; i < results.size();) {
+    const CostBoundedKey &entry = keys[results[i].key_index];
+    size_t end = i + 1;
+    while (end < results.size() &&
+           results[end].key_index == results[i].key_index) {
+      ++end;
+    }
+    const size_t begin = i;
+    i = end;
+
+    switch (callback->OnKey(entry.key)) {
+      case Callback::TRAVERSE_DONE:
+        return;
+      case Callback::TRAVERSE_NEXT_KEY:
+        continue;
+      case Callback::TRAVERSE_CULL:
+        LOG(FATAL) << "Culling is not implemented.";
+        continue;
+      default:
+        break;
+    }
+    switch (callback->OnActualKey(entry.key, entry.actual_key,
+                                  entry.num_expanded)) {
+      case Callback::TRAVERSE_DONE:
+        return;
+      case Callback::TRAVERSE_NEXT_KEY:
+        continue;
+      case Callback::TRAVERSE_CULL:
+        LOG(FATAL) << "Culling is not implemented.";
+        continue;
+      default:
+        break;
+    }
+    for (size_t j = begin; j < end; ++j) {
+      const Callback::ResultType result =
+          callback->OnToken(entry.key, entry.actual_key, results[j].token);
+      if (result == Callback::TRAVERSE_DONE) {
+        return;
+      }
+      if (result == Callback::TRAVERSE_NEXT_KEY) {
+        break;
+      }
+      DCHECK_NE(Callback::TRAVERSE_CULL, result) << "Not implemented";
+    }
+  }
+}
+
+namespace {
+
 // An implementation of prefix search without key expansion.  Runs |callback|
 // for prefixes of |encoded_key| in |key_trie|.
 // Args:
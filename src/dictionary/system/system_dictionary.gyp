@@ -94,6 +94,7 @@
         '../../base/base.gyp:base_core',
         '../../base/base.gyp:japanese_util',
         '../../storage/louds/louds.gyp:bit_vector_based_array_builder',
+        '../../storage/louds/louds.gyp:louds_trie',
         '../../storage/louds/louds.gyp:louds_trie_builder',
         '../dictionary_base.gyp:pos_matcher',
         '../dictionary_base.gyp:text_dictionary_loader',
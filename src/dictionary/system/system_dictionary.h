@@ -118,6 +118,17 @@ class SystemDictionary : public DictionaryInterface {
                     const ConversionRequest &conversion_request,
                     Callback *callback) const override;
 
+  // Looks up the |max_tokens| cheapest tokens whose keys start with |key| and
+  // runs |callback| for them, keys ordered by their cheapest token.  Unlike
+  // LookupPredictive(), long keys are not cut off; instead, subtrees of the key
+  // trie whose minimum cost cannot beat the current top |max_tokens| are not
+  // explored.  Falls back to LookupPredictive() for dictionaries built without
+  // the subtree minimum cost section.
+  void LookupPredictiveByCost(absl::string_view key,
+                              const ConversionRequest &conversion_request,
+                              size_t max_tokens,
+                              Callback *callback) const override;
+
   void LookupExact(absl::string_view key,
                    const ConversionRequest &conversion_request,
                    Callback *callback) const override;
@@ -161,10 +172,21 @@ class SystemDictionary : public DictionaryInterface {
       absl::string_view encoded_key, const KeyExpansionTable &table,
       size_t limit, std::vector<PredictiveLookupSearchState> *result) const;
 
+  // Returns the lower bound of the token costs in the subtree of |node|.
+  // |parent_bound| is used for the nodes deeper than the annotated ones.
+  int GetSubtreeMinCost(const storage::louds::LoudsTrie::Node &node,
+                        int parent_bound) const {
+    const size_t index = node.node_id() - 1;
+    return index < subtree_min_cost_size_ ? subtree_min_cost_[index]
+                                          : parent_bound;
+  }
+
   storage::louds::LoudsTrie key_trie_;
   storage::louds::LoudsTrie value_trie_;
   storage::louds::BitVectorBasedArray token_array_;
   const uint32_t *frequent_pos_;
+  const uint16_t *subtree_min_cost_;
+  size_t subtree_min_cost_size_;
   const SystemDictionaryCodecInterface *codec_;
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <cstring>
 #include <ios>
+#include <limits>
 #include <map>
 #include <memory>
 #include <ostream>
@@ -56,6 +57,7 @@
 #include "dictionary/system/words_info.h"
 #include "dictionary/text_dictionary_loader.h"
 #include "storage/louds/bit_vector_based_array_builder.h"
+#include "storage/louds/louds_trie.h"
 #include "storage/louds/louds_trie_builder.h"
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -65,6 +67,9 @@ ABSL_FLAG(bool, preserve_intermediate_dictionary, false,
           "preserve inetemediate dictionary file.");
 ABSL_FLAG(int32_t, min_key_length_to_use_small_cost_encoding, 6,
           "minimum key length to use 1 byte cost encoding.");
+ABSL_FLAG(int32_t, subtree_min_cost_max_depth, 3,
+          "maximum depth of key trie nodes annotated with the minimum cost of "
+          "their subtrees.");
 
 namespace mozc {
 namespace dictionary {
@@ -134,6 +139,7 @@ void SystemDictionaryBuilder::BuildFromTokensInternal(
   SetValueType(&key_info_list);
 
   BuildTokenArray(key_info_list);
+  BuildSubtreeMinCost(key_info_list);
 }
 
 void SystemDictionaryBuilder::WriteToFile(
@@ -173,6 +179,12 @@ void SystemDictionaryBuilder::WriteToStream(
       file_codec_->GetSectionName(codec_->GetSectionNameForPos()));
   sections.push_back(frequent_pos_section);
 
+  DictionaryFileSection subtree_min_cost_section(
+      reinterpret_cast<const char *>(subtree_min_cost_.data()),
+      subtree_min_cost_.size() * sizeof(uint16_t),
+      file_codec_->GetSectionName(codec_->GetSectionNameForSubtreeMinCost()));
+  sections.push_back(subtree_min_cost_section);
+
   if (absl::GetFlag(FLAGS_preserve_intermediate_dictionary) &&
       !intermediate_output_file_base_path.empty()) {
     // Write out intermediate results to files.
@@ -182,6 +194,8 @@ void SystemDictionaryBuilder::WriteToStream(
     WriteSectionToFile(key_trie_section, basepath + ".key");
     WriteSectionToFile(token_array_section, basepath + ".tokens");
     WriteSectionToFile(frequent_pos_section, basepath + ".freq_pos");
+    WriteSectionToFile(subtree_min_cost_section,
+                       basepath + ".subtree_min_cost");
   }
 
   LOG(INFO) << "Start writing dictionary file.";
@@ -439,5 +453,48 @@ void SystemDictionaryBuilder::BuildTokenArray(
   token_array_builder_.Build();
 }
 
+void SystemDictionaryBuilder::BuildSubtreeMinCost(
+    const KeyInfoList &key_info_list) {
+  // Since node IDs of LOUDS are assigned in BFS order, the nodes whose depth is
+  // at most |max_depth| occupy the contiguous ID range [1, N].  Thus the
+  // annotation is a dense array and the nodes beyond it inherit the value of
+  // their ancestor at lookup time.
+  const size_t max_depth = absl::GetFlag(FLAGS_subtree_min_cost_max_depth);
+  storage::louds::LoudsTrie key_trie;
+  CHECK(key_trie.Open(
+      reinterpret_cast<const uint8_t *>(key_trie_builder_.image().data())));
+
+  subtree_min_cost_.clear();
+  for (const KeyInfo &key_info : key_info_list) {
+    int min_cost = std::numeric_limits<uint16_t>::max();
+    for (const TokenInfo &token_info : key_info.tokens) {
+      int cost = token_info.token->cost;
+      if (token_info.cost_type == TokenInfo::CAN_USE_SMALL_ENCODING) {
+        // The 1 byte encoding drops the lower 8 bits, so the decoded cost can
+        // be smaller than the original one.
+        cost &= 0xff00;
+      }
+      min_cost = std::min(min_cost, cost);
+    }
+
+    std::string key_str;
+    codec_->EncodeKey(key_info.key, &key_str);
+    storage::louds::LoudsTrie::Node node;
+    for (size_t depth = 0;; ++depth) {
+      const size_t index = node.node_id() - 1;
+      if (index >= subtree_min_cost_.size()) {
+        subtree_min_cost_.resize(index + 1,
+                                 std::numeric_limits<uint16_t>::max());
+      }
+      subtree_min_cost_[index] =
+          std::min<int>(subtree_min_cost_[index], min_cost);
+      if (depth >= max_depth || depth >= key_str.size()) {
+        break;
+      }
+      CHECK(key_trie.MoveToChildByLabel(key_str[depth], &node));
+    }
+  }
+}
+
 }  // namespace dictionary
 }  // namespace mozc
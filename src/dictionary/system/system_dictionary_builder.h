@@ -92,6 +92,7 @@ class SystemDictionaryBuilder {
   void BuildValueTrie(const KeyInfoList &key_info_list);
   void BuildKeyTrie(const KeyInfoList &key_info_list);
   void BuildTokenArray(const KeyInfoList &key_info_list);
+  void BuildSubtreeMinCost(const KeyInfoList &key_info_list);
 
   void SetIdForValue(KeyInfoList *key_info_list) const;
   void SetIdForKey(KeyInfoList *key_info_list) const;
@@ -105,6 +106,10 @@ class SystemDictionaryBuilder {
   storage::louds::LoudsTrieBuilder key_trie_builder_;
   storage::louds::BitVectorBasedArrayBuilder token_array_builder_;
 
+  // Minimum token cost in the subtree rooted at each shallow node of the key
+  // trie, indexed by (node_id - 1).
+  std::vector<uint16_t> subtree_min_cost_;
+
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32_t, int> frequent_pos_;
 
@@ -62,6 +62,7 @@
 #include "absl/container/btree_set.h"
 #include "absl/flags/declare.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 
@@ -529,6 +530,55 @@ TEST_F(SystemDictionaryTest, LookupPredictiveCutOffEmulatingBFS) {
   EXPECT_FALSE(callback.IsFound(&tokens[1]));
 }
 
+TEST_F(SystemDictionaryTest, LookupPredictiveByCost) {
+  Token tokens[] = {
+      {"あいうえお", "aiueo", 0, 0, 0, Token::NONE},
+      {"がっこう", "学校", 1, 0, 0, Token::NONE},
+      {"かっこう", "格好", 2, 0, 0, Token::NONE},
+  };
+  // Build a dictionary with the above tokens plus those from test data.
+  std::vector<Token *> source_tokens = MakeTokenPointers(&tokens);
+  text_dict_.CollectTokens(&source_tokens);  // Load test data.
+  constexpr size_t kNumTokens = 10000;
+  std::unique_ptr<SystemDictionary> system_dic =
+      BuildSystemDictionary(source_tokens, kNumTokens);
+  ASSERT_TRUE(system_dic);
+
+  // Unlike LookupPredictiveCutOffEmulatingBFS, the long key is looked up as
+  // its cost is the lowest.
+  constexpr size_t kMaxTokens = 20;
+  CollectTokenCallback callback;
+  system_dic->LookupPredictiveByCost("あ", convreq_, kMaxTokens, &callback);
+  ASSERT_FALSE(callback.tokens().empty());
+  EXPECT_EQ(callback.tokens()[0].value, "aiueo");
+
+  // The costs of the results are the smallest ones among the keys starting
+  // with "あ".
+  std::vector<int> expected_costs;
+  for (size_t i = 0; i < kNumTokens && i < source_tokens.size(); ++i) {
+    if (absl::StartsWith(source_tokens[i]->key, "あ")) {
+      expected_costs.push_back(source_tokens[i]->cost);
+    }
+  }
+  std::sort(expected_costs.begin(), expected_costs.end());
+  expected_costs.resize(std::min(expected_costs.size(), kMaxTokens));
+  std::vector<int> actual_costs;
+  for (const Token &token : callback.tokens()) {
+    EXPECT_TRUE(absl::StartsWith(token.key, "あ")) << token.key;
+    actual_costs.push_back(token.cost);
+  }
+  std::sort(actual_costs.begin(), actual_costs.end());
+  EXPECT_EQ(actual_costs, expected_costs);
+
+  // Kana modifier insensitive lookup is also supported.
+  callback.Clear();
+  request_.set_kana_modifier_insensitive_conversion(true);
+  config_.set_use_kana_modifier_insensitive_conversion(true);
+  system_dic->LookupPredictiveByCost("かつこう", convreq_, 1, &callback);
+  ASSERT_EQ(callback.tokens().size(), 1);
+  EXPECT_TOKEN_EQ(tokens[1], callback.tokens()[0]);
+}
+
 TEST_F(SystemDictionaryTest, LookupExact) {
   const std::string k0 = "は";
   const std::string k1 = "はひふへほ";
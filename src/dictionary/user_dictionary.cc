@@ -30,30 +30,33 @@
 #include "dictionary/user_dictionary.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <memory>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/executor.h"
 #include "base/file_util.h"
-#include "base/hash.h"
-#include "base/japanese_util.h"
 #include "base/logging.h"
 #include "base/singleton.h"
-#include "base/thread.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_cache.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
 #include "protocol/config.pb.h"
 #include "usage_stats/usage_stats.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
@@ -62,30 +65,33 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
+// Incremented when the tokens of any user dictionary are swapped.
+std::atomic<uint64_t> g_generation{0};
+
 struct OrderByKey {
-  bool operator()(const UserPos::Token &token, absl::string_view key) const {
-    return token.key < key;
+  bool operator()(const UserPos::Token *token, absl::string_view key) const {
+    return token->key < key;
   }
 
-  bool operator()(absl::string_view key, const UserPos::Token &token) const {
-    return key < token.key;
+  bool operator()(absl::string_view key, const UserPos::Token *token) const {
+    return key < token->key;
   }
 };
 
 struct OrderByKeyPrefix {
-  bool operator()(const UserPos::Token &token, absl::string_view prefix) const {
-    return absl::string_view(token.key).substr(0, prefix.size()) < prefix;
+  bool operator()(const UserPos::Token *token, absl::string_view prefix) const {
+    return absl::string_view(token->key).substr(0, prefix.size()) < prefix;
   }
 
-  bool operator()(absl::string_view prefix, const UserPos::Token &token) const {
-    return prefix < absl::string_view(token.key).substr(0, prefix.size());
+  bool operator()(absl::string_view prefix, const UserPos::Token *token) const {
+    return prefix < absl::string_view(token->key).substr(0, prefix.size());
   }
 };
 
 struct OrderByKeyThenById {
-  bool operator()(const UserPos::Token &lhs, const UserPos::Token &rhs) const {
-    const int comp = lhs.key.compare(rhs.key);
-    return comp == 0 ? (lhs.id < rhs.id) : (comp < 0);
+  bool operator()(const UserPos::Token *lhs, const UserPos::Token *rhs) const {
+    const int comp = lhs->key.compare(rhs->key);
+    return comp == 0 ? (lhs->id < rhs->id) : (comp < 0);
   }
 };
 
@@ -129,86 +135,80 @@ class UserDictionary::TokensIndex {
   bool empty() const { return user_pos_tokens_.empty(); }
   size_t size() const { return user_pos_tokens_.size(); }
 
-  std::vector<UserPos::Token>::const_iterator begin() const {
+  std::vector<const UserPos::Token *>::const_iterator begin() const {
     return user_pos_tokens_.begin();
   }
-  std::vector<UserPos::Token>::const_iterator end() const {
+  std::vector<const UserPos::Token *>::const_iterator end() const {
     return user_pos_tokens_.end();
   }
 
-  void Load(const user_dictionary::UserDictionaryStorage &storage) {
-    user_pos_tokens_.clear();
-    std::set<uint64_t> seen;
-    std::vector<UserPos::Token> tokens;
+  const UserDictionaryCache::CompiledDictionaries &dictionaries() const {
+    return dictionaries_;
+  }
 
-    const SuppressionDictionaryLock l(suppression_dictionary_);
-    suppression_dictionary_->Clear();
+  // Compiles |storage|.  The dictionaries in |reusable| are shared instead of
+  // being compiled again if their contents are not modified.
+  void Load(const user_dictionary::UserDictionaryStorage &storage,
+            const UserDictionaryCache::CompiledDictionaries &reusable) {
+    // Fingerprint to the index in |reusable|.
+    absl::flat_hash_map<uint64_t, size_t> reusable_map;
+    for (size_t i = 0; i < reusable.size(); ++i) {
+      reusable_map.emplace(reusable[i]->fingerprint, i);
+    }
 
+    UserDictionaryCache::CompiledDictionaries dictionaries;
+    size_t num_reused = 0;
     for (const UserDictionaryStorage::UserDictionary &dic :
          storage.dictionaries()) {
       if (!dic.enabled() || dic.entries_size() == 0) {
         continue;
       }
+      const auto it = reusable_map.find(
+          UserDictionaryCache::GetDictionaryFingerprint(dic));
+      if (it != reusable_map.end()) {
+        dictionaries.push_back(reusable[it->second]);
+        ++num_reused;
+      } else {
+        dictionaries.push_back(UserDictionaryCache::Compile(*user_pos_, dic));
+      }
+    }
+    VLOG(1) << num_reused << " of " << dictionaries.size()
+            << " user dictionaries are reused";
+    Load(std::move(dictionaries));
+  }
 
-      const bool is_shortcuts =
-          (dic.name() == "__auto_imported_android_shortcuts_dictionary");
+  // Builds the index from compiled dictionaries.
+  void Load(UserDictionaryCache::CompiledDictionaries dictionaries) {
+    dictionaries_ = std::move(dictionaries);
+    user_pos_tokens_.clear();
 
-      for (const UserDictionaryStorage::UserDictionaryEntry &entry :
-           dic.entries()) {
-        if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
-          continue;
-        }
+    const SuppressionDictionaryLock l(suppression_dictionary_);
+    suppression_dictionary_->Clear();
 
-        std::string tmp, reading;
-        UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
-
-        // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
-        // because the normalization is user-visible.
-        // http://b/2480844
-        japanese_util::NormalizeVoicedSoundMark(tmp, &reading);
-
-        DCHECK_LE(0, entry.pos());
-        MOZC_CLANG_PUSH_WARNING();
-        // clang-format off
-#if MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
-        MOZC_CLANG_DISABLE_WARNING(tautological-constant-out-of-range-compare);
-#endif  // MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
-        // clang-format on
-        DCHECK_LE(entry.pos(), 255);
-        MOZC_CLANG_POP_WARNING();
-        const uint64_t fp =
-            Hash::Fingerprint(reading + "\t" + entry.value() + "\t" +
-                              static_cast<char>(entry.pos()));
-        if (!seen.insert(fp).second) {
-          VLOG(1) << "Found dup item";
-          continue;
+    // An entry duplicated in multiple dictionaries is taken from the first
+    // one.  Duplicates inside a dictionary are removed at compilation.
+    absl::flat_hash_set<uint64_t> seen;
+    size_t num_tokens = 0;
+    for (const auto &dic : dictionaries_) {
+      num_tokens += dic->tokens.size();
+    }
+    user_pos_tokens_.reserve(num_tokens);
+    for (const auto &dic : dictionaries_) {
+      for (size_t i = 0; i < dic->tokens.size(); ++i) {
+        if (!seen.contains(dic->token_fingerprints[i])) {
+          user_pos_tokens_.push_back(&dic->tokens[i]);
         }
-
-        // "抑制単語"
-        if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
-          suppression_dictionary_->AddEntry(reading, entry.value());
-        } else {
-          tokens.clear();
-          user_pos_->GetTokens(
-              reading, entry.value(),
-              UserDictionaryUtil::GetStringPosType(entry.pos()), &tokens);
-          for (auto &token : tokens) {
-            Util::StripWhiteSpaces(entry.comment(), &token.comment);
-            if (is_shortcuts &&
-                token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
-              // Words fed by Android shortcut are registered as SUGGESTION_ONLY
-              // POS in order to minimize the side-effect of extremely short
-              // reading. However, user expect that they should appear in the
-              // normal conversion. Here we replace the attribute from
-              // SUGGESTION_ONLY to SHORTCUT, which has more adaptive cost based
-              // on the length of the key.
-              token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
-              token.add_attribute(UserPos::Token::SHORTCUT);
-            }
-            user_pos_tokens_.push_back(std::move(token));
-          }
+      }
+      for (const auto &entry : dic->suppression_entries) {
+        if (!seen.contains(entry.entry_fingerprint)) {
+          suppression_dictionary_->AddEntry(entry.key, entry.value);
         }
       }
+      seen.insert(dic->token_fingerprints.begin(),
+                  dic->token_fingerprints.end());
+      for (const auto &entry : dic->suppression_entries) {
+        seen.insert(entry.entry_fingerprint);
+      }
     }
     user_pos_tokens_.shrink_to_fit();
 
@@ -225,10 +225,13 @@ class UserDictionary::TokensIndex {
  private:
   const UserPosInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
-  std::vector<UserPos::Token> user_pos_tokens_;
+  // Tokens are owned by |dictionaries_|, which may be shared with the index
+  // loaded previously.
+  UserDictionaryCache::CompiledDictionaries dictionaries_;
+  std::vector<const UserPos::Token *> user_pos_tokens_;
 };
 
-class UserDictionary::UserDictionaryReloader : public Thread {
+class UserDictionary::UserDictionaryReloader {
  public:
   explicit UserDictionaryReloader(UserDictionary *dic)
       : modified_at_(0), dic_(dic) {
@@ -238,10 +241,15 @@ class UserDictionary::UserDictionaryReloader : public Thread {
   UserDictionaryReloader(const UserDictionaryReloader &) = delete;
   UserDictionaryReloader &operator=(const UserDictionaryReloader &) = delete;
 
-  ~UserDictionaryReloader() override { Join(); }
+  ~UserDictionaryReloader() { Join(); }
+
+  bool IsRunning() const { return !task_.IsDone(); }
+
+  void Join() { task_.Wait(); }
 
   // When the user dictionary exists AND the modification time has been updated,
-  // reloads the dictionary.  Returns true when reloader thread is started.
+  // reloads the dictionary.  Returns true when reloading is scheduled on the
+  // background executor.
   bool MaybeStartReload() {
     absl::StatusOr<FileTimeStamp> modification_time =
         FileUtil::GetModificationTime(
@@ -259,11 +267,12 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       return false;
     }
     modified_at_ = *modification_time;
-    Start("UserDictionaryReloader");
+    task_ = Executor::Get()->Post([this]() { Run(); }, Executor::LOW);
     return true;
   }
 
-  void Run() override {
+ private:
+  void Run() {
     UserDictionaryStorage storage(
         Singleton<UserDictionaryFileManager>::get()->GetFileName());
 
@@ -283,14 +292,33 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       }
     }
 
+    // The compiled dictionaries are cached with the key of the storage so that
+    // the next process can skip compiling it.
+    const uint64_t cache_key =
+        UserDictionaryCache::GetCacheKey(storage.GetProto(), *dic_->user_pos_);
+    const std::string cache_filename = UserDictionaryCache::GetCacheFileName(
+        Singleton<UserDictionaryFileManager>::get()->GetFileName());
+    absl::StatusOr<UserDictionaryCache::CompiledDictionaries> cached =
+        UserDictionaryCache::Read(cache_filename, cache_key);
+    if (cached.ok()) {
+      dic_->Load(*std::move(cached));
+      return;
+    }
+    VLOG(1) << "Cannot use the user dictionary cache: " << cached.status();
+
     dic_->Load(storage.GetProto());
+    if (absl::Status s = UserDictionaryCache::Write(
+            cache_filename, cache_key, dic_->GetCompiledDictionaries());
+        !s.ok()) {
+      LOG(WARNING) << "Failed to write the user dictionary cache: " << s;
+    }
   }
 
- private:
   FileTimeStamp modified_at_;
   UserDictionary *dic_;
   std::string key_;
   std::string value_;
+  Executor::TaskHandle task_;
 };
 
 UserDictionary::UserDictionary(std::unique_ptr<const UserPosInterface> user_pos,
@@ -348,7 +376,7 @@ void UserDictionary::LookupPredictive(
   for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
                                             key, OrderByKeyPrefix());
        begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
+    const UserPos::Token &user_pos_token = **begin;
     switch (callback->OnKey(user_pos_token.key)) {
       case Callback::TRAVERSE_DONE:
         return;
@@ -390,7 +418,7 @@ void UserDictionary::LookupPrefix(absl::string_view key,
   for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
                                   OrderByKey());
        it != tokens_->end(); ++it) {
-    const UserPos::Token &user_pos_token = *it;
+    const UserPos::Token &user_pos_token = **it;
     if (user_pos_token.key > key) {
       break;
     }
@@ -443,7 +471,7 @@ void UserDictionary::LookupExact(absl::string_view key,
 
   Token token;
   for (; begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
+    const UserPos::Token &user_pos_token = **begin;
     if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
       continue;
     }
@@ -475,7 +503,7 @@ bool UserDictionary::LookupComment(absl::string_view key,
   for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
                                             key, OrderByKey());
        begin != end; ++begin) {
-    const UserPos::Token &token = *begin;
+    const UserPos::Token &token = **begin;
     if (token.value == value && !token.comment.empty()) {
       comment->assign(token.comment);
       return true;
@@ -522,6 +550,9 @@ class FindValueCallback : public DictionaryInterface::Callback {
 
 void UserDictionary::WaitForReloader() { reloader_->Join(); }
 
+// static
+uint64_t UserDictionary::GetGeneration() { return g_generation.load(); }
+
 void UserDictionary::Swap(TokensIndex *new_tokens) {
   DCHECK(new_tokens);
   TokensIndex *old_tokens = tokens_;
@@ -529,38 +560,36 @@ void UserDictionary::Swap(TokensIndex *new_tokens) {
     absl::WriterMutexLock l(&mutex_);
     tokens_ = new_tokens;
   }
+  ++g_generation;
   delete old_tokens;
 }
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
-  size_t size = 0;
-  {
-    absl::ReaderMutexLock l(&mutex_);
-    size = tokens_->size();
-  }
-
-  // If UserDictionary is pretty big, we first remove the
-  // current dictionary to save memory usage.
-#ifdef OS_ANDROID
-  constexpr size_t kVeryBigUserDictionarySize = 5000;
-#else   // OS_ANDROID
-  constexpr size_t kVeryBigUserDictionarySize = 100000;
-#endif  // OS_ANDROID
-
-  if (size >= kVeryBigUserDictionarySize) {
-    TokensIndex *dummy_empty_tokens =
-        new TokensIndex(user_pos_.get(), suppression_dictionary_);
-    Swap(dummy_empty_tokens);
-  }
-
+  // The current index keeps serving lookups while the new one is built.  Since
+  // the unmodified dictionaries are shared between them, the extra memory is
+  // bounded by the modified dictionaries.
   TokensIndex *tokens =
       new TokensIndex(user_pos_.get(), suppression_dictionary_);
-  tokens->Load(storage);
+  tokens->Load(storage, GetCompiledDictionaries());
   Swap(tokens);
   return true;
 }
 
+void UserDictionary::Load(
+    UserDictionaryCache::CompiledDictionaries dictionaries) {
+  TokensIndex *tokens =
+      new TokensIndex(user_pos_.get(), suppression_dictionary_);
+  tokens->Load(std::move(dictionaries));
+  Swap(tokens);
+}
+
+UserDictionaryCache::CompiledDictionaries
+UserDictionary::GetCompiledDictionaries() const {
+  absl::ReaderMutexLock l(&mutex_);
+  return tokens_->dictionaries();
+}
+
 std::vector<std::string> UserDictionary::GetPosList() const {
   std::vector<std::string> pos_list;
   user_pos_->GetPosList(&pos_list);
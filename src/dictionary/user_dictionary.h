@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -38,6 +39,7 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_cache.h"
 #include "dictionary/user_pos_interface.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "absl/strings/string_view.h"
@@ -92,12 +94,21 @@ class UserDictionary : public DictionaryInterface {
   // Waits until reloader finishes
   void WaitForReloader();
 
+  // Returns the compiled dictionaries of the current index.  Unmodified
+  // dictionaries are shared across reloads.
+  UserDictionaryCache::CompiledDictionaries GetCompiledDictionaries() const;
+
   // Gets the user POS list.
   std::vector<std::string> GetPosList() const;
 
   // Sets user dicitonary filename for unittesting
   static void SetUserDictionaryName(const std::string &filename);
 
+  // Returns the number of the updates of the user dictionaries in the
+  // process.  Caches of results depending on the user dictionaries are stale
+  // when it changes, e.g., after an asynchronous reload.
+  static uint64_t GetGeneration();
+
   enum RequestType { PREFIX, PREDICTIVE, EXACT };
 
   // Populates Token from UserToken.
@@ -114,6 +125,9 @@ class UserDictionary : public DictionaryInterface {
   // Swaps internal tokens index to |new_tokens|.
   void Swap(TokensIndex *new_tokens);
 
+  // Loads dictionary from already compiled dictionaries.
+  void Load(UserDictionaryCache::CompiledDictionaries dictionaries);
+
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPosInterface> user_pos_;
   const PosMatcher pos_matcher_;
@@ -0,0 +1,360 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/japanese_util.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+#include "base/util.h"
+#include "dictionary/user_dictionary_util.h"
+#include "dictionary/user_pos_interface.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using ::mozc::user_dictionary::UserDictionary;
+
+// "MZUD" followed by the format version.  Bump the version when the layout
+// below or the compilation in Compile() changes.
+constexpr char kMagic[] = "MZUD";
+constexpr uint32_t kVersion = 1;
+constexpr char kShortcutsDictionaryName[] =
+    "__auto_imported_android_shortcuts_dictionary";
+
+// The cache is a local file of the same machine, so integers are stored in the
+// host byte order.
+//
+//   header: magic[4] version:u32 key:u64 num_dictionaries:u32
+//   dictionary: fingerprint:u64
+//               num_tokens:u32 (entry_fp:u64 id:u16 attributes:u16
+//                               key:str value:str comment:str)*
+//               num_suppression_entries:u32 (entry_fp:u64 key:str value:str)*
+//   str: length:u32 bytes
+class ImageWriter {
+ public:
+  template <typename T>
+  void Write(T value) {
+    static_assert(std::is_integral_v<T>);
+    image_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void WriteString(absl::string_view str) {
+    Write<uint32_t>(str.size());
+    image_.append(str.data(), str.size());
+  }
+
+  std::string &image() { return image_; }
+
+ private:
+  std::string image_;
+};
+
+class ImageReader {
+ public:
+  explicit ImageReader(absl::string_view image) : image_(image) {}
+
+  template <typename T>
+  bool Read(T *value) {
+    static_assert(std::is_integral_v<T>);
+    if (image_.size() < sizeof(T)) {
+      return false;
+    }
+    memcpy(value, image_.data(), sizeof(T));
+    image_.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  bool ReadString(std::string *str) {
+    uint32_t size = 0;
+    if (!Read(&size) || image_.size() < size) {
+      return false;
+    }
+    str->assign(image_.data(), size);
+    image_.remove_prefix(size);
+    return true;
+  }
+
+  // Reads the number of the following records, each of which takes at least
+  // |min_record_size| bytes.  Fails if the rest of the image cannot hold
+  // them, so that the count can be used to reserve the containers.
+  bool ReadCount(size_t min_record_size, uint32_t *count) {
+    return Read(count) && *count <= image_.size() / min_record_size;
+  }
+
+  bool empty() const { return image_.empty(); }
+
+ private:
+  absl::string_view image_;
+};
+
+bool ParseDictionary(ImageReader *reader,
+                     UserDictionaryCache::CompiledDictionary *dic) {
+  constexpr size_t kMinTokenSize = sizeof(uint64_t) + sizeof(uint16_t) * 2 +
+                                   sizeof(uint32_t) * 3;
+  uint32_t num_tokens = 0;
+  if (!reader->Read(&dic->fingerprint) ||
+      !reader->ReadCount(kMinTokenSize, &num_tokens)) {
+    return false;
+  }
+  dic->token_fingerprints.reserve(num_tokens);
+  dic->tokens.reserve(num_tokens);
+  for (uint32_t i = 0; i < num_tokens; ++i) {
+    uint64_t fp = 0;
+    UserPosInterface::Token token;
+    if (!reader->Read(&fp) || !reader->Read(&token.id) ||
+        !reader->Read(&token.attributes) || !reader->ReadString(&token.key) ||
+        !reader->ReadString(&token.value) ||
+        !reader->ReadString(&token.comment)) {
+      return false;
+    }
+    dic->token_fingerprints.push_back(fp);
+    dic->tokens.push_back(std::move(token));
+  }
+
+  constexpr size_t kMinSuppressionEntrySize =
+      sizeof(uint64_t) + sizeof(uint32_t) * 2;
+  uint32_t num_suppression_entries = 0;
+  if (!reader->ReadCount(kMinSuppressionEntrySize, &num_suppression_entries)) {
+    return false;
+  }
+  dic->suppression_entries.reserve(num_suppression_entries);
+  for (uint32_t i = 0; i < num_suppression_entries; ++i) {
+    UserDictionaryCache::CompiledDictionary::SuppressionEntry entry;
+    if (!reader->Read(&entry.entry_fingerprint) ||
+        !reader->ReadString(&entry.key) || !reader->ReadString(&entry.value)) {
+      return false;
+    }
+    dic->suppression_entries.push_back(std::move(entry));
+  }
+  return true;
+}
+
+}  // namespace
+
+uint64_t UserDictionaryCache::GetDictionaryFingerprint(
+    const UserDictionary &dic) {
+  return Hash::Fingerprint(dic.SerializeAsString());
+}
+
+uint64_t UserDictionaryCache::GetEntryFingerprint(absl::string_view reading,
+                                                  absl::string_view value,
+                                                  int pos) {
+  DCHECK_LE(0, pos);
+  DCHECK_LE(pos, 255);
+  std::string str = absl::StrCat(reading, "\t", value, "\t");
+  str.push_back(static_cast<char>(pos));
+  return Hash::Fingerprint(str);
+}
+
+std::shared_ptr<const UserDictionaryCache::CompiledDictionary>
+UserDictionaryCache::Compile(const UserPosInterface &user_pos,
+                             const UserDictionary &dic) {
+  auto compiled = std::make_shared<CompiledDictionary>();
+  compiled->fingerprint = GetDictionaryFingerprint(dic);
+
+  const bool is_shortcuts = (dic.name() == kShortcutsDictionaryName);
+  absl::flat_hash_set<uint64_t> seen;
+  std::vector<UserPosInterface::Token> tokens;
+  for (const UserDictionary::Entry &entry : dic.entries()) {
+    if (!UserDictionaryUtil::IsValidEntry(user_pos, entry)) {
+      continue;
+    }
+
+    std::string tmp, reading;
+    UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
+
+    // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
+    // because the normalization is user-visible.
+    // http://b/2480844
+    japanese_util::NormalizeVoicedSoundMark(tmp, &reading);
+
+    const uint64_t fp = GetEntryFingerprint(reading, entry.value(),
+                                            static_cast<int>(entry.pos()));
+    if (!seen.insert(fp).second) {
+      VLOG(1) << "Found dup item";
+      continue;
+    }
+
+    // "抑制単語"
+    if (entry.pos() == UserDictionary::SUPPRESSION_WORD) {
+      compiled->suppression_entries.push_back({fp, reading, entry.value()});
+      continue;
+    }
+
+    tokens.clear();
+    user_pos.GetTokens(reading, entry.value(),
+                       UserDictionaryUtil::GetStringPosType(entry.pos()),
+                       &tokens);
+    for (auto &token : tokens) {
+      Util::StripWhiteSpaces(entry.comment(), &token.comment);
+      if (is_shortcuts &&
+          token.has_attribute(UserPosInterface::Token::SUGGESTION_ONLY)) {
+        // Words fed by Android shortcut are registered as SUGGESTION_ONLY
+        // POS in order to minimize the side-effect of extremely short
+        // reading. However, user expect that they should appear in the
+        // normal conversion. Here we replace the attribute from
+        // SUGGESTION_ONLY to SHORTCUT, which has more adaptive cost based
+        // on the length of the key.
+        token.remove_attribute(UserPosInterface::Token::SUGGESTION_ONLY);
+        token.add_attribute(UserPosInterface::Token::SHORTCUT);
+      }
+      compiled->tokens.push_back(std::move(token));
+      compiled->token_fingerprints.push_back(fp);
+    }
+  }
+  compiled->tokens.shrink_to_fit();
+  compiled->token_fingerprints.shrink_to_fit();
+  return compiled;
+}
+
+uint64_t UserDictionaryCache::GetCacheKey(
+    const user_dictionary::UserDictionaryStorage &storage,
+    const UserPosInterface &user_pos) {
+  std::string seed = absl::StrCat(kMagic, kVersion, "\t");
+  std::vector<std::string> pos_list;
+  user_pos.GetPosList(&pos_list);
+  for (const std::string &pos : pos_list) {
+    uint16_t id = 0;
+    user_pos.GetPosIds(pos, &id);
+    absl::StrAppend(&seed, pos, ":", id, "\t");
+  }
+  return Hash::FingerprintWithSeed(storage.SerializeAsString(),
+                                   Hash::Fingerprint32(seed));
+}
+
+std::string UserDictionaryCache::GetCacheFileName(const std::string &filename) {
+  return absl::StrCat(filename, ".cache");
+}
+
+std::string UserDictionaryCache::Serialize(
+    uint64_t key, const CompiledDictionaries &dictionaries) {
+  ImageWriter writer;
+  writer.image().append(kMagic, 4);
+  writer.Write(kVersion);
+  writer.Write(key);
+  writer.Write<uint32_t>(dictionaries.size());
+  for (const auto &dic : dictionaries) {
+    writer.Write(dic->fingerprint);
+    writer.Write<uint32_t>(dic->tokens.size());
+    for (size_t i = 0; i < dic->tokens.size(); ++i) {
+      const UserPosInterface::Token &token = dic->tokens[i];
+      writer.Write(dic->token_fingerprints[i]);
+      writer.Write(token.id);
+      writer.Write(token.attributes);
+      writer.WriteString(token.key);
+      writer.WriteString(token.value);
+      writer.WriteString(token.comment);
+    }
+    writer.Write<uint32_t>(dic->suppression_entries.size());
+    for (const auto &entry : dic->suppression_entries) {
+      writer.Write(entry.entry_fingerprint);
+      writer.WriteString(entry.key);
+      writer.WriteString(entry.value);
+    }
+  }
+  return std::move(writer.image());
+}
+
+absl::StatusOr<UserDictionaryCache::CompiledDictionaries>
+UserDictionaryCache::Parse(absl::string_view image, uint64_t key) {
+  if (!absl::StartsWith(image, absl::string_view(kMagic, 4))) {
+    return absl::DataLossError("Not a user dictionary cache");
+  }
+  ImageReader reader(image.substr(4));
+  uint32_t version = 0;
+  uint64_t image_key = 0;
+  uint32_t num_dictionaries = 0;
+  constexpr size_t kMinDictionarySize =
+      sizeof(uint64_t) + sizeof(uint32_t) * 2;
+  if (!reader.Read(&version) || !reader.Read(&image_key) ||
+      !reader.ReadCount(kMinDictionarySize, &num_dictionaries)) {
+    return absl::DataLossError("Broken user dictionary cache header");
+  }
+  if (version != kVersion || image_key != key) {
+    return absl::FailedPreconditionError("User dictionary cache is stale");
+  }
+
+  CompiledDictionaries dictionaries;
+  dictionaries.reserve(num_dictionaries);
+  for (uint32_t i = 0; i < num_dictionaries; ++i) {
+    auto dic = std::make_shared<CompiledDictionary>();
+    if (!ParseDictionary(&reader, dic.get())) {
+      return absl::DataLossError("Broken user dictionary cache");
+    }
+    dictionaries.push_back(std::move(dic));
+  }
+  if (!reader.empty()) {
+    return absl::DataLossError("Trailing bytes in user dictionary cache");
+  }
+  return dictionaries;
+}
+
+absl::Status UserDictionaryCache::Write(
+    const std::string &filename, uint64_t key,
+    const CompiledDictionaries &dictionaries) {
+  const std::string tmp_filename = absl::StrCat(filename, ".tmp");
+  if (absl::Status s =
+          FileUtil::SetContents(tmp_filename, Serialize(key, dictionaries));
+      !s.ok()) {
+    return s;
+  }
+  return FileUtil::AtomicRename(tmp_filename, filename);
+}
+
+absl::StatusOr<UserDictionaryCache::CompiledDictionaries>
+UserDictionaryCache::Read(const std::string &filename, uint64_t key) {
+  Mmap mmap;
+  if (!mmap.Open(filename.c_str())) {
+    return absl::NotFoundError(absl::StrCat("Cannot open ", filename));
+  }
+  return Parse(absl::string_view(mmap.begin(), mmap.size()), key);
+}
+
+}  // namespace dictionary
+}  // namespace mozc
@@ -0,0 +1,122 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compiled form of UserDictionaryStorage.
+//
+// Each dictionary in the storage is compiled independently into the tokens
+// expanded by UserPos and the suppression entries, so that unchanged
+// dictionaries can be reused when only a part of the storage is edited.  The
+// compiled dictionaries can also be written to a binary cache file keyed by the
+// fingerprint of the storage, which lets the next process skip expanding and
+// sorting the entries.
+#ifndef MOZC_DICTIONARY_USER_DICTIONARY_CACHE_H_
+#define MOZC_DICTIONARY_USER_DICTIONARY_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dictionary/user_pos_interface.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+
+class UserDictionaryCache {
+ public:
+  // Tokens and suppression entries compiled from one dictionary.  Duplicated
+  // entries in the dictionary are already removed.
+  struct CompiledDictionary {
+    struct SuppressionEntry {
+      uint64_t entry_fingerprint = 0;
+      std::string key;
+      std::string value;
+    };
+
+    // Fingerprint of the source dictionary.
+    uint64_t fingerprint = 0;
+    // |tokens[i]| is expanded from the entry of |token_fingerprints[i]|.
+    std::vector<UserPosInterface::Token> tokens;
+    std::vector<uint64_t> token_fingerprints;
+    std::vector<SuppressionEntry> suppression_entries;
+  };
+  using CompiledDictionaries =
+      std::vector<std::shared_ptr<const CompiledDictionary>>;
+
+  UserDictionaryCache() = delete;
+  UserDictionaryCache(const UserDictionaryCache &) = delete;
+  UserDictionaryCache &operator=(const UserDictionaryCache &) = delete;
+
+  // Returns the fingerprint of |dic| used to find reusable compiled
+  // dictionaries.
+  static uint64_t GetDictionaryFingerprint(
+      const user_dictionary::UserDictionary &dic);
+
+  // Returns the fingerprint identifying an entry for deduplication.
+  static uint64_t GetEntryFingerprint(absl::string_view reading,
+                                      absl::string_view value, int pos);
+
+  // Compiles |dic| into tokens.
+  static std::shared_ptr<const CompiledDictionary> Compile(
+      const UserPosInterface &user_pos,
+      const user_dictionary::UserDictionary &dic);
+
+  // Returns the key of the cache for |storage|.  The key also depends on the
+  // POS ids of |user_pos| since they are embedded in tokens.
+  static uint64_t GetCacheKey(
+      const user_dictionary::UserDictionaryStorage &storage,
+      const UserPosInterface &user_pos);
+
+  // Returns the cache file name for the user dictionary file |filename|.
+  static std::string GetCacheFileName(const std::string &filename);
+
+  // Writes |dictionaries| to |filename| atomically.
+  static absl::Status Write(const std::string &filename, uint64_t key,
+                            const CompiledDictionaries &dictionaries);
+
+  // Reads the compiled dictionaries from |filename|.  Returns an error if the
+  // file is broken or its key doesn't match |key|.
+  static absl::StatusOr<CompiledDictionaries> Read(const std::string &filename,
+                                                   uint64_t key);
+
+  // Serializes/parses the cache image.  Exposed for Write() and Read().
+  static std::string Serialize(uint64_t key,
+                               const CompiledDictionaries &dictionaries);
+  static absl::StatusOr<CompiledDictionaries> Parse(absl::string_view image,
+                                                    uint64_t key);
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_USER_DICTIONARY_CACHE_H_
@@ -0,0 +1,175 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "base/file_util.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "dictionary/user_pos.h"
+#include "dictionary/user_pos_interface.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "testing/base/public/gmock.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using ::mozc::user_dictionary::UserDictionary;
+using ::mozc::user_dictionary::UserDictionaryStorage;
+
+void AddEntry(const char *key, const char *value, UserDictionary::PosType pos,
+              const char *comment, UserDictionary *dic) {
+  UserDictionary::Entry *entry = dic->add_entries();
+  entry->set_key(key);
+  entry->set_value(value);
+  entry->set_pos(pos);
+  entry->set_comment(comment);
+}
+
+class UserDictionaryCacheTest : public ::testing::Test {
+ protected:
+  UserDictionaryCacheTest()
+      : user_pos_(UserPos::CreateFromDataManager(mock_data_manager_)) {
+    UserDictionary *dic = storage_.add_dictionaries();
+    dic->set_id(1);
+    dic->set_name("test");
+    AddEntry("あいう", "亜伊宇", UserDictionary::NOUN, "comment", dic);
+    AddEntry("あいう", "亜伊宇", UserDictionary::NOUN, "duplicated", dic);
+    AddEntry("かきく", "書き句", UserDictionary::SUPPRESSION_WORD, "", dic);
+    AddEntry("", "invalid", UserDictionary::NOUN, "", dic);
+  }
+
+  const testing::MockDataManager mock_data_manager_;
+  std::unique_ptr<UserPos> user_pos_;
+  UserDictionaryStorage storage_;
+};
+
+TEST_F(UserDictionaryCacheTest, Compile) {
+  const auto compiled =
+      UserDictionaryCache::Compile(*user_pos_, storage_.dictionaries(0));
+  EXPECT_EQ(
+      compiled->fingerprint,
+      UserDictionaryCache::GetDictionaryFingerprint(storage_.dictionaries(0)));
+
+  // The duplicated and invalid entries are removed.
+  ASSERT_EQ(compiled->tokens.size(), 1);
+  ASSERT_EQ(compiled->token_fingerprints.size(), 1);
+  EXPECT_EQ(compiled->tokens[0].key, "あいう");
+  EXPECT_EQ(compiled->tokens[0].value, "亜伊宇");
+  EXPECT_EQ(compiled->tokens[0].comment, "comment");
+  EXPECT_EQ(compiled->token_fingerprints[0],
+            UserDictionaryCache::GetEntryFingerprint("あいう", "亜伊宇",
+                                                     UserDictionary::NOUN));
+
+  ASSERT_EQ(compiled->suppression_entries.size(), 1);
+  EXPECT_EQ(compiled->suppression_entries[0].key, "かきく");
+  EXPECT_EQ(compiled->suppression_entries[0].value, "書き句");
+}
+
+TEST_F(UserDictionaryCacheTest, SerializeAndParse) {
+  const UserDictionaryCache::CompiledDictionaries dictionaries = {
+      UserDictionaryCache::Compile(*user_pos_, storage_.dictionaries(0))};
+  const uint64_t key = UserDictionaryCache::GetCacheKey(storage_, *user_pos_);
+  const std::string image = UserDictionaryCache::Serialize(key, dictionaries);
+
+  absl::StatusOr<UserDictionaryCache::CompiledDictionaries> parsed =
+      UserDictionaryCache::Parse(image, key);
+  ASSERT_TRUE(parsed.ok()) << parsed.status();
+  ASSERT_EQ(parsed->size(), 1);
+  const UserDictionaryCache::CompiledDictionary &expected = *dictionaries[0];
+  const UserDictionaryCache::CompiledDictionary &actual = *(*parsed)[0];
+  EXPECT_EQ(actual.fingerprint, expected.fingerprint);
+  EXPECT_EQ(actual.token_fingerprints, expected.token_fingerprints);
+  ASSERT_EQ(actual.tokens.size(), expected.tokens.size());
+  for (size_t i = 0; i < actual.tokens.size(); ++i) {
+    EXPECT_EQ(actual.tokens[i].key, expected.tokens[i].key);
+    EXPECT_EQ(actual.tokens[i].value, expected.tokens[i].value);
+    EXPECT_EQ(actual.tokens[i].id, expected.tokens[i].id);
+    EXPECT_EQ(actual.tokens[i].attributes, expected.tokens[i].attributes);
+    EXPECT_EQ(actual.tokens[i].comment, expected.tokens[i].comment);
+  }
+  ASSERT_EQ(actual.suppression_entries.size(), 1);
+  EXPECT_EQ(actual.suppression_entries[0].key, "かきく");
+
+  // The cache of another storage is rejected.
+  storage_.mutable_dictionaries(0)->set_name("modified");
+  const uint64_t modified_key =
+      UserDictionaryCache::GetCacheKey(storage_, *user_pos_);
+  EXPECT_NE(modified_key, key);
+  EXPECT_FALSE(UserDictionaryCache::Parse(image, modified_key).ok());
+
+  // Broken images are rejected.
+  EXPECT_FALSE(UserDictionaryCache::Parse("", key).ok());
+  EXPECT_FALSE(
+      UserDictionaryCache::Parse(image.substr(0, image.size() - 1), key).ok());
+  EXPECT_FALSE(UserDictionaryCache::Parse(image + "x", key).ok());
+
+  // Counts which the image cannot hold are rejected.
+  constexpr uint32_t kHugeCount = std::numeric_limits<uint32_t>::max();
+  constexpr size_t kNumDictionariesOffset = 16;
+  constexpr size_t kNumTokensOffset = 28;
+  for (const size_t offset : {kNumDictionariesOffset, kNumTokensOffset}) {
+    std::string broken = image;
+    memcpy(&broken[offset], &kHugeCount, sizeof(kHugeCount));
+    EXPECT_FALSE(UserDictionaryCache::Parse(broken, key).ok()) << offset;
+  }
+}
+
+TEST_F(UserDictionaryCacheTest, WriteAndRead) {
+  const std::string filename = UserDictionaryCache::GetCacheFileName(
+      FileUtil::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "user_dic.db"));
+  ASSERT_OK(FileUtil::UnlinkIfExists(filename));
+  const uint64_t key = UserDictionaryCache::GetCacheKey(storage_, *user_pos_);
+
+  EXPECT_FALSE(UserDictionaryCache::Read(filename, key).ok());
+  ASSERT_OK(UserDictionaryCache::Write(
+      filename, key,
+      {UserDictionaryCache::Compile(*user_pos_, storage_.dictionaries(0))}));
+  absl::StatusOr<UserDictionaryCache::CompiledDictionaries> read =
+      UserDictionaryCache::Read(filename, key);
+  ASSERT_TRUE(read.ok()) << read.status();
+  ASSERT_EQ(read->size(), 1);
+  EXPECT_EQ((*read)[0]->tokens.size(), 1);
+  EXPECT_OK(FileUtil::UnlinkIfExists(filename));
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
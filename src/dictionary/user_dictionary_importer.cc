@@ -39,12 +39,13 @@
 #include <cstdint>
 #include <iterator>
 #include <map>
-#include <set>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/executor.h"
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
@@ -54,6 +55,7 @@
 #include "base/util.h"
 #include "base/win_util.h"
 #include "dictionary/user_dictionary_util.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -187,53 +189,157 @@ bool ConvertEntryInternal(const PosMap *pos_map, size_t map_size,
   return true;
 }
 
+// An entry converted from a raw entry in the import.
+struct ConvertedEntry {
+  enum Type {
+    EMPTY,
+    INVALID,
+    VALID,
+  };
+  Type type = EMPTY;
+  UserDictionary::Entry entry;
+  uint64_t fingerprint = 0;
+};
+
+void ConvertRawEntry(const UserDictionaryImporter::RawEntry &raw_entry,
+                     ConvertedEntry *converted) {
+  if (raw_entry.key.empty() && raw_entry.value.empty() &&
+      raw_entry.comment.empty()) {
+    converted->type = ConvertedEntry::EMPTY;
+    return;
+  }
+  if (!UserDictionaryImporter::ConvertEntry(raw_entry, &converted->entry)) {
+    converted->type = ConvertedEntry::INVALID;
+    return;
+  }
+  converted->type = ConvertedEntry::VALID;
+  converted->fingerprint = EntryFingerprint(converted->entry);
+}
+
+// Converts |raw_entries| into |converted_entries|.  With |executor|, the
+// entries are split into |num_slices| slices and the last one is converted on
+// the calling thread.
+void ConvertRawEntries(const UserDictionaryImporter::RawEntry *raw_entries,
+                       size_t size, int num_slices, Executor *executor,
+                       ConvertedEntry *converted_entries) {
+  if (executor == nullptr || num_slices <= 1 || size < 2) {
+    for (size_t i = 0; i < size; ++i) {
+      ConvertRawEntry(raw_entries[i], &converted_entries[i]);
+    }
+    return;
+  }
+
+  const size_t slice_size = (size + num_slices - 1) / num_slices;
+  std::vector<Executor::TaskHandle> handles;
+  size_t begin = 0;
+  for (; begin + slice_size < size; begin += slice_size) {
+    const size_t end = begin + slice_size;
+    handles.push_back(executor->Post([=]() {
+      for (size_t i = begin; i < end; ++i) {
+        ConvertRawEntry(raw_entries[i], &converted_entries[i]);
+      }
+    }));
+  }
+  for (size_t i = begin; i < size; ++i) {
+    ConvertRawEntry(raw_entries[i], &converted_entries[i]);
+  }
+  for (const Executor::TaskHandle &handle : handles) {
+    handle.Wait();
+  }
+}
+
 }  // namespace
 
 UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
     InputIteratorInterface *iter, UserDictionary *user_dic) {
+  return ImportFromIterator(iter, ImportOptions(), user_dic);
+}
+
+UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
+    InputIteratorInterface *iter, const ImportOptions &options,
+    UserDictionary *user_dic) {
   if (iter == nullptr || user_dic == nullptr) {
     LOG(ERROR) << "iter or user_dic is nullptr";
     return IMPORT_FATAL;
   }
 
   const size_t max_size = UserDictionaryUtil::max_entry_size();
+  const size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
 
   ErrorType ret = IMPORT_NO_ERROR;
 
-  std::set<uint64_t> existent_entries;
-  for (size_t i = 0; i < user_dic->entries_size(); ++i) {
-    existent_entries.insert(EntryFingerprint(user_dic->entries(i)));
-  }
-
-  UserDictionary::Entry entry;
-  RawEntry raw_entry;
-  while (iter->Next(&raw_entry)) {
-    if (user_dic->entries_size() >= max_size) {
-      LOG(WARNING) << "Too many words in one dictionary";
-      return IMPORT_TOO_MANY_WORDS;
+  absl::flat_hash_set<uint64_t> existent_entries;
+  existent_entries.reserve(user_dic->entries_size() + chunk_size);
+  for (const UserDictionary::Entry &entry : user_dic->entries()) {
+    existent_entries.insert(EntryFingerprint(entry));
+  }
+
+  // Started when a chunk is large enough to be split.
+  std::unique_ptr<Executor> executor;
+  const size_t min_entries_per_worker =
+      std::max<size_t>(options.min_entries_per_worker, 1);
+
+  // The buffers are reused over the chunks to keep the allocated strings.
+  std::vector<RawEntry> raw_entries(chunk_size);
+  std::vector<ConvertedEntry> converted_entries(chunk_size);
+  size_t num_read = 0;
+  bool has_next = true;
+  while (has_next) {
+    size_t size = 0;
+    while (size < chunk_size && (has_next = iter->Next(&raw_entries[size]))) {
+      ++size;
     }
-
-    if (raw_entry.key.empty() && raw_entry.value.empty() &&
-        raw_entry.comment.empty()) {
-      // Empty entry is just skipped. It could be annoying if we show a
-      // warning dialog when these empty candidates exist.
-      continue;
+    if (size == 0) {
+      break;
     }
+    num_read += size;
 
-    if (!ConvertEntry(raw_entry, &entry)) {
-      LOG(WARNING) << "Entry is not valid";
-      ret = IMPORT_INVALID_ENTRIES;
-      continue;
+    const int num_slices = static_cast<int>(std::min<size_t>(
+        std::max(options.num_workers, 1), size / min_entries_per_worker));
+    if (num_slices > 1 && executor == nullptr) {
+      executor = std::make_unique<Executor>(options.num_workers);
     }
+    ConvertRawEntries(raw_entries.data(), size, num_slices, executor.get(),
+                      converted_entries.data());
+
+    const size_t num_valid = std::count_if(
+        converted_entries.begin(), converted_entries.begin() + size,
+        [](const ConvertedEntry &converted) {
+          return converted.type == ConvertedEntry::VALID;
+        });
+    user_dic->mutable_entries()->Reserve(
+        std::min(max_size, user_dic->entries_size() + num_valid));
+
+    for (size_t i = 0; i < size; ++i) {
+      if (user_dic->entries_size() >= max_size) {
+        LOG(WARNING) << "Too many words in one dictionary";
+        return IMPORT_TOO_MANY_WORDS;
+      }
 
-    // Don't register words if it is aleady in the current dictionary.
-    if (!existent_entries.insert(EntryFingerprint(entry)).second) {
-      continue;
+      ConvertedEntry &converted = converted_entries[i];
+      if (converted.type == ConvertedEntry::EMPTY) {
+        // Empty entry is just skipped. It could be annoying if we show a
+        // warning dialog when these empty candidates exist.
+        continue;
+      }
+
+      if (converted.type == ConvertedEntry::INVALID) {
+        LOG(WARNING) << "Entry is not valid";
+        ret = IMPORT_INVALID_ENTRIES;
+        continue;
+      }
+
+      // Don't register words if it is aleady in the current dictionary.
+      if (!existent_entries.insert(converted.fingerprint).second) {
+        continue;
+      }
+
+      *user_dic->add_entries() = std::move(converted.entry);
     }
 
-    UserDictionary::Entry *new_entry = user_dic->add_entries();
-    DCHECK(new_entry);
-    *new_entry = entry;
+    if (options.progress_callback) {
+      options.progress_callback(num_read, user_dic->entries_size());
+    }
   }
 
   return ret;
@@ -243,12 +349,19 @@ UserDictionaryImporter::ErrorType
 UserDictionaryImporter::ImportFromTextLineIterator(
     IMEType ime_type, TextLineIteratorInterface *iter,
     UserDictionary *user_dic) {
+  return ImportFromTextLineIterator(ime_type, iter, ImportOptions(), user_dic);
+}
+
+UserDictionaryImporter::ErrorType
+UserDictionaryImporter::ImportFromTextLineIterator(
+    IMEType ime_type, TextLineIteratorInterface *iter,
+    const ImportOptions &options, UserDictionary *user_dic) {
   TextInputIterator text_iter(ime_type, iter);
   if (text_iter.ime_type() == NUM_IMES) {
     return IMPORT_NOT_SUPPORTED;
   }
 
-  return ImportFromIterator(&text_iter, user_dic);
+  return ImportFromIterator(&text_iter, options, user_dic);
 }
 
 UserDictionaryImporter::StringTextLineIterator::StringTextLineIterator(
@@ -30,6 +30,8 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_IMPORTER_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_IMPORTER_H_
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 #include "base/port.h"
@@ -184,15 +186,37 @@ class UserDictionaryImporter {
   static bool ConvertEntry(const RawEntry &from,
                            user_dictionary::UserDictionary::Entry *to);
 
+  // Options of the bulk import.  Raw entries are read from the iterator in
+  // chunks of |chunk_size|, the POS conversion and the validation of a chunk
+  // are run on |num_workers| threads, and then the converted entries are
+  // appended to the dictionary in the original order.
+  struct ImportOptions {
+    // Entries are converted on the calling thread when it is 1 or less.
+    int num_workers = 1;
+    // Each worker converts at least this number of entries, so that the
+    // threads are not started for small imports.
+    size_t min_entries_per_worker = 256;
+    size_t chunk_size = 4096;
+    // Called after each chunk with the number of entries read from the
+    // iterator so far and the number of entries in the dictionary.
+    std::function<void(size_t num_read, size_t num_entries)> progress_callback;
+  };
+
   // Import a dictionary from InputIteratorInterface.
   // This is the most generic interface.
   static ErrorType ImportFromIterator(InputIteratorInterface *iter,
                                       user_dictionary::UserDictionary *dic);
+  static ErrorType ImportFromIterator(InputIteratorInterface *iter,
+                                      const ImportOptions &options,
+                                      user_dictionary::UserDictionary *dic);
 
   // Import a dictionary from TextLineIterator.
   static ErrorType ImportFromTextLineIterator(
       IMEType ime_type, TextLineIteratorInterface *iter,
       user_dictionary::UserDictionary *dic);
+  static ErrorType ImportFromTextLineIterator(
+      IMEType ime_type, TextLineIteratorInterface *iter,
+      const ImportOptions &options, user_dictionary::UserDictionary *dic);
 
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(UserDictionaryImporter);
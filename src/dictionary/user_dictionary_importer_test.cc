@@ -411,6 +411,55 @@ TEST(UserDictionaryImporter, ImportFromIteratorDupTest) {
   EXPECT_EQ(2, user_dic.entries_size());
 }
 
+TEST(UserDictionaryImporter, ImportFromIteratorWithOptionsTest) {
+  std::vector<UserDictionaryImporter::RawEntry> entries;
+  for (size_t i = 0; i < 1000; ++i) {
+    UserDictionaryImporter::RawEntry entry;
+    // Every 5th entry duplicates the previous one.
+    const uint32_t id = static_cast<uint32_t>(i % 5 == 4 ? i - 1 : i);
+    entry.key = "key" + std::to_string(id);
+    entry.value = "value" + std::to_string(id);
+    if (i % 3 != 0) {
+      entry.pos = "名詞";
+    }
+    entries.push_back(entry);
+  }
+
+  TestInputIterator expected_iter;
+  expected_iter.set_available(true);
+  expected_iter.set_entries(&entries);
+  UserDictionaryStorage::UserDictionary expected;
+  EXPECT_EQ(UserDictionaryImporter::IMPORT_INVALID_ENTRIES,
+            UserDictionaryImporter::ImportFromIterator(&expected_iter,
+                                                       &expected));
+
+  UserDictionaryImporter::ImportOptions options;
+  options.num_workers = 4;
+  options.min_entries_per_worker = 16;
+  options.chunk_size = 64;
+  std::vector<size_t> progress;
+  options.progress_callback = [&progress, &entries](size_t num_read,
+                                                    size_t num_entries) {
+    EXPECT_LE(num_entries, num_read);
+    EXPECT_LE(num_read, entries.size());
+    progress.push_back(num_read);
+  };
+
+  TestInputIterator iter;
+  iter.set_available(true);
+  iter.set_entries(&entries);
+  UserDictionaryStorage::UserDictionary user_dic;
+  EXPECT_EQ(UserDictionaryImporter::IMPORT_INVALID_ENTRIES,
+            UserDictionaryImporter::ImportFromIterator(&iter, options,
+                                                       &user_dic));
+
+  // The result doesn't depend on the chunks and the threads.
+  EXPECT_EQ(expected.SerializeAsString(), user_dic.SerializeAsString());
+  EXPECT_EQ((entries.size() + 63) / 64, progress.size());
+  ASSERT_FALSE(progress.empty());
+  EXPECT_EQ(entries.size(), progress.back());
+}
+
 TEST(UserDictionaryImporter, GuessIMETypeTest) {
   EXPECT_EQ(UserDictionaryImporter::NUM_IMES,
             UserDictionaryImporter::GuessIMEType(""));
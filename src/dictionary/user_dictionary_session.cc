@@ -30,6 +30,7 @@
 #include "dictionary/user_dictionary_session.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <memory>
@@ -37,6 +38,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/cpu_stats.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/protobuf/protobuf.h"
@@ -328,11 +330,18 @@ constexpr int kMaxUndoHistory = 30;
 // storage.
 constexpr char kDefaultDictionaryName[] = "user dictionary";
 
+// The maximum number of threads converting the imported entries.
+constexpr size_t kMaxImportWorkers = 4;
+
 }  // namespace
 
 UserDictionarySession::UserDictionarySession(const std::string &filepath)
     : storage_(new mozc::UserDictionaryStorage(filepath)),
-      default_dictionary_name_(kDefaultDictionaryName) {}
+      default_dictionary_name_(kDefaultDictionaryName) {
+  // Large imports convert the entries on multiple threads.
+  import_options_.num_workers = static_cast<int>(std::min<size_t>(
+      CPUStats().GetNumberOfProcessors(), kMaxImportWorkers));
+}
 UserDictionarySession::~UserDictionarySession() { ClearUndoHistory(); }
 
 // TODO(hidehiko) move this to header.
@@ -654,7 +663,8 @@ UserDictionarySession::ImportFromStringInternal(UserDictionary *dictionary,
   {
     UserDictionaryImporter::StringTextLineIterator iter(data);
     import_result = UserDictionaryImporter::ImportFromTextLineIterator(
-        UserDictionaryImporter::IME_AUTO_DETECT, &iter, dictionary);
+        UserDictionaryImporter::IME_AUTO_DETECT, &iter, import_options_,
+        dictionary);
   }
 
   LOG_IF(WARNING, import_result != UserDictionaryImporter::IMPORT_NO_ERROR)
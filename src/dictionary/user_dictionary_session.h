@@ -37,6 +37,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "dictionary/user_dictionary_importer.h"
 #include "protocol/user_dictionary_storage.pb.h"
 
 namespace mozc {
@@ -121,6 +122,14 @@ class UserDictionarySession {
       const std::string &dictionary_name, const std::string &data,
       uint64_t *new_dictionary_id);
 
+  // Sets the options used by ImportFromString and
+  // ImportToNewDictionaryFromString, e.g. to convert the entries of a large
+  // text on multiple threads or to report the progress.
+  void set_import_options(
+      const UserDictionaryImporter::ImportOptions &import_options) {
+    import_options_ = import_options;
+  }
+
   // Clears all the dictionaries and undo history (doesn't save to the file).
   // This operation is not undoable.
   void ClearDictionariesAndUndoHistory();
@@ -143,6 +152,7 @@ class UserDictionarySession {
   std::unique_ptr<mozc::UserDictionaryStorage> storage_;
   std::string default_dictionary_name_;
   std::deque<UndoCommand *> undo_history_;
+  UserDictionaryImporter::ImportOptions import_options_;
 
   DISALLOW_COPY_AND_ASSIGN(UserDictionarySession);
 };
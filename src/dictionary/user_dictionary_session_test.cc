@@ -39,6 +39,7 @@
 
 #include "base/file_util.h"
 #include "base/system_util.h"
+#include "dictionary/user_dictionary_importer.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "testing/base/public/gmock.h"
@@ -57,6 +58,7 @@ constexpr char kDictionaryData[] =
 
 using ::mozc::FileUtil;
 using ::mozc::SystemUtil;
+using ::mozc::UserDictionaryImporter;
 using ::mozc::user_dictionary::UserDictionary;
 using ::mozc::user_dictionary::UserDictionaryCommandStatus;
 using ::mozc::user_dictionary::UserDictionarySession;
@@ -654,6 +656,32 @@ TEST_F(UserDictionarySessionTest, ImportFromString) {
   EXPECT_EQ(0, session.storage().dictionaries(0).entries_size());
 }
 
+TEST_F(UserDictionarySessionTest, ImportFromStringWithOptions) {
+  UserDictionarySession session(GetUserDictionaryFile());
+
+  UserDictionaryImporter::ImportOptions options;
+  options.num_workers = 2;
+  options.chunk_size = 2;
+  size_t num_entries = 0;
+  options.progress_callback = [&num_entries](size_t, size_t size) {
+    num_entries = size;
+  };
+  session.set_import_options(options);
+
+  uint64_t dictionary_id;
+  ASSERT_EQ(UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS,
+            session.CreateDictionary("user dictionary", &dictionary_id));
+  ASSERT_EQ(UserDictionaryCommandStatus::USER_DICTIONARY_COMMAND_SUCCESS,
+            session.ImportFromString(dictionary_id, kDictionaryData));
+
+  ASSERT_EQ(1, session.storage().dictionaries_size());
+  const UserDictionary &dictionary = session.storage().dictionaries(0);
+  ASSERT_EQ(4, dictionary.entries_size());
+  EXPECT_EQ("きょうと", dictionary.entries(0).key());
+  EXPECT_EQ("すずき", dictionary.entries(3).key());
+  EXPECT_EQ(4, num_entries);
+}
+
 TEST_F(UserDictionarySessionTest, ImportToNewDictionaryFromString) {
   UserDictionarySession session(GetUserDictionaryFile());
 
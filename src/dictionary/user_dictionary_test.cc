@@ -51,6 +51,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_cache.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_pos.h"
 #include "dictionary/user_pos_interface.h"
@@ -354,6 +355,11 @@ class UserDictionaryTest : public ::testing::Test {
     }
   }
 
+  static UserDictionaryCache::CompiledDictionaries GetCompiledDictionaries(
+      const UserDictionary &dic) {
+    return dic.GetCompiledDictionaries();
+  }
+
   // Helper function to lookup comment string from |dic|.
   std::string LookupComment(const UserDictionary &dic, absl::string_view key,
                             absl::string_view value) {
@@ -689,6 +695,136 @@ TEST_F(UserDictionaryTest, AsyncLoadTest) {
     dic->WaitForReloader();
   }
   EXPECT_OK(FileUtil::UnlinkIfExists(filename));
+  EXPECT_OK(FileUtil::UnlinkIfExists(
+      UserDictionaryCache::GetCacheFileName(filename)));
+}
+
+TEST_F(UserDictionaryTest, IncrementalLoad) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage("");
+  LoadFromString(kUserDictionary0, &storage);
+  {
+    UserDictionaryStorage::UserDictionary *dic1 =
+        storage.GetProto().add_dictionaries();
+    UserDictionaryStorage::UserDictionaryEntry *entry = dic1->add_entries();
+    entry->set_key("end");
+    entry->set_value("end");
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    // Also in the first dictionary with another comment.
+    entry = dic1->add_entries();
+    entry->set_key("comment_key2");
+    entry->set_value("comment_value2");
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    entry->set_comment("another comment");
+  }
+  dic->Load(storage.GetProto());
+  const UserDictionaryCache::CompiledDictionaries compiled0 =
+      GetCompiledDictionaries(*dic);
+  ASSERT_EQ(compiled0.size(), 2);
+  // The entry in the first dictionary wins.
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "comment");
+
+  // Modify only the second dictionary.
+  {
+    UserDictionaryStorage::UserDictionaryEntry *entry =
+        storage.GetProto().mutable_dictionaries(1)->add_entries();
+    entry->set_key("endless");
+    entry->set_value("endless");
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+  }
+  dic->Load(storage.GetProto());
+  const UserDictionaryCache::CompiledDictionaries compiled1 =
+      GetCompiledDictionaries(*dic);
+  ASSERT_EQ(compiled1.size(), 2);
+  EXPECT_EQ(compiled1[0], compiled0[0]);
+  EXPECT_NE(compiled1[1], compiled0[1]);
+
+  EntryCollector collector;
+  dic->LookupPrefix("endless", convreq_, &collector);
+  std::vector<std::string> values;
+  for (const Entry &entry : collector.entries()) {
+    values.push_back(entry.value);
+  }
+  EXPECT_THAT(values, ::testing::UnorderedElementsAre("end", "endless"));
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "comment");
+}
+
+TEST_F(UserDictionaryTest, CompiledCache) {
+  const std::string filename = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "compiled_cache_test.db");
+  const std::string cache_filename =
+      UserDictionaryCache::GetCacheFileName(filename);
+  ASSERT_OK(FileUtil::UnlinkIfExists(filename));
+  ASSERT_OK(FileUtil::UnlinkIfExists(cache_filename));
+  {
+    UserDictionaryStorage storage(filename);
+    ASSERT_TRUE(storage.Lock());
+    uint64_t id = 0;
+    ASSERT_TRUE(storage.CreateDictionary("test", &id));
+    UserDictionaryStorage::UserDictionaryEntry *entry =
+        storage.GetProto().mutable_dictionaries(0)->add_entries();
+    entry->set_key("end");
+    entry->set_value("end");
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    ASSERT_OK(storage.Save());
+    ASSERT_TRUE(storage.UnLock());
+  }
+
+  // The first reload writes the cache.
+  UserDictionary::SetUserDictionaryName(filename);
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+    EXPECT_OK(FileUtil::FileExists(cache_filename));
+    EntryCollector collector;
+    dic->LookupExact("end", convreq_, &collector);
+    EXPECT_EQ(collector.entries().size(), 1);
+  }
+
+  // Overwrite the cache with other contents under the same key to see that
+  // the next process uses it instead of the storage.
+  {
+    UserDictionaryStorage storage(filename);
+    ASSERT_OK(storage.Load());
+    const UserPosMock user_pos;
+    UserDictionaryStorage::UserDictionary other;
+    UserDictionaryStorage::UserDictionaryEntry *entry = other.add_entries();
+    entry->set_key("cached");
+    entry->set_value("cached");
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    ASSERT_OK(UserDictionaryCache::Write(
+        cache_filename,
+        UserDictionaryCache::GetCacheKey(storage.GetProto(), user_pos),
+        {UserDictionaryCache::Compile(user_pos, other)}));
+  }
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+    EntryCollector collector;
+    dic->LookupExact("cached", convreq_, &collector);
+    EXPECT_EQ(collector.entries().size(), 1);
+    EntryCollector collector_end;
+    dic->LookupExact("end", convreq_, &collector_end);
+    EXPECT_TRUE(collector_end.entries().empty());
+  }
+
+  UserDictionary::SetUserDictionaryName("");
+  EXPECT_OK(FileUtil::UnlinkIfExists(filename));
+  EXPECT_OK(FileUtil::UnlinkIfExists(cache_filename));
+}
+
+TEST_F(UserDictionaryTest, GetGeneration) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+  const uint64_t generation = UserDictionary::GetGeneration();
+  {
+    UserDictionaryStorage storage("");
+    UserDictionaryTest::LoadFromString(kUserDictionary0, &storage);
+    dic->Load(storage.GetProto());
+  }
+  EXPECT_LT(generation, UserDictionary::GetGeneration());
 }
 
 TEST_F(UserDictionaryTest, TestSuppressionDictionary) {
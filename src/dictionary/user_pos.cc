@@ -68,8 +68,7 @@ void UserPos::GetPosList(std::vector<std::string> *pos_list) const {
 }
 
 bool UserPos::IsValidPos(absl::string_view pos) const {
-  const auto iter =
-      std::lower_bound(string_array_.begin(), string_array_.end(), pos);
+  const auto iter = string_array_.find(pos);
   if (iter == string_array_.end()) {
     return false;
   }
@@ -77,9 +76,8 @@ bool UserPos::IsValidPos(absl::string_view pos) const {
 }
 
 bool UserPos::GetPosIds(absl::string_view pos, uint16_t *id) const {
-  const auto str_iter =
-      std::lower_bound(string_array_.begin(), string_array_.end(), pos);
-  if (str_iter == string_array_.end() || *str_iter != pos) {
+  const auto str_iter = string_array_.find(pos);
+  if (str_iter == string_array_.end()) {
     return false;
   }
   const auto token_iter = std::lower_bound(begin(), end(), str_iter.index());
@@ -98,9 +96,8 @@ bool UserPos::GetTokens(absl::string_view key, absl::string_view value,
   }
 
   tokens->clear();
-  const auto str_iter =
-      std::lower_bound(string_array_.begin(), string_array_.end(), pos);
-  if (str_iter == string_array_.end() || *str_iter != pos) {
+  const auto str_iter = string_array_.find(pos);
+  if (str_iter == string_array_.end()) {
     return false;
   }
   std::pair<iterator, iterator> range =
@@ -29,19 +29,27 @@
 
 #include "engine/engine.h"
 
+#include <atomic>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "base/file_util.h"
+#include "base/hot_page_pinner.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "composer/composer.h"
+#include "composer/table.h"
 #include "converter/connector.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
 #include "converter/immutable_converter.h"
 #include "converter/immutable_converter_interface.h"
 #include "converter/segmenter.h"
+#include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/dictionary_impl.h"
 #include "dictionary/dictionary_interface.h"
@@ -60,9 +68,36 @@
 #include "prediction/predictor_interface.h"
 #include "prediction/suggestion_filter.h"
 #include "prediction/user_history_predictor.h"
+#include "request/conversion_request.h"
 #include "rewriter/rewriter.h"
 #include "rewriter/rewriter_interface.h"
+#include "absl/flags/flag.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, hot_page_pinning_mb, 0,
+          "Maximum size in MiB of the hot pages of the system dictionary and "
+          "the connection matrix kept in memory with mlock.  The budget is "
+          "shared by all the engines in the process.  0 disables the "
+          "pinning.");
+
+ABSL_FLAG(int32_t, hot_page_profile_interval_sec, 60,
+          "Interval in seconds to sample the pages accessed by the engine for "
+          "the hot page pinning.");
+
+ABSL_FLAG(std::string, hot_page_profile_path, "",
+          "If set, the access profile of the hot page pinning is restored "
+          "from and saved to this file, so that the hot pages are pinned "
+          "right after startup.");
+
+ABSL_FLAG(bool, hot_page_use_huge_pages, false,
+          "If true, advise transparent huge pages for the pinned data.");
+
+ABSL_FLAG(std::string, engine_warm_up_keys, "",
+          "Comma separated Hiragana keys converted and predicted to warm up "
+          "the engine.  If empty, the built-in representative keys are used.");
 
 namespace mozc {
 namespace {
@@ -76,6 +111,24 @@ using ::mozc::dictionary::UserDictionary;
 using ::mozc::dictionary::UserPos;
 using ::mozc::dictionary::ValueDictionary;
 
+// Representative keys for warm-up: frequent words and phrases, a number and a
+// long sentence, which visit the common parts of the dictionary, the
+// connection matrix and the rewriters.
+constexpr const char *kDefaultWarmUpKeys[] = {
+    "わたし",
+    "きょうは",
+    "ありがとうございます",
+    "よろしくおねがいします",
+    "にほんご",
+    "へんかん",
+    "あしたのかいぎ",
+    "こんにちは",
+    "すみません",
+    "さんじ",
+    "100えん",
+    "きょうはいいてんきですね",
+};
+
 class UserDataManagerImpl final : public UserDataManagerInterface {
  public:
   UserDataManagerImpl(PredictorInterface *predictor,
@@ -161,7 +214,23 @@ absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateMobileEngine(
 }
 
 Engine::Engine() = default;
-Engine::~Engine() = default;
+
+Engine::~Engine() {
+  if (hot_page_regions_.empty()) {
+    return;
+  }
+  HotPagePinner *pinner = HotPagePinner::Get();
+  const std::string profile_path = absl::GetFlag(FLAGS_hot_page_profile_path);
+  if (!profile_path.empty()) {
+    const absl::Status status =
+        FileUtil::SetContents(profile_path, pinner->SerializeProfile());
+    LOG_IF(WARNING, !status.ok())
+        << "Cannot save the hot page profile: " << status;
+  }
+  for (const HotPagePinner::RegionId id : hot_page_regions_) {
+    pinner->RemoveRegion(id);
+  }
+}
 
 // Since the composite predictor class differs on desktop and mobile, Init()
 // takes a function pointer to create an instance of predictor class.
@@ -294,11 +363,92 @@ absl::Status Engine::Init(
 
   data_manager_ = std::move(data_manager);
 
+  StartHotPagePinning();
+
   return absl::Status();
 
 #undef RETURN_IF_NULL
 }
 
+void Engine::StartHotPagePinning() {
+  const int32_t budget_mb = absl::GetFlag(FLAGS_hot_page_pinning_mb);
+  if (budget_mb <= 0 || !HotPagePinner::IsSupported()) {
+    return;
+  }
+
+  // The pinner and its budget are shared by all the engines in the process.
+  HotPagePinner *pinner = HotPagePinner::Get();
+  pinner->set_max_pinned_bytes(static_cast<size_t>(budget_mb) << 20);
+  const bool advise_huge_pages = absl::GetFlag(FLAGS_hot_page_use_huge_pages);
+
+  // The accesses to the token array in the system dictionary and to the
+  // connection matrix are sampled by their readers.
+  const char *dictionary_data = nullptr;
+  int dictionary_size = 0;
+  data_manager_->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+  hot_page_regions_.push_back(pinner->AddRegion(
+      "dictionary", absl::string_view(dictionary_data, dictionary_size),
+      advise_huge_pages));
+  const char *connector_data = nullptr;
+  size_t connector_size = 0;
+  data_manager_->GetConnectorData(&connector_data, &connector_size);
+  hot_page_regions_.push_back(pinner->AddRegion(
+      "connector", absl::string_view(connector_data, connector_size),
+      advise_huge_pages));
+
+  const std::string profile_path = absl::GetFlag(FLAGS_hot_page_profile_path);
+  if (!profile_path.empty() && FileUtil::FileExists(profile_path).ok()) {
+    absl::StatusOr<std::string> profile = FileUtil::GetContents(profile_path);
+    if (profile.ok() && pinner->ParseProfile(*profile)) {
+      pinner->Pin();
+    }
+  }
+
+  pinner->StartPinning(
+      absl::Seconds(absl::GetFlag(FLAGS_hot_page_profile_interval_sec)));
+}
+
+std::vector<std::string> Engine::GetWarmUpKeys() const {
+  const std::string keys = absl::GetFlag(FLAGS_engine_warm_up_keys);
+  if (!keys.empty()) {
+    return absl::StrSplit(keys, ',', absl::SkipEmpty());
+  }
+  return std::vector<std::string>(std::begin(kDefaultWarmUpKeys),
+                                  std::end(kDefaultWarmUpKeys));
+}
+
+bool Engine::WarmUp(absl::string_view key,
+                    const std::atomic<bool> *cancel_flag) {
+  // Only Start*ForRequest methods are called, which don't learn anything.
+  // The converter checks |cancel_flag| between its stages.
+  ConversionRequest request;
+  composer::Composer composer(&composer::Table::GetDefaultTable(),
+                              &request.request(), &request.config());
+  composer.InsertCharacterPreedit(std::string(key));
+  request.set_composer(&composer);
+  request.set_cancel_flag(cancel_flag);
+
+  Segments segments;
+  if (!converter_->StartConversionForRequest(request, &segments)) {
+    VLOG(1) << "Warm-up conversion failed: " << key;
+  }
+  if (request.IsCancelled()) {
+    return false;
+  }
+  segments.Clear();
+  if (!converter_->StartSuggestionForRequest(request, &segments)) {
+    VLOG(1) << "Warm-up suggestion failed: " << key;
+  }
+  if (request.IsCancelled()) {
+    return false;
+  }
+  segments.Clear();
+  if (!converter_->StartPredictionForRequest(request, &segments)) {
+    VLOG(1) << "Warm-up prediction failed: " << key;
+  }
+  return !request.IsCancelled();
+}
+
 bool Engine::Reload() {
   if (!user_dictionary_) {
     return true;
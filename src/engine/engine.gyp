@@ -60,6 +60,7 @@
         '../base/absl.gyp:absl_status',
         '../base/absl.gyp:absl_strings',
         '../base/base.gyp:base',
+        '../composer/composer.gyp:composer',
         '../converter/converter.gyp:converter',
         '../converter/converter_base.gyp:connector',
         '../converter/converter_base.gyp:segmenter',
@@ -30,10 +30,12 @@
 #ifndef MOZC_ENGINE_ENGINE_H_
 #define MOZC_ENGINE_ENGINE_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/hot_page_pinner.h"
 #include "base/port.h"
 #include "converter/connector.h"
 #include "converter/converter.h"
@@ -117,6 +119,12 @@ class Engine : public EngineInterface {
     return user_dictionary_->GetPosList();
   }
 
+  // Returns the keys given by --engine_warm_up_keys, or the built-in
+  // representative keys if the flag is empty.
+  std::vector<std::string> GetWarmUpKeys() const override;
+  bool WarmUp(absl::string_view key,
+              const std::atomic<bool> *cancel_flag) override;
+
  private:
   // Initializes the object by the given data manager and predictor factory
   // function.  Predictor factory is used to select DefaultPredictor and
@@ -127,6 +135,10 @@ class Engine : public EngineInterface {
                         std::unique_ptr<PredictorInterface>),
                     bool enable_content_word_learning);
 
+  // Starts pinning the hot pages of the data set when it is enabled by the
+  // flags.
+  void StartHotPagePinning();
+
   std::unique_ptr<const DataManagerInterface> data_manager_;
   std::unique_ptr<const dictionary::PosMatcher> pos_matcher_;
   std::unique_ptr<dictionary::SuppressionDictionary> suppression_dictionary_;
@@ -147,6 +159,10 @@ class Engine : public EngineInterface {
 
   std::unique_ptr<ConverterImpl> converter_;
   std::unique_ptr<UserDataManagerInterface> user_data_manager_;
+
+  // Regions of |data_manager_| registered to the process-wide hot page
+  // pinner.  Removed in the destructor, before |data_manager_| is released.
+  std::vector<HotPagePinner::RegionId> hot_page_regions_;
 };
 
 }  // namespace mozc
@@ -33,9 +33,9 @@
 #include <memory>
 #include <utility>
 
+#include "base/executor.h"
 #include "base/file_util.h"
 #include "base/logging.h"
-#include "base/thread.h"
 #include "data_manager/data_manager.h"
 #include "engine/engine.h"
 #include "protocol/engine_builder.pb.h"
@@ -63,15 +63,25 @@ EngineReloadResponse::Status ConvertStatus(DataManager::Status status) {
 }
 }  // namespace
 
-class EngineBuilder::Preparator : public Thread {
+class EngineBuilder::Preparator {
  public:
   explicit Preparator(const EngineReloadRequest &request) {
     *response_.mutable_request() = request;
   }
 
-  ~Preparator() override = default;
+  ~Preparator() { Join(); }
 
-  void Run() override {
+  // Runs the preparation on the background executor.
+  void Start() {
+    task_ = Executor::Get()->Post([this]() { Run(); }, Executor::NORMAL);
+  }
+
+  bool IsRunning() const { return !task_.IsDone(); }
+
+  void Join() { task_.Wait(); }
+
+ private:
+  void Run() {
     const EngineReloadRequest &request = response_.request();
 
     auto tmp_data_manager = std::make_unique<DataManager>();
@@ -98,7 +108,6 @@ class EngineBuilder::Preparator : public Thread {
     data_manager_ = std::move(tmp_data_manager);
   }
 
- private:
   DataManager::Status InitDataManager(const EngineReloadRequest &request,
                                       DataManager *data_manager) {
     if (request.has_magic_number()) {
@@ -111,6 +120,7 @@ class EngineBuilder::Preparator : public Thread {
   friend class EngineBuilder;
   EngineReloadResponse response_;
   std::unique_ptr<DataManager> data_manager_;
+  Executor::TaskHandle task_;
 };
 
 EngineBuilder::EngineBuilder() = default;
@@ -128,8 +138,7 @@ void EngineBuilder::PrepareAsync(const EngineReloadRequest &request,
     VLOG(1) << "Previously loaded data is discarded";
   }
   preparator_ = std::make_unique<Preparator>(request);
-  preparator_->SetJoinable(true);
-  preparator_->Start("EngineBuilder::Preparator");
+  preparator_->Start();
   response->set_status(EngineReloadResponse::ACCEPTED);
 }
 
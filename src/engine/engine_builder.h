@@ -43,7 +43,7 @@ class EngineBuilder : public EngineBuilderInterface {
   ~EngineBuilder() override;
 
   // Implementation of EngineBuilderInterface.  PrepareAsync() is implemented
-  // using Thread.
+  // using the background executor.
   void PrepareAsync(const EngineReloadRequest &request,
                     EngineReloadResponse *response) override;
   bool HasResponse() const override;
@@ -51,7 +51,7 @@ class EngineBuilder : public EngineBuilderInterface {
   std::unique_ptr<EngineInterface> BuildFromPreparedData() override;
   void Clear() override;
 
-  // Waits for internal thread to complete.
+  // Waits for the background preparation to complete.
   void Wait();
 
  private:
@@ -30,6 +30,7 @@
 #ifndef MOZC_ENGINE_ENGINE_INTERFACE_H_
 #define MOZC_ENGINE_ENGINE_INTERFACE_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -81,6 +82,17 @@ class EngineInterface {
   // Gets the user POS list.
   virtual std::vector<std::string> GetPosList() const = 0;
 
+  // Gets the keys to be passed to WarmUp() after the engine is created.
+  virtual std::vector<std::string> GetWarmUpKeys() const { return {}; }
+
+  // Converts and predicts |key| without learning, so that the data pages and
+  // the caches used for |key| are loaded before the first user requests.
+  // Returns false if |cancel_flag| is raised before |key| is finished.
+  virtual bool WarmUp(absl::string_view key,
+                      const std::atomic<bool> *cancel_flag) {
+    return true;
+  }
+
  protected:
   EngineInterface() = default;
 };
@@ -30,6 +30,8 @@
 #ifndef MOZC_ENGINE_ENGINE_MOCK_H_
 #define MOZC_ENGINE_ENGINE_MOCK_H_
 
+#include <atomic>
+
 #include "engine/engine_interface.h"
 #include "testing/base/public/gmock.h"
 
@@ -50,6 +52,10 @@ class MockEngine : public EngineInterface {
   MOCK_METHOD(const DataManagerInterface *, GetDataManager, (),
               (const, override));
   MOCK_METHOD(std::vector<std::string>, GetPosList, (), (const, override));
+  MOCK_METHOD(std::vector<std::string>, GetWarmUpKeys, (), (const, override));
+  MOCK_METHOD(bool, WarmUp,
+              (absl::string_view key, const std::atomic<bool> *cancel_flag),
+              (override));
 };
 
 }  // namespace mozc
@@ -103,6 +103,14 @@ IPCClientInterface *IPCClientFactory::NewClient(const std::string &name) {
   return new IPCClient(name);
 }
 
+IPCClientInterface *IPCClientFactory::NewPersistentClient(
+    const std::string &name, const std::string &path_name) {
+  IPCClient *client = new IPCClient(name, path_name);
+  client->set_keep_alive(true);
+  client->set_shared_memory(use_shared_memory_);
+  return client;
+}
+
 // static
 IPCClientFactory *IPCClientFactory::GetIPCClientFactory() {
   return Singleton<IPCClientFactory>::get();
@@ -118,6 +126,14 @@ const std::string &IPCClient::GetServerProductVersion() const {
   return ipc_path_manager_->GetServerProductVersion();
 }
 
+bool IPCClient::IsReusable() const {
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+  return keep_alive_ && connected_ && last_ipc_error_ == IPC_NO_ERROR;
+#else   // OS_LINUX && !OS_ANDROID
+  return false;
+#endif  // OS_LINUX && !OS_ANDROID
+}
+
 uint32_t IPCClient::GetServerProcessId() const {
   DCHECK(ipc_path_manager_);
   return ipc_path_manager_->GetServerProcessId();
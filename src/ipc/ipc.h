@@ -37,6 +37,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "base/scoped_handle.h"
@@ -83,6 +84,13 @@ class IPCClientInterface {
 
   // return last error
   virtual IPCErrorType GetLastIPCError() const = 0;
+
+  // Returns true if Call() can be invoked again on this client.  Such a Call()
+  // fails with IPC_NO_CONNECTION if the connection turns out to be closed
+  // before the request is sent.  Only in that case, the request can be safely
+  // retried on a new client; with other errors, the server may have processed
+  // it.
+  virtual bool IsReusable() const { return false; }
 };
 
 #ifdef __APPLE__
@@ -140,12 +148,29 @@ class IPCClient : public IPCClientInterface {
   // When Server doesn't send response within timeout, 'Call' returns false.
   // When timeout (in msec) is set -1, 'Call' waits forever.
   // Note that on Linux and Windows, Call() closes the socket_. This means you
-  // cannot call the Call() function more than once.
+  // cannot call the Call() function more than once, unless keep-alive is
+  // enabled.
   bool Call(const std::string &request, std::string *response,
             int32_t timeout) override;  // msec
 
   IPCErrorType GetLastIPCError() const override { return last_ipc_error_; }
 
+  // Keeps the connection open after Call() so that this client can be reused
+  // for subsequent calls.  Must be set before the first Call().  Only
+  // supported on Linux; ignored on the other platforms.
+  void set_keep_alive(bool keep_alive) { keep_alive_ = keep_alive; }
+
+  // Exchanges the payloads through shared memory instead of the socket when
+  // the server supports it.  Implies keep-alive.  Must be set before the
+  // first Call().  Only supported on Linux; ignored on the other platforms.
+  void set_shared_memory(bool shared_memory) {
+    shared_memory_ = shared_memory;
+    keep_alive_ |= shared_memory;
+  }
+
+  // Returns true if keep-alive is enabled and the connection is still usable.
+  bool IsReusable() const override;
+
   // terminate the server process named |name|
   // Do not use it unless version mismatch happens
   static bool TerminateServer(const std::string &name);
@@ -167,9 +192,26 @@ class IPCClient : public IPCClientInterface {
   std::string name_;
   MachPortManagerInterface *mach_port_manager_;
 #else   // OS_WIN
+  bool CallKeepAlive(const std::string &request, std::string *response,
+                     int32_t timeout);
+  IPCErrorType CallSharedMemory(const std::string &request,
+                                std::string *response, int32_t timeout);
+  // Returns the memfd of the shared memory to be sent to the server, or -1
+  // on failure.
+  int InitSharedMemory();
+  void CloseSharedMemory();
+
   int socket_;
+  // True after the keep-alive handshake has been sent.
+  bool keep_alive_started_ = false;
+  // Shared memory channel.  See unix_ipc.cc for the protocol.
+  char *shared_memory_buffer_ = nullptr;
+  int request_event_ = -1;
+  int response_event_ = -1;
 #endif  // OS_WIN
   bool connected_;
+  bool keep_alive_ = false;
+  bool shared_memory_ = false;
   IPCPathManager *ipc_path_manager_;
   IPCErrorType last_ipc_error_;
 };
@@ -183,6 +225,13 @@ class IPCClientFactoryInterface {
   // old interface for backward compatibility.
   // same as NewClient(name, "");
   virtual IPCClientInterface *NewClient(const std::string &name) = 0;
+
+  // Returns a client whose connection is kept open across Call()s where the
+  // platform supports it.  Check IsReusable() before reusing the client.
+  virtual IPCClientInterface *NewPersistentClient(
+      const std::string &name, const std::string &path_name) {
+    return NewClient(name, path_name);
+  }
 };
 
 // Creates IPCClient object.
@@ -198,8 +247,19 @@ class IPCClientFactory : public IPCClientFactoryInterface {
   // same as NewClient(name, "");
   IPCClientInterface *NewClient(const std::string &name) override;
 
+  IPCClientInterface *NewPersistentClient(
+      const std::string &name, const std::string &path_name) override;
+
   // Return a singleton instance.
   static IPCClientFactory *GetIPCClientFactory();
+
+  // Makes NewPersistentClient() create the clients with shared memory.
+  void set_use_shared_memory(bool use_shared_memory) {
+    use_shared_memory_ = use_shared_memory;
+  }
+
+ private:
+  bool use_shared_memory_ = false;
 };
 
 // Synchronous, Single-thread IPC Server
@@ -272,6 +332,10 @@ class IPCServer {
 #else   // OS_WIN
   int socket_;
   std::string server_address_;
+  struct KeepAliveConnection;
+  // Connections of keep-alive clients, served in Loop() together with new
+  // connections.
+  std::vector<std::unique_ptr<KeepAliveConnection>> keep_alive_connections_;
 #endif  // OS_WIN
 
   int timeout_;
@@ -43,10 +43,12 @@ namespace mozc {
 IPCClientMock::IPCClientMock(IPCClientFactoryMock *caller)
     : caller_(caller),
       connected_(false),
+      reusable_(false),
       server_protocol_version_(0),
       server_product_version_(Version::GetMozcVersion()),
       server_process_id_(0),
-      result_(false) {}
+      result_(false),
+      last_ipc_error_(IPC_NO_ERROR) {}
 
 bool IPCClientMock::Connected() const { return connected_; }
 
@@ -65,7 +67,8 @@ uint32_t IPCClientMock::GetServerProcessId() const {
 bool IPCClientMock::Call(const std::string &request, std::string *response,
                          const int32_t timeout) {
   caller_->SetGeneratedRequest(request);
-  if (!connected_ || !result_) {
+  last_ipc_error_ = caller_->GetCallError();
+  if (!connected_ || !result_ || last_ipc_error_ != IPC_NO_ERROR) {
     return false;
   }
   response->assign(response_);
@@ -75,6 +78,9 @@ bool IPCClientMock::Call(const std::string &request, std::string *response,
 IPCClientFactoryMock::IPCClientFactoryMock()
     : connection_(false),
       result_(false),
+      reusable_(false),
+      call_error_(IPC_NO_ERROR),
+      num_new_clients_(0),
       server_protocol_version_(IPC_PROTOCOL_VERSION) {}
 
 IPCClientInterface *IPCClientFactoryMock::NewClient(
@@ -120,10 +126,16 @@ void IPCClientFactoryMock::SetServerProcessId(
   server_process_id_ = server_process_id;
 }
 
+void IPCClientFactoryMock::SetReusable(const bool reusable) {
+  reusable_ = reusable;
+}
+
 IPCClientMock *IPCClientFactoryMock::NewClientMock() {
+  ++num_new_clients_;
   IPCClientMock *client = new IPCClientMock(this);
   client->set_connection(connection_);
   client->set_result(result_);
+  client->set_reusable(reusable_);
   client->set_response(response_);
   client->set_server_protocol_version(server_protocol_version_);
   client->set_server_product_version(server_product_version_);
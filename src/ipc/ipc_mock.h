@@ -49,7 +49,8 @@ class IPCClientMock : public IPCClientInterface {
   bool Call(const std::string &request, std::string *response,
             int32_t timeout) override;
 
-  IPCErrorType GetLastIPCError() const override { return IPC_NO_ERROR; }
+  IPCErrorType GetLastIPCError() const override { return last_ipc_error_; }
+  bool IsReusable() const override { return reusable_ && connected_; }
 
   void set_connection(const bool connection) { connected_ = connection; }
   void set_result(const bool result) { result_ = result; }
@@ -63,15 +64,18 @@ class IPCClientMock : public IPCClientInterface {
     server_process_id_ = server_process_id;
   }
   void set_response(const std::string &response) { response_ = response; }
+  void set_reusable(const bool reusable) { reusable_ = reusable; }
 
  private:
   IPCClientFactoryMock *caller_;
   bool connected_;
+  bool reusable_;
   uint32_t server_protocol_version_;
   std::string server_product_version_;
   uint32_t server_process_id_;
   bool result_;
   std::string response_;
+  IPCErrorType last_ipc_error_;
 
   DISALLOW_COPY_AND_ASSIGN(IPCClientMock);
 };
@@ -109,11 +113,25 @@ class IPCClientFactoryMock : public IPCClientFactoryInterface {
   // This function is supporsed to be used by unittests.
   void SetServerProcessId(const uint32_t server_process_id);
 
+  // This function is supporsed to be used by unittests.
+  void SetReusable(const bool reusable);
+
+  // Makes Call() of all the clients, including the existing ones, fail with
+  // |error| unless it is IPC_NO_ERROR.
+  void SetCallError(const IPCErrorType error) { call_error_ = error; }
+  IPCErrorType GetCallError() const { return call_error_; }
+
+  // Returns the number of the clients created so far.
+  int GetNumNewClients() const { return num_new_clients_; }
+
  private:
   IPCClientMock *NewClientMock();
 
   bool connection_;
   bool result_;
+  bool reusable_;
+  IPCErrorType call_error_;
+  int num_new_clients_;
   uint32_t server_protocol_version_;
   std::string server_product_version_;
   uint32_t server_process_id_;
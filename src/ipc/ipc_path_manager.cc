@@ -231,6 +231,12 @@ bool IPCPathManager::SavePathName() {
   ipc_path_info_->set_thread_id(0);
 #endif  // OS_WIN
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+  // See unix_ipc.cc for the protocols.
+  ipc_path_info_->set_features(ipc::IPCPathInfo::KEEP_ALIVE |
+                               ipc::IPCPathInfo::SHARED_MEMORY);
+#endif  // OS_LINUX && !OS_ANDROID
+
   std::string buf;
   if (!ipc_path_info_->SerializeToString(&buf)) {
     LOG(ERROR) << "SerializeToString failed";
@@ -323,6 +329,10 @@ uint32_t IPCPathManager::GetServerProcessId() const {
   return ipc_path_info_->process_id();
 }
 
+uint32_t IPCPathManager::GetServerFeatures() const {
+  return ipc_path_info_->features();
+}
+
 void IPCPathManager::Clear() {
   absl::MutexLock l(&mutex_);
   ipc_path_info_->Clear();
@@ -90,6 +90,10 @@ class IPCPathManager {
   // return process id of the server
   uint32_t GetServerProcessId() const;
 
+  // return bit set of ipc::IPCPathInfo::Feature supported by the server.
+  // return 0 for the servers which don't support any optional feature.
+  uint32_t GetServerFeatures() const;
+
   // Checks the server pid is the valid server specified with server_path.
   // server pid can be obtained by OS dependent method.
   // This API is only available on Windows Vista or Linux.
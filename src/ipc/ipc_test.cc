@@ -29,8 +29,19 @@
 
 #include "ipc/ipc.h"
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_ANDROID
+
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -38,6 +49,7 @@
 #include "base/system_util.h"
 #include "base/thread.h"
 #include "base/util.h"
+#include "ipc/ipc_path_manager.h"
 #include "ipc/ipc_test_util.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
@@ -108,6 +120,10 @@ class EchoServer : public mozc::IPCServer {
       output->clear();
       return false;
     }
+    if (input == "empty") {
+      output->clear();
+      return true;
+    }
     output->assign(input.data(), input.size());
     return true;
   }
@@ -158,3 +174,247 @@ TEST(IPCTest, IPCTest) {
 
   con.Wait();
 }
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+TEST(IPCTest, KeepAlive) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+  constexpr char kKeepAliveServerAddress[] = "test_keep_alive_server";
+  EchoServer con(kKeepAliveServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(1000);
+
+  mozc::IPCClient persistent(kKeepAliveServerAddress, "");
+  persistent.set_keep_alive(true);
+  ASSERT_TRUE(persistent.Connected());
+  for (int i = 0; i < 100; ++i) {
+    const std::string input = "test" + GenRandomString(i * 100 + 1);
+    std::string output;
+    ASSERT_TRUE(persistent.Call(input, &output, 1000));
+    EXPECT_EQ(input, output);
+    EXPECT_TRUE(persistent.IsReusable());
+
+    // One-shot connections are served while the persistent one is open.
+    mozc::IPCClient one_shot(kKeepAliveServerAddress, "");
+    ASSERT_TRUE(one_shot.Connected());
+    EXPECT_FALSE(one_shot.IsReusable());
+    ASSERT_TRUE(one_shot.Call(input, &output, 1000));
+    EXPECT_EQ(input, output);
+  }
+
+  // An empty response is not sent, and the connection is closed as an error.
+  {
+    mozc::IPCClient empty(kKeepAliveServerAddress, "");
+    empty.set_keep_alive(true);
+    std::string output;
+    EXPECT_FALSE(empty.Call("empty", &output, 1000));
+    EXPECT_FALSE(empty.IsReusable());
+    EXPECT_TRUE(persistent.Call("test", &output, 1000));
+  }
+
+  // Beyond the limit of the keep-alive connections, the server closes the
+  // connection after the first request.  The next call fails without sending
+  // the request, so that the caller can retry it.
+  {
+    std::vector<std::unique_ptr<mozc::IPCClient>> clients;
+    std::string output;
+    for (int i = 0; i < 16; ++i) {
+      clients.push_back(
+          std::make_unique<mozc::IPCClient>(kKeepAliveServerAddress, ""));
+      clients.back()->set_keep_alive(true);
+      ASSERT_TRUE(clients.back()->Call("test", &output, 1000));
+    }
+    mozc::Util::Sleep(100);
+    EXPECT_FALSE(clients.back()->Call("test", &output, 1000));
+    EXPECT_EQ(mozc::IPC_NO_CONNECTION, clients.back()->GetLastIPCError());
+    EXPECT_FALSE(clients.back()->IsReusable());
+    EXPECT_TRUE(clients.front()->Call("test", &output, 1000));
+  }
+
+  // The connection is closed when the server finishes.
+  std::string output;
+  EXPECT_FALSE(persistent.Call("kill", &output, 1000));
+  EXPECT_FALSE(persistent.IsReusable());
+
+  con.Wait();
+}
+#endif  // OS_LINUX && !OS_ANDROID
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+TEST(IPCTest, SharedMemory) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+  constexpr char kSharedMemoryServerAddress[] = "test_shared_memory_server";
+  EchoServer con(kSharedMemoryServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(1000);
+
+  mozc::IPCClient shared(kSharedMemoryServerAddress, "");
+  shared.set_shared_memory(true);
+  ASSERT_TRUE(shared.Connected());
+  // Payloads not fitting in the shared memory fall back to the socket.
+  for (const size_t size : {1, 100, 8000, 2 << 20, 10}) {
+    const std::string input = "test" + GenRandomString(size);
+    std::string output;
+    ASSERT_TRUE(shared.Call(input, &output, 1000));
+    EXPECT_EQ(input, output);
+    EXPECT_TRUE(shared.IsReusable());
+
+    mozc::IPCClient one_shot(kSharedMemoryServerAddress, "");
+    ASSERT_TRUE(one_shot.Connected());
+    ASSERT_TRUE(one_shot.Call(input, &output, 1000));
+    EXPECT_EQ(input, output);
+  }
+
+  // An empty response is not sent, and the connection is closed as an error.
+  {
+    mozc::IPCClient empty(kSharedMemoryServerAddress, "");
+    empty.set_shared_memory(true);
+    std::string output;
+    EXPECT_FALSE(empty.Call("empty", &output, 1000));
+    EXPECT_FALSE(empty.IsReusable());
+  }
+
+  std::string output;
+  EXPECT_FALSE(shared.Call("kill", &output, 1000));
+  EXPECT_FALSE(shared.IsReusable());
+
+  con.Wait();
+}
+#endif  // OS_LINUX && !OS_ANDROID
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID)
+namespace {
+
+// Connects to the server |name| without IPCClient, and returns the socket.
+int ConnectDirectly(const char *name) {
+  mozc::IPCPathManager *manager = mozc::IPCPathManager::GetIPCPathManager(name);
+  std::string path;
+  if (!manager->LoadPathName() || !manager->GetPathName(&path)) {
+    return -1;
+  }
+  const int socket = ::socket(PF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socket < 0 || path.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  ::memcpy(address.sun_path, path.data(), path.size());
+  if (::connect(socket, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address.sun_family) + path.size()) != 0) {
+    ::close(socket);
+    return -1;
+  }
+  return socket;
+}
+
+// Sends the shared memory magic with |fds| attached.
+bool SendSharedMemoryMagic(int socket, const int (&fds)[3]) {
+  char magic[] = {'\0', 'M', 'S', 'M'};
+  iovec iov = {magic, sizeof(magic)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  ::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  return ::sendmsg(socket, &msg, MSG_NOSIGNAL) == sizeof(magic);
+}
+
+// Checks that the server still serves the shared memory clients, and then
+// stops it.
+void ExpectServingAndKill(const char *name) {
+  mozc::IPCClient shared(name, "");
+  shared.set_shared_memory(true);
+  std::string output;
+  ASSERT_TRUE(shared.Call("test", &output, 1000));
+  EXPECT_EQ("test", output);
+  EXPECT_FALSE(shared.Call("kill", &output, 1000));
+}
+
+}  // namespace
+
+TEST(IPCTest, SharedMemoryNotSealed) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+  constexpr char kSharedMemoryServerAddress[] = "test_not_sealed_server";
+  EchoServer con(kSharedMemoryServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(1000);
+
+  // Connects to the server directly, and sends the shared memory magic with a
+  // memfd which is not sealed.
+  const int socket = ConnectDirectly(kSharedMemoryServerAddress);
+  ASSERT_LE(0, socket);
+  const int fds[] = {::memfd_create("test", MFD_CLOEXEC),
+                     ::eventfd(0, EFD_CLOEXEC), ::eventfd(0, EFD_CLOEXEC)};
+  ASSERT_EQ(0, ::ftruncate(fds[0], 1 << 20));
+  ASSERT_TRUE(SendSharedMemoryMagic(socket, fds));
+
+  // The server closes the connection without serving it.
+  char c = 0;
+  EXPECT_EQ(0, ::recv(socket, &c, 1, 0));
+  for (const int fd : fds) {
+    ::close(fd);
+  }
+  ::close(socket);
+
+  // The server keeps serving the other clients.
+  ExpectServingAndKill(kSharedMemoryServerAddress);
+  con.Wait();
+}
+
+TEST(IPCTest, SharedMemoryNotEventFd) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+  constexpr char kSharedMemoryServerAddress[] = "test_not_eventfd_server";
+  EchoServer con(kSharedMemoryServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(1000);
+
+  // Sends a sealed memfd, but pipes instead of the eventfds.
+  const int socket = ConnectDirectly(kSharedMemoryServerAddress);
+  ASSERT_LE(0, socket);
+  int pipe_fds[2];
+  ASSERT_EQ(0, ::pipe(pipe_fds));
+  const int fds[] = {::memfd_create("test", MFD_CLOEXEC | MFD_ALLOW_SEALING),
+                     pipe_fds[0], pipe_fds[1]};
+  ASSERT_EQ(0, ::ftruncate(fds[0], 1 << 20));
+  ASSERT_EQ(0, ::fcntl(fds[0], F_ADD_SEALS,
+                       F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+  ASSERT_TRUE(SendSharedMemoryMagic(socket, fds));
+
+  char c = 0;
+  EXPECT_EQ(0, ::recv(socket, &c, 1, 0));
+  for (const int fd : fds) {
+    ::close(fd);
+  }
+  ::close(socket);
+
+  ExpectServingAndKill(kSharedMemoryServerAddress);
+  con.Wait();
+}
+
+TEST(IPCTest, StalledMagic) {
+  mozc::SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+  constexpr char kServerAddress[] = "test_stalled_magic_server";
+  EchoServer con(kServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(1000);
+
+  // Sends only the first byte of the magic, and then stalls.
+  const int socket = ConnectDirectly(kServerAddress);
+  ASSERT_LE(0, socket);
+  const char first = '\0';
+  ASSERT_EQ(1, ::send(socket, &first, 1, MSG_NOSIGNAL));
+
+  // The server gives up the connection after the timeout.
+  char c = 0;
+  EXPECT_EQ(0, ::recv(socket, &c, 1, 0));
+  ::close(socket);
+
+  ExpectServingAndKill(kServerAddress);
+  con.Wait();
+}
+#endif  // OS_LINUX && !OS_ANDROID
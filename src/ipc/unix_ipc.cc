@@ -35,6 +35,9 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -43,17 +46,26 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cerrno>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/thread.h"
 #include "ipc/ipc.h"
+#include "ipc/ipc.pb.h"
 #include "ipc/ipc_path_manager.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 #ifndef UNIX_PATH_MAX
 #define UNIX_PATH_MAX 108
@@ -64,6 +76,113 @@ namespace {
 
 constexpr int kInvalidSocket = -1;
 
+// Keep-alive protocol:
+// A keep-alive client starts the connection with kKeepAliveMagic, and then
+// sends requests and receives responses framed by a 32-bit length in network
+// byte order.  Since a serialized protobuf never starts with '\0' (field
+// number 0 is invalid), the server can distinguish keep-alive clients from the
+// legacy ones, which send one request per connection terminated by half-close.
+constexpr char kKeepAliveMagic[] = {'\0', 'M', 'K', 'A'};
+constexpr size_t kKeepAliveMagicSize = sizeof(kKeepAliveMagic);
+constexpr uint32_t kMaxFrameSize = 64 << 20;
+// Shared memory protocol:
+// A shared memory client starts the connection with kSharedMemoryMagic, which
+// carries three file descriptors (SCM_RIGHTS): a memfd of the buffer, and
+// eventfds to notify a request and a response.  The memfd must be sealed
+// against resizing, and the server rejects it otherwise.  The buffer starts
+// with SharedMemoryHeader followed by the payload.  A request is written to
+// the buffer with state REQUEST, and the server overwrites it with the
+// response with state RESPONSE.  Payloads not fitting in the buffer are sent
+// as the keep-alive frames on the socket, and then the state is
+// RESPONSE_ON_SOCKET for the responses.  The socket is also used to detect
+// the disconnection.
+constexpr char kSharedMemoryMagic[] = {'\0', 'M', 'S', 'M'};
+static_assert(sizeof(kSharedMemoryMagic) == kKeepAliveMagicSize);
+constexpr size_t kSharedMemorySize = 1 << 20;
+constexpr size_t kSharedMemoryDataOffset = 64;
+constexpr size_t kSharedMemoryCapacity =
+    kSharedMemorySize - kSharedMemoryDataOffset;
+constexpr int kNumSharedMemoryFds = 3;  // memfd, request and response events.
+
+struct SharedMemoryHeader {
+  enum State : uint32_t {
+    IDLE = 0,
+    REQUEST = 1,
+    RESPONSE = 2,
+    RESPONSE_ON_SOCKET = 3,
+  };
+  std::atomic<uint32_t> state;
+  uint32_t size;
+};
+static_assert(sizeof(SharedMemoryHeader) <= kSharedMemoryDataOffset);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+SharedMemoryHeader *GetSharedMemoryHeader(char *buffer) {
+  return reinterpret_cast<SharedMemoryHeader *>(buffer);
+}
+
+char *GetSharedMemoryData(char *buffer) {
+  return buffer + kSharedMemoryDataOffset;
+}
+
+char *MapSharedMemory(int fd) {
+  void *address = ::mmap(nullptr, kSharedMemorySize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    LOG(ERROR) << "mmap() failed: " << strerror(errno);
+    return nullptr;
+  }
+  return static_cast<char *>(address);
+}
+
+// The seals of the memfd.  The size of the buffer is fixed so that the peer
+// can't make the mapping fault (SIGBUS) by shrinking the file.
+constexpr int kSharedMemorySeals = F_SEAL_SHRINK | F_SEAL_GROW;
+
+// Maps the memfd received from a client.  Returns nullptr unless it is sealed
+// with kSharedMemorySeals and has the expected size.
+char *MapReceivedSharedMemory(int fd) {
+  const int seals = ::fcntl(fd, F_GET_SEALS);
+  if (seals < 0 || (seals & kSharedMemorySeals) != kSharedMemorySeals) {
+    LOG(ERROR) << "The shared memory is not sealed";
+    return nullptr;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size != kSharedMemorySize) {
+    LOG(ERROR) << "Invalid size of the shared memory";
+    return nullptr;
+  }
+  return MapSharedMemory(fd);
+}
+
+void UnmapSharedMemory(char *buffer) {
+  if (buffer != nullptr) {
+    ::munmap(buffer, kSharedMemorySize);
+  }
+}
+
+bool NotifyEvent(int event) {
+  const uint64_t value = 1;
+  return ::write(event, &value, sizeof(value)) == sizeof(value);
+}
+
+void ClearEvent(int event) {
+  uint64_t value = 0;
+  ::read(event, &value, sizeof(value));
+}
+
+void CloseFd(int *fd) {
+  if (*fd >= 0) {
+    ::close(*fd);
+    *fd = -1;
+  }
+}
+
+// The server serves at most this number of keep-alive connections.  Beyond
+// this, a keep-alive connection is closed after serving one request, and the
+// client reconnects.
+constexpr size_t kMaxKeepAliveConnections = 16;
+
 absl::Status mkdir_p(const std::string &dirname) {
   const std::string parent_dir = FileUtil::Dirname(dirname);
   struct stat st;
@@ -202,6 +321,243 @@ IPCErrorType RecvMessage(int socket, std::string *msg, int timeout) {
   return IPC_NO_ERROR;
 }
 
+// Sends exactly |size| bytes of |data|.  The number of bytes sent is stored to
+// |sent_size| if it is not nullptr, even on failure.
+IPCErrorType SendBytes(int socket, const char *data, size_t size, int timeout,
+                       size_t *sent_size = nullptr) {
+  size_t offset = 0;
+  if (sent_size != nullptr) {
+    *sent_size = 0;
+  }
+  while (offset < size) {
+    if (IsWriteTimeout(socket, timeout)) {
+      LOG(WARNING) << "Write timeout " << timeout;
+      return IPC_TIMEOUT_ERROR;
+    }
+    const ssize_t l =
+        ::send(socket, data + offset, size - offset, MSG_NOSIGNAL);
+    if (l < 0) {
+      LOG(ERROR) << "an error occurred during send(): " << strerror(errno);
+      return IPC_WRITE_ERROR;
+    }
+    offset += l;
+    if (sent_size != nullptr) {
+      *sent_size = offset;
+    }
+  }
+  return IPC_NO_ERROR;
+}
+
+// Receives exactly |size| bytes into |data|.
+IPCErrorType RecvBytes(int socket, char *data, size_t size, int timeout) {
+  size_t offset = 0;
+  while (offset < size) {
+    if (IsReadTimeout(socket, timeout)) {
+      LOG(WARNING) << "Read timeout " << timeout;
+      return IPC_TIMEOUT_ERROR;
+    }
+    const ssize_t l = ::recv(socket, data + offset, size - offset, 0);
+    if (l < 0) {
+      LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
+      return IPC_READ_ERROR;
+    }
+    if (l == 0) {
+      // The peer closed the connection.
+      VLOG(1) << "connection closed by peer";
+      return IPC_READ_ERROR;
+    }
+    offset += l;
+  }
+  return IPC_NO_ERROR;
+}
+
+// Sends |payload| as a keep-alive frame.  |prefix| is sent before the frame.
+IPCErrorType SendFrame(int socket, absl::string_view prefix,
+                       absl::string_view payload, int timeout,
+                       size_t *sent_size = nullptr) {
+  const uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+  std::string frame;
+  frame.reserve(prefix.size() + sizeof(length) + payload.size());
+  frame.append(prefix.data(), prefix.size());
+  frame.append(reinterpret_cast<const char *>(&length), sizeof(length));
+  frame.append(payload.data(), payload.size());
+  return SendBytes(socket, frame.data(), frame.size(), timeout, sent_size);
+}
+
+// Returns true if the idle keep-alive connection has been closed by the peer.
+// Nothing is expected to arrive on the connection between calls, so any
+// readable event means the server has closed it (e.g. it exited or dropped
+// the connection), or the stream is out of sync.
+bool IsIdleConnectionClosed(int socket) {
+  pollfd fd = {socket, POLLIN, 0};
+  const int result = ::poll(&fd, 1, 0);
+  if (result < 0) {
+    LOG(ERROR) << "poll() failed: " << strerror(errno);
+    return true;
+  }
+  return result > 0;
+}
+
+IPCErrorType RecvFrame(int socket, std::string *payload, int timeout) {
+  uint32_t length = 0;
+  if (const IPCErrorType error = RecvBytes(
+          socket, reinterpret_cast<char *>(&length), sizeof(length), timeout);
+      error != IPC_NO_ERROR) {
+    return error;
+  }
+  length = ntohl(length);
+  if (length > kMaxFrameSize) {
+    LOG(ERROR) << "too large frame: " << length;
+    return IPC_READ_ERROR;
+  }
+  payload->resize(length);
+  return RecvBytes(socket, payload->data(), length, timeout);
+}
+
+// Writes |response| to the shared memory, or sends it on the socket if it
+// doesn't fit, and then notifies the client.
+IPCErrorType SendSharedMemoryResponse(int socket, char *buffer,
+                                      int response_event,
+                                      const std::string &response,
+                                      int timeout) {
+  SharedMemoryHeader *header = GetSharedMemoryHeader(buffer);
+  if (response.size() <= kSharedMemoryCapacity) {
+    ::memcpy(GetSharedMemoryData(buffer), response.data(), response.size());
+    header->size = response.size();
+    header->state.store(SharedMemoryHeader::RESPONSE,
+                        std::memory_order_release);
+  } else {
+    header->state.store(SharedMemoryHeader::RESPONSE_ON_SOCKET,
+                        std::memory_order_release);
+    if (const IPCErrorType error = SendFrame(socket, "", response, timeout);
+        error != IPC_NO_ERROR) {
+      return error;
+    }
+  }
+  if (!NotifyEvent(response_event)) {
+    LOG(ERROR) << "Cannot notify the response: " << strerror(errno);
+    return IPC_WRITE_ERROR;
+  }
+  return IPC_NO_ERROR;
+}
+
+enum class ConnectionType {
+  LEGACY,
+  KEEP_ALIVE,
+  SHARED_MEMORY,
+  BROKEN,
+};
+
+// Receives the magic of a keep-alive client and the file descriptors attached
+// to it.  Like RecvBytes(), it waits for each part of the magic at most
+// |timeout| msec, so that a stalled client doesn't block the server.
+bool RecvMagic(int socket, char *magic, int timeout, std::vector<int> *fds) {
+  size_t offset = 0;
+  while (offset < kKeepAliveMagicSize) {
+    if (IsReadTimeout(socket, timeout)) {
+      LOG(WARNING) << "Read timeout " << timeout;
+      return false;
+    }
+    iovec iov = {magic + offset, kKeepAliveMagicSize - offset};
+    alignas(cmsghdr) char
+        control[CMSG_SPACE(sizeof(int) * kNumSharedMemoryFds)];
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    const ssize_t l =
+        ::recvmsg(socket, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (l < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      continue;
+    }
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); l >= 0 && cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        continue;
+      }
+      const size_t num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const int *data = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+      fds->insert(fds->end(), data, data + num_fds);
+    }
+    if (l <= 0 || (msg.msg_flags & MSG_CTRUNC) != 0) {
+      LOG(ERROR) << "Cannot receive the magic";
+      return false;
+    }
+    offset += l;
+  }
+  return true;
+}
+
+// Returns true if |fd| is an eventfd.  The server reads and writes the event
+// file descriptors given by the client, which might be, e.g., a pipe that
+// blocks the server.
+bool IsEventFd(int fd) {
+  const std::string path = absl::StrCat("/proc/self/fd/", fd);
+  char target[64];
+  const ssize_t size = ::readlink(path.c_str(), target, sizeof(target));
+  return size >= 0 &&
+         absl::string_view(target, size) == "anon_inode:[eventfd]";
+}
+
+// Sends the magic with |fds| attached.
+IPCErrorType SendMagic(int socket, const char *magic,
+                       const std::vector<int> &fds) {
+  iovec iov = {const_cast<char *>(magic), kKeepAliveMagicSize};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kNumSharedMemoryFds)];
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (!fds.empty()) {
+    DCHECK_LE(fds.size(), kNumSharedMemoryFds);
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    ::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+  }
+  if (::sendmsg(socket, &msg, MSG_NOSIGNAL) != kKeepAliveMagicSize) {
+    LOG(ERROR) << "an error occurred during sendmsg(): " << strerror(errno);
+    return IPC_WRITE_ERROR;
+  }
+  return IPC_NO_ERROR;
+}
+
+// Peeks the first byte of a new connection to detect the protocol.  The magic
+// of keep-alive clients is consumed, and the file descriptors of shared memory
+// clients are stored to |fds|.
+ConnectionType GetConnectionType(int socket, int timeout,
+                                 std::vector<int> *fds) {
+  if (IsReadTimeout(socket, timeout)) {
+    return ConnectionType::BROKEN;
+  }
+  char first = 0;
+  const ssize_t l = ::recv(socket, &first, 1, MSG_PEEK);
+  if (l < 0) {
+    LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
+    return ConnectionType::BROKEN;
+  }
+  if (l == 0 || first != kKeepAliveMagic[0]) {
+    return ConnectionType::LEGACY;
+  }
+  char magic[kKeepAliveMagicSize];
+  if (!RecvMagic(socket, magic, timeout, fds)) {
+    return ConnectionType::BROKEN;
+  }
+  if (::memcmp(magic, kKeepAliveMagic, kKeepAliveMagicSize) == 0 &&
+      fds->empty()) {
+    return ConnectionType::KEEP_ALIVE;
+  }
+  if (::memcmp(magic, kSharedMemoryMagic, kKeepAliveMagicSize) == 0 &&
+      fds->size() == kNumSharedMemoryFds && IsEventFd((*fds)[1]) &&
+      IsEventFd((*fds)[2])) {
+    return ConnectionType::SHARED_MEMORY;
+  }
+  return ConnectionType::BROKEN;
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -302,6 +658,7 @@ void IPCClient::Init(const std::string &name, const std::string &server_path) {
 }
 
 IPCClient::~IPCClient() {
+  CloseSharedMemory();
   if (socket_ != kInvalidSocket) {
     if (::close(socket_) < 0) {
       LOG(WARNING) << "close failed: " << strerror(errno);
@@ -315,6 +672,18 @@ IPCClient::~IPCClient() {
 // RPC call
 bool IPCClient::Call(const std::string &request, std::string *response,
                      int32_t timeout) {
+  if (keep_alive_ && !keep_alive_started_ &&
+      (ipc_path_manager_ == nullptr ||
+       (ipc_path_manager_->GetServerFeatures() &
+        ipc::IPCPathInfo::KEEP_ALIVE) == 0)) {
+    // The server doesn't advertise the keep-alive protocol.  Such a server
+    // would wait for the half-close forever.
+    keep_alive_ = false;
+  }
+  if (keep_alive_) {
+    return CallKeepAlive(request, response, timeout);
+  }
+
   last_ipc_error_ = SendMessage(socket_, request, timeout);
   if (last_ipc_error_ != IPC_NO_ERROR) {
     LOG(ERROR) << "SendMessage failed";
@@ -338,6 +707,156 @@ bool IPCClient::Call(const std::string &request, std::string *response,
   return true;
 }
 
+bool IPCClient::CallKeepAlive(const std::string &request,
+                              std::string *response, int32_t timeout) {
+  last_ipc_error_ = IPC_NO_ERROR;
+  if (keep_alive_started_ && IsIdleConnectionClosed(socket_)) {
+    // Nothing has been sent, so the caller can safely retry the request on a
+    // new connection.
+    LOG(WARNING) << "The keep-alive connection is closed by peer";
+    last_ipc_error_ = IPC_NO_CONNECTION;
+    connected_ = false;
+    return false;
+  }
+  if (!keep_alive_started_) {
+    keep_alive_started_ = true;
+    int memfd = -1;
+    if (shared_memory_ &&
+        (ipc_path_manager_->GetServerFeatures() &
+         ipc::IPCPathInfo::SHARED_MEMORY) != 0) {
+      memfd = InitSharedMemory();
+    }
+    if (memfd >= 0) {
+      last_ipc_error_ = SendMagic(socket_, kSharedMemoryMagic,
+                                  {memfd, request_event_, response_event_});
+      ::close(memfd);
+    } else {
+      last_ipc_error_ = SendMagic(socket_, kKeepAliveMagic, {});
+    }
+  }
+
+  if (last_ipc_error_ == IPC_NO_ERROR) {
+    if (shared_memory_buffer_ != nullptr) {
+      last_ipc_error_ = CallSharedMemory(request, response, timeout);
+    } else {
+      size_t sent_size = 0;
+      last_ipc_error_ = SendFrame(socket_, "", request, timeout, &sent_size);
+      if (last_ipc_error_ == IPC_WRITE_ERROR && sent_size == 0) {
+        // The request has not reached the server at all.
+        last_ipc_error_ = IPC_NO_CONNECTION;
+      } else if (last_ipc_error_ == IPC_NO_ERROR) {
+        last_ipc_error_ = RecvFrame(socket_, response, timeout);
+      }
+    }
+  }
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    // The stream may be out of sync, e.g. the response to this request may
+    // arrive later.  Don't reuse this connection any more.
+    LOG(ERROR) << "Keep-alive call failed";
+    connected_ = false;
+    return false;
+  }
+  VLOG(1) << "Call succeeded";
+  return true;
+}
+
+IPCErrorType IPCClient::CallSharedMemory(const std::string &request,
+                                         std::string *response,
+                                         int32_t timeout) {
+  SharedMemoryHeader *header = GetSharedMemoryHeader(shared_memory_buffer_);
+  char *data = GetSharedMemoryData(shared_memory_buffer_);
+  if (request.size() <= kSharedMemoryCapacity) {
+    ::memcpy(data, request.data(), request.size());
+    header->size = request.size();
+    header->state.store(SharedMemoryHeader::REQUEST,
+                        std::memory_order_release);
+    if (!NotifyEvent(request_event_)) {
+      LOG(ERROR) << "Cannot notify the request: " << strerror(errno);
+      return IPC_WRITE_ERROR;
+    }
+  } else {
+    // The server answers on the shared memory as well.
+    header->state.store(SharedMemoryHeader::REQUEST,
+                        std::memory_order_relaxed);
+    if (const IPCErrorType error = SendFrame(socket_, "", request, timeout);
+        error != IPC_NO_ERROR) {
+      return error;
+    }
+  }
+
+  while (true) {
+    switch (header->state.load(std::memory_order_acquire)) {
+      case SharedMemoryHeader::RESPONSE: {
+        const uint32_t size = header->size;
+        if (size > kSharedMemoryCapacity) {
+          return IPC_READ_ERROR;
+        }
+        response->assign(data, size);
+        header->state.store(SharedMemoryHeader::IDLE,
+                            std::memory_order_relaxed);
+        return IPC_NO_ERROR;
+      }
+      case SharedMemoryHeader::RESPONSE_ON_SOCKET:
+        header->state.store(SharedMemoryHeader::IDLE,
+                            std::memory_order_relaxed);
+        return RecvFrame(socket_, response, timeout);
+      default:
+        break;
+    }
+    // Waits for the notification.  The socket becomes readable only when the
+    // response is sent on it or the server closes the connection.
+    pollfd fds[] = {{response_event_, POLLIN, 0}, {socket_, POLLIN, 0}};
+    const int result = ::poll(fds, std::size(fds), timeout);
+    if (result == 0) {
+      LOG(WARNING) << "Read timeout " << timeout;
+      return IPC_TIMEOUT_ERROR;
+    }
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "poll() failed: " << strerror(errno);
+      return IPC_READ_ERROR;
+    }
+    if (fds[0].revents != 0) {
+      ClearEvent(response_event_);
+    }
+    if (fds[1].revents != 0 &&
+        header->state.load(std::memory_order_acquire) ==
+            SharedMemoryHeader::REQUEST) {
+      LOG(ERROR) << "connection closed by peer";
+      return IPC_READ_ERROR;
+    }
+  }
+}
+
+int IPCClient::InitSharedMemory() {
+  int memfd = ::memfd_create("mozc_ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0) {
+    LOG(ERROR) << "memfd_create() failed: " << strerror(errno);
+    return -1;
+  }
+  request_event_ = ::eventfd(0, EFD_CLOEXEC);
+  response_event_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (::ftruncate(memfd, kSharedMemorySize) != 0 ||
+      ::fcntl(memfd, F_ADD_SEALS, kSharedMemorySeals) != 0 ||
+      request_event_ < 0 || response_event_ < 0 ||
+      (shared_memory_buffer_ = MapSharedMemory(memfd)) == nullptr) {
+    LOG(ERROR) << "Cannot initialize the shared memory: " << strerror(errno);
+    ::close(memfd);
+    CloseSharedMemory();
+    return -1;
+  }
+  return memfd;
+}
+
+void IPCClient::CloseSharedMemory() {
+  UnmapSharedMemory(shared_memory_buffer_);
+  shared_memory_buffer_ = nullptr;
+  CloseFd(&request_event_);
+  CloseFd(&response_event_);
+}
+
 bool IPCClient::Connected() const { return connected_; }
 
 // Server
@@ -414,6 +933,7 @@ IPCServer::~IPCServer() {
   if (server_thread_ != nullptr) {
     server_thread_->Terminate();
   }
+  keep_alive_connections_.clear();
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
@@ -427,19 +947,195 @@ IPCServer::~IPCServer() {
 
 bool IPCServer::Connected() const { return connected_; }
 
+// A connection of a keep-alive client.  |buffer| is non-null for the shared
+// memory clients.
+struct IPCServer::KeepAliveConnection {
+  KeepAliveConnection(int socket, char *buffer, int request_event,
+                      int response_event)
+      : socket(socket),
+        buffer(buffer),
+        request_event(request_event),
+        response_event(response_event) {}
+  ~KeepAliveConnection() {
+    UnmapSharedMemory(buffer);
+    CloseFd(&request_event);
+    CloseFd(&response_event);
+    CloseFd(&socket);
+  }
+
+  int socket;
+  char *buffer;
+  int request_event;
+  int response_event;
+};
+
 void IPCServer::Loop() {
-  // The most portable and straightforward single-thread server
+  // The most portable and straightforward single-thread server.  Keep-alive
+  // connections are multiplexed with the listening socket by poll().
   bool error = false;
   pid_t pid = 0;
   std::string request;
   std::string response;
+
+  // Processes |request|.  Returns false if the connection should be closed.
+  // As with the legacy connections, an empty response is not sent back, and
+  // the client sees the closed connection as an error.
+  auto process = [&]() {
+    if (!Process(request, &response)) {
+      LOG(WARNING) << "Process() failed";
+      error = true;
+      return false;
+    }
+    if (response.empty()) {
+      LOG(WARNING) << "response is empty";
+      return false;
+    }
+    return true;
+  };
+
+  // Serves one request framed on the socket of a keep-alive connection.
+  // Returns false if the connection should be closed.
+  auto serve_frame = [&](const KeepAliveConnection &connection) {
+    if (RecvFrame(connection.socket, &request, timeout_) != IPC_NO_ERROR) {
+      return false;
+    }
+    if (!process()) {
+      return false;
+    }
+    if (connection.buffer != nullptr) {
+      // Shared memory clients wait for the response on the shared memory.
+      return SendSharedMemoryResponse(connection.socket, connection.buffer,
+                                      connection.response_event, response,
+                                      timeout_) == IPC_NO_ERROR;
+    }
+    if (SendFrame(connection.socket, "", response, timeout_) != IPC_NO_ERROR) {
+      LOG(WARNING) << "SendFrame() failed";
+      return false;
+    }
+    return true;
+  };
+
+  // Serves one request on the shared memory of a keep-alive connection.
+  auto serve_shared_memory = [&](const KeepAliveConnection &connection) {
+    ClearEvent(connection.request_event);
+    SharedMemoryHeader *header = GetSharedMemoryHeader(connection.buffer);
+    if (header->state.load(std::memory_order_acquire) !=
+        SharedMemoryHeader::REQUEST) {
+      // Spurious wakeup.
+      return true;
+    }
+    // The buffer is writable by the client.  Copy and validate it first.
+    const uint32_t size = header->size;
+    if (size > kSharedMemoryCapacity) {
+      LOG(ERROR) << "Broken request size: " << size;
+      return false;
+    }
+    request.assign(GetSharedMemoryData(connection.buffer), size);
+    if (!process()) {
+      return false;
+    }
+    return SendSharedMemoryResponse(connection.socket, connection.buffer,
+                                    connection.response_event, response,
+                                    timeout_) == IPC_NO_ERROR;
+  };
+
+  std::vector<pollfd> fds;
   while (!error) {
+    fds.clear();
+    fds.push_back({socket_, POLLIN, 0});
+    for (const auto &connection : keep_alive_connections_) {
+      fds.push_back({connection->socket, POLLIN, 0});
+      // request_event is -1 for the connections without shared memory, and
+      // poll() ignores it.
+      fds.push_back({connection->request_event, POLLIN, 0});
+    }
+    if (::poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "poll() failed: " << strerror(errno);
+      return;
+    }
+
+    std::vector<std::unique_ptr<KeepAliveConnection>> alive_connections;
+    alive_connections.reserve(keep_alive_connections_.size());
+    for (size_t i = 0; i < keep_alive_connections_.size(); ++i) {
+      std::unique_ptr<KeepAliveConnection> &connection =
+          keep_alive_connections_[i];
+      const pollfd &socket_fd = fds[2 * i + 1];
+      const pollfd &event_fd = fds[2 * i + 2];
+      bool alive = true;
+      if (!error && event_fd.revents != 0) {
+        alive = serve_shared_memory(*connection);
+      }
+      if (alive && !error && socket_fd.revents != 0) {
+        alive = serve_frame(*connection);
+      }
+      if (alive) {
+        alive_connections.push_back(std::move(connection));
+      }
+    }
+    keep_alive_connections_.swap(alive_connections);
+    if (error || (fds[0].revents & POLLIN) == 0) {
+      continue;
+    }
+
     const int new_sock = ::accept(socket_, nullptr, nullptr);
     if (new_sock < 0) {
       LOG(FATAL) << "accept() failed: " << strerror(errno);
       return;
     }
     if (!IsPeerValid(new_sock, &pid)) {
+      ::close(new_sock);
+      continue;
+    }
+
+    std::vector<int> received_fds;
+    const ConnectionType type =
+        GetConnectionType(new_sock, timeout_, &received_fds);
+    if (type == ConnectionType::KEEP_ALIVE ||
+        type == ConnectionType::SHARED_MEMORY) {
+      SetCloseOnExecFlag(new_sock);
+      char *buffer = nullptr;
+      int request_event = -1;
+      int response_event = -1;
+      if (type == ConnectionType::SHARED_MEMORY) {
+        buffer = MapReceivedSharedMemory(received_fds[0]);
+        CloseFd(&received_fds[0]);
+        request_event = received_fds[1];
+        response_event = received_fds[2];
+        received_fds.clear();
+      }
+      auto connection = std::make_unique<KeepAliveConnection>(
+          new_sock, buffer, request_event, response_event);
+      if (type == ConnectionType::SHARED_MEMORY && buffer == nullptr) {
+        LOG(WARNING) << "Cannot map the shared memory";
+        continue;
+      }
+      if (keep_alive_connections_.size() < kMaxKeepAliveConnections) {
+        // The first request is served in the next iteration.
+        keep_alive_connections_.push_back(std::move(connection));
+        continue;
+      }
+      // Too many connections.  Serve the first request, and then close the
+      // connection so that the client reconnects.
+      pollfd first[] = {{connection->socket, POLLIN, 0},
+                        {connection->request_event, POLLIN, 0}};
+      if (::poll(first, std::size(first), timeout_) > 0) {
+        if (first[1].revents != 0) {
+          serve_shared_memory(*connection);
+        } else {
+          serve_frame(*connection);
+        }
+      }
+      continue;
+    }
+    for (int &fd : received_fds) {
+      CloseFd(&fd);
+    }
+    if (type == ConnectionType::BROKEN) {
+      LOG(WARNING) << "Broken connection";
+      ::close(new_sock);
       continue;
     }
 
@@ -468,6 +1164,7 @@ void IPCServer::Loop() {
     ::close(new_sock);
   }
 
+  keep_alive_connections_.clear();
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
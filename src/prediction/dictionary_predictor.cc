@@ -67,6 +67,7 @@
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 #ifndef NDEBUG
 #define MOZC_DEBUG
@@ -103,6 +104,18 @@ constexpr int kInfinity = (2 << 20);
 constexpr size_t kSuggestionMaxResultsSize = 256;
 constexpr size_t kPredictionMaxResultsSize = 100000;
 
+// Maximum number of the tokens looked up by cost for a one-character key.  It
+// is about the number of the tokens of the keys that LookupPredictive() of the
+// system dictionary visits.
+constexpr size_t kMaxCostBoundedLookupTokens = 256;
+
+// Prediction subroutines are skipped when the deadline of the request comes
+// within these margins.  Realtime conversion is the most expensive one.
+constexpr absl::Duration kRealtimeDeadlineMargin = absl::Milliseconds(20);
+constexpr absl::Duration kTypingCorrectionDeadlineMargin =
+    absl::Milliseconds(10);
+constexpr absl::Duration kDefaultDeadlineMargin = absl::Milliseconds(5);
+
 bool IsEnableNewSpatialScoring(const ConversionRequest &request) {
   return request.request()
       .decoder_experiment_params()
@@ -220,6 +233,26 @@ Segments GetSegmentsForRealtimeCandidatesGeneration(
   return segments;
 }
 
+// Runs |callback| taking at most |lookup_limit| results for |input_key|.
+// For a one-character key, the breadth-first LookupPredictive() reaches its
+// limit within the shortest keys.  The mixed conversion keeps the cheapest
+// results only, so the cheapest tokens are looked up instead, pruning the
+// subtrees that cannot beat them.
+void LookupPredictiveWithLimit(const DictionaryInterface &dictionary,
+                               const std::string &input_key,
+                               const ConversionRequest &request,
+                               size_t lookup_limit,
+                               DictionaryInterface::Callback *callback) {
+  if (IsMixedConversionEnabled(request.request()) &&
+      Util::CharsLen(input_key) == 1) {
+    dictionary.LookupPredictiveByCost(
+        input_key, request,
+        std::min(lookup_limit, kMaxCostBoundedLookupTokens), callback);
+    return;
+  }
+  dictionary.LookupPredictive(input_key, request, callback);
+}
+
 }  // namespace
 
 class DictionaryPredictor::PredictiveLookupCallback
@@ -572,7 +605,12 @@ bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
   // conversion, meaning that results may include the candidates whose
   // key is exactly the same as the composition.  This mode is used in mobile.
   const bool is_mixed_conversion = IsMixedConversionEnabled(request.request());
-  AggregatePredictionForRequest(request, *segments, &results);
+  PredictionTypes skipped_types = NO_PREDICTION;
+  AggregatePredictionForRequest(request, *segments, &results, &skipped_types);
+  if (skipped_types != NO_PREDICTION) {
+    ++deadline_stats_.degraded_requests;
+    segments->set_degraded(true);
+  }
   if (results.empty()) {
     return false;
   }
@@ -606,7 +644,7 @@ bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
 DictionaryPredictor::PredictionTypes
 DictionaryPredictor::AggregatePredictionForRequest(
     const ConversionRequest &request, const Segments &segments,
-    std::vector<Result> *results) const {
+    std::vector<Result> *results, PredictionTypes *skipped_types) const {
   const bool is_mixed_conversion = IsMixedConversionEnabled(request.request());
   // In mixed conversion mode, the number of real time candidates is increased.
   const size_t realtime_max_size =
@@ -614,7 +652,7 @@ DictionaryPredictor::AggregatePredictionForRequest(
   const auto &unigram_config = GetUnigramConfig(request, segments);
 
   return AggregatePrediction(request, realtime_max_size, unigram_config,
-                             segments, results);
+                             segments, results, skipped_types);
 }
 
 DictionaryPredictor::UnigramConfig DictionaryPredictor::GetUnigramConfig(
@@ -649,8 +687,12 @@ DictionaryPredictor::UnigramConfig DictionaryPredictor::GetUnigramConfig(
 DictionaryPredictor::PredictionTypes DictionaryPredictor::AggregatePrediction(
     const ConversionRequest &request, size_t realtime_max_size,
     const UnigramConfig &unigram_config, const Segments &segments,
-    std::vector<Result> *results) const {
+    std::vector<Result> *results, PredictionTypes *skipped_types) const {
   DCHECK(results);
+  PredictionTypes skipped = NO_PREDICTION;
+  if (skipped_types == nullptr) {
+    skipped_types = &skipped;
+  }
 
   // Zero query prediction.
   if (segments.conversion_segment(0).key().empty()) {
@@ -674,14 +716,30 @@ DictionaryPredictor::PredictionTypes DictionaryPredictor::AggregatePrediction(
     }
   }
 
+  // In partial suggestion or prediction, only realtime candidates are used.
+  const bool is_partial =
+      request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
+      request.request_type() == ConversionRequest::PARTIAL_PREDICTION;
   PredictionTypes selected_types = NO_PREDICTION;
   if (ShouldAggregateRealTimeConversionResults(request, segments)) {
-    AggregateRealtimeConversion(request, realtime_max_size, segments, results);
-    selected_types |= REALTIME;
+    if (!ShouldSkipForDeadline(request, REALTIME)) {
+      AggregateRealtimeConversion(request, realtime_max_size, segments,
+                                  results);
+      selected_types |= REALTIME;
+    } else if (is_partial) {
+      // Partial requests have no other candidates, so the top candidate of
+      // the immutable converter, which is much cheaper than the full realtime
+      // conversion, is still returned.
+      *skipped_types |= REALTIME;
+      ConversionRequest minimal_request = request;
+      minimal_request.set_use_actual_converter_for_realtime_conversion(false);
+      AggregateRealtimeConversion(minimal_request, 1, segments, results);
+      selected_types |= REALTIME;
+    } else {
+      *skipped_types |= REALTIME;
+    }
   }
-  // In partial suggestion or prediction, only realtime candidates are used.
-  if (request.request_type() == ConversionRequest::PARTIAL_SUGGESTION ||
-      request.request_type() == ConversionRequest::PARTIAL_PREDICTION) {
+  if (is_partial) {
     return selected_types;
   }
 
@@ -700,34 +758,82 @@ DictionaryPredictor::PredictionTypes DictionaryPredictor::AggregatePrediction(
   // Add bigram candidates.
   constexpr int kMinHistoryKeyLen = 3;
   if (HasHistoryKeyLongerThanOrEqualTo(segments, kMinHistoryKeyLen)) {
-    AggregateBigramPrediction(request, segments,
-                              Segment::Candidate::SOURCE_INFO_NONE, results);
-    selected_types |= BIGRAM;
+    if (ShouldSkipForDeadline(request, BIGRAM)) {
+      *skipped_types |= BIGRAM;
+    } else {
+      AggregateBigramPrediction(request, segments,
+                                Segment::Candidate::SOURCE_INFO_NONE, results);
+      selected_types |= BIGRAM;
+    }
   }
 
   // Add english candidates.
   if (IsLanguageAwareInputEnabled(request) && IsQwertyMobileTable(request) &&
       key_len >= min_unigram_key_len) {
-    AggregateEnglishPredictionUsingRawInput(request, segments, results);
-    selected_types |= ENGLISH;
+    if (ShouldSkipForDeadline(request, ENGLISH)) {
+      *skipped_types |= ENGLISH;
+    } else {
+      AggregateEnglishPredictionUsingRawInput(request, segments, results);
+      selected_types |= ENGLISH;
+    }
   }
 
   // Add typing correction candidates.
   constexpr int kMinTypingCorrectionKeyLen = 3;
   if (IsTypingCorrectionEnabled(request) &&
       key_len >= kMinTypingCorrectionKeyLen) {
-    AggregateTypeCorrectingPrediction(request, segments, results);
-    selected_types |= TYPING_CORRECTION;
+    if (ShouldSkipForDeadline(request, TYPING_CORRECTION)) {
+      *skipped_types |= TYPING_CORRECTION;
+    } else {
+      AggregateTypeCorrectingPrediction(request, segments, results);
+      selected_types |= TYPING_CORRECTION;
+    }
   }
 
   if (ShouldEnrichPartialCandidates(request)) {
-    AggregatePrefixCandidates(request, segments, results);
-    selected_types |= PREFIX;
+    if (ShouldSkipForDeadline(request, PREFIX)) {
+      *skipped_types |= PREFIX;
+    } else {
+      AggregatePrefixCandidates(request, segments, results);
+      selected_types |= PREFIX;
+    }
   }
 
   return selected_types;
 }
 
+bool DictionaryPredictor::ShouldSkipForDeadline(
+    const ConversionRequest &request, PredictionType type) const {
+  absl::Duration margin = kDefaultDeadlineMargin;
+  uint64_t *skipped_count = nullptr;
+  switch (type) {
+    case REALTIME:
+      margin = kRealtimeDeadlineMargin;
+      skipped_count = &deadline_stats_.realtime_skipped;
+      break;
+    case BIGRAM:
+      skipped_count = &deadline_stats_.bigram_skipped;
+      break;
+    case ENGLISH:
+      skipped_count = &deadline_stats_.english_skipped;
+      break;
+    case TYPING_CORRECTION:
+      margin = kTypingCorrectionDeadlineMargin;
+      skipped_count = &deadline_stats_.typing_correction_skipped;
+      break;
+    case PREFIX:
+      skipped_count = &deadline_stats_.prefix_skipped;
+      break;
+    default:
+      return false;
+  }
+  if (!request.IsDeadlineNear(margin)) {
+    return false;
+  }
+  ++*skipped_count;
+  return true;
+}
+
 bool DictionaryPredictor::AddPredictionToCandidates(
     const ConversionRequest &request, bool include_exact_key,
     Segments *segments, std::vector<Result> *results) const {
@@ -2041,7 +2147,8 @@ void DictionaryPredictor::GetPredictiveResults(
     PredictiveLookupCallback callback(
         types, lookup_limit, input_key.size(), nullptr, source_info,
         zip_code_id, unknown_id, "", GetSpatialCostParams(request), results);
-    dictionary.LookupPredictive(input_key, request, &callback);
+    LookupPredictiveWithLimit(dictionary, input_key, request, lookup_limit,
+                              &callback);
     return;
   }
 
@@ -2059,7 +2166,8 @@ void DictionaryPredictor::GetPredictiveResults(
     PredictiveLookupCallback callback(
         types, lookup_limit, input_key.size(), nullptr, source_info,
         zip_code_id, unknown_id, "", GetSpatialCostParams(request), results);
-    dictionary.LookupPredictive(input_key, request, &callback);
+    LookupPredictiveWithLimit(dictionary, input_key, request, lookup_limit,
+                              &callback);
     return;
   }
 
@@ -2080,7 +2188,8 @@ void DictionaryPredictor::GetPredictiveResults(
                                       nullptr, source_info, zip_code_id,
                                       unknown_id, non_expanded_original_key,
                                       GetSpatialCostParams(request), results);
-    dictionary.LookupPredictive(input_key, request, &callback);
+    LookupPredictiveWithLimit(dictionary, input_key, request, lookup_limit,
+                              &callback);
   }
 }
 
@@ -2448,23 +2557,25 @@ bool DictionaryPredictor::AggregateNumberCandidates(
     input_key = segments.conversion_segment(0).key();
   }
 
-  // NumberDecoder decoder;
-  std::vector<NumberDecoder::Result> decode_results;
+  NumberDecoder::ResultBuffer decode_results;
   if (!number_decoder_.Decode(input_key, &decode_results)) {
     return false;
   }
 
-  for (const auto &r : decode_results) {
+  for (size_t i = 0; i < decode_results.size(); ++i) {
+    const absl::string_view candidate = decode_results.candidate(i);
+    const size_t consumed_key_byte_len =
+        decode_results.consumed_key_byte_len(i);
     Result result;
-    const bool is_arabic = Util::GetScriptType(r.candidate) == Util::NUMBER;
+    const bool is_arabic = Util::GetScriptType(candidate) == Util::NUMBER;
     result.types = PredictionType::NUMBER;
-    result.key = input_key.substr(0, r.consumed_key_byte_len);
-    result.value = r.candidate;
+    result.key = input_key.substr(0, consumed_key_byte_len);
+    result.value = std::string(candidate);
     // Heuristic small cost: 1000 ~= 500 * log(10)
     result.wcost = 1000;
     result.lid = is_arabic ? number_id_ : kanji_number_id_;
     result.rid = is_arabic ? number_id_ : kanji_number_id_;
-    if (r.consumed_key_byte_len < input_key.size()) {
+    if (consumed_key_byte_len < input_key.size()) {
       result.candidate_attributes |= Segment::Candidate::PARTIALLY_KEY_CONSUMED;
       result.consumed_key_size = Util::CharsLen(result.key);
     }
@@ -53,6 +53,7 @@
 #include "request/conversion_request.h"
 // for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
+#include "absl/container/flat_hash_map.h"
 
 namespace mozc {
 
@@ -80,6 +81,21 @@ class DictionaryPredictor : public PredictorInterface {
     return predictor_name_;
   }
 
+  // Counts the prediction stages skipped because the deadline of the request
+  // was near.
+  struct DeadlineStats {
+    uint64_t realtime_skipped = 0;
+    uint64_t bigram_skipped = 0;
+    uint64_t english_skipped = 0;
+    uint64_t typing_correction_skipped = 0;
+    uint64_t prefix_skipped = 0;
+    // The number of requests for which any stage was skipped.
+    uint64_t degraded_requests = 0;
+  };
+
+  DeadlineStats GetDeadlineStats() const { return deadline_stats_; }
+  void ResetDeadlineStats() { deadline_stats_ = DeadlineStats(); }
+
  protected:
   // Protected members for unittesting
   // For use util method accessing private members, made them protected.
@@ -294,6 +310,8 @@ class DictionaryPredictor : public PredictorInterface {
   FRIEND_TEST(DictionaryPredictorTest, TriggerConditions);
   FRIEND_TEST(DictionaryPredictorTest, TriggerConditionsMobile);
   FRIEND_TEST(DictionaryPredictorTest, TriggerConditionsLatinInputMode);
+  FRIEND_TEST(DictionaryPredictorTest, Deadline);
+  FRIEND_TEST(DictionaryPredictorTest, DeadlineForPartialSuggestion);
   FRIEND_TEST(DictionaryPredictorTest, GetLMCost);
   FRIEND_TEST(DictionaryPredictorTest, DoNotAggregateZipcodeEntries);
   FRIEND_TEST(TriggerConditionsTest, TriggerConditions);
@@ -312,16 +330,25 @@ class DictionaryPredictor : public PredictorInterface {
       uint16_t rid, std::vector<Result> *results);
 
   // Returns the bitfield that indicates what prediction subroutines
-  // were used.  NO_PREDICTION means that no prediction was made.
+  // were used.  NO_PREDICTION means that no prediction was made.  The
+  // subroutines skipped because of the deadline are set to |skipped_types| if
+  // not nullptr.
   PredictionTypes AggregatePredictionForRequest(
       const ConversionRequest &request, const Segments &segments,
-      std::vector<Result> *results) const;
+      std::vector<Result> *results,
+      PredictionTypes *skipped_types = nullptr) const;
+
+  PredictionTypes AggregatePrediction(
+      const ConversionRequest &request, size_t realtime_max_size,
+      const UnigramConfig &unigram_config, const Segments &segments,
+      std::vector<Result> *results,
+      PredictionTypes *skipped_types = nullptr) const;
 
-  PredictionTypes AggregatePrediction(const ConversionRequest &request,
-                                      size_t realtime_max_size,
-                                      const UnigramConfig &unigram_config,
-                                      const Segments &segments,
-                                      std::vector<Result> *results) const;
+  // Returns true if the prediction subroutine |type| should be skipped as the
+  // deadline of |request| is near.  Unigram and number candidates are never
+  // skipped so that the result is not empty.
+  bool ShouldSkipForDeadline(const ConversionRequest &request,
+                             PredictionType type) const;
 
   PredictionTypes AggregatePredictionForZeroQuery(
       const ConversionRequest &request, const Segments &segments,
@@ -535,6 +562,7 @@ class DictionaryPredictor : public PredictorInterface {
   ZeroQueryDict zero_query_dict_;
   ZeroQueryDict zero_query_number_dict_;
   NumberDecoder number_decoder_;
+  mutable DeadlineStats deadline_stats_;
 
   DISALLOW_COPY_AND_ASSIGN(DictionaryPredictor);
 };
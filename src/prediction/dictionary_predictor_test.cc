@@ -39,6 +39,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/serialized_string_array.h"
@@ -79,6 +80,7 @@
 #include "usage_stats/usage_stats_testing_util.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
+#include "absl/time/time.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
@@ -282,6 +284,10 @@ class CallCheckDictionary : public DictionaryInterface {
               (absl::string_view key, const ConversionRequest &convreq,
                Callback *callback),
               (const, override));
+  MOCK_METHOD(void, LookupPredictiveByCost,
+              (absl::string_view key, const ConversionRequest &convreq,
+               size_t max_tokens, Callback *callback),
+              (const, override));
   MOCK_METHOD(void, LookupPrefix,
               (absl::string_view key, const ConversionRequest &convreq,
                Callback *callback),
@@ -1109,6 +1115,89 @@ TEST_P(TriggerConditionsTest, TriggerConditions) {
 INSTANTIATE_TEST_SUITE_P(TriggerConditionsForPlatforms, TriggerConditionsTest,
                          ::testing::Values(DESKTOP, MOBILE));
 
+TEST_F(DictionaryPredictorTest, Deadline) {
+  std::unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+  commands::RequestForUnitTest::FillMobileRequest(request_.get());
+  config_->set_use_dictionary_suggest(true);
+
+  Segments segments;
+  std::vector<DictionaryPredictor::Result> results;
+  SetUpInputForSuggestion("ぐーぐる", composer_.get(), &segments);
+  composer_->SetInputMode(transliteration::HIRAGANA);
+
+  // Far from the deadline.
+  convreq_for_prediction_->set_deadline(Clock::GetAbslTime() +
+                                        absl::Hours(1));
+  DictionaryPredictor::PredictionTypes skipped_types =
+      DictionaryPredictor::NO_PREDICTION;
+  EXPECT_EQ(DictionaryPredictor::UNIGRAM | DictionaryPredictor::REALTIME,
+            predictor->AggregatePredictionForRequest(
+                *convreq_for_prediction_, segments, &results, &skipped_types));
+  EXPECT_EQ(DictionaryPredictor::NO_PREDICTION, skipped_types);
+  EXPECT_EQ(0, predictor->GetDeadlineStats().realtime_skipped);
+
+  // The deadline has passed.  Only the realtime conversion is skipped, and
+  // unigram candidates are still returned.
+  convreq_for_prediction_->set_deadline(Clock::GetAbslTime());
+  results.clear();
+  EXPECT_EQ(DictionaryPredictor::UNIGRAM,
+            predictor->AggregatePredictionForRequest(
+                *convreq_for_prediction_, segments, &results, &skipped_types));
+  EXPECT_EQ(DictionaryPredictor::REALTIME, skipped_types);
+  EXPECT_FALSE(results.empty());
+  EXPECT_EQ(1, predictor->GetDeadlineStats().realtime_skipped);
+
+  // The result is marked as degraded.
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_for_prediction_,
+                                           &segments));
+  EXPECT_TRUE(segments.degraded());
+  EXPECT_EQ(1, predictor->GetDeadlineStats().degraded_requests);
+
+  predictor->ResetDeadlineStats();
+  EXPECT_EQ(0, predictor->GetDeadlineStats().realtime_skipped);
+}
+
+TEST_F(DictionaryPredictorTest, DeadlineForPartialSuggestion) {
+  std::unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+  config_->set_use_dictionary_suggest(true);
+  config_->set_use_realtime_conversion(true);
+
+  Segments segments;
+  std::vector<DictionaryPredictor::Result> results;
+  SetUpInputForSuggestion("わたしのなまえ", composer_.get(), &segments);
+  composer_->SetInputMode(transliteration::HIRAGANA);
+  ConversionRequest request = *convreq_for_suggestion_;
+  request.set_request_type(ConversionRequest::PARTIAL_SUGGESTION);
+
+  // Partial requests use only the realtime conversion, so its top candidate
+  // is returned even after the deadline.
+  request.set_deadline(Clock::GetAbslTime());
+  DictionaryPredictor::PredictionTypes skipped_types =
+      DictionaryPredictor::NO_PREDICTION;
+  EXPECT_EQ(DictionaryPredictor::REALTIME,
+            predictor->AggregatePredictionForRequest(request, segments,
+                                                     &results, &skipped_types));
+  EXPECT_EQ(DictionaryPredictor::REALTIME, skipped_types);
+  ASSERT_EQ(1, results.size());
+  EXPECT_EQ(1, predictor->GetDeadlineStats().realtime_skipped);
+
+  // Without the deadline, more candidates are returned.
+  request.set_deadline(absl::InfiniteFuture());
+  results.clear();
+  skipped_types = DictionaryPredictor::NO_PREDICTION;
+  EXPECT_EQ(DictionaryPredictor::REALTIME,
+            predictor->AggregatePredictionForRequest(request, segments,
+                                                     &results, &skipped_types));
+  EXPECT_EQ(DictionaryPredictor::NO_PREDICTION, skipped_types);
+  EXPECT_LT(1, results.size());
+}
+
 TEST_F(DictionaryPredictorTest, TriggerConditionsMobile) {
   std::unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
@@ -1478,6 +1567,47 @@ TEST_F(DictionaryPredictorTest, AggregateUnigramCandidateForMixedConversion) {
   }
 }
 
+TEST_F(DictionaryPredictorTest,
+       AggregateUnigramCandidateForMixedConversionByCost) {
+  config_->set_use_dictionary_suggest(true);
+  config_->set_use_realtime_conversion(false);
+  request_->set_mixed_conversion(true);
+  table_->LoadFromFile("system://romanji-hiragana.tsv");
+  composer_->SetTable(table_.get());
+
+  {
+    // The cheapest tokens are looked up for a one-character key.
+    CallCheckDictionary dictionary;
+    EXPECT_CALL(dictionary, LookupPredictive(_, _, _)).Times(0);
+    EXPECT_CALL(dictionary,
+                LookupPredictiveByCost(absl::string_view("あ"), _,
+                                       ::testing::Le(256), _))
+        .Times(1);
+    InsertInputSequence("a", composer_.get());
+    Segments segments;
+    segments.add_segment()->set_key("あ");
+
+    std::vector<TestableDictionaryPredictor::Result> results;
+    TestableDictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
+        dictionary, *convreq_for_prediction_, segments, 0, 0, &results);
+  }
+  {
+    // Longer keys are looked up as usual.
+    CallCheckDictionary dictionary;
+    EXPECT_CALL(dictionary, LookupPredictive(absl::string_view("ああ"), _, _))
+        .Times(1);
+    EXPECT_CALL(dictionary, LookupPredictiveByCost(_, _, _, _)).Times(0);
+    composer_->Reset();
+    InsertInputSequence("aa", composer_.get());
+    Segments segments;
+    segments.add_segment()->set_key("ああ");
+
+    std::vector<TestableDictionaryPredictor::Result> results;
+    TestableDictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
+        dictionary, *convreq_for_prediction_, segments, 0, 0, &results);
+  }
+}
+
 TEST_F(DictionaryPredictorTest, AggregateBigramPrediction) {
   std::unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
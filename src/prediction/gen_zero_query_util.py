@@ -72,5 +72,5 @@ def WriteZeroQueryData(zero_query_dict, output_token_array,
         f.write(struct.pack('<H', 0))  # Set 0 for unused field.
         f.write(struct.pack('<I', 0))  # Set 0 for unused field.
 
-  serialized_string_array_builder.SerializeToFile(sorted_strings,
-                                                  output_string_array)
+  serialized_string_array_builder.SerializeToFile(
+      sorted_strings, output_string_array, build_hash_index=True)
@@ -30,80 +30,114 @@
 #include "prediction/number_decoder.h"
 
 #include <algorithm>
-#include <istream>
-#include <memory>
-#include <sstream>
+#include <cstring>
+#include <deque>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "base/number_util.h"
-#include "absl/strings/str_split.h"
+#include "base/logging.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 
+void NumberDecoderString::Append(absl::string_view str) {
+  DCHECK_LE(size_ + str.size(), kCapacity);
+  const size_t len = std::min(str.size(), kCapacity - size_);
+  memcpy(data_ + size_, str.data(), len);
+  size_ += len;
+}
+
+void NumberDecoderString::AppendNumber(int number) {
+  DCHECK_GE(number, 0);
+  char buf[16];
+  char *p = buf + sizeof(buf);
+  do {
+    *--p = '0' + number % 10;
+    number /= 10;
+  } while (number > 0);
+  Append(absl::string_view(p, buf + sizeof(buf) - p));
+}
+
+void NumberDecoderResultBuffer::Add(size_t consumed_key_byte_len,
+                                    const NumberDecoderString &prefix,
+                                    int number) {
+  DCHECK_LT(size_, kMaxSize);
+  if (size_ >= kMaxSize) {
+    return;
+  }
+  Item &item = results_[size_++];
+  item.consumed_key_byte_len = consumed_key_byte_len;
+  item.candidate = prefix;
+  if (number >= 0) {
+    item.candidate.AppendNumber(number);
+  }
+}
+
 NumberDecoder::NumberDecoder() { InitEntries(); }
 
 void NumberDecoder::InitEntries() {
+  std::vector<std::pair<absl::string_view, Entry>> entries;
+  auto add = [&entries](absl::string_view key, const Entry &entry) {
+    entries.emplace_back(key, entry);
+  };
+
   // unit
-  entries_.AddEntry("ぜろ", Entry({UNIT, 0}));
-  entries_.AddEntry("いち", Entry({UNIT, 1}));
-  entries_.AddEntry("いっ", Entry({UNIT, 1}));
-  entries_.AddEntry("に", Entry({UNIT, 2}));
-  entries_.AddEntry("さん", Entry({UNIT, 3}));
-  entries_.AddEntry("し", Entry({UNIT, 4}));
-  entries_.AddEntry("よん", Entry({UNIT, 4}));
-  entries_.AddEntry("よ", Entry({UNIT, 4}));
-  entries_.AddEntry("ご", Entry({UNIT, 5}));
-  entries_.AddEntry("ろく", Entry({UNIT, 6}));
-  entries_.AddEntry("ろっ", Entry({UNIT, 6}));
-  entries_.AddEntry("なな", Entry({UNIT, 7}));
-  entries_.AddEntry("しち", Entry({UNIT, 7}));
-  entries_.AddEntry("はち", Entry({UNIT, 8}));
-  entries_.AddEntry("はっ", Entry({UNIT, 8}));
-  entries_.AddEntry("きゅう", Entry({UNIT, 9}));
-  entries_.AddEntry("きゅー", Entry({UNIT, 9}));
-  entries_.AddEntry("く", Entry({UNIT, 9}));
+  add("ぜろ", Entry({UNIT, 0}));
+  add("いち", Entry({UNIT, 1}));
+  add("いっ", Entry({UNIT, 1}));
+  add("に", Entry({UNIT, 2}));
+  add("さん", Entry({UNIT, 3}));
+  add("し", Entry({UNIT, 4}));
+  add("よん", Entry({UNIT, 4}));
+  add("よ", Entry({UNIT, 4}));
+  add("ご", Entry({UNIT, 5}));
+  add("ろく", Entry({UNIT, 6}));
+  add("ろっ", Entry({UNIT, 6}));
+  add("なな", Entry({UNIT, 7}));
+  add("しち", Entry({UNIT, 7}));
+  add("はち", Entry({UNIT, 8}));
+  add("はっ", Entry({UNIT, 8}));
+  add("きゅう", Entry({UNIT, 9}));
+  add("きゅー", Entry({UNIT, 9}));
+  add("く", Entry({UNIT, 9}));
 
   // small digit
   // "重", etc
-  entries_.AddEntry("じゅう", Entry({SMALL_DIGIT, 10, 2, "", true}));
-  entries_.AddEntry("じゅー", Entry({SMALL_DIGIT, 10, 2, "", true}));
-  entries_.AddEntry("じゅっ", Entry({SMALL_DIGIT, 10, 2}));
-  entries_.AddEntry("ひゃく", Entry({SMALL_DIGIT, 100, 3}));
-  entries_.AddEntry("ひゃっ", Entry({SMALL_DIGIT, 100, 3}));
-  entries_.AddEntry("びゃく", Entry({SMALL_DIGIT, 100, 3}));
-  entries_.AddEntry("びゃっ", Entry({SMALL_DIGIT, 100, 3}));
-  entries_.AddEntry("ぴゃく", Entry({SMALL_DIGIT, 100, 3}));
-  entries_.AddEntry("ぴゃっ", Entry({SMALL_DIGIT, 100, 3}));
+  add("じゅう", Entry({SMALL_DIGIT, 10, 2, "", true}));
+  add("じゅー", Entry({SMALL_DIGIT, 10, 2, "", true}));
+  add("じゅっ", Entry({SMALL_DIGIT, 10, 2}));
+  add("ひゃく", Entry({SMALL_DIGIT, 100, 3}));
+  add("ひゃっ", Entry({SMALL_DIGIT, 100, 3}));
+  add("びゃく", Entry({SMALL_DIGIT, 100, 3}));
+  add("びゃっ", Entry({SMALL_DIGIT, 100, 3}));
+  add("ぴゃく", Entry({SMALL_DIGIT, 100, 3}));
+  add("ぴゃっ", Entry({SMALL_DIGIT, 100, 3}));
   // "戦", etc
-  entries_.AddEntry("せん", Entry({SMALL_DIGIT, 1000, 4, "", true}));
+  add("せん", Entry({SMALL_DIGIT, 1000, 4, "", true}));
   // "膳"
-  entries_.AddEntry("ぜん", Entry({SMALL_DIGIT, 1000, 4, "", true}));
+  add("ぜん", Entry({SMALL_DIGIT, 1000, 4, "", true}));
 
   // big digit
-  entries_.AddEntry("まん", Entry({BIG_DIGIT, 10000, 1, "万"}));
-  entries_.AddEntry("おく", Entry({BIG_DIGIT, -1, 2, "億"}));
-  entries_.AddEntry("おっ", Entry({BIG_DIGIT, -1, 2, "億"}));
+  add("まん", Entry({BIG_DIGIT, 10000, 1, "万"}));
+  add("おく", Entry({BIG_DIGIT, -1, 2, "億"}));
+  add("おっ", Entry({BIG_DIGIT, -1, 2, "億"}));
   // "町", etc
-  entries_.AddEntry("ちょう", Entry({BIG_DIGIT, -1, 3, "兆", true}));
+  add("ちょう", Entry({BIG_DIGIT, -1, 3, "兆", true}));
   // "系", etc
-  entries_.AddEntry("けい", Entry({BIG_DIGIT, -1, 4, "京", true}));
-  entries_.AddEntry("がい", Entry({BIG_DIGIT, -1, 5, "垓"}));
+  add("けい", Entry({BIG_DIGIT, -1, 4, "京", true}));
+  add("がい", Entry({BIG_DIGIT, -1, 5, "垓"}));
 
   // spacial cases
   // conflict with "にち"
-  entries_.AddEntry("にちょう",
-                    Entry({UNIT_AND_BIG_DIGIT, 2, 3, "兆", true, 3}));
-  entries_.AddEntry("にちょうめ",
-                    Entry({UNIT_AND_STOP_DECODING, 2, -1, "", false, 3}));
-  entries_.AddEntry("にちゃん",
-                    Entry({UNIT_AND_STOP_DECODING, 2, -1, "", false, 3}));
+  add("にちょう", Entry({UNIT_AND_BIG_DIGIT, 2, 3, "兆", true, 3}));
+  add("にちょうめ", Entry({UNIT_AND_STOP_DECODING, 2, -1, "", false, 3}));
+  add("にちゃん", Entry({UNIT_AND_STOP_DECODING, 2, -1, "", false, 3}));
   // サンチーム (currency) v.s. 3チーム
-  entries_.AddEntry("さんちーむ",
-                    Entry({UNIT_AND_STOP_DECODING, 3, -1, "", true, 6}));
+  add("さんちーむ", Entry({UNIT_AND_STOP_DECODING, 3, -1, "", true, 6}));
 
   // number suffix conflicting with the other entries
-  const std::vector<std::string> kSuffixEntries = {
+  constexpr absl::string_view kSuffixEntries[] = {
       // に
       // 握り, 日, 人
       "にぎり",
@@ -149,78 +183,157 @@ void NumberDecoder::InitEntries() {
       // 丁目
       "ちょうめ",
   };
-  for (const auto &key : kSuffixEntries) {
-    entries_.AddEntry(key, Entry());
+  for (const absl::string_view key : kSuffixEntries) {
+    add(key, Entry());
+  }
+
+  Compile(entries);
+}
+
+void NumberDecoder::Compile(
+    const std::vector<std::pair<absl::string_view, Entry>> &entries) {
+  std::vector<std::pair<absl::string_view, int>> keys;
+  keys.reserve(entries.size());
+  entries_.clear();
+  entries_.reserve(entries.size());
+  for (const auto &[key, entry] : entries) {
+    keys.emplace_back(key, entries_.size());
+    entries_.push_back(entry);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // Builds the trie in breadth first order so that the edges from a node are
+  // stored contiguously.  Each pending node covers the range of |keys| which
+  // share the prefix of |depth| bytes.
+  struct Pending {
+    size_t node;
+    size_t begin;
+    size_t end;
+    size_t depth;
+  };
+  nodes_.assign(1, Node());
+  edges_.clear();
+  std::deque<Pending> queue = {{0, 0, keys.size(), 0}};
+  while (!queue.empty()) {
+    Pending p = queue.front();
+    queue.pop_front();
+    if (p.begin < p.end && keys[p.begin].first.size() == p.depth) {
+      nodes_[p.node].entry_index = keys[p.begin].second;
+      ++p.begin;
+    }
+    nodes_[p.node].first_edge = edges_.size();
+    for (size_t i = p.begin; i < p.end;) {
+      const uint8_t byte = keys[i].first[p.depth];
+      size_t j = i + 1;
+      while (j < p.end &&
+             static_cast<uint8_t>(keys[j].first[p.depth]) == byte) {
+        ++j;
+      }
+      edges_.push_back({byte, static_cast<uint16_t>(nodes_.size())});
+      queue.push_back({nodes_.size(), i, j, p.depth + 1});
+      nodes_.emplace_back();
+      i = j;
+    }
+    nodes_[p.node].num_edges = edges_.size() - nodes_[p.node].first_edge;
+  }
+  DCHECK_LT(nodes_.size(), 0x10000);
+}
+
+const NumberDecoder::Entry *NumberDecoder::LongestMatch(
+    absl::string_view key, size_t *key_byte_len) const {
+  const Entry *result = nullptr;
+  size_t node = 0;
+  for (size_t i = 0; i < key.size(); ++i) {
+    const Node &n = nodes_[node];
+    const Edge *begin = edges_.data() + n.first_edge;
+    const Edge *end = begin + n.num_edges;
+    const uint8_t byte = key[i];
+    const Edge *edge = std::lower_bound(
+        begin, end, byte,
+        [](const Edge &e, uint8_t b) { return e.byte < b; });
+    if (edge == end || edge->byte != byte) {
+      break;
+    }
+    node = edge->child;
+    if (nodes_[node].entry_index >= 0) {
+      result = &entries_[nodes_[node].entry_index];
+      *key_byte_len = i + 1;
+    }
   }
+  return result;
 }
 
 bool NumberDecoder::Decode(absl::string_view key,
-                           std::vector<Result> *results) const {
+                           ResultBuffer *results) const {
   State state;
   results->clear();
-  DecodeAux(key, &state, results);
+  while (!key.empty()) {
+    size_t key_byte_len = 0;
+    const Entry *e = LongestMatch(key, &key_byte_len);
+    if (e == nullptr) {
+      break;
+    }
+    bool stop = false;
+    switch (e->type) {
+      case STOP_DECODING:
+        stop = true;
+        break;
+      case UNIT:
+        stop = !HandleUnitEntry(*e, &state, results);
+        break;
+      case SMALL_DIGIT:
+        stop = !HandleSmallDigitEntry(*e, &state, results);
+        break;
+      case BIG_DIGIT:
+        stop = !HandleBigDigitEntry(*e, &state, results);
+        break;
+      case UNIT_AND_BIG_DIGIT:
+        if (!HandleUnitEntry(*e, &state, results)) {
+          stop = true;
+          break;
+        }
+        state.consumed_key_byte_len += e->consume_byte_len_of_first;
+        // The rest of the key is consumed below on success.
+        key.remove_prefix(e->consume_byte_len_of_first);
+        key_byte_len -= e->consume_byte_len_of_first;
+        stop = !HandleBigDigitEntry(*e, &state, results);
+        break;
+      case UNIT_AND_STOP_DECODING:
+        if (HandleUnitEntry(*e, &state, results)) {
+          state.consumed_key_byte_len += e->consume_byte_len_of_first;
+        }
+        stop = true;
+        break;
+      default:
+        LOG(ERROR) << "Error";
+        stop = true;
+    }
+    if (stop) {
+      break;
+    }
+    DCHECK_GT(key_byte_len, 0);
+    state.consumed_key_byte_len += key_byte_len;
+    key.remove_prefix(key_byte_len);
+  }
 
   MayAppendResults(state, state.consumed_key_byte_len, results);
   return !results->empty();
 }
 
-void NumberDecoder::DecodeAux(absl::string_view key, State *state,
-                              std::vector<Result> *results) const {
-  if (key.size() == 0) {
-    return;
-  }
-  size_t key_byte_len;
-  Entry e;
-  if (!entries_.LongestMatch(key, &e, &key_byte_len)) {
-    return;
-  }
-  switch (e.type) {
-    case STOP_DECODING:
-      return;
-    case UNIT:
-      if (!HandleUnitEntry(e, state, results)) {
-        return;
-      }
-      state->consumed_key_byte_len += key_byte_len;
-      break;
-    case SMALL_DIGIT:
-      if (!HandleSmallDigitEntry(e, state, results)) {
-        return;
-      }
-      state->consumed_key_byte_len += key_byte_len;
-      break;
-    case BIG_DIGIT:
-      if (!HandleBigDigitEntry(e, state, results)) {
-        return;
-      }
-      state->consumed_key_byte_len += key_byte_len;
-      break;
-    case UNIT_AND_BIG_DIGIT:
-      if (!HandleUnitEntry(e, state, results)) {
-        return;
-      }
-      state->consumed_key_byte_len += e.consume_byte_len_of_first;
-      if (!HandleBigDigitEntry(e, state, results)) {
-        return;
-      }
-      state->consumed_key_byte_len +=
-          (key_byte_len - e.consume_byte_len_of_first);
-      break;
-    case UNIT_AND_STOP_DECODING:
-      if (!HandleUnitEntry(e, state, results)) {
-        return;
-      }
-      state->consumed_key_byte_len += e.consume_byte_len_of_first;
-      return;
-    default:
-      LOG(ERROR) << "Error";
+bool NumberDecoder::Decode(absl::string_view key,
+                           std::vector<Result> *results) const {
+  results->clear();
+  ResultBuffer buffer;
+  Decode(key, &buffer);
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    results->emplace_back(buffer.consumed_key_byte_len(i),
+                          std::string(buffer.candidate(i)));
   }
-  DCHECK_GT(key_byte_len, 0);
-  DecodeAux(key.substr(key_byte_len), state, results);
+  return !results->empty();
 }
 
 bool NumberDecoder::HandleUnitEntry(const Entry &entry, State *state,
-                                    std::vector<Result> *results) const {
+                                    ResultBuffer *results) const {
   results->clear();
 
   if (state->IsValid() && entry.number == 0) {
@@ -248,7 +361,7 @@ bool NumberDecoder::HandleUnitEntry(const Entry &entry, State *state,
 }
 
 bool NumberDecoder::HandleSmallDigitEntry(const Entry &entry, State *state,
-                                          std::vector<Result> *results) const {
+                                          ResultBuffer *results) const {
   results->clear();
   if (state->small_digit > 1 && entry.digit >= state->small_digit) {
     // Invalid: じゅうせん
@@ -275,7 +388,7 @@ bool NumberDecoder::HandleSmallDigitEntry(const Entry &entry, State *state,
 }
 
 bool NumberDecoder::HandleBigDigitEntry(const Entry &entry, State *state,
-                                        std::vector<Result> *results) const {
+                                        ResultBuffer *results) const {
   results->clear();
 
   if (state->big_digit > 0 && entry.digit >= state->big_digit) {
@@ -292,8 +405,8 @@ bool NumberDecoder::HandleBigDigitEntry(const Entry &entry, State *state,
   }
 
   //  state->current_num = -1;
-  state->current_num_str.append(
-      absl::StrCat(state->small_digit_num, entry.digit_str));
+  state->current_num_str.AppendNumber(state->small_digit_num);
+  state->current_num_str.Append(entry.digit_str);
   state->small_digit_num = -1;
   state->small_digit = -1;
   state->big_digit = entry.digit;
@@ -302,7 +415,7 @@ bool NumberDecoder::HandleBigDigitEntry(const Entry &entry, State *state,
 
 void NumberDecoder::MayAppendResults(const State &state,
                                      size_t consumed_byte_len,
-                                     std::vector<Result> *results) const {
+                                     ResultBuffer *results) const {
   if (!state.IsValid()) {
     return;
   }
@@ -311,15 +424,13 @@ void NumberDecoder::MayAppendResults(const State &state,
 
   if (small_digit > 0) {
     // "1万" + "2000"
-    results->emplace_back(Result{
-        consumed_byte_len, absl::StrCat(state.current_num_str, small_digit)});
+    results->Add(consumed_byte_len, state.current_num_str, small_digit);
   } else if (!state.current_num_str.empty()) {
     // "1万"
-    results->emplace_back(
-        Result{consumed_byte_len, absl::StrCat(state.current_num_str)});
+    results->Add(consumed_byte_len, state.current_num_str, -1);
   } else if (small_digit == 0) {
     // "0"
-    results->emplace_back(Result{consumed_byte_len, absl::StrCat(0)});
+    results->Add(consumed_byte_len, NumberDecoderString(), 0);
   }
 }
 
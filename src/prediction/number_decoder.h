@@ -30,12 +30,15 @@
 #ifndef MOZC_PREDICTION_NUMBER_DECODER_H_
 #define MOZC_PREDICTION_NUMBER_DECODER_H_
 
-#include <istream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "base/trie.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
@@ -57,7 +60,8 @@ struct NumberDecoderEntry {
   NumberDecoderEntryType type = STOP_DECODING;
   int number = 0;
   int digit = 1;
-  std::string digit_str = "";
+  // Points to a string literal.
+  absl::string_view digit_str = "";
   // Output the current status before decoding the input with the entry.
   bool output_before_decode = false;
   // For UNIT_AND_BIG_DIGIT and UNIT_AND_STOP_DECODING.
@@ -65,6 +69,24 @@ struct NumberDecoderEntry {
   int consume_byte_len_of_first = 0;
 };
 
+// Fixed size string used while decoding, so that decoding doesn't allocate
+// memory.  The longest decoded number,
+// "9999垓9999京9999兆9999億9999万9999", has 39 bytes.
+class NumberDecoderString {
+ public:
+  static constexpr size_t kCapacity = 64;
+
+  absl::string_view view() const { return absl::string_view(data_, size_); }
+  bool empty() const { return size_ == 0; }
+  void clear() { size_ = 0; }
+  void Append(absl::string_view str);
+  void AppendNumber(int number);
+
+ private:
+  char data_[kCapacity];
+  size_t size_ = 0;
+};
+
 // We decode the Japanese number reading using big_digit and small_digit.
 // Big digit stands for the number digit for 10^4N, e.g. "万", "億", "兆", ...
 // Small digit stands for the digit, 1, 10, 100, 1000.
@@ -75,7 +97,7 @@ struct NumberDecoderState {
   // Current small digit number in integer (e.g. 2000, <= 9999)
   int small_digit_num = -1;
   // Current number in string (e.g. 46億, 2億6000万)
-  std::string current_num_str;
+  NumberDecoderString current_num_str;
   // The current index for the small digit ('digit' in NumberDecoderEntry).
   // e.g. (small_digit_number : digit index) = (1:1), (10:2), (100:3), (1000:4)
   int small_digit = -1;
@@ -90,8 +112,8 @@ struct NumberDecoderState {
 
   std::string DebugString() const {
     return absl::StrCat("small_digit_num: ", small_digit_num,
-                        "\tnum_str: ", current_num_str, "\tsd: ", small_digit,
-                        "\tbd: ", big_digit,
+                        "\tnum_str: ", current_num_str.view(),
+                        "\tsd: ", small_digit, "\tbd: ", big_digit,
                         "\tconsumed_blen: ", consumed_key_byte_len);
   }
 };
@@ -115,29 +137,79 @@ struct NumberDecoderResult {
   }
 };
 
+// Decoded results in fixed size buffers.  Decoding yields at most two
+// results: the number before the last entry, e.g. "2" for "にじゅう", and the
+// whole number.
+class NumberDecoderResultBuffer {
+ public:
+  static constexpr size_t kMaxSize = 2;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t consumed_key_byte_len(size_t i) const {
+    return results_[i].consumed_key_byte_len;
+  }
+  absl::string_view candidate(size_t i) const {
+    return results_[i].candidate.view();
+  }
+
+  void clear() { size_ = 0; }
+  void Add(size_t consumed_key_byte_len, const NumberDecoderString &prefix,
+           int number);
+
+ private:
+  struct Item {
+    size_t consumed_key_byte_len = 0;
+    NumberDecoderString candidate;
+  };
+  std::array<Item, kMaxSize> results_;
+  size_t size_ = 0;
+};
+
 class NumberDecoder {
  public:
   using State = NumberDecoderState;
   using Entry = NumberDecoderEntry;
   using Result = NumberDecoderResult;
+  using ResultBuffer = NumberDecoderResultBuffer;
 
   NumberDecoder();
+
+  // Decodes |key| without memory allocation.
+  bool Decode(absl::string_view key, ResultBuffer *results) const;
   bool Decode(absl::string_view key, std::vector<Result> *results) const;
 
  private:
-  void DecodeAux(absl::string_view key, State *state,
-                 std::vector<Result> *results) const;
+  // Node of the trie compiled from the entries.  The edges from a node are
+  // stored contiguously in |edges_| in ascending order of the byte.
+  struct Node {
+    uint16_t first_edge = 0;
+    uint16_t num_edges = 0;
+    // Index in |entries_|, or -1 if the node has no entry.
+    int16_t entry_index = -1;
+  };
+  struct Edge {
+    uint8_t byte;
+    uint16_t child;
+  };
+
+  // Finds the longest entry which is a prefix of |key|.
+  const Entry *LongestMatch(absl::string_view key, size_t *key_byte_len) const;
   bool HandleUnitEntry(const Entry &entry, State *state,
-                       std::vector<Result> *results) const;
+                       ResultBuffer *results) const;
   bool HandleSmallDigitEntry(const Entry &entry, State *state,
-                             std::vector<Result> *results) const;
+                             ResultBuffer *results) const;
   bool HandleBigDigitEntry(const Entry &entry, State *state,
-                           std::vector<Result> *results) const;
+                           ResultBuffer *results) const;
   void MayAppendResults(const State &state, size_t consumed_byte_len,
-                        std::vector<Result> *results) const;
+                        ResultBuffer *results) const;
   void InitEntries();
+  // Compiles the entries into |nodes_| and |edges_|.
+  void Compile(const std::vector<std::pair<absl::string_view, Entry>> &entries);
 
-  Trie<Entry> entries_;
+  std::vector<Entry> entries_;
+  std::vector<Node> nodes_;
+  std::vector<Edge> edges_;
 };
 
 }  // namespace mozc
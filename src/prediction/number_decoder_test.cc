@@ -37,6 +37,7 @@
 #include "testing/base/public/gmock.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
+#include "absl/algorithm/container.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
@@ -141,6 +142,32 @@ TEST(NumberDecoderTest, Decode) {
   }
 }
 
+TEST(NumberDecoderTest, DecodeToResultBuffer) {
+  NumberDecoder decoder;
+  NumberDecoder::ResultBuffer results;
+
+  ASSERT_TRUE(decoder.Decode("にじゅうさんまんよんせん", &results));
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results.consumed_key_byte_len(0), 30);
+  EXPECT_EQ(results.candidate(0), "23万4");
+  EXPECT_EQ(results.consumed_key_byte_len(1), 36);
+  EXPECT_EQ(results.candidate(1), "23万4000");
+
+  // The buffer is cleared by the next decoding.
+  ASSERT_TRUE(decoder.Decode("きゅうせんきゅうひゃくきゅうじゅうきゅうがい"
+                             "きゅうせんきゅうひゃくきゅうじゅうきゅうけい"
+                             "きゅうせんきゅうひゃくきゅうじゅうきゅうちょう"
+                             "きゅうせんきゅうひゃくきゅうじゅうきゅうおく"
+                             "きゅうせんきゅうひゃくきゅうじゅうきゅうまん"
+                             "きゅうせんきゅうひゃくきゅうじゅうきゅう",
+                             &results));
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_EQ(results.candidate(0), "9999垓9999京9999兆9999億9999万9999");
+
+  EXPECT_FALSE(decoder.Decode("ひと", &results));
+  EXPECT_TRUE(results.empty());
+}
+
 TEST(NumberDecoderTest, Random) {
   const std::vector<std::string> kKeys = {
       "ぜろ",   "いち",   "いっ",   "に",     "さん",   "し",     "よん",
@@ -41,6 +41,8 @@
         'dictionary_predictor.cc',
         'number_decoder.cc',
         'predictor.cc',
+        'user_history_cold_segment.cc',
+        'user_history_key_index.cc',
         'user_history_predictor.cc',
       ],
       'dependencies': [
@@ -39,6 +39,8 @@
       'sources': [
         'dictionary_predictor_test.cc',
         'number_decoder_test.cc',
+        'user_history_cold_segment_test.cc',
+        'user_history_key_index_test.cc',
         'user_history_predictor_test.cc',
         'predictor_test.cc',
         'zero_query_dict_test.cc',
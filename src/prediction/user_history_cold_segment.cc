@@ -0,0 +1,462 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/user_history_cold_segment.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/encryptor.h"
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+#include "base/password_manager.h"
+#include "base/util.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+constexpr char kMagic[] = "UHCS";
+// Version 1 stored the keys in plain text.
+constexpr uint32_t kVersion = 2;
+constexpr size_t kSaltSize = 32;
+// [number of records][offset of index][salt][version][magic]
+constexpr size_t kTrailerSize = 4 + 4 + kSaltSize + 4 + 4;
+
+uint32_t ReadUint32(const char *ptr) {
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+void WriteUint32(uint32_t value, OutputFileStream *ofs) {
+  ofs->write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// Same as UserHistoryPredictor::EntryFingerprint().
+uint32_t EntryFingerprint(const UserHistoryColdSegment::Entry &entry) {
+  return Hash::Fingerprint32(entry.key() + "\t" + entry.value());
+}
+
+std::unique_ptr<Encryptor::Key> DeriveKey(const std::string &salt) {
+  std::string password;
+  if (!PasswordManager::GetPassword(&password) || password.empty()) {
+    LOG(ERROR) << "PasswordManager::GetPassword() failed";
+    return nullptr;
+  }
+  auto key = std::make_unique<Encryptor::Key>();
+  if (!key->DeriveFromPassword(password, salt)) {
+    LOG(ERROR) << "Encryptor::Key::DeriveFromPassword() failed";
+    return nullptr;
+  }
+  return key;
+}
+
+}  // namespace
+
+UserHistoryColdSegment::UserHistoryColdSegment(std::string filename)
+    : filename_(std::move(filename)) {}
+
+UserHistoryColdSegment::~UserHistoryColdSegment() = default;
+
+bool UserHistoryColdSegment::Open() {
+  absl::MutexLock l(&mutex_);
+  return OpenLocked();
+}
+
+bool UserHistoryColdSegment::OpenLocked() {
+  CloseLocked();
+  if (!FileUtil::FileExists(filename_).ok()) {
+    VLOG(1) << "No cold segment: " << filename_;
+    return false;
+  }
+  if (!mmap_.Open(filename_.c_str(), "r")) {
+    LOG(ERROR) << "Cannot open the cold segment: " << filename_;
+    return false;
+  }
+  if (mmap_.size() < kTrailerSize) {
+    LOG(ERROR) << "The cold segment is too small: " << mmap_.size();
+    CloseLocked();
+    return false;
+  }
+  const char *trailer = mmap_.begin() + mmap_.size() - kTrailerSize;
+  const uint32_t size = ReadUint32(trailer);
+  const uint32_t index_offset = ReadUint32(trailer + 4);
+  const std::string salt(trailer + 8, kSaltSize);
+  const uint32_t version = ReadUint32(trailer + 8 + kSaltSize);
+  if (memcmp(trailer + 12 + kSaltSize, kMagic, 4) == 0 &&
+      version != kVersion) {
+    // Removes the segment of the old version, which has the keys in plain
+    // text.  The entries are lost; they are rarely used anyway.
+    LOG(WARNING) << "Removing the cold segment of version " << version;
+    CloseLocked();
+    if (absl::Status s = FileUtil::UnlinkIfExists(filename_); !s.ok()) {
+      LOG(ERROR) << "Cannot remove the cold segment: " << s;
+    }
+    return false;
+  }
+  if (memcmp(trailer + 12 + kSaltSize, kMagic, 4) != 0 ||
+      static_cast<uint64_t>(index_offset) + static_cast<uint64_t>(size) * 4 +
+              kTrailerSize !=
+          mmap_.size()) {
+    LOG(ERROR) << "The cold segment is broken: " << filename_;
+    CloseLocked();
+    return false;
+  }
+  key_ = DeriveKey(salt);
+  if (key_ == nullptr) {
+    CloseLocked();
+    return false;
+  }
+  size_ = size;
+  index_ = mmap_.begin() + index_offset;
+  VLOG(1) << "Opened the cold segment, size=" << size_;
+  return true;
+}
+
+void UserHistoryColdSegment::Close() {
+  absl::MutexLock l(&mutex_);
+  CloseLocked();
+}
+
+void UserHistoryColdSegment::CloseLocked() {
+  mmap_.Close();
+  size_ = 0;
+  index_ = nullptr;
+  key_.reset();
+}
+
+void UserHistoryColdSegment::Clear() {
+  absl::MutexLock l(&mutex_);
+  CloseLocked();
+  if (absl::Status s = FileUtil::UnlinkIfExists(filename_); !s.ok()) {
+    LOG(ERROR) << "Cannot remove the cold segment: " << s;
+  }
+}
+
+UserHistoryColdSegment::Record UserHistoryColdSegment::GetRecord(
+    size_t i) const {
+  DCHECK_LT(i, size_);
+  // The data before the index are the records.
+  const size_t limit = index_ - mmap_.begin();
+  const size_t offset = ReadUint32(index_ + i * 4);
+  if (offset + 4 > limit) {
+    return Record();
+  }
+  const size_t key_size = ReadUint32(mmap_.begin() + offset);
+  if (offset + 4 + key_size + 4 > limit) {
+    return Record();
+  }
+  const char *key = mmap_.begin() + offset + 4;
+  const size_t payload_size = ReadUint32(key + key_size);
+  if (offset + 8 + key_size + payload_size > limit) {
+    return Record();
+  }
+  Record record;
+  record.key.assign(key, key_size);
+  if (record.key.empty() || !Encryptor::DecryptString(*key_, &record.key)) {
+    LOG(ERROR) << "Broken key in the cold segment";
+    return Record();
+  }
+  record.payload = absl::string_view(key + key_size + 4, payload_size);
+  return record;
+}
+
+bool UserHistoryColdSegment::Decode(const Record &record, Entry *entry) const {
+  if (record.payload.empty()) {
+    return false;
+  }
+  std::string data(record.payload);
+  if (!Encryptor::DecryptString(*key_, &data) ||
+      !entry->ParseFromString(data)) {
+    LOG(ERROR) << "Broken entry in the cold segment";
+    return false;
+  }
+  return true;
+}
+
+size_t UserHistoryColdSegment::LowerBound(absl::string_view key) const {
+  size_t lo = 0, hi = size_;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (GetRecord(mid).key < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void UserHistoryColdSegment::LookupPredictive(
+    absl::string_view prefix, size_t max_size,
+    std::vector<Entry> *entries) const {
+  absl::ReaderMutexLock l(&mutex_);
+  size_t num_found = 0;
+  for (size_t i = LowerBound(prefix); i < size_ && num_found < max_size; ++i) {
+    const Record record = GetRecord(i);
+    if (!absl::StartsWith(record.key, prefix)) {
+      break;
+    }
+    Entry entry;
+    if (Decode(record, &entry)) {
+      entries->push_back(std::move(entry));
+      ++num_found;
+    }
+  }
+}
+
+void UserHistoryColdSegment::LookupPrefix(absl::string_view key,
+                                          std::vector<Entry> *entries) const {
+  absl::ReaderMutexLock l(&mutex_);
+  for (size_t len = 1; len <= key.size(); ++len) {
+    const absl::string_view prefix = key.substr(0, len);
+    for (size_t i = LowerBound(prefix); i < size_; ++i) {
+      const Record record = GetRecord(i);
+      if (record.key != prefix) {
+        break;
+      }
+      Entry entry;
+      if (Decode(record, &entry)) {
+        entries->push_back(std::move(entry));
+      }
+    }
+  }
+}
+
+bool UserHistoryColdSegment::LookupEntry(absl::string_view key,
+                                         absl::string_view value,
+                                         Entry *entry) const {
+  absl::ReaderMutexLock l(&mutex_);
+  for (size_t i = LowerBound(key); i < size_; ++i) {
+    const Record record = GetRecord(i);
+    if (record.key != key) {
+      break;
+    }
+    if (Decode(record, entry) && entry->value() == value) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool UserHistoryColdSegment::WriteCompacted(
+    std::vector<Entry> added,
+    const std::function<bool(uint32_t fp)> &is_dropped, size_t max_size,
+    uint64_t min_access_time, const std::string &filename) const {
+  auto keep = [&](const Entry &entry, uint32_t fp) {
+    return entry.entry_type() == Entry::DEFAULT_ENTRY && !entry.removed() &&
+           !entry.key().empty() &&
+           entry.last_access_time() >= min_access_time && !is_dropped(fp);
+  };
+
+  // Keeps the last one for the duplicated entries in |added|.  Entries in
+  // |added| shadow the current ones even when they are dropped, e.g., the
+  // entries removed by the user.
+  absl::flat_hash_set<uint32_t> added_fps;
+  {
+    absl::flat_hash_map<uint32_t, size_t> last_pos;
+    for (size_t i = 0; i < added.size(); ++i) {
+      last_pos[EntryFingerprint(added[i])] = i;
+    }
+    std::vector<Entry> unique_added;
+    for (size_t i = 0; i < added.size(); ++i) {
+      const uint32_t fp = EntryFingerprint(added[i]);
+      if (last_pos[fp] != i) {
+        continue;
+      }
+      added_fps.insert(fp);
+      if (keep(added[i], fp)) {
+        unique_added.push_back(std::move(added[i]));
+      }
+    }
+    added.swap(unique_added);
+  }
+  std::sort(added.begin(), added.end(), [](const Entry &lhs, const Entry &rhs) {
+    return lhs.key() < rhs.key();
+  });
+
+  auto keep_current = [&](const Entry &entry) {
+    const uint32_t fp = EntryFingerprint(entry);
+    return !added_fps.contains(fp) && keep(entry, fp);
+  };
+
+  // The first pass finds the access time of the oldest entry to keep.
+  std::vector<uint64_t> access_times;
+  for (const Entry &entry : added) {
+    access_times.push_back(entry.last_access_time());
+  }
+  for (size_t i = 0; i < size_; ++i) {
+    Entry entry;
+    if (Decode(GetRecord(i), &entry) && keep_current(entry)) {
+      access_times.push_back(entry.last_access_time());
+    }
+  }
+  uint64_t min_time = 0;
+  // Number of entries to keep whose access time is |min_time|.
+  size_t num_min_time = access_times.size();
+  if (access_times.size() > max_size) {
+    auto nth = access_times.end() - max_size;
+    std::nth_element(access_times.begin(), nth, access_times.end());
+    min_time = *nth;
+    num_min_time = max_size - std::count_if(nth, access_times.end(),
+                                            [min_time](uint64_t t) {
+                                              return t > min_time;
+                                            });
+  }
+  std::vector<uint64_t>().swap(access_times);
+  auto within_capacity = [&](const Entry &entry) {
+    if (entry.last_access_time() > min_time) {
+      return true;
+    }
+    if (entry.last_access_time() == min_time && num_min_time > 0) {
+      --num_min_time;
+      return true;
+    }
+    return false;
+  };
+
+  std::string salt(kSaltSize, '\0');
+  Util::GetRandomSequence(&salt[0], kSaltSize);
+  std::unique_ptr<Encryptor::Key> key = DeriveKey(salt);
+  if (key == nullptr) {
+    return false;
+  }
+
+  // The second pass merges the current entries and |added| in the key order.
+  OutputFileStream ofs(filename, std::ios::out | std::ios::binary);
+  if (!ofs) {
+    LOG(ERROR) << "failed to write: " << filename;
+    return false;
+  }
+  std::vector<uint32_t> offsets;
+  uint64_t offset = 0;
+  auto write = [&](const Entry &entry) {
+    if (!within_capacity(entry)) {
+      return;
+    }
+    std::string encrypted_key = entry.key();
+    std::string payload;
+    entry.SerializeToString(&payload);
+    if (!Encryptor::EncryptString(*key, &encrypted_key) ||
+        !Encryptor::EncryptString(*key, &payload)) {
+      LOG(ERROR) << "Encryptor::EncryptString() failed";
+      return;
+    }
+    offsets.push_back(static_cast<uint32_t>(offset));
+    WriteUint32(encrypted_key.size(), &ofs);
+    ofs.write(encrypted_key.data(), encrypted_key.size());
+    WriteUint32(payload.size(), &ofs);
+    ofs.write(payload.data(), payload.size());
+    offset += 8 + encrypted_key.size() + payload.size();
+  };
+
+  auto added_iter = added.begin();
+  for (size_t i = 0; i < size_; ++i) {
+    Entry entry;
+    if (!Decode(GetRecord(i), &entry) || !keep_current(entry)) {
+      continue;
+    }
+    for (; added_iter != added.end() && added_iter->key() < entry.key();
+         ++added_iter) {
+      write(*added_iter);
+    }
+    write(entry);
+  }
+  for (; added_iter != added.end(); ++added_iter) {
+    write(*added_iter);
+  }
+
+  if (offset > UINT32_MAX) {
+    LOG(ERROR) << "The cold segment is too large: " << offset;
+    return false;
+  }
+  for (const uint32_t record_offset : offsets) {
+    WriteUint32(record_offset, &ofs);
+  }
+  WriteUint32(offsets.size(), &ofs);
+  WriteUint32(static_cast<uint32_t>(offset), &ofs);
+  ofs.write(salt.data(), salt.size());
+  WriteUint32(kVersion, &ofs);
+  ofs.write(kMagic, 4);
+  if (!ofs) {
+    LOG(ERROR) << "failed to write: " << filename;
+    return false;
+  }
+  return true;
+}
+
+bool UserHistoryColdSegment::Compact(
+    std::vector<Entry> added,
+    const std::function<bool(uint32_t fp)> &is_dropped, size_t max_size,
+    uint64_t min_access_time) {
+  // The lookups can go on while the new file is written.
+  const std::string tmp_filename = filename_ + ".tmp";
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    if (!WriteCompacted(std::move(added), is_dropped, max_size,
+                        min_access_time, tmp_filename)) {
+      return false;
+    }
+  }
+
+  absl::MutexLock l(&mutex_);
+  // The current file has to be unmapped before renamed over on Windows.
+  CloseLocked();
+  if (absl::Status s = FileUtil::AtomicRename(tmp_filename, filename_);
+      !s.ok()) {
+    LOG(ERROR) << "AtomicRename failed: " << s << "; from: " << tmp_filename
+               << ", to: " << filename_;
+    OpenLocked();
+    return false;
+  }
+#ifdef OS_WIN
+  if (!FileUtil::HideFile(filename_)) {
+    LOG(ERROR) << "Cannot make hidden: " << filename_;
+  }
+#endif  // OS_WIN
+  return OpenLocked();
+}
+
+}  // namespace mozc
@@ -0,0 +1,147 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_PREDICTION_USER_HISTORY_COLD_SEGMENT_H_
+#define MOZC_PREDICTION_USER_HISTORY_COLD_SEGMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/encryptor.h"
+#include "base/mmap.h"
+#include "prediction/user_history_predictor.pb.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mozc {
+
+// Read-only on-disk storage for the user history entries evicted from the
+// in-memory LRU of UserHistoryPredictor.
+//
+// The entries are sorted by key and the file is mmapped, so that prefix
+// lookups don't need to load the whole segment into memory.  Both the keys
+// and the entries are encrypted with the same password as the user history
+// file.  The binary search decrypts only the keys it visits.
+//
+// The segment is immutable once written.  Compact() rewrites the whole file
+// by merging the current entries with new ones.
+//
+// Thread safety: the lookups may run concurrently with each other and with
+// Compact(), which blocks them only while it swaps the file.  Open(), Close(),
+// Clear() and Compact() must not run concurrently with each other.
+//
+// File layout (integers are little endian uint32):
+//   records: ([key length][encrypted key][entry length][encrypted entry])*
+//   index:   [offset of record]*  (in the key order)
+//   trailer: [number of records][offset of index][salt][version][magic]
+class UserHistoryColdSegment {
+ public:
+  using Entry = user_history_predictor::UserHistory::Entry;
+
+  explicit UserHistoryColdSegment(std::string filename);
+  UserHistoryColdSegment(const UserHistoryColdSegment &) = delete;
+  UserHistoryColdSegment &operator=(const UserHistoryColdSegment &) = delete;
+  ~UserHistoryColdSegment();
+
+  // Opens the segment file.  Returns false if the file doesn't exist or is
+  // broken; the segment is empty in that case.
+  bool Open();
+  void Close();
+
+  // Closes and removes the segment file.
+  void Clear();
+
+  size_t size() const {
+    absl::ReaderMutexLock l(&mutex_);
+    return size_;
+  }
+  const std::string &filename() const { return filename_; }
+
+  // Appends at most |max_size| entries whose key starts with |prefix|.
+  void LookupPredictive(absl::string_view prefix, size_t max_size,
+                        std::vector<Entry> *entries) const;
+
+  // Appends the entries whose key is a prefix of |key|, including |key|
+  // itself.
+  void LookupPrefix(absl::string_view key, std::vector<Entry> *entries) const;
+
+  // Finds the entry for (|key|, |value|).
+  bool LookupEntry(absl::string_view key, absl::string_view value,
+                   Entry *entry) const;
+
+  // Rewrites the segment with the current entries and |added|.  Entries in
+  // |added| replace the current entries with the same fingerprint.  Drops the
+  // entries for which |is_dropped| returns true, removed entries and entries
+  // last accessed before |min_access_time|.  When more than |max_size|
+  // entries remain, the least recently accessed ones are dropped.
+  bool Compact(std::vector<Entry> added,
+               const std::function<bool(uint32_t fp)> &is_dropped,
+               size_t max_size, uint64_t min_access_time);
+
+ private:
+  struct Record {
+    // Decrypted key.  Empty if the record is broken.
+    std::string key;
+    absl::string_view payload;
+  };
+
+  // Returns the |i|-th record with its key decrypted.
+  Record GetRecord(size_t i) const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  bool Decode(const Record &record, Entry *entry) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  // Returns the first index whose key is not less than |key|.
+  size_t LowerBound(absl::string_view key) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  // Writes the result of Compact() to |filename|.
+  bool WriteCompacted(std::vector<Entry> added,
+                      const std::function<bool(uint32_t fp)> &is_dropped,
+                      size_t max_size, uint64_t min_access_time,
+                      const std::string &filename) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  bool OpenLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CloseLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::string filename_;
+  // Guards the opened segment below.
+  mutable absl::Mutex mutex_;
+  Mmap mmap_ ABSL_GUARDED_BY(mutex_);
+  size_t size_ ABSL_GUARDED_BY(mutex_) = 0;
+  const char *index_ ABSL_GUARDED_BY(mutex_) = nullptr;
+  // Key to decrypt the entries of the opened segment.
+  std::unique_ptr<Encryptor::Key> key_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_PREDICTION_USER_HISTORY_COLD_SEGMENT_H_
@@ -0,0 +1,241 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/user_history_cold_segment.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/system_util.h"
+#include "base/thread.h"
+#include "prediction/user_history_predictor.pb.h"
+#include "testing/base/public/gmock.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+#include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+using Entry = UserHistoryColdSegment::Entry;
+
+Entry MakeEntry(absl::string_view key, absl::string_view value,
+                uint64_t last_access_time) {
+  Entry entry;
+  entry.set_key(std::string(key));
+  entry.set_value(std::string(value));
+  entry.set_last_access_time(last_access_time);
+  return entry;
+}
+
+std::vector<std::string> GetValues(const std::vector<Entry> &entries) {
+  std::vector<std::string> values;
+  for (const Entry &entry : entries) {
+    values.push_back(entry.value());
+  }
+  return values;
+}
+
+bool DropNothing(uint32_t fp) { return false; }
+
+// Looks up the segment until stopped.
+class LookupThread : public Thread {
+ public:
+  explicit LookupThread(const UserHistoryColdSegment *segment)
+      : segment_(segment) {}
+
+  void Run() override {
+    while (!done_) {
+      std::vector<Entry> entries;
+      segment_->LookupPredictive("か", 10, &entries);
+      // The entry is in both the old and the new segment.
+      EXPECT_THAT(GetValues(entries), ::testing::Contains("釜"));
+    }
+  }
+
+  void Stop() {
+    done_ = true;
+    Join();
+  }
+
+ private:
+  const UserHistoryColdSegment *segment_;
+  std::atomic<bool> done_ = false;
+};
+
+class UserHistoryColdSegmentTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    SystemUtil::SetUserProfileDirectory(absl::GetFlag(FLAGS_test_tmpdir));
+    filename_ = FileUtil::JoinPath(absl::GetFlag(FLAGS_test_tmpdir),
+                                   "user_history_cold_segment_test.db");
+    ASSERT_OK(FileUtil::UnlinkIfExists(filename_));
+  }
+
+  void TearDown() override { EXPECT_OK(FileUtil::UnlinkIfExists(filename_)); }
+
+  std::string filename_;
+};
+
+TEST_F(UserHistoryColdSegmentTest, CompactAndLookup) {
+  UserHistoryColdSegment segment(filename_);
+  EXPECT_FALSE(segment.Open());
+  EXPECT_EQ(0, segment.size());
+
+  ASSERT_TRUE(segment.Compact({MakeEntry("かまた", "蒲田", 10),
+                               MakeEntry("かま", "釜", 20),
+                               MakeEntry("かま", "鎌", 30),
+                               MakeEntry("きた", "北", 40)},
+                              DropNothing, 100, 0));
+  EXPECT_EQ(4, segment.size());
+
+  std::vector<Entry> entries;
+  segment.LookupPredictive("かま", 10, &entries);
+  EXPECT_THAT(GetValues(entries),
+              ::testing::UnorderedElementsAre("蒲田", "釜", "鎌"));
+
+  entries.clear();
+  segment.LookupPredictive("か", 1, &entries);
+  EXPECT_EQ(1, entries.size());
+
+  entries.clear();
+  segment.LookupPrefix("かまたろう", &entries);
+  EXPECT_THAT(GetValues(entries),
+              ::testing::UnorderedElementsAre("蒲田", "釜", "鎌"));
+
+  Entry entry;
+  ASSERT_TRUE(segment.LookupEntry("きた", "北", &entry));
+  EXPECT_EQ(40, entry.last_access_time());
+  EXPECT_FALSE(segment.LookupEntry("きた", "喜多", &entry));
+
+  // The segment survives reopening.
+  UserHistoryColdSegment reopened(filename_);
+  ASSERT_TRUE(reopened.Open());
+  EXPECT_EQ(4, reopened.size());
+  EXPECT_TRUE(reopened.LookupEntry("かまた", "蒲田", &entry));
+  EXPECT_EQ("かまた", entry.key());
+}
+
+TEST_F(UserHistoryColdSegmentTest, KeysAreEncrypted) {
+  UserHistoryColdSegment segment(filename_);
+  ASSERT_TRUE(segment.Compact({MakeEntry("ひみつのよみ", "秘密", 10)},
+                              DropNothing, 100, 0));
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(filename_);
+  ASSERT_OK(contents);
+  EXPECT_EQ(std::string::npos, contents->find("ひみつのよみ"));
+  EXPECT_EQ(std::string::npos, contents->find("秘密"));
+
+  std::vector<Entry> entries;
+  segment.LookupPredictive("ひみつ", 10, &entries);
+  EXPECT_THAT(GetValues(entries), ::testing::ElementsAre("秘密"));
+}
+
+TEST_F(UserHistoryColdSegmentTest, LookupDuringCompact) {
+  UserHistoryColdSegment segment(filename_);
+  ASSERT_TRUE(segment.Compact({MakeEntry("かま", "釜", 10)}, DropNothing, 100,
+                              0));
+
+  LookupThread lookup(&segment);
+  lookup.SetJoinable(true);
+  lookup.Start("LookupDuringCompact");
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_TRUE(segment.Compact({MakeEntry("かも", "鴨", 20 + i)}, DropNothing,
+                                100, 0));
+  }
+  lookup.Stop();
+  EXPECT_EQ(2, segment.size());
+}
+
+TEST_F(UserHistoryColdSegmentTest, CompactMergesAndDrops) {
+  UserHistoryColdSegment segment(filename_);
+  ASSERT_TRUE(segment.Compact(
+      {MakeEntry("あ", "亜", 10), MakeEntry("い", "伊", 20),
+       MakeEntry("う", "宇", 30), MakeEntry("え", "絵", 1)},
+      DropNothing, 100, 5));
+  // "絵" is older than |min_access_time|.
+  EXPECT_EQ(3, segment.size());
+
+  Entry removed = MakeEntry("う", "宇", 40);
+  removed.set_removed(true);
+  Entry updated = MakeEntry("あ", "亜", 50);
+  updated.set_suggestion_freq(3);
+  ASSERT_TRUE(segment.Compact({removed, updated, MakeEntry("", "空", 60)},
+                              DropNothing, 100, 5));
+  EXPECT_EQ(2, segment.size());
+
+  Entry entry;
+  EXPECT_FALSE(segment.LookupEntry("う", "宇", &entry));
+  ASSERT_TRUE(segment.LookupEntry("あ", "亜", &entry));
+  EXPECT_EQ(50, entry.last_access_time());
+  EXPECT_EQ(3, entry.suggestion_freq());
+
+  // Drops the entries rejected by the callback.
+  ASSERT_TRUE(segment.Compact(
+      {}, [](uint32_t fp) { return true; }, 100, 0));
+  EXPECT_EQ(0, segment.size());
+}
+
+TEST_F(UserHistoryColdSegmentTest, CompactKeepsRecentEntries) {
+  UserHistoryColdSegment segment(filename_);
+  std::vector<Entry> added;
+  for (int i = 0; i < 10; ++i) {
+    added.push_back(MakeEntry("かぎ" + std::to_string(i),
+                              "鍵" + std::to_string(i), 100 + i));
+  }
+  ASSERT_TRUE(segment.Compact(added, DropNothing, 3, 0));
+  EXPECT_EQ(3, segment.size());
+
+  std::vector<Entry> entries;
+  segment.LookupPredictive("かぎ", 10, &entries);
+  EXPECT_THAT(GetValues(entries),
+              ::testing::UnorderedElementsAre("鍵7", "鍵8", "鍵9"));
+}
+
+TEST_F(UserHistoryColdSegmentTest, Clear) {
+  UserHistoryColdSegment segment(filename_);
+  ASSERT_TRUE(segment.Compact({MakeEntry("あ", "亜", 10)}, DropNothing, 100,
+                              0));
+  EXPECT_TRUE(FileUtil::FileExists(filename_).ok());
+
+  segment.Clear();
+  EXPECT_EQ(0, segment.size());
+  EXPECT_FALSE(FileUtil::FileExists(filename_).ok());
+  std::vector<Entry> entries;
+  segment.LookupPredictive("", 10, &entries);
+  EXPECT_TRUE(entries.empty());
+}
+
+}  // namespace
+}  // namespace mozc
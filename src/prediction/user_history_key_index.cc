@@ -0,0 +1,166 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/user_history_key_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/japanese_util.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+void UserHistoryKeyIndex::Add(uint32_t fp, absl::string_view key) {
+  if (key.empty()) {
+    Remove(fp);
+    return;
+  }
+
+  auto [iter, inserted] = items_.try_emplace(fp);
+  Item &item = iter->second;
+  item.seq = ++next_seq_;
+  if (!inserted) {
+    if (item.key == key) {
+      return;
+    }
+    // Fingerprint collision of a different key; reindex it.
+    keys_.erase({item.key, fp});
+    romans_.erase({item.roman, fp});
+    if (!item.roman.empty()) {
+      roman_tails_.erase({item.roman.substr(1), fp});
+    }
+  }
+
+  item.key.assign(key.data(), key.size());
+  item.roman.clear();
+  japanese_util::HiraganaToRomanji(key, &item.roman);
+  keys_.emplace(item.key, fp);
+  romans_.emplace(item.roman, fp);
+  if (!item.roman.empty()) {
+    roman_tails_.emplace(item.roman.substr(1), fp);
+  }
+}
+
+void UserHistoryKeyIndex::Remove(uint32_t fp) {
+  const auto iter = items_.find(fp);
+  if (iter == items_.end()) {
+    return;
+  }
+  const Item &item = iter->second;
+  keys_.erase({item.key, fp});
+  romans_.erase({item.roman, fp});
+  if (!item.roman.empty()) {
+    roman_tails_.erase({item.roman.substr(1), fp});
+  }
+  items_.erase(iter);
+}
+
+void UserHistoryKeyIndex::Clear() {
+  items_.clear();
+  keys_.clear();
+  romans_.clear();
+  roman_tails_.clear();
+  next_seq_ = 0;
+}
+
+// static
+void UserHistoryKeyIndex::LookupPredictiveInternal(const KeySet &key_set,
+                                                   absl::string_view prefix,
+                                                   std::vector<uint32_t> *fps) {
+  for (auto iter = key_set.lower_bound({std::string(prefix), 0});
+       iter != key_set.end() && absl::StartsWith(iter->first, prefix);
+       ++iter) {
+    fps->push_back(iter->second);
+  }
+}
+
+void UserHistoryKeyIndex::LookupPredictive(absl::string_view prefix,
+                                           std::vector<uint32_t> *fps) const {
+  LookupPredictiveInternal(keys_, prefix, fps);
+}
+
+void UserHistoryKeyIndex::LookupPrefix(absl::string_view key,
+                                       std::vector<uint32_t> *fps) const {
+  std::string prefix;
+  prefix.reserve(key.size());
+  for (const char c : key) {
+    prefix.push_back(c);
+    for (auto iter = keys_.lower_bound({prefix, 0});
+         iter != keys_.end() && iter->first == prefix; ++iter) {
+      fps->push_back(iter->second);
+    }
+  }
+}
+
+void UserHistoryKeyIndex::LookupRomanFuzzyCandidates(
+    absl::string_view roman_prefix, std::vector<uint32_t> *fps) const {
+  if (roman_prefix.empty()) {
+    return;
+  }
+  // The first mismatch is not at the first character.
+  LookupPredictiveInternal(romans_, roman_prefix.substr(0, 1), fps);
+  // The first two characters are swapped.
+  if (roman_prefix.size() > 1) {
+    LookupPredictiveInternal(romans_, roman_prefix.substr(1, 1), fps);
+  }
+  // The first character is matched to the voice sound mark.
+  if (!isalnum(static_cast<unsigned char>(roman_prefix[0]))) {
+    LookupPredictiveInternal(romans_, "-", fps);
+  }
+  // The first character is deleted.
+  LookupPredictiveInternal(roman_tails_, roman_prefix, fps);
+}
+
+void UserHistoryKeyIndex::SortByRecency(std::vector<uint32_t> *fps) const {
+  std::vector<std::pair<uint64_t, uint32_t>> sorted;
+  sorted.reserve(fps->size());
+  absl::flat_hash_set<uint32_t> seen;
+  for (const uint32_t fp : *fps) {
+    const auto iter = items_.find(fp);
+    if (iter == items_.end() || !seen.insert(fp).second) {
+      continue;
+    }
+    sorted.emplace_back(iter->second.seq, fp);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs > rhs; });
+  fps->clear();
+  for (const auto &[unused_seq, fp] : sorted) {
+    fps->push_back(fp);
+  }
+}
+
+}  // namespace mozc
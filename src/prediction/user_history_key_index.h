@@ -0,0 +1,121 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_PREDICTION_USER_HISTORY_KEY_INDEX_H_
+#define MOZC_PREDICTION_USER_HISTORY_KEY_INDEX_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+// Secondary index over the keys of user history entries.
+//
+// UserHistoryPredictor stores its entries in an LRU cache keyed by the
+// fingerprint of (key, value), so finding the entries matching the current
+// input used to require a walk over the whole LRU list.  This class keeps the
+// entry keys (and their romanized forms) in sorted order so that prefix
+// queries only enumerate the matching entries.  It also remembers the LRU
+// order of the indexed entries so that the caller can visit the matches from
+// the most recent one, as the linear walk did.
+//
+// The index only holds fingerprints; callers are expected to look up the
+// actual entries from the LRU cache.
+class UserHistoryKeyIndex {
+ public:
+  UserHistoryKeyIndex() = default;
+  UserHistoryKeyIndex(const UserHistoryKeyIndex &) = delete;
+  UserHistoryKeyIndex &operator=(const UserHistoryKeyIndex &) = delete;
+  ~UserHistoryKeyIndex() = default;
+
+  // Adds the entry |fp| with |key|, or updates it if already exists.  The
+  // entry becomes the most recent one.  Entries with empty key are not
+  // indexed.
+  void Add(uint32_t fp, absl::string_view key);
+
+  // Removes the entry |fp|.  Does nothing if |fp| is not indexed.
+  void Remove(uint32_t fp);
+
+  void Clear();
+
+  size_t size() const { return items_.size(); }
+
+  // Appends the entries whose key starts with |prefix|.
+  void LookupPredictive(absl::string_view prefix,
+                        std::vector<uint32_t> *fps) const;
+
+  // Appends the entries whose key is a prefix of |key|, including |key|
+  // itself.
+  void LookupPrefix(absl::string_view key, std::vector<uint32_t> *fps) const;
+
+  // Appends the entries whose romanized key may fuzzily match |roman_prefix|
+  // with UserHistoryPredictor::RomanFuzzyPrefixMatch(), i.e., one deletion or
+  // one swap of characters in the prefix.  The result is a superset of the
+  // actual matches; callers still need to verify them.
+  void LookupRomanFuzzyCandidates(absl::string_view roman_prefix,
+                                  std::vector<uint32_t> *fps) const;
+
+  // Removes duplicates from |fps| and sorts them from the most recent entry.
+  // Fingerprints that are not indexed are removed.
+  void SortByRecency(std::vector<uint32_t> *fps) const;
+
+ private:
+  using KeySet = std::set<std::pair<std::string, uint32_t>>;
+
+  struct Item {
+    std::string key;
+    std::string roman;
+    uint64_t seq = 0;
+  };
+
+  static void LookupPredictiveInternal(const KeySet &key_set,
+                                       absl::string_view prefix,
+                                       std::vector<uint32_t> *fps);
+
+  absl::flat_hash_map<uint32_t, Item> items_;
+  // (key, fp) pairs sorted by key.
+  KeySet keys_;
+  // (romanized key, fp) pairs sorted by the romanized key.
+  KeySet romans_;
+  // Same as |romans_| but the first character is dropped, so that prefix
+  // queries can also find romanized keys having one extra leading character.
+  KeySet roman_tails_;
+  // Monotonically increasing counter to remember the LRU order.
+  uint64_t next_seq_ = 0;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_PREDICTION_USER_HISTORY_KEY_INDEX_H_
@@ -0,0 +1,141 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "prediction/user_history_key_index.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "testing/base/public/gmock.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+TEST(UserHistoryKeyIndexTest, LookupPredictive) {
+  UserHistoryKeyIndex index;
+  index.Add(1, "かまた");
+  index.Add(2, "かま");
+  index.Add(3, "きた");
+  index.Add(4, "か");
+  EXPECT_EQ(4, index.size());
+
+  std::vector<uint32_t> fps;
+  index.LookupPredictive("かま", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(1, 2));
+
+  fps.clear();
+  index.LookupPredictive("か", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(1, 2, 4));
+
+  fps.clear();
+  index.LookupPredictive("く", &fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+TEST(UserHistoryKeyIndexTest, LookupPrefix) {
+  UserHistoryKeyIndex index;
+  index.Add(1, "かまた");
+  index.Add(2, "かま");
+  index.Add(3, "きた");
+  index.Add(4, "か");
+
+  std::vector<uint32_t> fps;
+  index.LookupPrefix("かまたろう", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(1, 2, 4));
+
+  fps.clear();
+  index.LookupPrefix("かま", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(2, 4));
+}
+
+TEST(UserHistoryKeyIndexTest, Remove) {
+  UserHistoryKeyIndex index;
+  index.Add(1, "かまた");
+  index.Add(2, "かま");
+  index.Remove(1);
+  index.Remove(100);  // Not indexed.
+  EXPECT_EQ(1, index.size());
+
+  std::vector<uint32_t> fps;
+  index.LookupPredictive("かま", &fps);
+  EXPECT_THAT(fps, ElementsAre(2));
+
+  // Entries with empty key are not indexed.
+  index.Add(2, "");
+  EXPECT_EQ(0, index.size());
+
+  index.Add(3, "かま");
+  index.Clear();
+  EXPECT_EQ(0, index.size());
+  fps.clear();
+  index.LookupPredictive("", &fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+TEST(UserHistoryKeyIndexTest, SortByRecency) {
+  UserHistoryKeyIndex index;
+  index.Add(1, "あ");
+  index.Add(2, "い");
+  index.Add(3, "う");
+  index.Add(1, "あ");  // 1 becomes the most recent.
+
+  std::vector<uint32_t> fps = {2, 3, 1, 2, 100};
+  index.SortByRecency(&fps);
+  EXPECT_THAT(fps, ElementsAre(1, 3, 2));
+}
+
+TEST(UserHistoryKeyIndexTest, LookupRomanFuzzyCandidates) {
+  UserHistoryKeyIndex index;
+  index.Add(1, "かまた");    // "kamata"
+  index.Add(2, "あまた");    // "amata"
+  index.Add(3, "ぱんだ");    // "panda"
+  index.Add(4, "いんたー");  // "inta-"
+
+  std::vector<uint32_t> fps;
+  // Deletion of the first character.
+  index.LookupRomanFuzzyCandidates("amat", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(1, 2));
+
+  // Swap of the first two characters.
+  fps.clear();
+  index.LookupRomanFuzzyCandidates("apnda", &fps);
+  EXPECT_THAT(fps, UnorderedElementsAre(2, 3));
+
+  fps.clear();
+  index.LookupRomanFuzzyCandidates("", &fps);
+  EXPECT_THAT(fps, IsEmpty());
+}
+
+}  // namespace
+}  // namespace mozc
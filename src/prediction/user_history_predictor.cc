@@ -42,10 +42,10 @@
 
 #include "base/clock.h"
 #include "base/config_file_stream.h"
+#include "base/executor.h"
 #include "base/hash.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
-#include "base/thread.h"
 #include "base/trie.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -54,6 +54,7 @@
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/predictor_interface.h"
+#include "prediction/user_history_key_index.h"
 #include "prediction/user_history_predictor.pb.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -66,6 +67,7 @@
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 namespace {
@@ -76,8 +78,10 @@ using dictionary::PosMatcher;
 using dictionary::SuppressionDictionary;
 using usage_stats::UsageStats;
 
-// Finds suggestion candidates from the most recent 3000 history in LRU.
-// We don't check all history, since suggestion is called every key event
+// Finds suggestion candidates from the most recent 3000 histories in LRU
+// whose keys match the input.  The key index skips the histories that do not
+// match, so they are not counted.  We don't check all the matching histories,
+// since suggestion is called every key event.
 constexpr size_t kMaxSuggestionTrial = 3000;
 
 // Finds suffix matches of history_segments from the most recent 500 histories
@@ -92,6 +96,24 @@ constexpr size_t kLruCacheSize = 4000;
 constexpr size_t kLruCacheSize = 10000;
 #endif  // OS_ANDROID
 
+// Maximum number of the entries in the cold segment.  The cold segment is
+// mmapped and only the matching entries are decoded, so it doesn't affect
+// the memory footprint as much as kLruCacheSize.
+#ifdef OS_ANDROID
+constexpr size_t kColdSegmentSize = 50000;
+#else   // OS_ANDROID
+constexpr size_t kColdSegmentSize = 200000;
+#endif  // OS_ANDROID
+
+// Rewriting the cold segment costs time proportional to its size, so the
+// evicted entries are merged into it only when this many of them are pending.
+// Until then they are saved with the hot entries in the history file.
+constexpr size_t kMinColdSegmentCompactionSize = kLruCacheSize / 4;
+
+// Finds suggestion candidates from at most 100 matching entries in the cold
+// segment for each key.
+constexpr size_t kMaxColdTrial = 100;
+
 // Don't save key/value that are
 // longer than kMaxCandidateSize to avoid memory explosion
 constexpr size_t kMaxStringLength = 256;
@@ -112,6 +134,13 @@ constexpr char kFileName[] = "user://history.db";
 constexpr char kFileName[] = "user://.history.db";
 #endif  // OS_WIN
 
+// File name for the cold segment of the history
+#ifdef OS_WIN
+constexpr char kColdSegmentFileName[] = "user://history_cold.db";
+#else   // OS_WIN
+constexpr char kColdSegmentFileName[] = "user://.history_cold.db";
+#endif  // OS_WIN
+
 // Uses '\t' as a key/value delimiter
 constexpr char kDelimiter[] = "\t";
 constexpr char kEmojiDescription[] = "絵文字";
@@ -347,36 +376,6 @@ UserHistoryPredictor::EntryPriorityQueue::NewEntry() {
   return pool_.Alloc();
 }
 
-class UserHistoryPredictorSyncer : public Thread {
- public:
-  enum RequestType { LOAD, SAVE };
-
-  UserHistoryPredictorSyncer(UserHistoryPredictor *predictor, RequestType type)
-      : predictor_(predictor), type_(type) {
-    DCHECK(predictor_);
-  }
-
-  void Run() override {
-    switch (type_) {
-      case LOAD:
-        VLOG(1) << "Executing Reload method";
-        predictor_->Load();
-        break;
-      case SAVE:
-        VLOG(1) << "Executing Sync method";
-        predictor_->Save();
-        break;
-      default:
-        LOG(ERROR) << "Unknown request: " << static_cast<int>(type_);
-    }
-  }
-
-  ~UserHistoryPredictorSyncer() override { Join(); }
-
-  UserHistoryPredictor *predictor_;
-  RequestType type_;
-};
-
 UserHistoryPredictor::UserHistoryPredictor(
     const DictionaryInterface *dictionary, const PosMatcher *pos_matcher,
     const SuppressionDictionary *suppression_dictionary,
@@ -387,7 +386,9 @@ UserHistoryPredictor::UserHistoryPredictor(
       predictor_name_("UserHistoryPredictor"),
       content_word_learning_enabled_(enable_content_word_learning),
       updated_(false),
-      dic_(new DicCache(UserHistoryPredictor::cache_size())) {
+      dic_(new DicCache(UserHistoryPredictor::cache_size())),
+      key_index_(new UserHistoryKeyIndex),
+      cold_segment_(new UserHistoryColdSegment(GetColdSegmentFileName())) {
   AsyncLoad();  // non-blocking
   // Load()  blocking version can be used if any
 }
@@ -402,15 +403,17 @@ std::string UserHistoryPredictor::GetUserHistoryFileName() {
   return ConfigFileStream::GetFileName(kFileName);
 }
 
+std::string UserHistoryPredictor::GetColdSegmentFileName() {
+  return ConfigFileStream::GetFileName(kColdSegmentFileName);
+}
+
 // Returns revert id
 // static
 uint16_t UserHistoryPredictor::revert_id() { return kRevertId; }
 
 void UserHistoryPredictor::WaitForSyncer() {
-  if (syncer_ != nullptr) {
-    syncer_->Join();
-    syncer_.reset();
-  }
+  syncer_.Wait();
+  syncer_ = Executor::TaskHandle();
 }
 
 bool UserHistoryPredictor::Wait() {
@@ -419,14 +422,10 @@ bool UserHistoryPredictor::Wait() {
 }
 
 bool UserHistoryPredictor::CheckSyncerAndDelete() const {
-  if (syncer_ != nullptr) {
-    if (syncer_->IsRunning()) {
-      return false;
-    } else {
-      syncer_.reset();
-    }
+  if (!syncer_.IsDone()) {
+    return false;
   }
-
+  syncer_ = Executor::TaskHandle();
   return true;
 }
 
@@ -445,9 +444,12 @@ bool UserHistoryPredictor::AsyncLoad() {
     return true;
   }
 
-  syncer_ = std::make_unique<UserHistoryPredictorSyncer>(
-      this, UserHistoryPredictorSyncer::LOAD);
-  syncer_->Start("UserHistoryPredictor:Load");
+  syncer_ = Executor::Get()->Post(
+      [this]() {
+        VLOG(1) << "Executing Reload method";
+        Load();
+      },
+      Executor::NORMAL);
 
   return true;
 }
@@ -461,14 +463,26 @@ bool UserHistoryPredictor::AsyncSave() {
     return true;
   }
 
-  syncer_ = std::make_unique<UserHistoryPredictorSyncer>(
-      this, UserHistoryPredictorSyncer::SAVE);
-  syncer_->Start("UserHistoryPredictor:Save");
+  // Saving can be postponed while the user is typing.
+  syncer_ = Executor::Get()->Post(
+      [this]() {
+        VLOG(1) << "Executing Sync method";
+        Save();
+      },
+      Executor::LOW);
 
   return true;
 }
 
 bool UserHistoryPredictor::Load() {
+  // The cold segment is optional.
+  cold_segment_->Open();
+  {
+    absl::MutexLock l(&cold_mutex_);
+    evicted_entries_.clear();
+    removed_cold_fps_.clear();
+  }
+
   const std::string filename = GetUserHistoryFileName();
 
   UserHistoryStorage history(filename);
@@ -481,6 +495,7 @@ bool UserHistoryPredictor::Load() {
 
 bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
   dic_->Clear();
+  key_index_->Clear();
   for (const Entry &entry : history.GetProto().entries()) {
     // Workaround for b/116826494: Some garbled characters are suggested
     // from user history. This fiters such entries.
@@ -489,7 +504,10 @@ bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
                  << entry.Utf8DebugString();
       continue;
     }
-    dic_->Insert(EntryFingerprint(entry), entry);
+    DicElement *e = InsertToDic(EntryFingerprint(entry), entry.key());
+    if (e != nullptr) {
+      e->value = entry;
+    }
   }
 
   VLOG(1) << "Loaded user history, size=" << history.GetProto().entries_size();
@@ -505,6 +523,18 @@ bool UserHistoryPredictor::Save() {
   // Do not check incognito_mode or use_history_suggest in Config here.
   // The input data should not have been inserted when those flags are on.
 
+  // Entries removed by the user are dropped from the disk right away.
+  bool compact_cold_segment = false;
+  {
+    absl::ReaderMutexLock l(&cold_mutex_);
+    compact_cold_segment =
+        !removed_cold_fps_.empty() ||
+        evicted_entries_.size() >= kMinColdSegmentCompactionSize;
+  }
+  if (compact_cold_segment) {
+    CompactColdSegment();
+  }
+
   const DicElement *tail = dic_->Tail();
   if (tail == nullptr) {
     return true;
@@ -513,18 +543,27 @@ bool UserHistoryPredictor::Save() {
   const std::string filename = GetUserHistoryFileName();
 
   UserHistoryStorage history(filename);
+  // The pending evicted entries are older than the ones in |dic_|, so they
+  // are evicted again when the history is loaded.
+  for (const Entry &entry : GetPendingColdEntries()) {
+    *history.GetProto().add_entries() = entry;
+  }
   for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
     *history.GetProto().add_entries() = elm->value;
   }
 
   // Updates usage stats here.
   UsageStats::SetInteger("UserHistoryPredictorEntrySize",
-                         static_cast<int>(history.GetProto().entries_size()));
+                         static_cast<int>(dic_->Size()));
 
   if (!history.Save()) {
     LOG(ERROR) << "UserHistoryStorage::Save() failed";
     return false;
   }
+  {
+    absl::MutexLock l(&cold_mutex_);
+    evicted_entries_.clear();
+  }
   Load(history);
 
   updated_ = false;
@@ -540,6 +579,13 @@ bool UserHistoryPredictor::ClearAllHistory() {
   // Renews DicCache as LruCache tries to reuse the internal value by
   // using FreeList
   dic_ = std::make_unique<DicCache>(UserHistoryPredictor::cache_size());
+  key_index_->Clear();
+  cold_segment_->Clear();
+  {
+    absl::MutexLock l(&cold_mutex_);
+    evicted_entries_.clear();
+    removed_cold_fps_.clear();
+  }
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -572,7 +618,7 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
 
   for (size_t i = 0; i < keys.size(); ++i) {
     VLOG(2) << "Removing: " << keys[i];
-    if (!dic_->Erase(keys[i])) {
+    if (!EraseFromDic(keys[i])) {
       LOG(ERROR) << "cannot erase " << keys[i];
     }
   }
@@ -700,6 +746,18 @@ bool UserHistoryPredictor::ClearHistoryEntry(const std::string &key,
       deleted = true;
     }
   }
+  {
+    // The entry may also be in the cold segment, which is immutable until the
+    // next save.
+    const uint32_t fp = Fingerprint(key, value);
+    Entry entry;
+    if (!dic_->HasKey(fp) && LookupColdEntry(key, value, &entry)) {
+      absl::MutexLock l(&cold_mutex_);
+      if (removed_cold_fps_.insert(fp).second) {
+        deleted = true;
+      }
+    }
+  }
   {
     // Finds a chain of history entries that produces key and value. If exists,
     // remove the link so that N-gram history prediction never generates this
@@ -1330,13 +1388,20 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
   std::unique_ptr<Trie<std::string>> expanded;
   GetInputKeyFromSegments(request, segments, &input_key, &base_key, &expanded);
 
+  // Only visits the entries that can match the input, from the most recent
+  // one as the LRU order.
+  std::vector<uint32_t> fps;
+  GetLookupCandidates(base_key, expanded.get(), roman_input_key, prev_entry,
+                      &fps);
+
   const uint64_t now = Clock::GetTime();
   int trial = 0;
-  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
-    if (!IsValidEntryIgnoringRemovedField(elm->value)) {
+  for (const uint32_t fp : fps) {
+    const Entry *entry = dic_->LookupWithoutInsert(fp);
+    if (entry == nullptr || !IsValidEntryIgnoringRemovedField(*entry)) {
       continue;
     }
-    if (elm->value.last_access_time() + k62DaysInSec < now) {
+    if (entry->last_access_time() + k62DaysInSec < now) {
       updated_ = true;  // We found an entry to be deleted at next save.
       continue;
     }
@@ -1349,17 +1414,184 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
     // Lookup key from elm_value and prev_entry.
     // If a new entry is found, the entry is pushed to the results.
     // TODO(team): make KanaFuzzyLookupEntry().
-    if (!LookupEntry(request_type, input_key, base_key, expanded.get(),
-                     &(elm->value), prev_entry, results) &&
-        !RomanFuzzyLookupEntry(roman_input_key, &(elm->value), results)) {
+    if (!LookupEntry(request_type, input_key, base_key, expanded.get(), entry,
+                     prev_entry, results) &&
+        !RomanFuzzyLookupEntry(roman_input_key, entry, results)) {
       continue;
     }
 
     // already found enough results.
     if (results->size() >= max_results_size) {
-      break;
+      return;
+    }
+  }
+
+  // Then looks up the cold segment for older entries.
+  std::vector<Entry> cold_entries;
+  GetColdLookupCandidates(base_key, expanded.get(), &cold_entries);
+  for (const Entry &entry : cold_entries) {
+    if (!IsValidEntryIgnoringRemovedField(entry) ||
+        entry.last_access_time() + k62DaysInSec < now) {
+      continue;
+    }
+    if (!LookupEntry(request_type, input_key, base_key, expanded.get(), &entry,
+                     prev_entry, results)) {
+      continue;
+    }
+    if (results->size() >= max_results_size) {
+      return;
+    }
+  }
+}
+
+void UserHistoryPredictor::GetColdLookupCandidates(
+    const std::string &key_base, const Trie<std::string> *key_expanded,
+    std::vector<Entry> *entries) const {
+  DCHECK(entries);
+  absl::ReaderMutexLock l(&cold_mutex_);
+  if (cold_segment_->size() == 0 && evicted_entries_.empty()) {
+    return;
+  }
+  // The pending entries are not many, and newer than the ones in the cold
+  // segment.
+  for (auto it = evicted_entries_.rbegin(); it != evicted_entries_.rend();
+       ++it) {
+    bool matched = false;
+    if (!key_base.empty()) {
+      matched = absl::StartsWith(it->key(), key_base) ||
+                absl::StartsWith(key_base, it->key());
+    } else if (key_expanded != nullptr) {
+      std::string expanded_key;
+      size_t key_length = 0;
+      matched = key_expanded->LongestMatch(it->key(), &expanded_key,
+                                           &key_length);
+    }
+    if (matched) {
+      entries->push_back(*it);
+    }
+  }
+  if (!key_base.empty()) {
+    cold_segment_->LookupPrefix(key_base, entries);
+    cold_segment_->LookupPredictive(key_base, kMaxColdTrial, entries);
+  } else if (key_expanded != nullptr) {
+    std::vector<std::string> expanded_keys;
+    key_expanded->LookUpPredictiveAll("", &expanded_keys);
+    for (const std::string &expanded_key : expanded_keys) {
+      cold_segment_->LookupPredictive(expanded_key, kMaxColdTrial, entries);
+    }
+  }
+  // Removes the entries shadowed by the hot entries or removed.
+  absl::flat_hash_set<uint32_t> seen;
+  entries->erase(
+      std::remove_if(entries->begin(), entries->end(),
+                     [&](const Entry &entry) {
+                       const uint32_t fp = EntryFingerprint(entry);
+                       return dic_->HasKey(fp) ||
+                              removed_cold_fps_.contains(fp) ||
+                              !seen.insert(fp).second;
+                     }),
+      entries->end());
+}
+
+bool UserHistoryPredictor::CompactColdSegment() {
+  const uint64_t now = Clock::GetTime();
+  const uint64_t min_access_time =
+      (now > k62DaysInSec) ? now - k62DaysInSec : 0;
+  // The pending changes are copied, not moved, so that the lookups during the
+  // compaction still see them.  They are dropped once the segment has them.
+  std::vector<Entry> added;
+  absl::flat_hash_set<uint32_t> removed_fps;
+  {
+    absl::ReaderMutexLock l(&cold_mutex_);
+    added = evicted_entries_;
+    removed_fps = removed_cold_fps_;
+  }
+  const size_t num_added = added.size();
+  const bool result = cold_segment_->Compact(
+      std::move(added),
+      [this, &removed_fps](uint32_t fp) {
+        // Entries in |dic_| are newer than the ones in the cold segment.
+        return dic_->HasKey(fp) || removed_fps.contains(fp);
+      },
+      kColdSegmentSize, min_access_time);
+  if (result) {
+    absl::MutexLock l(&cold_mutex_);
+    const size_t num_merged = std::min(num_added, evicted_entries_.size());
+    evicted_entries_.erase(evicted_entries_.begin(),
+                           evicted_entries_.begin() + num_merged);
+    for (const uint32_t fp : removed_fps) {
+      removed_cold_fps_.erase(fp);
+    }
+  }
+  LOG_IF(ERROR, !result) << "Failed to compact the cold segment";
+  VLOG(1) << "Cold segment size=" << cold_segment_->size();
+  return result;
+}
+
+bool UserHistoryPredictor::LookupColdEntry(absl::string_view key,
+                                           absl::string_view value,
+                                           Entry *entry) const {
+  absl::ReaderMutexLock l(&cold_mutex_);
+  for (auto it = evicted_entries_.rbegin(); it != evicted_entries_.rend();
+       ++it) {
+    if (it->key() == key && it->value() == value) {
+      *entry = *it;
+      return true;
     }
   }
+  return cold_segment_->LookupEntry(key, value, entry);
+}
+
+std::vector<UserHistoryPredictor::Entry>
+UserHistoryPredictor::GetPendingColdEntries() const {
+  absl::ReaderMutexLock l(&cold_mutex_);
+  // Keeps the last one for the entries evicted more than once.
+  absl::flat_hash_set<uint32_t> seen;
+  std::vector<Entry> entries;
+  for (auto it = evicted_entries_.rbegin(); it != evicted_entries_.rend();
+       ++it) {
+    const uint32_t fp = EntryFingerprint(*it);
+    if (!dic_->HasKey(fp) && !removed_cold_fps_.contains(fp) &&
+        seen.insert(fp).second) {
+      entries.push_back(*it);
+    }
+  }
+  std::reverse(entries.begin(), entries.end());
+  return entries;
+}
+
+bool UserHistoryPredictor::IsRemovedColdEntry(uint32_t fp) const {
+  absl::ReaderMutexLock l(&cold_mutex_);
+  return removed_cold_fps_.contains(fp);
+}
+
+void UserHistoryPredictor::GetLookupCandidates(
+    const std::string &key_base, const Trie<std::string> *key_expanded,
+    const std::string &roman_input_key, const Entry *prev_entry,
+    std::vector<uint32_t> *fps) const {
+  DCHECK(fps);
+  if (!key_base.empty()) {
+    // Entries whose key is a prefix of |key_base| (RIGHT_PREFIX_MATCH and
+    // EXACT_MATCH) or starts with |key_base| (LEFT_PREFIX_MATCH). The
+    // expanded keys only filter the latter case further.
+    key_index_->LookupPrefix(key_base, fps);
+    key_index_->LookupPredictive(key_base, fps);
+  } else if (key_expanded != nullptr) {
+    // Entries whose key starts with one of the expanded keys.
+    std::vector<std::string> expanded_keys;
+    key_expanded->LookUpPredictiveAll("", &expanded_keys);
+    for (const std::string &expanded_key : expanded_keys) {
+      key_index_->LookupPredictive(expanded_key, fps);
+    }
+  } else if (prev_entry != nullptr) {
+    // Zero query suggestion only returns the entries linked from
+    // |prev_entry|.
+    for (const NextEntry &next_entry : prev_entry->next_entries()) {
+      fps->push_back(next_entry.entry_fp());
+    }
+  }
+  key_index_->LookupRomanFuzzyCandidates(roman_input_key, fps);
+  key_index_->SortByRecency(fps);
 }
 
 // static
@@ -1547,6 +1779,40 @@ bool UserHistoryPredictor::IsValidEntryIgnoringRemovedField(
   return true;
 }
 
+UserHistoryPredictor::DicElement *UserHistoryPredictor::InsertToDic(
+    uint32_t fp, const std::string &key) {
+  // LruCache::Insert() silently evicts the tail when the cache is full.
+  // Detects it by the size so that the evicted entry is also removed from
+  // the index.
+  const DicElement *tail = dic_->Tail();
+  const uint32_t tail_fp = (tail == nullptr) ? 0 : tail->key;
+  const bool has_key = dic_->HasKey(fp);
+  const size_t size = dic_->Size();
+  if (!has_key && tail != nullptr && size >= cache_size() &&
+      tail->value.entry_type() == Entry::DEFAULT_ENTRY) {
+    // The tail is going to be evicted.  Keeps it for the cold segment.
+    absl::MutexLock l(&cold_mutex_);
+    if (evicted_entries_.size() < cache_size()) {
+      evicted_entries_.push_back(tail->value);
+    }
+  }
+  DicElement *e = dic_->Insert(fp);
+  if (!has_key && tail != nullptr && dic_->Size() == size) {
+    key_index_->Remove(tail_fp);
+  }
+  if (e == nullptr) {
+    key_index_->Remove(fp);
+    return nullptr;
+  }
+  key_index_->Add(fp, key);
+  return e;
+}
+
+bool UserHistoryPredictor::EraseFromDic(uint32_t fp) {
+  key_index_->Remove(fp);
+  return dic_->Erase(fp);
+}
+
 void UserHistoryPredictor::InsertEvent(EntryType type) {
   if (type == Entry::DEFAULT_ENTRY) {
     return;
@@ -1556,7 +1822,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   const uint32_t dic_key = Fingerprint("", "", type);
 
   CHECK(dic_.get());
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key, "");
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
@@ -1597,6 +1863,13 @@ void UserHistoryPredictor::Insert(const std::string &key,
                                   Segments *segments) {
   const uint32_t dic_key = Fingerprint(key, value);
 
+  // The entry learned before may be in the cold segment.  Moves it back to
+  // |dic_| so that its frequencies and next entries are kept.
+  Entry cold_entry;
+  const bool in_cold_segment =
+      !dic_->HasKey(dic_key) && !IsRemovedColdEntry(dic_key) &&
+      LookupColdEntry(key, value, &cold_entry);
+
   if (!dic_->HasKey(dic_key)) {
     // The key is a new key inserted in the last Finish method.
     // Here we push a new RevertEntry so that the new "key" can be
@@ -1612,7 +1885,7 @@ void UserHistoryPredictor::Insert(const std::string &key,
     // add a treatment for UPDATE_ENTRY mode
   }
 
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key, key);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
@@ -1620,6 +1893,9 @@ void UserHistoryPredictor::Insert(const std::string &key,
 
   Entry *entry = &(e->value);
   DCHECK(entry);
+  if (in_cold_segment) {
+    *entry = cold_entry;
+  }
 
   entry->set_key(key);
   entry->set_value(value);
@@ -1948,7 +2224,7 @@ void UserHistoryPredictor::Revert(Segments *segments) {
     if (revert_entry.id == UserHistoryPredictor::revert_id() &&
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
       VLOG(2) << "Erasing the key: " << StringToUint32(revert_entry.key);
-      dic_->Erase(StringToUint32(revert_entry.key));
+      EraseFromDic(StringToUint32(revert_entry.key));
     }
   }
 }
@@ -2127,6 +2403,9 @@ uint32_t UserHistoryPredictor::GetScore(const Entry &entry) {
 // static
 uint32_t UserHistoryPredictor::cache_size() { return kLruCacheSize; }
 
+// static
+uint32_t UserHistoryPredictor::cold_segment_size() { return kColdSegmentSize; }
+
 // Returns the size of next entries.
 // static
 uint32_t UserHistoryPredictor::max_next_entries_size() {
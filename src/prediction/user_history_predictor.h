@@ -39,15 +39,20 @@
 #include <utility>
 #include <vector>
 
+#include "base/executor.h"
 #include "base/freelist.h"
 #include "base/trie.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/predictor_interface.h"
+#include "prediction/user_history_cold_segment.h"
+#include "prediction/user_history_key_index.h"
 #include "prediction/user_history_predictor.pb.h"
 #include "storage/lru_cache.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 // for FRIEND_TEST
 #include "testing/base/public/gunit_prod.h"
 
@@ -60,7 +65,6 @@ class StringStorageInterface;
 class ConversionRequest;
 class Segment;
 class Segments;
-class UserHistoryPredictorSyncer;
 
 // Added serialization method for UserHistory.
 class UserHistoryStorage {
@@ -94,8 +98,8 @@ class UserHistoryStorage {
 
 // UserHistoryPredictor is NOT thread safe.
 // Currently, all methods of UserHistoryPredictor is called
-// by single thread. Although AsyncSave() and AsyncLoad() make
-// worker threads internally, these two functions won't be
+// by single thread. Although AsyncSave() and AsyncLoad() run
+// on the background executor, these two functions won't be
 // called by multiple-threads at the same time
 class UserHistoryPredictor : public PredictorInterface {
  public:
@@ -144,6 +148,10 @@ class UserHistoryPredictor : public PredictorInterface {
   // Gets user history filename.
   static std::string GetUserHistoryFileName();
 
+  // Gets the filename of the cold segment, which holds the entries evicted
+  // from the in-memory history.
+  static std::string GetColdSegmentFileName();
+
   const std::string &GetPredictorName() const override {
     return predictor_name_;
   }
@@ -163,6 +171,9 @@ class UserHistoryPredictor : public PredictorInterface {
   // Returns the size of cache.
   static uint32_t cache_size();
 
+  // Returns the maximum number of entries in the cold segment.
+  static uint32_t cold_segment_size();
+
   // Returns the size of next entries.
   static uint32_t max_next_entries_size();
 
@@ -221,7 +232,6 @@ class UserHistoryPredictor : public PredictorInterface {
     std::vector<SegmentForLearning> conversion_segments_;
   };
 
-  friend class UserHistoryPredictorSyncer;
   friend class UserHistoryPredictorTest;
 
   FRIEND_TEST(UserHistoryPredictorTest, UserHistoryPredictorTestSuggestion);
@@ -295,12 +305,12 @@ class UserHistoryPredictor : public PredictorInterface {
   // Saves user history data in LRU to local file
   bool Save();
 
-  // non-blocking version of Load
-  // This makes a new thread and call Load()
+  // non-blocking version of Save
+  // This posts Save() to the background executor.
   bool AsyncSave();
 
-  // non-blocking version of Sync
-  // This makes a new thread and call Save()
+  // non-blocking version of Load
+  // This posts Load() to the background executor.
   bool AsyncLoad();
 
   // Waits until syncer finishes.
@@ -370,6 +380,45 @@ class UserHistoryPredictor : public PredictorInterface {
 
   bool CheckSyncerAndDelete() const;
 
+  // Inserts |fp| to |dic_| and keeps |key_index_| in sync, including the
+  // eviction of the LRU tail.  |key| must be the key of the entry that the
+  // caller stores in the returned element.
+  DicElement *InsertToDic(uint32_t fp, const std::string &key);
+
+  // Erases |fp| from |dic_| and |key_index_|.
+  bool EraseFromDic(uint32_t fp);
+
+  // Moves the entries evicted from |dic_| to the cold segment and applies
+  // the removal of cold entries.  Called from Save().
+  bool CompactColdSegment();
+
+  // Finds the cold entry for (|key|, |value|) in the pending evicted entries
+  // and the cold segment.
+  bool LookupColdEntry(absl::string_view key, absl::string_view value,
+                       Entry *entry) const;
+
+  // Returns the evicted entries not merged to the cold segment yet, oldest
+  // first.
+  std::vector<Entry> GetPendingColdEntries() const;
+
+  // Returns true if the cold entry of |fp| is removed by ClearHistoryEntry().
+  bool IsRemovedColdEntry(uint32_t fp) const;
+
+  // Looks up the cold segment for the entries that may match the input.
+  // Entries shadowed by |dic_| or removed by ClearHistoryEntry() are skipped.
+  void GetColdLookupCandidates(const std::string &key_base,
+                               const Trie<std::string> *key_expanded,
+                               std::vector<Entry> *entries) const;
+
+  // Collects the fingerprints of the entries that may match the input, sorted
+  // from the most recent one.  This is a superset of the entries accepted by
+  // LookupEntry() and RomanFuzzyLookupEntry().
+  void GetLookupCandidates(const std::string &key_base,
+                           const Trie<std::string> *key_expanded,
+                           const std::string &roman_input_key,
+                           const Entry *prev_entry,
+                           std::vector<uint32_t> *fps) const;
+
   // If |entry| is the target of prediction,
   // create a new result and insert it to |results|.
   // Can set |prev_entry| if there is a history segment just before |input_key|.
@@ -505,7 +554,19 @@ class UserHistoryPredictor : public PredictorInterface {
   bool content_word_learning_enabled_;
   mutable std::atomic<bool> updated_;
   std::unique_ptr<DicCache> dic_;
-  mutable std::unique_ptr<UserHistoryPredictorSyncer> syncer_;
+  std::unique_ptr<UserHistoryKeyIndex> key_index_;
+  // Cold tier of the history.  The entries evicted from |dic_| are kept in
+  // |evicted_entries_| and moved to |cold_segment_| by a save once enough of
+  // them are pending.
+  std::unique_ptr<UserHistoryColdSegment> cold_segment_;
+  // Guards the pending changes of the cold tier below.  Save() on the
+  // executor merges them to |cold_segment_| while the lookups read them.
+  mutable absl::Mutex cold_mutex_;
+  std::vector<Entry> evicted_entries_ ABSL_GUARDED_BY(cold_mutex_);
+  // Fingerprints of the cold entries removed by ClearHistoryEntry().  They
+  // are dropped from the cold segment at the next save.
+  absl::flat_hash_set<uint32_t> removed_cold_fps_ ABSL_GUARDED_BY(cold_mutex_);
+  mutable Executor::TaskHandle syncer_;
 };
 
 }  // namespace mozc
@@ -62,8 +62,10 @@
 #include "usage_stats/usage_stats_testing_util.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 namespace {
@@ -155,7 +157,7 @@ class UserHistoryPredictorTest : public ::testing::Test {
       UserHistoryPredictor *predictor, const std::string &key,
       const std::string &value) {
     UserHistoryPredictor::Entry *e =
-        &predictor->dic_->Insert(predictor->Fingerprint(key, value))->value;
+        &predictor->InsertToDic(predictor->Fingerprint(key, value), key)->value;
     e->set_key(key);
     e->set_value(value);
     e->set_removed(false);
@@ -174,6 +176,20 @@ class UserHistoryPredictorTest : public ::testing::Test {
     return predictor.dic_->Size();
   }
 
+  static size_t ColdSegmentSize(const UserHistoryPredictor &predictor) {
+    return predictor.cold_segment_->size();
+  }
+
+  static size_t PendingColdEntrySize(const UserHistoryPredictor &predictor) {
+    absl::ReaderMutexLock l(&predictor.cold_mutex_);
+    return predictor.evicted_entries_.size();
+  }
+
+  static bool SaveHistory(UserHistoryPredictor *predictor) {
+    predictor->updated_ = true;
+    return predictor->Save();
+  }
+
   static bool LoadStorage(UserHistoryPredictor *predictor,
                           const UserHistoryStorage &history) {
     return predictor->Load(history);
@@ -4280,4 +4296,65 @@ TEST_F(UserHistoryPredictorTest, MaxPredictionCandidatesSizeForZeroQuery) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, ColdSegment) {
+  ScopedClockMock clock(1, 0);
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  // Overflows the LRU cache.  The first |kNumEvicted| entries are evicted.
+  constexpr int kNumEvicted = 10;
+  const int num_entries = UserHistoryPredictor::cache_size() + kNumEvicted;
+  for (int i = 0; i < num_entries; ++i) {
+    UserHistoryPredictor::Entry *e = InsertEntry(
+        predictor, absl::StrCat("かぎ", i, "め"), absl::StrCat("鍵", i, "目"));
+    e->set_last_access_time(1);
+  }
+  EXPECT_EQ(UserHistoryPredictor::cache_size(), EntrySize(*predictor));
+
+  // A few evicted entries are kept in the history file instead of
+  // rewriting the cold segment.  They are still suggested.
+  EXPECT_EQ(0, ColdSegmentSize(*predictor));
+  ASSERT_TRUE(SaveHistory(predictor));
+  EXPECT_EQ(0, ColdSegmentSize(*predictor));
+  EXPECT_EQ(kNumEvicted, PendingColdEntrySize(*predictor));
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor, "かぎ0め", "鍵0目"));
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor, "かぎ9め", "鍵9目"));
+
+  // The pending entries are loaded on startup.
+  predictor->Reload();
+  WaitForSyncer(predictor);
+  EXPECT_EQ(kNumEvicted, PendingColdEntrySize(*predictor));
+  EXPECT_TRUE(IsSuggested(predictor, "かぎ0め", "鍵0目"));
+
+  // The cold segment is rewritten once enough entries are evicted.
+  const int num_more_entries = UserHistoryPredictor::cache_size() / 4;
+  for (int i = num_entries; i < num_entries + num_more_entries; ++i) {
+    UserHistoryPredictor::Entry *e = InsertEntry(
+        predictor, absl::StrCat("かぎ", i, "め"), absl::StrCat("鍵", i, "目"));
+    e->set_last_access_time(1);
+  }
+  ASSERT_TRUE(SaveHistory(predictor));
+  const size_t cold_size = kNumEvicted + num_more_entries;
+  EXPECT_EQ(cold_size, ColdSegmentSize(*predictor));
+  EXPECT_EQ(0, PendingColdEntrySize(*predictor));
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor, "かぎ0め", "鍵0目"));
+
+  // The cold segment is loaded on startup.
+  predictor->Reload();
+  WaitForSyncer(predictor);
+  EXPECT_EQ(cold_size, ColdSegmentSize(*predictor));
+  EXPECT_TRUE(IsSuggested(predictor, "かぎ0め", "鍵0目"));
+
+  // Removed entries are no longer suggested, and are dropped on save.
+  EXPECT_TRUE(predictor->ClearHistoryEntry("かぎ0め", "鍵0目"));
+  EXPECT_FALSE(IsSuggested(predictor, "かぎ0め", "鍵0目"));
+  ASSERT_TRUE(SaveHistory(predictor));
+  EXPECT_EQ(cold_size - 1, ColdSegmentSize(*predictor));
+  EXPECT_FALSE(IsSuggested(predictor, "かぎ0め", "鍵0目"));
+
+  predictor->ClearAllHistory();
+  WaitForSyncer(predictor);
+  EXPECT_EQ(0, ColdSegmentSize(*predictor));
+  EXPECT_FALSE(IsSuggested(predictor, "かぎ1め", "鍵1目"));
+}
+
 }  // namespace mozc
@@ -195,9 +195,8 @@ class ZeroQueryDict {
   }
 
   std::pair<iterator, iterator> equal_range(absl::string_view key) const {
-    const auto iter =
-        std::lower_bound(string_array_.begin(), string_array_.end(), key);
-    if (iter == string_array_.end() || *iter != key) {
+    const auto iter = string_array_.find(key);
+    if (iter == string_array_.end()) {
       return std::pair<iterator, iterator>(end(), end());
     }
     return std::equal_range(begin(), end(), iter.index());
@@ -34,8 +34,10 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
+#include "base/executor.h"
 #include "base/logging.h"
 #include "base/process.h"
 #include "base/run_level.h"
@@ -67,7 +69,7 @@ constexpr size_t kMaxErrorTimes = 5;
 constexpr uint64_t kRetryIntervalTime = 30;  // 30 sec
 constexpr char kServiceName[] = "renderer";
 
-inline void CallCommand(IPCClientInterface *client,
+inline bool CallCommand(IPCClientInterface *client,
                         const commands::RendererCommand &command) {
   std::string buf;
   command.SerializeToString(&buf);
@@ -77,7 +79,9 @@ inline void CallCommand(IPCClientInterface *client,
 
   if (!client->Call(buf, &result, kIPCTimeout)) {
     LOG(ERROR) << "Cannot send the request: ";
+    return false;
   }
+  return true;
 }
 }  // namespace
 
@@ -332,6 +336,10 @@ RendererClient::RendererClient()
 }
 
 RendererClient::~RendererClient() {
+  if (sender_ != nullptr) {
+    WaitForPendingUpdates();
+    sender_.reset();
+  }
   if (!IsAvailable() || !is_window_visible_) {
     return;
   }
@@ -407,7 +415,53 @@ void RendererClient::set_suppress_error_dialog(bool suppress) {
   renderer_launcher_interface_->set_suppress_error_dialog(suppress);
 }
 
+void RendererClient::EnableAsyncUpdates() {
+  if (sender_ == nullptr) {
+    sender_ = std::make_unique<Executor>(1);
+  }
+}
+
+void RendererClient::WaitForPendingUpdates() {
+  absl::MutexLock exec_lock(&exec_mutex_);
+  std::unique_ptr<commands::RendererCommand> command;
+  {
+    absl::MutexLock l(&pending_update_mutex_);
+    command = std::move(pending_update_);
+  }
+  if (command != nullptr) {
+    ExecCommandInternal(*command);
+  }
+}
+
 bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
+  if (sender_ == nullptr) {
+    absl::MutexLock l(&exec_mutex_);
+    return ExecCommandInternal(command);
+  }
+
+  if (command.type() != commands::RendererCommand::UPDATE) {
+    // Keep the order with the queued update.
+    WaitForPendingUpdates();
+    absl::MutexLock l(&exec_mutex_);
+    return ExecCommandInternal(command);
+  }
+
+  {
+    absl::MutexLock l(&pending_update_mutex_);
+    if (pending_update_ != nullptr) {
+      // The queued update is not sent yet.  Overwrite it, as the renderer
+      // only needs the latest state.
+      *pending_update_ = command;
+      return true;
+    }
+    pending_update_ = std::make_unique<commands::RendererCommand>(command);
+  }
+  sender_->Post([this]() { WaitForPendingUpdates(); });
+  return true;
+}
+
+bool RendererClient::ExecCommandInternal(
+    const commands::RendererCommand &command) {
   if (renderer_launcher_interface_ == nullptr) {
     LOG(ERROR) << "RendererLauncher is nullptr";
     return false;
@@ -436,7 +490,12 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
 
   VLOG(2) << "Sending: " << command.DebugString();
 
-  std::unique_ptr<IPCClientInterface> client(CreateIPCClient());
+  // Reuse the connection of the previous command if possible.
+  const bool reused = ipc_client_ != nullptr && ipc_client_->IsReusable();
+  std::unique_ptr<IPCClientInterface> client =
+      reused ? std::move(ipc_client_)
+             : std::unique_ptr<IPCClientInterface>(CreateIPCClient());
+  ipc_client_.reset();
 
   // In case IPCClient::Init fails with timeout error, the last error should be
   // checked here.  See also b/3264926.
@@ -494,7 +553,15 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return true;
   }
 
-  CallCommand(client.get(), command);
+  if (!CallCommand(client.get(), command) && reused &&
+      client->GetLastIPCError() != IPC_TIMEOUT_ERROR) {
+    // The renderer may have been restarted since the last command.
+    LOG(WARNING) << "The connection to the renderer is lost. Reconnecting.";
+    return ExecCommandInternal(command);
+  }
+  if (client->IsReusable()) {
+    ipc_client_ = std::move(client);
+  }
 
   return true;
 }
@@ -504,9 +571,10 @@ IPCClientInterface *RendererClient::CreateIPCClient() const {
     return nullptr;
   }
   if (disable_renderer_path_check_) {
-    return ipc_client_factory_interface_->NewClient(name_, "");
+    return ipc_client_factory_interface_->NewPersistentClient(name_, "");
   }
-  return ipc_client_factory_interface_->NewClient(name_, renderer_path_);
+  return ipc_client_factory_interface_->NewPersistentClient(name_,
+                                                            renderer_path_);
 }
 
 }  // namespace renderer
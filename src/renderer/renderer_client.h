@@ -33,8 +33,11 @@
 #include <memory>
 #include <string>
 
+#include "base/executor.h"
 #include "base/port.h"
 #include "renderer/renderer_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 
@@ -119,8 +122,19 @@ class RendererClient : public RendererInterface {
   // Sets the flag of error dialog suppression.
   void set_suppress_error_dialog(bool suppress);
 
+  // Sends UPDATE commands on a background thread so that ExecCommand() never
+  // blocks the caller.  When several updates are queued before the sender
+  // catches up, only the last one is sent.  Other commands are sent
+  // synchronously after the queued update.
+  void EnableAsyncUpdates();
+
+  // Sends the queued update, if any, and waits for the update being sent.
+  void WaitForPendingUpdates();
+
  private:
   IPCClientInterface *CreateIPCClient() const;
+  bool ExecCommandInternal(const commands::RendererCommand &command)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(exec_mutex_);
 
   bool is_window_visible_;
   bool disable_renderer_path_check_;
@@ -132,6 +146,18 @@ class RendererClient : public RendererInterface {
 
   std::unique_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  // Serializes the commands sent from the caller and the sender thread.
+  absl::Mutex exec_mutex_;
+  // The connection kept open between commands, if the IPC supports it.
+  std::unique_ptr<IPCClientInterface> ipc_client_ ABSL_GUARDED_BY(exec_mutex_);
+
+  // Background sender for UPDATE commands.  nullptr unless
+  // EnableAsyncUpdates() is called.
+  std::unique_ptr<Executor> sender_;
+  absl::Mutex pending_update_mutex_;
+  std::unique_ptr<commands::RendererCommand> pending_update_
+      ABSL_GUARDED_BY(pending_update_mutex_);
 };
 
 }  // namespace renderer
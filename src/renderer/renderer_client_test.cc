@@ -62,6 +62,7 @@ const std::string UpdateVersion(int diff) {
 }
 
 int g_counter = 0;
+std::string g_last_request;
 bool g_connected = false;
 uint32_t g_server_protocol_version = IPC_PROTOCOL_VERSION;
 std::string g_server_product_version;
@@ -87,6 +88,7 @@ class TestIPCClient : public IPCClientInterface {
   bool Call(const std::string &request, std::string *response,
             int32_t timeout) override {
     g_counter++;
+    g_last_request = request;
     return true;
   }
 
@@ -96,6 +98,8 @@ class TestIPCClient : public IPCClientInterface {
 
   static int counter() { return g_counter; }
 
+  static const std::string &last_request() { return g_last_request; }
+
   static void set_server_protocol_version(uint32_t version) {
     g_server_protocol_version = version;
   }
@@ -368,6 +372,49 @@ TEST(RendererClient, ConnectionTest) {
   }
 }
 
+TEST(RendererClient, AsyncUpdatesTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+  client.EnableAsyncUpdates();
+
+  launcher.Reset();
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::Reset();
+
+  constexpr int kNumUpdates = 100;
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  for (int i = 0; i < kNumUpdates; ++i) {
+    command.mutable_output()->set_id(i);
+    EXPECT_TRUE(client.ExecCommand(command));
+  }
+  client.WaitForPendingUpdates();
+
+  // Updates may be coalesced, but the last one is always sent.
+  EXPECT_GE(TestIPCClient::counter(), 1);
+  EXPECT_LE(TestIPCClient::counter(), kNumUpdates);
+  commands::RendererCommand sent;
+  ASSERT_TRUE(sent.ParseFromString(TestIPCClient::last_request()));
+  EXPECT_EQ(sent.output().id(), kNumUpdates - 1);
+
+  // Other commands are sent synchronously after the queued update.
+  TestIPCClient::Reset();
+  command.mutable_output()->set_id(kNumUpdates);
+  EXPECT_TRUE(client.ExecCommand(command));
+  commands::RendererCommand noop;
+  noop.set_type(commands::RendererCommand::NOOP);
+  EXPECT_TRUE(client.ExecCommand(noop));
+  ASSERT_TRUE(sent.ParseFromString(TestIPCClient::last_request()));
+  EXPECT_EQ(sent.type(), commands::RendererCommand::NOOP);
+}
+
 TEST(RendererClient, ShutdownTest) {
   TestIPCClientFactory factory;
   TestRendererLauncher launcher;
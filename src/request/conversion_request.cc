@@ -29,9 +29,11 @@
 
 #include "request/conversion_request.h"
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 
@@ -185,4 +187,26 @@ void ConversionRequest::set_should_call_set_key_in_prediction(bool value) {
   should_call_set_key_in_prediction_ = value;
 }
 
+absl::Time ConversionRequest::deadline() const { return deadline_; }
+
+void ConversionRequest::set_deadline(absl::Time deadline) {
+  deadline_ = deadline;
+}
+
+bool ConversionRequest::IsDeadlineNear(absl::Duration margin) const {
+  if (deadline_ == absl::InfiniteFuture()) {
+    return false;
+  }
+  return Clock::GetAbslTime() + margin >= deadline_;
+}
+
+void ConversionRequest::set_cancel_flag(const std::atomic<bool> *flag) {
+  cancel_flag_ = flag;
+}
+
+bool ConversionRequest::IsCancelled() const {
+  return cancel_flag_ != nullptr &&
+         cancel_flag_->load(std::memory_order_relaxed);
+}
+
 }  // namespace mozc
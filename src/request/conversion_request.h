@@ -30,9 +30,11 @@
 #ifndef MOZC_REQUEST_CONVERSION_REQUEST_H_
 #define MOZC_REQUEST_CONVERSION_REQUEST_H_
 
+#include <atomic>
 #include <string>
 
 #include "base/port.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 constexpr size_t kMaxConversionCandidatesSize = 200;
@@ -143,6 +145,21 @@ class ConversionRequest {
   bool should_call_set_key_in_prediction() const;
   void set_should_call_set_key_in_prediction(bool value);
 
+  // The time by which the result should be returned.  Predictors skip their
+  // expensive stages when the deadline is near.  absl::InfiniteFuture() means
+  // no deadline.
+  absl::Time deadline() const;
+  void set_deadline(absl::Time deadline);
+
+  // Returns true if the deadline comes within |margin| from now.
+  bool IsDeadlineNear(absl::Duration margin) const;
+
+  // Background conversions set a flag which is raised when the result is no
+  // longer needed.  The converter checks it between its stages and gives up
+  // the conversion.  The flag must outlive this request.
+  void set_cancel_flag(const std::atomic<bool> *flag);
+  bool IsCancelled() const;
+
  private:
   RequestType request_type_ = CONVERSION;
 
@@ -188,6 +205,10 @@ class ConversionRequest {
   // If true, set conversion key to output segments in prediction.
   bool should_call_set_key_in_prediction_ = false;
 
+  absl::Time deadline_ = absl::InfiniteFuture();
+
+  const std::atomic<bool> *cancel_flag_ = nullptr;
+
   // TODO(noriyukit): Moves all the members of Segments that are irrelevant to
   // this structure, e.g., Segments::request_type_.
   // Also, a key for conversion is eligible to live in this class.
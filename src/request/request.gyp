@@ -38,6 +38,7 @@
         'conversion_request.cc',
       ],
       'dependencies': [
+        '../base/absl.gyp:absl_time',
         '../base/base.gyp:base',
         '../config/config.gyp:config_handler',
         '../protocol/protocol.gyp:commands_proto',
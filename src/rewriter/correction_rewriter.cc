@@ -65,8 +65,7 @@ bool CorrectionRewriter::LookupCorrection(
   results->clear();
 
   using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range =
-      std::equal_range(error_array_.begin(), error_array_.end(), key);
+  std::pair<Iter, Iter> range = error_array_.equal_range(key);
   for (; range.first != range.second; ++range.first) {
     const absl::string_view v = value_array_[range.first.index()];
     if (value.empty() || value == v) {
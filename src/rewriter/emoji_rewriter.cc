@@ -199,8 +199,8 @@ bool EmojiRewriter::IsEmojiCandidate(const Segment::Candidate &candidate) {
 std::pair<EmojiDataIterator, EmojiDataIterator> EmojiRewriter::LookUpToken(
     absl::string_view key) const {
   // Search string array for key.
-  auto iter = std::lower_bound(string_array_.begin(), string_array_.end(), key);
-  if (iter == string_array_.end() || *iter != key) {
+  const auto iter = string_array_.find(key);
+  if (iter == string_array_.end()) {
     return std::pair<EmojiDataIterator, EmojiDataIterator>(end(), end());
   }
   // Search token array for the string index.
@@ -66,20 +66,23 @@ def WriteOutput(key_value_pairs: List[KeyValuePair], token_array_file: str,
     token_array_file: Token array file to consist SerializedDictionary.
     string_array_file: String array file to consist SerializedDictionary.
   """
-  strings = []
+  # As SerializedDictionary::Compile() does, strings are deduplicated and
+  # sorted so that the hash index maps a key to its unique index.
+  sorted_strings = sorted(
+      set(s for key_value in key_value_pairs for s in key_value) | {''})
+  string_index = dict((s, i) for i, s in enumerate(sorted_strings))
   with open(token_array_file, 'wb') as f:
-    for index, (key, value) in enumerate(key_value_pairs):
-      f.write(struct.pack('<I', 2 * index))
-      f.write(struct.pack('<I', 2 * index + 1))
-      f.write(struct.pack('<I', 0))
-      f.write(struct.pack('<I', 0))
+    for key, value in key_value_pairs:
+      f.write(struct.pack('<I', string_index[key]))
+      f.write(struct.pack('<I', string_index[value]))
+      f.write(struct.pack('<I', string_index['']))
+      f.write(struct.pack('<I', string_index['']))
       f.write(struct.pack('<H', 0))
       f.write(struct.pack('<H', 0))
       f.write(struct.pack('<H', 0))
       f.write(struct.pack('<H', 0))
-      strings.append(key)
-      strings.append(value)
-  serialized_string_array_builder.SerializeToFile(strings, string_array_file)
+  serialized_string_array_builder.SerializeToFile(
+      sorted_strings, string_array_file, build_hash_index=True)
 
 
 def ParseArgs() -> argparse.Namespace:
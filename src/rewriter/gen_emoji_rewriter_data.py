@@ -151,8 +151,8 @@ def OutputData(emoji_data_list, token_dict,
         f.write(struct.pack('<I', strings['']))
         f.write(struct.pack('<I', strings['']))
 
-  serialized_string_array_builder.SerializeToFile(sorted_strings,
-                                                  string_array_file)
+  serialized_string_array_builder.SerializeToFile(
+      sorted_strings, string_array_file, build_hash_index=True)
 
 
 def ParseOptions() -> argparse.Namespace:
@@ -78,7 +78,8 @@ def WriteData(input_path, output_value_array_path, output_error_array_path,
   serialized_string_array_builder.SerializeToFile(
       [value for (value, _, _) in outputs], output_value_array_path)
   serialized_string_array_builder.SerializeToFile(
-      [error for (_, error, _) in outputs], output_error_array_path)
+      [error for (_, error, _) in outputs], output_error_array_path,
+      build_hash_index=True)
   serialized_string_array_builder.SerializeToFile(
       [correction for (_, _, correction) in outputs],
       output_correction_array_path)
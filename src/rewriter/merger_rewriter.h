@@ -87,6 +87,9 @@ class MergerRewriter : public RewriterInterface {
                Segments *segments) const override {
     bool result = false;
     for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
+      if (request.IsCancelled()) {
+        return result;
+      }
       if (CheckCapability(request, segments, *rewriter)) {
         result |= rewriter->Rewrite(request, segments);
       }
@@ -32,12 +32,11 @@
 #include "session/internal/candidate_list.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <map>
 #include <string>
 #include <vector>
 
-#include "base/freelist.h"
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -55,6 +54,28 @@ void Candidate::Clear() {
   subcandidate_list_owner_ = false;
 }
 
+Candidate::Candidate(Candidate &&other)
+    : id_(other.id_),
+      attributes_(other.attributes_),
+      subcandidate_list_(other.subcandidate_list_),
+      subcandidate_list_owner_(other.subcandidate_list_owner_) {
+  other.subcandidate_list_ = nullptr;
+  other.subcandidate_list_owner_ = false;
+}
+
+Candidate &Candidate::operator=(Candidate &&other) {
+  if (this != &other) {
+    Clear();
+    id_ = other.id_;
+    attributes_ = other.attributes_;
+    subcandidate_list_ = other.subcandidate_list_;
+    subcandidate_list_owner_ = other.subcandidate_list_owner_;
+    other.subcandidate_list_ = nullptr;
+    other.subcandidate_list_owner_ = false;
+  }
+  return *this;
+}
+
 const CandidateList &Candidate::subcandidate_list() const {
   DCHECK(subcandidate_list_);
   return *subcandidate_list_;
@@ -77,24 +98,61 @@ static constexpr size_t kDefaultPageSize = 9;
 CandidateList::CandidateList(const bool rotate)
     : page_size_(kDefaultPageSize),
       focused_index_(0),
-      candidate_pool_(kDefaultPageSize),
       next_available_id_(0),
       rotate_(rotate),
-      focused_(false) {}
+      focused_(false),
+      version_(NewVersion()) {}
 
 CandidateList::~CandidateList() { Clear(); }
 
 void CandidateList::Clear() {
-  for (Candidate *candidate : candidates_) {
-    candidate->Clear();
-    candidate_pool_.Release(candidate);
-  }
   candidates_.clear();
   focused_index_ = 0;
   focused_ = false;
   next_available_id_ = 0;
   added_candidates_.clear();
   alternative_ids_.clear();
+  id_to_index_.clear();
+  subcandidate_list_indices_.clear();
+  version_ = NewVersion();
+}
+
+// static
+uint64_t CandidateList::NewVersion() {
+  static std::atomic<uint64_t> next_version{1};
+  return next_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t CandidateList::version() const {
+  uint64_t result = version_;
+  for (const size_t index : subcandidate_list_indices_) {
+    result = std::max(result, candidate(index).subcandidate_list().version());
+  }
+  return result;
+}
+
+size_t CandidateList::EstimateMemoryUsage() const {
+  // Each slot of flat_hash_map has one byte of the control bits.
+  size_t size =
+      sizeof(*this) + name_.capacity() +
+      candidates_.capacity() * sizeof(Candidate) +
+      added_candidates_.capacity() *
+          (sizeof(decltype(added_candidates_)::value_type) + 1) +
+      alternative_ids_.capacity() *
+          (sizeof(decltype(alternative_ids_)::value_type) + 1) +
+      id_to_index_.capacity() *
+          (sizeof(decltype(id_to_index_)::value_type) + 1) +
+      subcandidate_list_indices_.capacity() * sizeof(size_t);
+  for (const size_t index : subcandidate_list_indices_) {
+    size += candidate(index).subcandidate_list().EstimateMemoryUsage();
+  }
+  return size;
+}
+
+Candidate *CandidateList::AddCandidateInternal() {
+  version_ = NewVersion();
+  candidates_.emplace_back();
+  return &candidates_.back();
 }
 
 const Candidate &CandidateList::GetDeepestFocusedCandidate() const {
@@ -127,33 +185,27 @@ void CandidateList::AddCandidateWithAttributes(const int id,
     alternative_ids_[id] = alt_id;
 
     // Add attributes to the existing candidate.
-    for (size_t i = 0; i < size(); ++i) {
-      if (candidate(i).id() == alt_id) {
-        candidates_[i]->add_attributes(attributes);
-      }
+    if (const auto it = id_to_index_.find(alt_id); it != id_to_index_.end()) {
+      candidates_[it->second].add_attributes(attributes);
+      version_ = NewVersion();
     }
     return;
   }
 
-  Candidate *new_candidate = candidate_pool_.Alloc();
-  candidates_.push_back(new_candidate);
-
+  id_to_index_.emplace(id, size());
+  Candidate *new_candidate = AddCandidateInternal();
   new_candidate->set_id(id);
   new_candidate->set_attributes(attributes);
 }
 
 void CandidateList::AddSubCandidateList(CandidateList *subcandidate_list) {
-  Candidate *new_candidate = candidate_pool_.Alloc();
-  candidates_.push_back(new_candidate);
-
-  new_candidate->set_subcandidate_list(subcandidate_list);
+  subcandidate_list_indices_.push_back(size());
+  AddCandidateInternal()->set_subcandidate_list(subcandidate_list);
 }
 
 CandidateList *CandidateList::AllocateSubCandidateList(const bool rotate) {
-  Candidate *new_candidate = candidate_pool_.Alloc();
-  candidates_.push_back(new_candidate);
-
-  return new_candidate->allocate_subcandidate_list(rotate);
+  subcandidate_list_indices_.push_back(size());
+  return AddCandidateInternal()->allocate_subcandidate_list(rotate);
 }
 
 int CandidateList::focused_id() const {
@@ -169,13 +221,11 @@ int CandidateList::focused_id() const {
 
 int CandidateList::next_available_id() const {
   int result = next_available_id_;
-  for (size_t i = 0; i < candidates_.size(); ++i) {
-    if (candidate(i).IsSubcandidateList()) {
-      const int sub_available_id =
-          candidate(i).subcandidate_list().next_available_id();
-      if (result < sub_available_id) {
-        result = sub_available_id;
-      }
+  for (const size_t index : subcandidate_list_indices_) {
+    const int sub_available_id =
+        candidate(index).subcandidate_list().next_available_id();
+    if (result < sub_available_id) {
+      result = sub_available_id;
     }
   }
   return result;
@@ -316,15 +366,15 @@ bool CandidateList::MoveToAttributes(const Attributes attributes) {
     // Shift the index to make the first index focused_index_.
     const size_t index = (focused_index_ + i) % cand_size;
 
-    Candidate *cand = candidates_[index];
+    Candidate &cand = candidates_[index];
 
     // If the candidate is a subcandidate list, the subcandidate list is
     // traversed recursively.
-    if (cand->IsSubcandidateList() &&
-        cand->mutable_subcandidate_list()->MoveToAttributes(attributes)) {
+    if (cand.IsSubcandidateList() &&
+        cand.mutable_subcandidate_list()->MoveToAttributes(attributes)) {
       focused_index_ = index;
       return true;
-    } else if (cand->has_attributes(attributes)) {
+    } else if (cand.has_attributes(attributes)) {
       focused_index_ = index;
       return true;
     }
@@ -343,22 +393,25 @@ bool CandidateList::MoveToId(const int base_id) {
     id = iter->second;
   }
 
-  // NOTE(komatsu): Although this function's order is O(N), The size
-  // of N is less than kMaxCandidateSize (= 200).  So it would not be
-  // a problem.
-  for (size_t i = 0; i < size(); ++i) {
-    Candidate *cand = candidates_[i];
-    // If the candidate is a subcandidate list, the subcandidate list is
-    // traversed recursively.
-    if (cand->IsSubcandidateList() &&
-        cand->mutable_subcandidate_list()->MoveToId(id)) {
-      focused_index_ = i;
-      return true;
-    } else if (cand->id() == id) {
+  const auto iter = id_to_index_.find(id);
+  const size_t index = iter == id_to_index_.end() ? size() : iter->second;
+
+  // Subcandidate lists placed before the candidate are traversed first, as
+  // the first match in the list order is focused.
+  for (const size_t i : subcandidate_list_indices_) {
+    if (i > index) {
+      break;
+    }
+    Candidate &cand = candidates_[i];
+    if (cand.mutable_subcandidate_list()->MoveToId(id) || cand.id() == id) {
       focused_index_ = i;
       return true;
     }
   }
+  if (index < size()) {
+    focused_index_ = index;
+    return true;
+  }
   return false;
 }
 
@@ -378,7 +431,7 @@ bool CandidateList::MoveToPageIndex(const size_t page_index) {
 
 CandidateList *CandidateList::mutable_focused_subcandidate_list() {
   CHECK(focused_candidate().IsSubcandidateList());
-  return candidates_[focused_index_]->mutable_subcandidate_list();
+  return candidates_[focused_index_].mutable_subcandidate_list();
 }
 
 bool CandidateList::IsLastPage(const size_t index) const {
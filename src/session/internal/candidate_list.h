@@ -33,13 +33,11 @@
 #define MOZC_SESSION_INTERNAL_CANDIDATE_LIST_H_
 
 #include <cstdint>
-#include <map>
-#include <memory>
 #include <string>
 #include <vector>
 
-#include "base/freelist.h"
 #include "base/port.h"
+#include "absl/container/flat_hash_map.h"
 
 namespace mozc {
 namespace session {
@@ -67,10 +65,13 @@ using Attributes = uint32_t;
 class Candidate final {
  public:
   Candidate() = default;
-  ~Candidate() = default;
+  ~Candidate() { Clear(); }
 
   Candidate(const Candidate &) = delete;
   Candidate &operator=(const Candidate &) = delete;
+  // The ownership of the subcandidate list is moved.
+  Candidate(Candidate &&other);
+  Candidate &operator=(Candidate &&other);
 
   void Clear();
 
@@ -117,16 +118,22 @@ class CandidateList final {
   void AddSubCandidateList(CandidateList *subcandidate_list);
   CandidateList *AllocateSubCandidateList(bool rotate);
 
-  void set_name(const std::string &name) { name_ = name; }
+  void set_name(const std::string &name) {
+    name_ = name;
+    version_ = NewVersion();
+  }
   const std::string &name() const { return name_; }
 
-  void set_page_size(size_t page_size) { page_size_ = page_size; }
+  void set_page_size(size_t page_size) {
+    page_size_ = page_size;
+    version_ = NewVersion();
+  }
   size_t page_size() const { return page_size_; }
 
   // Accessors
   size_t size() const { return candidates_.size(); }
   size_t last_index() const { return size() - 1; }
-  const Candidate &candidate(size_t index) const { return *candidates_[index]; }
+  const Candidate &candidate(size_t index) const { return candidates_[index]; }
   const Candidate &focused_candidate() const {
     return candidate(focused_index_);
   }
@@ -136,7 +143,20 @@ class CandidateList final {
   void GetPageRange(size_t index, size_t *page_begin, size_t *page_end) const;
 
   bool focused() const { return focused_; }
-  void set_focused(bool focused) { focused_ = focused; }
+  void set_focused(bool focused) {
+    focused_ = focused;
+    version_ = NewVersion();
+  }
+
+  // Returns a value which changes whenever the candidates of this list or its
+  // subcandidate lists are modified.  Moving the focus doesn't change it.
+  // The values are unique in the process, so outputs built from a candidate
+  // list can be cached with the version.
+  uint64_t version() const;
+
+  // Returns the estimated number of bytes held by this list and its
+  // subcandidate lists.
+  size_t EstimateMemoryUsage() const;
 
   // Operations
   void MoveFirst() { focused_index_ = 0; }
@@ -154,6 +174,9 @@ class CandidateList final {
 
  private:
   CandidateList *mutable_focused_subcandidate_list();
+  Candidate *AddCandidateInternal();
+
+  static uint64_t NewVersion();
 
   static bool IsFirst(size_t index) { return index == 0; }
   bool IsLast(size_t index) const { return index == size() - 1; }
@@ -163,22 +186,29 @@ class CandidateList final {
   size_t page_size_;
   size_t focused_index_;
   std::string name_;
-  ObjectPool<Candidate> candidate_pool_;
-  std::vector<Candidate *> candidates_;
+  std::vector<Candidate> candidates_;
 
   // Map marking added candidate values.  The keys are fingerprints of
   // the candidate values, the values of the map are candidate ids.
-  std::map<uint64_t, int> added_candidates_;
+  absl::flat_hash_map<uint64_t, int> added_candidates_;
 
   // Id-to-id map.  The key and value ids have the same candidate
   // value.  (ex. {id:0, value:"kanji"} and {id:-5, value:"kanji"}).
   // The key ids are not directly stored in candidates, so accessing
   // these ids, they should be converted with this map.
-  std::map<int, int> alternative_ids_;
+  absl::flat_hash_map<int, int> alternative_ids_;
+
+  // Id-to-index map of the candidates which are not subcandidate lists.
+  absl::flat_hash_map<int, size_t> id_to_index_;
+
+  // Indices of the candidates which are subcandidate lists, in ascending
+  // order.
+  std::vector<size_t> subcandidate_list_indices_;
 
   int next_available_id_;
   bool rotate_;
   bool focused_;
+  uint64_t version_;
 };
 
 }  // namespace session
@@ -469,5 +469,43 @@ TEST_F(CandidateListTest, NextAvailableId) {
   EXPECT_EQ(214, sub_sub_list_2_1_->next_available_id());
 }
 
+TEST_F(CandidateListTest, Version) {
+  uint64_t version = main_list_->version();
+
+  // Moving the focus doesn't change the version.
+  EXPECT_TRUE(main_list_->MoveToId(211));
+  EXPECT_TRUE(main_list_->MoveNextPage());
+  EXPECT_EQ(version, main_list_->version());
+
+  // Modifying a subcandidate list changes the version of the parent.
+  sub_sub_list_2_1_->AddCandidate(213, "213");
+  EXPECT_LT(version, main_list_->version());
+  version = main_list_->version();
+
+  main_list_->set_focused(true);
+  EXPECT_LT(version, main_list_->version());
+  version = main_list_->version();
+
+  main_list_->Clear();
+  EXPECT_LT(version, main_list_->version());
+}
+
+TEST_F(CandidateListTest, EstimateMemoryUsage) {
+  CandidateList list(true);
+  const size_t empty_size = list.EstimateMemoryUsage();
+  for (int i = 0; i < 100; ++i) {
+    list.AddCandidate(i, std::to_string(i));
+  }
+  const size_t size = list.EstimateMemoryUsage();
+  EXPECT_GT(size, empty_size + 100 * sizeof(Candidate));
+
+  // Subcandidate lists are included.
+  CandidateList *sub_list = list.AllocateSubCandidateList(false);
+  for (int i = 100; i < 200; ++i) {
+    sub_list->AddCandidate(i, std::to_string(i));
+  }
+  EXPECT_GT(list.EstimateMemoryUsage(), size + 100 * sizeof(Candidate));
+}
+
 }  // namespace session
 }  // namespace mozc
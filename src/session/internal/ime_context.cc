@@ -92,6 +92,17 @@ const config::Config &ImeContext::GetConfig() const {
   return *config_;
 }
 
+size_t ImeContext::EstimateMemoryUsage() const {
+  // SpaceUsedLong() includes the size of the message object itself, which is
+  // already counted in sizeof(*this).
+  return sizeof(*this) + (composer_ ? composer_->EstimateMemoryUsage() : 0) +
+         (converter_ ? converter_->EstimateMemoryUsage() : 0) +
+         (client_capability_.SpaceUsedLong() - sizeof(client_capability_)) +
+         (application_info_.SpaceUsedLong() - sizeof(application_info_)) +
+         (client_context_.SpaceUsedLong() - sizeof(client_context_)) +
+         (output_.SpaceUsedLong() - sizeof(output_));
+}
+
 // static
 void ImeContext::CopyContext(const ImeContext &src, ImeContext *dest) {
   DCHECK(dest);
@@ -33,6 +33,7 @@
 #ifndef MOZC_SESSION_INTERNAL_IME_CONTEXT_H_
 #define MOZC_SESSION_INTERNAL_IME_CONTEXT_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <utility>
@@ -126,6 +127,9 @@ class ImeContext final {
   const commands::Output &output() const { return output_; }
   commands::Output *mutable_output() { return &output_; }
 
+  // Returns the estimated number of bytes held by this context.
+  size_t EstimateMemoryUsage() const;
+
   // Copy |source| context to |destination| context.
   // TODO(hsumita): Renames it as CopyFrom and make it non-static to keep
   // consistency with other classes.
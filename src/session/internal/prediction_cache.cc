@@ -0,0 +1,146 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/internal/prediction_cache.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "base/clock.h"
+#include "base/hash.h"
+#include "composer/composer.h"
+#include "converter/segments.h"
+#include "dictionary/user_dictionary.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+std::atomic<uint64_t> g_generation{0};
+
+}  // namespace
+
+PredictionCache::PredictionCache(size_t max_size)
+    : cache_(max_size), generation_(GetCurrentGeneration()) {}
+
+// static
+uint64_t PredictionCache::GetSettingsFingerprint(
+    const commands::Request &request, const config::Config &config) {
+  return Hash::Fingerprint(
+      absl::StrCat(request.SerializeAsString(), config.SerializeAsString()));
+}
+
+// static
+uint64_t PredictionCache::GetKey(const ConversionRequest &request,
+                                 const Segments &segments,
+                                 uint64_t settings_fingerprint) {
+  const composer::Composer &composer = request.composer();
+  std::string query_for_prediction, query_for_conversion, raw;
+  composer.GetQueryForPrediction(&query_for_prediction);
+  composer.GetQueryForConversion(&query_for_conversion);
+  composer.GetRawString(&raw);
+  std::string key = absl::StrCat(
+      query_for_prediction, "\t", query_for_conversion, "\t", raw, "\t",
+      composer.GetCursor(), "\t", composer.GetLength(), "\t",
+      composer.GetInputMode(), "\t", composer.GetInputFieldType(), "\t",
+      request.request_type(), "\t", request.create_partial_candidates(),
+      request.use_actual_converter_for_realtime_conversion(),
+      request.enable_user_history_for_conversion(), "\t",
+      segments.max_history_segments_size(), segments.resized());
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &segment = segments.history_segment(i);
+    absl::StrAppend(&key, "\t", segment.segment_type(), segment.key());
+    if (segment.candidates_size() > 0) {
+      absl::StrAppend(&key, "\t", segment.candidate(0).value);
+    }
+  }
+  absl::StrAppend(&key, "\t", settings_fingerprint);
+  return Hash::Fingerprint(key);
+}
+
+// static
+void PredictionCache::InvalidateAll() { ++g_generation; }
+
+// static
+uint64_t PredictionCache::GetCurrentGeneration() {
+  // Both counters only increase, so the sum changes when either changes.
+  return g_generation.load() + dictionary::UserDictionary::GetGeneration();
+}
+
+void PredictionCache::MaybeInvalidate() {
+  const uint64_t generation = GetCurrentGeneration();
+  if (generation != generation_) {
+    cache_.Clear();
+    generation_ = generation;
+  }
+}
+
+bool PredictionCache::Lookup(uint64_t key, Segments *segments) {
+  MaybeInvalidate();
+  const Entry *cached = cache_.Lookup(key);
+  if (cached == nullptr) {
+    ++stats_.misses;
+    return false;
+  }
+  if (Clock::GetAbslTime() - cached->inserted_at > kMaxAge) {
+    cache_.Erase(key);
+    ++stats_.misses;
+    return false;
+  }
+  ++stats_.hits;
+  *segments = cached->segments;
+  return true;
+}
+
+void PredictionCache::Insert(uint64_t key, const Segments &segments) {
+  MaybeInvalidate();
+  cache_.Insert(key, Entry{segments, Clock::GetAbslTime()});
+}
+
+void PredictionCache::Clear() { cache_.Clear(); }
+
+size_t PredictionCache::EstimateMemoryUsage() const {
+  size_t size = sizeof(*this);
+  for (const auto *element = cache_.Head(); element != nullptr;
+       element = element->next) {
+    size += element->value.segments.EstimateMemoryUsage();
+  }
+  return size;
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,125 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Per-session cache of suggestion and prediction results.
+
+#ifndef MOZC_SESSION_INTERNAL_PREDICTION_CACHE_H_
+#define MOZC_SESSION_INTERNAL_PREDICTION_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "storage/lru_cache.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+
+// Clients often request predictions for the same input again, e.g., when the
+// user deletes a character and types it again, or when the same preedit is
+// sent by TestSendKey and SendKey.  This cache keeps the resulting segments
+// keyed by the query, the request type, the history segments, the request and
+// the config, so that the predictors are not called for such inputs.
+//
+// The results become stale when the engine learns something, e.g., on
+// commit, or when the user data is modified.  InvalidateAll() discards the
+// results of all the caches in the process, and so does an update of the
+// user dictionaries, which are reloaded asynchronously.  In addition, the
+// results expire after kMaxAge, so that changes of the data not tracked
+// above are reflected soon.
+class PredictionCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  static constexpr absl::Duration kMaxAge = absl::Seconds(10);
+
+  explicit PredictionCache(size_t max_size);
+  PredictionCache(const PredictionCache &) = delete;
+  PredictionCache &operator=(const PredictionCache &) = delete;
+  ~PredictionCache() = default;
+
+  // Returns the fingerprint of |request| and |config|.  Callers compute it
+  // when they are set, instead of on every key event.
+  static uint64_t GetSettingsFingerprint(const commands::Request &request,
+                                         const config::Config &config);
+
+  // Returns the key of the prediction for |request| and the history segments
+  // of |segments|.  |settings_fingerprint| is GetSettingsFingerprint() of
+  // request.request() and request.config().
+  static uint64_t GetKey(const ConversionRequest &request,
+                         const Segments &segments,
+                         uint64_t settings_fingerprint);
+
+  // Discards the results of all the caches.
+  static void InvalidateAll();
+
+  // Copies the cached result for |key| to |segments| and returns true if
+  // exists.
+  bool Lookup(uint64_t key, Segments *segments);
+
+  void Insert(uint64_t key, const Segments &segments);
+
+  void Clear();
+
+  // Returns the estimated number of bytes held by the cached results.
+  size_t EstimateMemoryUsage() const;
+
+  const Stats &stats() const { return stats_; }
+  void ResetStats() { stats_ = Stats(); }
+
+ private:
+  struct Entry {
+    Segments segments;
+    absl::Time inserted_at;
+  };
+
+  // Returns the generation of the data which the results depend on.
+  static uint64_t GetCurrentGeneration();
+
+  // Clears the cache if InvalidateAll() has been called or the user
+  // dictionaries have been updated since the last check.
+  void MaybeInvalidate();
+
+  storage::LruCache<uint64_t, Entry> cache_;
+  uint64_t generation_;
+  Stats stats_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_INTERNAL_PREDICTION_CACHE_H_
@@ -0,0 +1,160 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/internal/prediction_cache.h"
+
+#include <cstdint>
+#include <string>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/base/public/gunit.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+class PredictionCacheTest : public ::testing::Test {
+ protected:
+  PredictionCacheTest() : composer_(&table_, &request_, &config_) {}
+
+  uint64_t GetKey(const Segments &segments) {
+    ConversionRequest conversion_request(&composer_, &request_, &config_);
+    conversion_request.set_request_type(ConversionRequest::SUGGESTION);
+    return PredictionCache::GetKey(
+        conversion_request, segments,
+        PredictionCache::GetSettingsFingerprint(request_, config_));
+  }
+
+  static Segments MakeResult(const std::string &value) {
+    Segments segments;
+    Segment *segment = segments.add_segment();
+    segment->set_key("abc");
+    segment->add_candidate()->value = value;
+    return segments;
+  }
+
+  composer::Table table_;
+  commands::Request request_;
+  config::Config config_;
+  composer::Composer composer_;
+};
+
+TEST_F(PredictionCacheTest, LookupAndInsert) {
+  PredictionCache cache(2);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  const uint64_t key = GetKey(segments);
+
+  EXPECT_FALSE(cache.Lookup(key, &segments));
+  cache.Insert(key, MakeResult("ABC"));
+  ASSERT_TRUE(cache.Lookup(key, &segments));
+  ASSERT_EQ(1, segments.conversion_segments_size());
+  EXPECT_EQ("ABC", segments.conversion_segment(0).candidate(0).value);
+
+  EXPECT_EQ(1, cache.stats().hits);
+  EXPECT_EQ(1, cache.stats().misses);
+  cache.ResetStats();
+  EXPECT_EQ(0, cache.stats().hits);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Lookup(key, &segments));
+}
+
+TEST_F(PredictionCacheTest, GetKey) {
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  const uint64_t key = GetKey(segments);
+  EXPECT_EQ(key, GetKey(segments));
+
+  // The conversion segments are not a part of the key.
+  Segments with_conversion = MakeResult("ABC");
+  EXPECT_EQ(key, GetKey(with_conversion));
+
+  Segments with_history;
+  Segment *history = with_history.add_segment();
+  history->set_segment_type(Segment::HISTORY);
+  history->set_key("きのう");
+  history->add_candidate()->value = "昨日";
+  EXPECT_NE(key, GetKey(with_history));
+
+  config_.set_incognito_mode(true);
+  EXPECT_NE(key, GetKey(segments));
+  config_.clear_incognito_mode();
+
+  composer_.InsertCharacter("d");
+  EXPECT_NE(key, GetKey(segments));
+  composer_.Backspace();
+  EXPECT_EQ(key, GetKey(segments));
+}
+
+TEST_F(PredictionCacheTest, InvalidateAll) {
+  PredictionCache cache1(2);
+  PredictionCache cache2(2);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  const uint64_t key = GetKey(segments);
+  cache1.Insert(key, MakeResult("ABC"));
+  cache2.Insert(key, MakeResult("ABC"));
+
+  PredictionCache::InvalidateAll();
+  EXPECT_FALSE(cache1.Lookup(key, &segments));
+  EXPECT_FALSE(cache2.Lookup(key, &segments));
+
+  cache1.Insert(key, MakeResult("ABC"));
+  EXPECT_TRUE(cache1.Lookup(key, &segments));
+}
+
+TEST_F(PredictionCacheTest, Expire) {
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+  PredictionCache cache(2);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  const uint64_t key = GetKey(segments);
+  cache.Insert(key, MakeResult("ABC"));
+
+  clock.PutClockForward(absl::ToInt64Seconds(PredictionCache::kMaxAge), 0);
+  EXPECT_TRUE(cache.Lookup(key, &segments));
+  clock.PutClockForward(1, 0);
+  EXPECT_FALSE(cache.Lookup(key, &segments));
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
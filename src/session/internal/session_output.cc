@@ -124,14 +124,19 @@ void FillCandidateWord(const Segment::Candidate &segment_candidate,
 #endif  // NDEBUG
 }
 
+// If |sources| and |focusable| are not nullptr, the segment candidate of each
+// word and whether its candidate list is focused are stored to them.
 void FillAllCandidateWordsInternal(
     const Segment &segment, const CandidateList &candidate_list,
-    const int focused_id, commands::CandidateList *candidate_list_proto) {
+    const int focused_id, commands::CandidateList *candidate_list_proto,
+    std::vector<const Segment::Candidate *> *sources = nullptr,
+    std::vector<bool> *focusable = nullptr) {
   for (size_t i = 0; i < candidate_list.size(); ++i) {
     const Candidate &candidate = candidate_list.candidate(i);
     if (candidate.IsSubcandidateList()) {
       FillAllCandidateWordsInternal(segment, candidate.subcandidate_list(),
-                                    focused_id, candidate_list_proto);
+                                    focused_id, candidate_list_proto, sources,
+                                    focusable);
       continue;
     }
 
@@ -155,11 +160,53 @@ void FillAllCandidateWordsInternal(
     const Segment::Candidate &segment_candidate = segment.candidate(id);
     FillCandidateWord(segment_candidate, id, index, segment.key(),
                       candidate_word_proto);
+    if (sources != nullptr && focusable != nullptr) {
+      sources->push_back(&segment_candidate);
+      focusable->push_back(candidate_list.focused());
+    }
   }
 }
 
 }  // namespace
 
+void CandidateWordCache::Clear() {
+  segment_ = nullptr;
+  segment_size_ = 0;
+  version_ = 0;
+  candidates_.clear();
+  has_all_candidate_words_ = false;
+  all_candidate_words_.Clear();
+  all_candidate_sources_.clear();
+  focusable_.clear();
+}
+
+size_t CandidateWordCache::EstimateMemoryUsage() const {
+  size_t size =
+      sizeof(*this) +
+      (candidates_.capacity() - candidates_.size()) * sizeof(candidates_[0]) +
+      (all_candidate_words_.SpaceUsedLong() - sizeof(all_candidate_words_)) +
+      all_candidate_sources_.capacity() * sizeof(const Segment::Candidate *) +
+      focusable_.capacity() / 8;
+  for (const auto &entry : candidates_) {
+    size += sizeof(entry.source) + entry.proto.SpaceUsedLong();
+  }
+  return size;
+}
+
+void CandidateWordCache::Validate(const Segment &segment,
+                                  const CandidateList &candidate_list) {
+  const uint64_t version = candidate_list.version();
+  if (segment_ == &segment && segment_size_ == segment.candidates_size() &&
+      version_ == version) {
+    return;
+  }
+  Clear();
+  segment_ = &segment;
+  segment_size_ = segment.candidates_size();
+  version_ = version;
+  candidates_.resize(candidate_list.size());
+}
+
 // static
 void SessionOutput::FillCandidate(
     const Segment &segment, const Candidate &candidate,
@@ -192,6 +239,18 @@ void SessionOutput::FillCandidates(const Segment &segment,
                                    const CandidateList &candidate_list,
                                    const size_t position,
                                    commands::Candidates *candidates_proto) {
+  FillCandidates(segment, candidate_list, position, nullptr, candidates_proto);
+}
+
+// static
+void SessionOutput::FillCandidates(const Segment &segment,
+                                   const CandidateList &candidate_list,
+                                   const size_t position,
+                                   CandidateWordCache *cache,
+                                   commands::Candidates *candidates_proto) {
+  if (cache != nullptr) {
+    cache->Validate(segment, candidate_list);
+  }
   if (candidate_list.focused()) {
     candidates_proto->set_focused_index(candidate_list.focused_index());
   }
@@ -215,8 +274,22 @@ void SessionOutput::FillCandidates(const Segment &segment,
     }
     commands::Candidates_Candidate *candidate_proto =
         candidates_proto->add_candidate();
-    candidate_proto->set_index(i);
-    FillCandidate(segment, candidate, candidate_proto);
+    // Subcandidate lists are always filled as their focused ids can change.
+    if (cache == nullptr || candidate.IsSubcandidateList()) {
+      candidate_proto->set_index(i);
+      FillCandidate(segment, candidate, candidate_proto);
+      continue;
+    }
+    CandidateWordCache::Entry<commands::Candidates_Candidate> &entry =
+        cache->candidates_[i];
+    const Segment::Candidate *source = &segment.candidate(candidate.id());
+    if (entry.source != source) {
+      entry.proto.Clear();
+      entry.proto.set_index(i);
+      FillCandidate(segment, candidate, &entry.proto);
+      entry.source = source;
+    }
+    *candidate_proto = entry.proto;
   }
 
   // Store subcandidates.
@@ -242,6 +315,61 @@ void SessionOutput::FillAllCandidateWords(
                                 candidate_list_proto);
 }
 
+// static
+void SessionOutput::FillAllCandidateWords(
+    const Segment &segment, const CandidateList &candidate_list,
+    const commands::Category category, CandidateWordCache *cache,
+    commands::CandidateList *candidate_list_proto) {
+  if (cache == nullptr) {
+    FillAllCandidateWords(segment, candidate_list, category,
+                          candidate_list_proto);
+    return;
+  }
+  cache->Validate(segment, candidate_list);
+
+  const commands::CandidateList &words = cache->all_candidate_words_;
+  if (cache->has_all_candidate_words_) {
+    for (size_t i = 0; i < words.candidates_size(); ++i) {
+      const int id = words.candidates(i).id();
+      if (!segment.is_valid_index(id) ||
+          &segment.candidate(id) != cache->all_candidate_sources_[i]) {
+        cache->has_all_candidate_words_ = false;
+        break;
+      }
+    }
+  }
+  if (!cache->has_all_candidate_words_) {
+    cache->all_candidate_words_.Clear();
+    cache->all_candidate_sources_.clear();
+    cache->focusable_.clear();
+    FillAllCandidateWordsInternal(segment, candidate_list,
+                                  candidate_list.focused_id(),
+                                  &cache->all_candidate_words_,
+                                  &cache->all_candidate_sources_,
+                                  &cache->focusable_);
+    if (cache->all_candidate_sources_.size() !=
+        cache->all_candidate_words_.candidates_size()) {
+      // The segment and the candidate list are inconsistent.  Don't cache the
+      // partially filled words.
+      cache->all_candidate_words_.Clear();
+      FillAllCandidateWords(segment, candidate_list, category,
+                            candidate_list_proto);
+      return;
+    }
+    cache->all_candidate_words_.clear_focused_index();
+    cache->has_all_candidate_words_ = true;
+  }
+
+  *candidate_list_proto = words;
+  candidate_list_proto->set_category(category);
+  const int focused_id = candidate_list.focused_id();
+  for (size_t i = 0; i < words.candidates_size(); ++i) {
+    if (cache->focusable_[i] && words.candidates(i).id() == focused_id) {
+      candidate_list_proto->set_focused_index(i);
+    }
+  }
+}
+
 // static
 void SessionOutput::FillRemovedCandidates(
     const Segment &segment, commands::CandidateList *candidate_list_proto) {
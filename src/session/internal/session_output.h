@@ -34,16 +34,15 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
+#include "converter/segments.h"
 #include "protocol/candidates.pb.h"
 #include "protocol/commands.pb.h"
 
 namespace mozc {
 
-class Segment;
-class Segments;
-
 namespace composer {
 class Composer;
 }
@@ -53,6 +52,51 @@ namespace session {
 class CandidateList;
 class Candidate;
 
+// Cache of the candidate words filled by SessionOutput.  The words only
+// depend on the segment and the candidate list, so they are reused while
+// neither of them is modified, e.g. on focus movement, paging and rendering
+// the same page again.
+class CandidateWordCache {
+ public:
+  CandidateWordCache() = default;
+  CandidateWordCache(const CandidateWordCache &) = delete;
+  CandidateWordCache &operator=(const CandidateWordCache &) = delete;
+
+  void Clear();
+
+  // Returns the estimated number of bytes held by this cache.
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  friend class SessionOutput;
+
+  // A filled word and the segment candidate it was filled from.  The source
+  // is compared on lookup to detect in-place updates of the segment.
+  template <typename Proto>
+  struct Entry {
+    const Segment::Candidate *source = nullptr;
+    Proto proto;
+  };
+
+  // Clears the cache if the segment or the candidate list has been changed
+  // since the last call.
+  void Validate(const Segment &segment, const CandidateList &candidate_list);
+
+  const Segment *segment_ = nullptr;
+  size_t segment_size_ = 0;
+  uint64_t version_ = 0;
+
+  // Candidates of the top level list indexed by their index in the list.
+  std::vector<Entry<commands::Candidates_Candidate>> candidates_;
+
+  // All candidate words without focused_index.  focusable_[i] is true if the
+  // list containing the i-th word is focused.
+  bool has_all_candidate_words_ = false;
+  commands::CandidateList all_candidate_words_;
+  std::vector<const Segment::Candidate *> all_candidate_sources_;
+  std::vector<bool> focusable_;
+};
+
 class SessionOutput {
  public:
   // Fill the Candidates_Candidate protobuf with the contents of candidate.
@@ -64,6 +108,11 @@ class SessionOutput {
                              const CandidateList &candidate_list,
                              size_t position,
                              commands::Candidates *candidates_proto);
+  // Same as above, but reuses the candidates filled before in |cache|.
+  static void FillCandidates(const Segment &segment,
+                             const CandidateList &candidate_list,
+                             size_t position, CandidateWordCache *cache,
+                             commands::Candidates *candidates_proto);
 
   // Fill the CandidateList protobuf with the contents of
   // candidate_list.  Candidates in the candidate_list are flatten
@@ -72,6 +121,11 @@ class SessionOutput {
       const Segment &segment, const CandidateList &candidate_list,
       const commands::Category category,
       commands::CandidateList *candidate_list_proto);
+  // Same as above, but reuses the candidate words filled before in |cache|.
+  static void FillAllCandidateWords(
+      const Segment &segment, const CandidateList &candidate_list,
+      commands::Category category, CandidateWordCache *cache,
+      commands::CandidateList *candidate_list_proto);
 
   // For debug. Fill the CandidateList protobuf with the
   // removed_candidates_for_debug in the segment.
@@ -206,6 +206,64 @@ TEST(SessionOutputTest, FillCandidates) {
   EXPECT_FALSE(candidates_proto.subcandidates().has_focused_index());
 }
 
+TEST(SessionOutputTest, FillCandidatesWithCache) {
+  Segment segment;
+  CandidateList candidate_list(true);
+  for (int i = 0; i < 20; ++i) {
+    const std::string value = std::to_string(i);
+    segment.push_back_candidate()->value = value;
+    candidate_list.AddCandidate(i, value);
+  }
+  CandidateList *transliterations = candidate_list.AllocateSubCandidateList(
+      false);
+  transliterations->set_name("Subcandidates");
+  for (int i = 0; i < 3; ++i) {
+    segment.add_meta_candidate()->value = "t13n" + std::to_string(i);
+    transliterations->AddCandidate(-(i + 1), "t13n" + std::to_string(i));
+  }
+  candidate_list.set_focused(true);
+  candidate_list.set_page_size(9);
+
+  CandidateWordCache cache;
+  auto expect_same_output = [&]() {
+    commands::Candidates expected, actual;
+    SessionOutput::FillCandidates(segment, candidate_list, 0, &expected);
+    SessionOutput::FillCandidates(segment, candidate_list, 0, &cache, &actual);
+    EXPECT_EQ(expected.SerializeAsString(), actual.SerializeAsString());
+
+    commands::CandidateList expected_words, actual_words;
+    SessionOutput::FillAllCandidateWords(segment, candidate_list,
+                                         commands::CONVERSION, &expected_words);
+    SessionOutput::FillAllCandidateWords(segment, candidate_list,
+                                         commands::CONVERSION, &cache,
+                                         &actual_words);
+    EXPECT_EQ(expected_words.SerializeAsString(),
+              actual_words.SerializeAsString());
+  };
+
+  // Focus movement and paging reuse the cache.
+  expect_same_output();
+  candidate_list.MoveNext();
+  expect_same_output();
+  candidate_list.MoveNextPage();
+  expect_same_output();
+  candidate_list.MoveToId(-2);
+  expect_same_output();
+  candidate_list.MovePrevPage();
+  expect_same_output();
+
+  // Updates of the segment are reflected.
+  *segment.insert_candidate(1) = *segment.mutable_candidate(3);
+  expect_same_output();
+
+  // Updates of the candidate list are reflected.
+  candidate_list.Clear();
+  candidate_list.AddCandidate(0, "0");
+  candidate_list.AddCandidate(2, "2");
+  candidate_list.set_focused(true);
+  expect_same_output();
+}
+
 TEST(SessionOutputTest, FillAllCandidateWords) {
   // IDs are ordered by BFS.
   //
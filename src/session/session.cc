@@ -1401,6 +1401,28 @@ uint64_t Session::last_command_time() const {
   return context_->last_command_time();
 }
 
+size_t Session::EstimateMemoryUsage() const {
+  size_t size = sizeof(*this) + context_->EstimateMemoryUsage();
+  if (prev_context_) {
+    size += prev_context_->EstimateMemoryUsage();
+  }
+  return size;
+}
+
+void Session::FillMemoryUsage(commands::SessionMemoryUsage *usage) const {
+  usage->set_total_bytes(EstimateMemoryUsage());
+  usage->set_composer_bytes(context_->composer().EstimateMemoryUsage());
+  usage->set_converter_bytes(context_->converter().EstimateMemoryUsage());
+  usage->set_undo_context_bytes(
+      prev_context_ ? prev_context_->EstimateMemoryUsage() : 0);
+}
+
+void Session::ReduceMemoryUsage() {
+  // Undo is no longer available after this.
+  ClearUndoContext();
+  context_->mutable_converter()->ReduceMemoryUsage();
+}
+
 bool Session::InsertCharacter(commands::Command *command) {
   if (!command->input().has_key()) {
     LOG(ERROR) << "No key event: " << command->input().DebugString();
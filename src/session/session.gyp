@@ -39,6 +39,7 @@
       'sources': [
         'session.cc',
         'session_converter.cc',
+        'speculative_converter.cc',
       ],
       'dependencies': [
         '../base/absl.gyp:absl_strings',
@@ -65,6 +66,7 @@
       'sources': [
         'internal/candidate_list.cc',
         'internal/ime_context.cc',
+        'internal/prediction_cache.cc',
         'internal/session_output.cc',
         'internal/key_event_transformer.cc',
       ],
@@ -73,8 +75,11 @@
         '../base/base.gyp:base',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:config_handler',
+        '../converter/converter_base.gyp:segments',
+        '../dictionary/dictionary_base.gyp:user_dictionary',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
+        '../request/request.gyp:conversion_request',
       ],
     },
     {
@@ -264,6 +264,10 @@ class Session : public SessionInterface {
   // return 0 (default value) if no command is executed in this session.
   uint64_t last_command_time() const override;
 
+  size_t EstimateMemoryUsage() const override;
+  void FillMemoryUsage(commands::SessionMemoryUsage *usage) const override;
+  void ReduceMemoryUsage() override;
+
   // TODO(komatsu): delete this function.
   // For unittest only
   mozc::composer::Composer *get_internal_composer_only_for_unittest();
@@ -34,9 +34,11 @@
 #include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/text_normalizer.h"
@@ -51,12 +53,15 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "session/internal/candidate_list.h"
+#include "session/internal/prediction_cache.h"
 #include "session/internal/session_output.h"
 #include "session/session_usage_stats_util.h"
+#include "session/speculative_converter.h"
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
+#include "absl/time/time.h"
 
 using mozc::usage_stats::UsageStats;
 
@@ -71,6 +76,19 @@ ABSL_FLAG(bool, use_actual_converter_for_realtime_conversion,
           "If true, use the actual (non-immutable) converter for real "
           "time conversion.");
 
+ABSL_FLAG(int32_t, prediction_deadline_ms, 0,
+          "Latency budget of suggestion and prediction in milliseconds.  "
+          "Expensive stages of prediction are skipped when the deadline is "
+          "near.  0 means no deadline.");
+
+ABSL_FLAG(int32_t, prediction_cache_size, 8,
+          "The number of suggestion and prediction results cached in each "
+          "session.  0 disables the cache.");
+
+ABSL_FLAG(bool, use_speculative_conversion, false,
+          "If true, start conversion in background while suggesting so that "
+          "the result is ready when the user converts the composition.");
+
 namespace mozc {
 namespace session {
 
@@ -113,6 +131,16 @@ const ConversionRequest CreateIncognitoConversionRequest(
   return request;
 }
 
+// Returns nullptr when --prediction_cache_size is 0.
+std::unique_ptr<PredictionCache> CreatePredictionCache() {
+  const int32_t prediction_cache_size =
+      absl::GetFlag(FLAGS_prediction_cache_size);
+  if (prediction_cache_size <= 0) {
+    return nullptr;
+  }
+  return std::make_unique<PredictionCache>(prediction_cache_size);
+}
+
 }  // namespace
 
 const size_t SessionConverter::kConsumedAllCharacters =
@@ -127,6 +155,7 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
       segment_index_(0),
       result_(new commands::Result),
       candidate_list_(new CandidateList(true)),
+      candidate_word_cache_(new CandidateWordCache),
       request_(request),
       state_(COMPOSITION),
       request_type_(ConversionRequest::CONVERSION),
@@ -136,6 +165,7 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
   conversion_preferences_.max_history_size = kDefaultMaxHistorySize;
   conversion_preferences_.request_suggestion = true;
   candidate_list_->set_page_size(request->candidate_page_size());
+  prediction_cache_ = CreatePredictionCache();
   SetConfig(config);
 }
 
@@ -167,8 +197,13 @@ bool SessionConverter::ConvertWithPreferences(
   SetConversionPreferences(preferences, segments_.get(), &conversion_request);
   SetRequestType(ConversionRequest::CONVERSION, &conversion_request);
 
-  if (!converter_->StartConversionForRequest(conversion_request,
-                                             segments_.get())) {
+  const bool speculated =
+      speculative_converter_ != nullptr &&
+      speculative_converter_->TakeResult(composer, *request_, *config_,
+                                         preferences.use_history,
+                                         segments_.get());
+  if (!speculated && !converter_->StartConversionForRequest(
+                         conversion_request, segments_.get())) {
     LOG(WARNING) << "StartConversionForRequest() failed";
     ResetState();
     return false;
@@ -442,6 +477,19 @@ bool SessionConverter::SuggestWithPreferences(
 
   segments_->clear_conversion_segments();
 
+  if (absl::GetFlag(FLAGS_use_speculative_conversion)) {
+    // Conversion usually follows suggestion, so converts the composition in
+    // background with the preferences used by Convert().
+    if (speculative_converter_ == nullptr) {
+      speculative_converter_ =
+          std::make_unique<SpeculativeConverter>(converter_);
+    }
+    speculative_converter_->Start(composer, *request_, *config_,
+                                  conversion_preferences_.use_history,
+                                  conversion_preferences_.max_history_size,
+                                  *segments_);
+  }
+
   const size_t cursor = composer.GetCursor();
 
   // We have four (2x2) conditions for
@@ -477,18 +525,33 @@ bool SessionConverter::SuggestWithPreferences(
       SetRequestType(ConversionRequest::SUGGESTION, &conversion_request);
     }
   }
+  SetPredictionDeadline(&conversion_request);
+
   // Start actual suggestion/prediction.
-  bool result;
-  if (use_partial_composition) {
-    result = converter_->StartPartialPredictionForRequest(conversion_request,
-                                                          segments_.get());
-  } else {
-    if (use_prediction_candidate) {
-      result = converter_->StartPredictionForRequest(conversion_request,
-                                                     segments_.get());
+  uint64_t cache_key = 0;
+  bool result = false;
+  if (prediction_cache_ != nullptr) {
+    cache_key = PredictionCache::GetKey(conversion_request, *segments_,
+                                        settings_fingerprint_);
+    result = prediction_cache_->Lookup(cache_key, segments_.get());
+  }
+  if (!result) {
+    if (use_partial_composition) {
+      result = converter_->StartPartialPredictionForRequest(conversion_request,
+                                                            segments_.get());
     } else {
-      result = converter_->StartSuggestionForRequest(conversion_request,
-                                                     segments_.get());
+      if (use_prediction_candidate) {
+        result = converter_->StartPredictionForRequest(conversion_request,
+                                                       segments_.get());
+      } else {
+        result = converter_->StartSuggestionForRequest(conversion_request,
+                                                       segments_.get());
+      }
+    }
+    // Best-effort results are not cached so that the next request can get
+    // the complete one.
+    if (result && prediction_cache_ != nullptr && !segments_->degraded()) {
+      prediction_cache_->Insert(cache_key, *segments_);
     }
   }
   if (!result) {
@@ -574,8 +637,22 @@ bool SessionConverter::PredictWithPreferences(
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         absl::GetFlag(FLAGS_use_actual_converter_for_realtime_conversion));
     SetRequestType(ConversionRequest::PREDICTION, &conversion_request);
-    if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+    SetPredictionDeadline(&conversion_request);
+    uint64_t cache_key = 0;
+    bool result = false;
+    if (prediction_cache_ != nullptr) {
+      cache_key = PredictionCache::GetKey(conversion_request, *segments_,
+                                          settings_fingerprint_);
+      result = prediction_cache_->Lookup(cache_key, segments_.get());
+    }
+    if (!result) {
+      result = converter_->StartPredictionForRequest(conversion_request,
+                                                     segments_.get());
+      if (result && prediction_cache_ != nullptr && !segments_->degraded()) {
+        prediction_cache_->Insert(cache_key, *segments_);
+      }
+    }
+    if (!result) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
 
       // TODO(komatsu): Perform refactoring after checking the stability test.
@@ -672,6 +749,7 @@ void SessionConverter::Commit(const composer::Composer &composer,
   CommitUsageStats(state_, context);
   ConversionRequest conversion_request(&composer, request_, config_);
   converter_->FinishConversion(conversion_request, segments_.get());
+  PredictionCache::InvalidateAll();
   ResetState();
 }
 
@@ -722,6 +800,7 @@ bool SessionConverter::CommitSuggestionInternal(
     CommitUsageStats(SessionConverterInterface::SUGGESTION, context);
     ConversionRequest conversion_request(&composer, request_, config_);
     converter_->FinishConversion(conversion_request, segments_.get());
+    PredictionCache::InvalidateAll();
     DCHECK_EQ(0, segments_->conversion_segments_size());
     ResetState();
   }
@@ -845,6 +924,7 @@ void SessionConverter::CommitPreedit(const composer::Composer &composer,
   // CONVERSION from SUGGESTION now.
   SetRequestType(ConversionRequest::CONVERSION, &conversion_request);
   converter_->FinishConversion(conversion_request, segments_.get());
+  PredictionCache::InvalidateAll();
   ResetState();
 }
 
@@ -865,6 +945,7 @@ void SessionConverter::CommitHead(size_t count,
 
 void SessionConverter::Revert() {
   converter_->RevertConversion(segments_.get());
+  PredictionCache::InvalidateAll();
 }
 
 void SessionConverter::SegmentFocusInternal(size_t index) {
@@ -1166,6 +1247,15 @@ void SessionConverter::SetConversionPreferences(
   request->set_enable_user_history_for_conversion(preferences.use_history);
 }
 
+// static
+void SessionConverter::SetPredictionDeadline(ConversionRequest *request) {
+  const int32_t deadline_ms = absl::GetFlag(FLAGS_prediction_deadline_ms);
+  if (deadline_ms > 0) {
+    request->set_deadline(Clock::GetAbslTime() +
+                          absl::Milliseconds(deadline_ms));
+  }
+}
+
 SessionConverter *SessionConverter::Clone() const {
   SessionConverter *session_converter =
       new SessionConverter(converter_, request_, config_);
@@ -1186,6 +1276,7 @@ SessionConverter *SessionConverter::Clone() const {
   *session_converter->result_ = *result_;
   session_converter->request_ = request_;
   session_converter->config_ = config_;
+  session_converter->settings_fingerprint_ = settings_fingerprint_;
   session_converter->use_cascading_window_ = use_cascading_window_;
   session_converter->selected_candidate_indices_ = selected_candidate_indices_;
 
@@ -1201,6 +1292,38 @@ SessionConverter *SessionConverter::Clone() const {
 
 void SessionConverter::ResetResult() { result_->Clear(); }
 
+size_t SessionConverter::EstimateMemoryUsage() const {
+  size_t size = sizeof(*this) + segments_->EstimateMemoryUsage() +
+                incognito_segments_->EstimateMemoryUsage() +
+                (previous_suggestions_.EstimateMemoryUsage() -
+                 sizeof(previous_suggestions_)) +
+                result_->SpaceUsedLong() +
+                candidate_list_->EstimateMemoryUsage() +
+                candidate_word_cache_->EstimateMemoryUsage() +
+                selected_candidate_indices_.capacity() * sizeof(int);
+  if (prediction_cache_ != nullptr) {
+    size += prediction_cache_->EstimateMemoryUsage();
+  }
+  return size;
+}
+
+void SessionConverter::ReduceMemoryUsage() {
+  // The cached objects keep their buffers after Clear(), so they are
+  // recreated.
+  if (prediction_cache_ != nullptr) {
+    prediction_cache_ = CreatePredictionCache();
+  }
+  candidate_word_cache_ = std::make_unique<CandidateWordCache>();
+  segments_->clear_cached_lattice();
+  incognito_segments_->clear_cached_lattice();
+  if (!IsActive()) {
+    // Only the history segments are needed in the composition state.
+    segments_->clear_conversion_segments();
+    previous_suggestions_.clear();
+    incognito_segments_->Clear();
+  }
+}
+
 void SessionConverter::ResetState() {
   state_ = COMPOSITION;
   segment_index_ = 0;
@@ -1492,7 +1615,7 @@ void SessionConverter::FillCandidates(commands::Candidates *candidates) const {
 
   const Segment &segment = segments_->conversion_segment(segment_index_);
   SessionOutput::FillCandidates(segment, *candidate_list_, position,
-                                candidates);
+                                candidate_word_cache_.get(), candidates);
 
   // Shortcut keys
   if (CheckState(PREDICTION | CONVERSION)) {
@@ -1524,6 +1647,10 @@ void SessionConverter::FillCandidates(commands::Candidates *candidates) const {
       break;
   }
 
+  if (segments_->degraded()) {
+    candidates->set_degraded(true);
+  }
+
   if (candidates->has_usages()) {
     candidates->mutable_usages()->set_category(commands::USAGE);
   }
@@ -1584,7 +1711,7 @@ void SessionConverter::FillAllCandidateWords(
   }
   const Segment &segment = segments_->conversion_segment(segment_index_);
   SessionOutput::FillAllCandidateWords(segment, *candidate_list_, category,
-                                       candidates);
+                                       candidate_word_cache_.get(), candidates);
 }
 
 void SessionConverter::FillIncognitoCandidateWords(
@@ -1606,6 +1733,8 @@ void SessionConverter::FillIncognitoCandidateWords(
 void SessionConverter::SetRequest(const commands::Request *request) {
   request_ = request;
   candidate_list_->set_page_size(request->candidate_page_size());
+  settings_fingerprint_ =
+      PredictionCache::GetSettingsFingerprint(*request_, *config_);
 }
 
 void SessionConverter::SetConfig(const config::Config *config) {
@@ -1613,6 +1742,8 @@ void SessionConverter::SetConfig(const config::Config *config) {
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   selection_shortcut_ = config->selection_shortcut();
   use_cascading_window_ = config->use_cascading_window();
+  settings_fingerprint_ =
+      PredictionCache::GetSettingsFingerprint(*request_, *config_);
 }
 
 void SessionConverter::OnStartComposition(const commands::Context &context) {
@@ -57,6 +57,9 @@ class Config;
 
 namespace session {
 class CandidateList;
+class CandidateWordCache;
+class PredictionCache;
+class SpeculativeConverter;
 
 // Class handling ConverterInterface with a session state.  This class
 // support stateful operations related with the converter.
@@ -264,6 +267,9 @@ class SessionConverter : public SessionConverterInterface {
     use_cascading_window_ = use_cascading_window;
   }
 
+  size_t EstimateMemoryUsage() const override;
+  void ReduceMemoryUsage() override;
+
   // Meaning that all the composition characters are consumed.
   // c.f. CommitSuggestionInternal
   static const size_t kConsumedAllCharacters;
@@ -361,6 +367,10 @@ class SessionConverter : public SessionConverterInterface {
   void SetRequestType(ConversionRequest::RequestType request_type,
                       ConversionRequest *conversion_request);
 
+  // Sets the deadline of suggestion and prediction from
+  // --prediction_deadline_ms.
+  static void SetPredictionDeadline(ConversionRequest *request);
+
   // Creates a config for incognito mode from the current config.
   const config::Config CreateIncognitoConfig();
 
@@ -377,8 +387,14 @@ class SessionConverter : public SessionConverterInterface {
 
   std::unique_ptr<CandidateList> candidate_list_;
 
+  // Caches the candidate words filled from |candidate_list_| to the output.
+  std::unique_ptr<CandidateWordCache> candidate_word_cache_;
+
   const commands::Request *request_;
   const config::Config *config_;
+  // PredictionCache::GetSettingsFingerprint() of |request_| and |config_|,
+  // updated by SetRequest() and SetConfig().
+  uint64_t settings_fingerprint_;
 
   SessionConverterInterface::State state_;
 
@@ -390,6 +406,14 @@ class SessionConverter : public SessionConverterInterface {
   // Default conversion preferences.
   ConversionPreferences conversion_preferences_;
 
+  // Caches the results of suggestion and prediction.  nullptr when
+  // --prediction_cache_size is 0.
+  std::unique_ptr<PredictionCache> prediction_cache_;
+
+  // Converts the composition in background while suggesting.  Created
+  // lazily when --use_speculative_conversion is enabled.
+  std::unique_ptr<SpeculativeConverter> speculative_converter_;
+
   config::Config::SelectionShortcut selection_shortcut_;
 
   // Selected index data of each segments for usage stats.
@@ -32,6 +32,7 @@
 #ifndef MOZC_SESSION_SESSION_CONVERTER_INTERFACE_H_
 #define MOZC_SESSION_SESSION_CONVERTER_INTERFACE_H_
 
+#include <cstddef>
 #include <string>
 
 #include "base/port.h"
@@ -246,6 +247,13 @@ class SessionConverterInterface {
 
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
 
+  // Returns the estimated number of bytes held by the converter.
+  virtual size_t EstimateMemoryUsage() const { return 0; }
+
+  // Releases the caches which can be rebuilt, e.g., the prediction cache and
+  // the cached lattice.  The state of the current conversion is kept.
+  virtual void ReduceMemoryUsage() {}
+
  private:
   DISALLOW_COPY_AND_ASSIGN(SessionConverterInterface);
 };
@@ -57,7 +57,9 @@
 #include "protocol/config.pb.h"
 #include "session/internal/candidate_list.h"
 #include "session/internal/keymap.h"
+#include "session/internal/prediction_cache.h"
 #include "session/request_test_util.h"
+#include "session/speculative_converter.h"
 #include "testing/base/public/gmock.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
@@ -66,8 +68,12 @@
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
 #include "absl/flags/flag.h"
+#include "absl/flags/reflection.h"
 #include "absl/strings/string_view.h"
 
+ABSL_DECLARE_FLAG(int32_t, prediction_cache_size);
+ABSL_DECLARE_FLAG(bool, use_speculative_conversion);
+
 namespace mozc {
 namespace session {
 
@@ -138,6 +144,16 @@ class SessionConverterTest : public ::testing::Test {
     return *converter.segments_;
   }
 
+  static const PredictionCache::Stats &GetPredictionCacheStats(
+      const SessionConverter &converter) {
+    return converter.prediction_cache_->stats();
+  }
+
+  static void WaitForSpeculativeConversion(const SessionConverter &converter) {
+    ASSERT_NE(nullptr, converter.speculative_converter_);
+    converter.speculative_converter_->WaitForTesting();
+  }
+
   static void SetSegments(const Segments &src, SessionConverter *converter) {
     CHECK(converter);
     *converter->segments_ = src;
@@ -475,6 +491,40 @@ TEST_F(SessionConverterTest, Convert) {
   EXPECT_COUNT_STATS("ConversionCandidates0", 1);
 }
 
+TEST_F(SessionConverterTest, ReduceMemoryUsage) {
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+  {
+    Segments segments;
+    SetAiueo(&segments);
+    FillT13Ns(&segments, composer_.get());
+    EXPECT_CALL(mock_converter, StartConversionForRequest(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  }
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  converter.CandidateNext(*composer_);
+  commands::Output output;
+  converter.FillOutput(*composer_, &output);
+  const size_t size = converter.EstimateMemoryUsage();
+  EXPECT_GT(size, sizeof(converter));
+
+  // The current conversion is kept.
+  converter.ReduceMemoryUsage();
+  ASSERT_TRUE(converter.IsActive());
+  output.Clear();
+  converter.FillOutput(*composer_, &output);
+  ASSERT_TRUE(output.has_candidates());
+  EXPECT_EQ(kChars_Aiueo, output.preedit().segment(0).key());
+
+  // The conversion segments are released after the conversion.
+  converter.Cancel();
+  EXPECT_FALSE(converter.IsActive());
+  converter.ReduceMemoryUsage();
+  EXPECT_LT(converter.EstimateMemoryUsage(), size);
+}
+
 TEST_F(SessionConverterTest, ConvertWithSpellingCorrection) {
   MockConverter mock_converter;
   SessionConverter converter(&mock_converter, request_.get(), config_.get());
@@ -1578,7 +1628,74 @@ TEST_F(SessionConverterTest, CommitPreedit) {
   EXPECT_COUNT_STATS("CommitFromComposition", 1);
 }
 
+TEST_F(SessionConverterTest, PredictionCache) {
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+  const Segments &segments = GetSegmentsTest();
+  EXPECT_CALL(mock_converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  composer_->InsertCharacterPreedit("てすと");
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  Mock::VerifyAndClearExpectations(&mock_converter);
+
+  // The same input is served from the cache.
+  EXPECT_CALL(mock_converter, StartSuggestionForRequest(_, _)).Times(0);
+  EXPECT_TRUE(converter.Suggest(*composer_));
+  EXPECT_TRUE(converter.IsActive());
+  EXPECT_EQ(1, GetPredictionCacheStats(converter).hits);
+  EXPECT_EQ(1, GetPredictionCacheStats(converter).misses);
+  Mock::VerifyAndClearExpectations(&mock_converter);
+
+  // Learning invalidates the cache.
+  PredictionCache::InvalidateAll();
+  EXPECT_CALL(mock_converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  EXPECT_TRUE(converter.Suggest(*composer_));
+}
+
+TEST_F(SessionConverterTest, SpeculativeConversion) {
+  absl::FlagSaver flag_saver;
+  absl::SetFlag(&FLAGS_use_speculative_conversion, true);
+  MockConverter mock_converter;
+  SessionConverter converter(&mock_converter, request_.get(), config_.get());
+
+  Segments segments;
+  SetAiueo(&segments);
+  FillT13Ns(&segments, composer_.get());
+  EXPECT_CALL(mock_converter, StartSuggestionForRequest(_, _))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_converter, StartConversionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  EXPECT_FALSE(converter.Suggest(*composer_));
+  WaitForSpeculativeConversion(converter);
+  Mock::VerifyAndClearExpectations(&mock_converter);
+
+  // The result of the background conversion is used.
+  EXPECT_CALL(mock_converter, StartConversionForRequest(_, _)).Times(0);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  ASSERT_TRUE(converter.IsActive());
+  EXPECT_EQ(kChars_Aiueo, GetSegments(converter).conversion_segment(0).key());
+  Mock::VerifyAndClearExpectations(&mock_converter);
+
+  // The composition is modified after the background conversion.
+  converter.Cancel();
+  EXPECT_CALL(mock_converter, StartSuggestionForRequest(_, _))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_converter, StartConversionForRequest(_, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SetArgPointee<1>(segments), Return(true)));
+  EXPECT_FALSE(converter.Suggest(*composer_));
+  WaitForSpeculativeConversion(converter);
+  composer_->InsertCharacterPreedit(kChars_Mo);
+  EXPECT_TRUE(converter.Convert(*composer_));
+}
+
 TEST_F(SessionConverterTest, ClearSegmentsBeforeSuggest) {
+  // Disables the cache so that the second Suggest() calls the converter.
+  absl::FlagSaver flag_saver;
+  absl::SetFlag(&FLAGS_prediction_cache_size, 0);
   MockConverter mock_converter;
   SessionConverter converter(&mock_converter, request_.get(), config_.get());
 
@@ -2067,6 +2184,32 @@ TEST_F(SessionConverterTest, SuggestAndPredict) {
   }
 }
 
+TEST_F(SessionConverterTest, SuggestDegraded) {
+  Segments segments;
+  {  // Initialize mock segments for suggestion
+    Segment *segment = segments.add_segment();
+    segment->set_key(kChars_Mo);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->value = kChars_Mozukusu;
+    candidate->content_key = kChars_Mozukusu;
+  }
+  composer_->InsertCharacterPreedit(kChars_Mo);
+
+  for (const bool degraded : {false, true}) {
+    segments.set_degraded(degraded);
+    MockConverter mock_converter;
+    SessionConverter converter(&mock_converter, request_.get(), config_.get());
+    EXPECT_CALL(mock_converter, StartSuggestionForRequest(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+    EXPECT_TRUE(converter.Suggest(*composer_));
+
+    commands::Output output;
+    converter.FillOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_candidates());
+    EXPECT_EQ(degraded, output.candidates().degraded());
+  }
+}
+
 TEST_F(SessionConverterTest, SuggestFillIncognitoCandidateWords) {
   Segments segments;
   {  // Initialize mock segments for suggestion
@@ -33,15 +33,20 @@
 #include "session/session_handler.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/clock.h"
+#include "base/executor.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "absl/flags/flag.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "base/process.h"
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
@@ -57,8 +62,10 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "protocol/user_dictionary_storage.pb.h"
+#include "session/internal/prediction_cache.h"
 #include "session/session.h"
 #include "session/session_observer_handler.h"
+#include "session/speculative_converter.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "session/session_watch_dog.h"
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
@@ -92,11 +99,36 @@ ABSL_FLAG(int32_t, last_create_session_timeout, 300,
           "\"last_create_session_timeout\" sec "
           "after create session command");
 
+ABSL_FLAG(int32_t, session_memory_budget_kb, 0,
+          "budget (KB) of the estimated memory usage of all the sessions. "
+          "if the usage exceeds the budget, least recently used sessions are "
+          "removed. 0 disables the budget");
+
+ABSL_FLAG(int32_t, session_memory_cap_kb, 0,
+          "cap (KB) of the estimated memory usage of each session. "
+          "if a session exceeds the cap after a command, its caches are "
+          "released. 0 disables the cap");
+
+ABSL_FLAG(bool, warm_up_engine, false,
+          "converts and predicts the warm-up keys of the engine in the "
+          "background after it is loaded. NO_OPERATION reports "
+          "engine_ready = false until the warm-up completes");
+
 ABSL_FLAG(bool, restricted, false, "Launch server with restricted setting");
 
 namespace mozc {
 
 namespace {
+
+// Maximum time a background step holds the engine mutex to delete the retired
+// sessions.
+constexpr absl::Duration kDeleteRetiredSessionsStepTime =
+    absl::Milliseconds(2);
+
+// Number of the commands of a session between the checks of its memory usage
+// against --session_memory_cap_kb.
+constexpr uint32_t kSessionMemoryCheckInterval = 8;
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   const commands::ApplicationInfo &info = session->application_info();
@@ -119,6 +151,25 @@ bool IsApplicationAlive(const session::SessionInterface *session) {
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
   return true;
 }
+
+// Returns true if |type| may modify the user data or the engine, which the
+// cached predictions of the sessions depend on.
+bool MayInvalidatePredictions(commands::Input::CommandType type) {
+  switch (type) {
+    case commands::Input::CLEAR_USER_HISTORY:
+    case commands::Input::CLEAR_USER_PREDICTION:
+    case commands::Input::CLEAR_UNUSED_USER_PREDICTION:
+    case commands::Input::SET_CONFIG:
+    case commands::Input::SET_IMPOSED_CONFIG:
+    case commands::Input::SYNC_DATA:
+    case commands::Input::RELOAD:
+    case commands::Input::SEND_USER_DICTIONARY_COMMAND:
+    case commands::Input::SEND_ENGINE_RELOAD_REQUEST:
+      return true;
+    default:
+      return false;
+  }
+}
 }  // namespace
 
 SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine) {
@@ -174,6 +225,12 @@ void SessionHandler::Init(
   max_session_size_ =
       std::max(2, std::min(absl::GetFlag(FLAGS_max_session_size), 128));
   session_map_ = std::make_unique<SessionMap>(max_session_size_);
+  session_memory_budget_ = static_cast<size_t>(std::max(
+                               0, absl::GetFlag(FLAGS_session_memory_budget_kb)))
+                           << 10;
+  session_memory_cap_ = static_cast<size_t>(std::max(
+                            0, absl::GetFlag(FLAGS_session_memory_cap_kb)))
+                        << 10;
 
   if (!engine_) {
     return;
@@ -181,9 +238,33 @@ void SessionHandler::Init(
 
   // everything is OK
   is_available_ = true;
+  StartWarmUp();
 }
 
 SessionHandler::~SessionHandler() {
+  Executor::TaskHandle warm_up_task;
+  {
+    absl::MutexLock lock(&warm_up_mutex_);
+    // WarmUpStep() finishes when no keys remain.
+    warm_up_keys_.clear();
+    warm_up_task = warm_up_task_;
+  }
+  warm_up_task.Cancel();
+  warm_up_task.Wait();
+
+  Executor::TaskHandle retire_task;
+  {
+    absl::MutexLock lock(&retired_mutex_);
+    stopping_ = true;
+    retire_task = retire_task_;
+  }
+  retire_task.Cancel();
+  retire_task.Wait();
+
+  // Deleting the sessions cancels their background conversions.  Holds the
+  // engine mutex so that no conversion is running on the engine after this.
+  absl::MutexLock lock(session::SpeculativeConverter::GetEngineMutex());
+  DeleteRetiredSessions();
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
        element != nullptr; element = element->next) {
@@ -200,6 +281,11 @@ SessionHandler::~SessionHandler() {
 
 bool SessionHandler::IsAvailable() const { return is_available_; }
 
+bool SessionHandler::IsReady() const {
+  absl::MutexLock lock(&warm_up_mutex_);
+  return is_available_ && is_ready_;
+}
+
 bool SessionHandler::StartWatchDog() {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   if (!session_watch_dog_->IsRunning()) {
@@ -235,6 +321,18 @@ void SessionHandler::UpdateSessions(const config::Config &config,
       }
     }
   }
+  {
+    // The retired sessions may still run their background conversions until
+    // they are deleted, so they must not refer to the old config.
+    absl::MutexLock lock(&retired_mutex_);
+    for (const auto &session : retired_sessions_) {
+      session->SetConfig(new_config.get());
+      session->SetRequest(new_request.get());
+      if (table != nullptr) {
+        session->SetTable(table);
+      }
+    }
+  }
   config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
       *new_config);
   // Now no references to the current config/request should exist.
@@ -348,6 +446,18 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     return false;
   }
 
+  // Holds back low priority background tasks, e.g., saving the user history,
+  // while the command is evaluated.
+  const Executor::ScopedInteractive interactive;
+  // Background conversions share the engine, which is not thread safe.  The
+  // running one is cancelled so that the command doesn't wait for it.
+  session::SpeculativeConverter::ScopedEngineLock engine_lock(
+      MayUseEngineInBackground());
+
+  if (MayInvalidatePredictions(command->input().type())) {
+    session::PredictionCache::InvalidateAll();
+  }
+
   bool eval_succeeded = false;
   stopwatch_->Reset();
   stopwatch_->Start();
@@ -416,6 +526,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::RELOAD_SPELL_CHECKER:
       eval_succeeded = ReloadSpellChecker(command);
       break;
+    case commands::Input::GET_SESSION_MEMORY_USAGE:
+      eval_succeeded = GetSessionMemoryUsage(command);
+      break;
     default:
       eval_succeeded = false;
   }
@@ -471,6 +584,7 @@ bool SessionHandler::SendKey(commands::Command *command) {
     return false;
   }
   (*session)->SendKey(command);
+  MaybeReduceMemoryUsageAfterCommand(id, *session);
   MaybeUpdateStoredConfig(command);
   return true;
 }
@@ -495,6 +609,7 @@ bool SessionHandler::SendCommand(commands::Command *command) {
     return false;
   }
   (*session)->SendCommand(command);
+  MaybeReduceMemoryUsageAfterCommand(id, *session);
   MaybeUpdateStoredConfig(command);
   return true;
 }
@@ -522,8 +637,10 @@ bool SessionHandler::CreateSession(commands::Command *command) {
       LOG(ERROR) << "oldest SessionElement is NULL";
       return false;
     }
-    delete oldest_element->value;
-    oldest_element->value = NULL;
+    RetireSession(oldest_element->value);
+    oldest_element->value = nullptr;
+    reduced_memory_usage_.erase(oldest_element->key);
+    num_commands_since_memory_check_.erase(oldest_element->key);
     session_map_->Erase(oldest_element->key);
     VLOG(1) << "Session is FULL, oldest SessionID " << oldest_element->key
             << " is removed";
@@ -538,10 +655,13 @@ bool SessionHandler::CreateSession(commands::Command *command) {
       if (engine_->GetUserDataManager()) {
         engine_->GetUserDataManager()->Wait();
       }
+      // The retired sessions refer to the current engine.
+      DeleteRetiredSessions();
       engine_.reset();
       engine_ = engine_builder_->BuildFromPreparedData();
       LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
       table_manager_->ClearCaches();
+      StartWarmUp();
       response->set_status(EngineReloadResponse::RELOADED);
     }
     engine_builder_->Clear();
@@ -580,6 +700,8 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   // session is not empty.
   last_session_empty_time_ = 0;
 
+  EvictSessionsOverMemoryBudget();
+
   UsageStats::IncrementCount("SessionCreated");
 
   return true;
@@ -649,10 +771,12 @@ bool SessionHandler::Cleanup(commands::Command *command) {
     }
   }
 
+  // The sessions are only detached here and deleted on a background task.
   for (size_t i = 0; i < remove_ids.size(); ++i) {
     DeleteSessionID(remove_ids[i]);
     VLOG(1) << "Session ID " << remove_ids[i] << " is removed by server";
   }
+  EvictSessionsOverMemoryBudget();
 
   // Sync all data. This is a regression bug fix http://b/3033708
   engine_->GetUserDataManager()->Sync();
@@ -693,7 +817,10 @@ bool SessionHandler::SendEngineReloadRequest(commands::Command *command) {
   return true;
 }
 
-bool SessionHandler::NoOperation(commands::Command *command) { return true; }
+bool SessionHandler::NoOperation(commands::Command *command) {
+  command->mutable_output()->set_engine_ready(IsReady());
+  return true;
+}
 
 bool SessionHandler::CheckSpelling(commands::Command *command) {
   if (!command->input().has_check_spelling_request() ||
@@ -708,6 +835,24 @@ bool SessionHandler::ReloadSpellChecker(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetSessionMemoryUsage(commands::Command *command) {
+  // Only the session of the caller is reported, so that the command does not
+  // disclose the IDs of the other sessions.
+  const SessionID id = command->input().id();
+  // Doesn't move the session in the LRU, as this is not a use of it.
+  session::SessionInterface *const *session =
+      session_map_->LookupWithoutInsert(id);
+  if (session == nullptr || *session == nullptr) {
+    LOG(WARNING) << "SessionID " << id << " is not available";
+    return false;
+  }
+  commands::SessionMemoryUsage *usage =
+      command->mutable_output()->mutable_session_memory_usage();
+  usage->set_id(id);
+  (*session)->FillMemoryUsage(usage);
+  return true;
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   SessionID id = 0;
@@ -731,9 +876,12 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
     return false;
   }
-  delete *session;
+  RetireSession(*session);
+  *session = nullptr;
 
   session_map_->Erase(id);  // remove from LRU
+  reduced_memory_usage_.erase(id);
+  num_commands_since_memory_check_.erase(id);
 
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == 0 && session_map_->Size() == 0) {
@@ -742,4 +890,228 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
 
   return true;
 }
+
+void SessionHandler::RetireSession(session::SessionInterface *session) {
+  absl::MutexLock lock(&retired_mutex_);
+  retired_sessions_.emplace_back(session);
+  if (retire_task_scheduled_ || stopping_) {
+    return;
+  }
+  retire_task_scheduled_ = true;
+  // LOW priority tasks are held back while commands are evaluated.
+  retire_task_ = Executor::Get()->Post([this]() { DeleteRetiredSessionsStep(); },
+                                       Executor::LOW);
+}
+
+void SessionHandler::DeleteRetiredSessionsStep() {
+  // Deleting a session cancels its background conversion, which runs with the
+  // engine mutex.
+  absl::MutexLock engine_lock(session::SpeculativeConverter::GetEngineMutex());
+  const absl::Time deadline = absl::Now() + kDeleteRetiredSessionsStepTime;
+  do {
+    std::unique_ptr<session::SessionInterface> session;
+    {
+      absl::MutexLock lock(&retired_mutex_);
+      if (retired_sessions_.empty()) {
+        retire_task_scheduled_ = false;
+        return;
+      }
+      session = std::move(retired_sessions_.front());
+      retired_sessions_.pop_front();
+    }
+    session.reset();
+  } while (absl::Now() < deadline);
+
+  absl::MutexLock lock(&retired_mutex_);
+  if (retired_sessions_.empty() || stopping_) {
+    retire_task_scheduled_ = false;
+    return;
+  }
+  retire_task_ = Executor::Get()->Post([this]() { DeleteRetiredSessionsStep(); },
+                                       Executor::LOW);
+}
+
+void SessionHandler::DeleteRetiredSessions() {
+  std::deque<std::unique_ptr<session::SessionInterface>> sessions;
+  {
+    absl::MutexLock lock(&retired_mutex_);
+    sessions.swap(retired_sessions_);
+  }
+  sessions.clear();
+}
+
+bool SessionHandler::MayUseEngineInBackground() {
+  // The background tasks are started only on this thread, so none starts
+  // between this check and the end of the command.
+  if (session::SpeculativeConverter::IsInUse()) {
+    return true;
+  }
+  {
+    absl::MutexLock lock(&warm_up_mutex_);
+    if (warm_up_task_scheduled_) {
+      return true;
+    }
+  }
+  absl::MutexLock lock(&retired_mutex_);
+  return retire_task_scheduled_;
+}
+
+void SessionHandler::StartWarmUp() {
+  std::vector<std::string> keys;
+  if (absl::GetFlag(FLAGS_warm_up_engine)) {
+    keys = engine_->GetWarmUpKeys();
+  }
+  absl::MutexLock lock(&warm_up_mutex_);
+  // A running warm-up continues with the keys of the new engine.
+  warm_up_keys_ = std::move(keys);
+  warm_up_index_ = 0;
+  is_ready_ = warm_up_keys_.empty();
+  if (is_ready_ || warm_up_task_scheduled_) {
+    return;
+  }
+  warm_up_task_scheduled_ = true;
+  // LOW priority tasks are held back while commands are evaluated, so the
+  // warm-up never delays a user request.
+  warm_up_task_ =
+      Executor::Get()->Post([this]() { WarmUpStep(); }, Executor::LOW);
+}
+
+void SessionHandler::WarmUpStep() {
+  // Conversions by the warm-up must not run concurrently with commands.  A
+  // command arriving meanwhile cancels the warm-up of the current key, which
+  // is retried after the command.
+  absl::MutexLock engine_lock(session::SpeculativeConverter::GetEngineMutex());
+  std::string key;
+  {
+    absl::MutexLock lock(&warm_up_mutex_);
+    if (warm_up_index_ >= warm_up_keys_.size()) {
+      warm_up_task_scheduled_ = false;
+      is_ready_ = true;
+      return;
+    }
+    key = warm_up_keys_[warm_up_index_];
+  }
+  std::atomic<bool> cancelled(false);
+  bool finished;
+  {
+    session::SpeculativeConverter::ScopedCancellableTask running(&cancelled);
+    finished = engine_->WarmUp(key, &cancelled);
+  }
+
+  absl::MutexLock lock(&warm_up_mutex_);
+  // StartWarmUp() may have replaced the keys meanwhile.
+  if (finished && warm_up_index_ < warm_up_keys_.size() &&
+      warm_up_keys_[warm_up_index_] == key) {
+    ++warm_up_index_;
+  }
+  if (warm_up_index_ >= warm_up_keys_.size()) {
+    warm_up_task_scheduled_ = false;
+    is_ready_ = true;
+    VLOG(1) << "Engine warm-up completed";
+    return;
+  }
+  warm_up_task_ =
+      Executor::Get()->Post([this]() { WarmUpStep(); }, Executor::LOW);
+}
+
+void SessionHandler::WaitForWarmUp() {
+  while (true) {
+    Executor::TaskHandle warm_up_task;
+    {
+      absl::MutexLock lock(&warm_up_mutex_);
+      if (!warm_up_task_scheduled_) {
+        return;
+      }
+      warm_up_task = warm_up_task_;
+    }
+    warm_up_task.Wait();
+  }
+}
+
+void SessionHandler::WaitForRetiredSessions() {
+  while (true) {
+    Executor::TaskHandle retire_task;
+    {
+      absl::MutexLock lock(&retired_mutex_);
+      if (!retire_task_scheduled_) {
+        return;
+      }
+      retire_task = retire_task_;
+    }
+    retire_task.Wait();
+  }
+}
+
+size_t SessionHandler::EstimateSessionMemoryUsage() const {
+  size_t size = 0;
+  for (const SessionElement *element = session_map_->Head();
+       element != nullptr; element = element->next) {
+    if (element->value != nullptr) {
+      size += element->value->EstimateMemoryUsage();
+    }
+  }
+  return size;
+}
+
+void SessionHandler::EvictSessionsOverMemoryBudget() {
+  if (session_memory_budget_ == 0) {
+    return;
+  }
+  size_t size = EstimateSessionMemoryUsage();
+  while (size > session_memory_budget_ && session_map_->Size() > 1) {
+    const SessionElement *oldest_element = session_map_->Tail();
+    const SessionID id = oldest_element->key;
+    if (oldest_element->value != nullptr) {
+      size -= std::min(size, oldest_element->value->EstimateMemoryUsage());
+    }
+    VLOG(1) << "Session memory exceeds the budget, SessionID " << id
+            << " is removed";
+    if (!DeleteSessionID(id)) {
+      break;
+    }
+  }
+}
+
+void SessionHandler::MaybeReduceMemoryUsageAfterCommand(
+    SessionID id, session::SessionInterface *session) {
+  if (session_memory_cap_ == 0) {
+    return;
+  }
+  // EstimateMemoryUsage() walks the whole session, so it is not called on
+  // every key event.
+  uint32_t &num_commands = num_commands_since_memory_check_[id];
+  if (++num_commands < kSessionMemoryCheckInterval) {
+    return;
+  }
+  num_commands = 0;
+  MaybeReduceMemoryUsage(id, session);
+}
+
+void SessionHandler::MaybeReduceMemoryUsage(
+    SessionID id, session::SessionInterface *session) {
+  if (session_memory_cap_ == 0) {
+    return;
+  }
+  const size_t size = session->EstimateMemoryUsage();
+  if (size <= session_memory_cap_) {
+    reduced_memory_usage_.erase(id);
+    return;
+  }
+  // The state of an active conversion is not released, so the usage can stay
+  // over the cap after the reduction.  Do not reduce it again on every command
+  // until the session grows by a quarter of the cap.
+  const auto it = reduced_memory_usage_.find(id);
+  if (it != reduced_memory_usage_.end() &&
+      size < it->second + session_memory_cap_ / 4) {
+    return;
+  }
+  VLOG(1) << "Session memory exceeds the cap, releasing the caches";
+  session->ReduceMemoryUsage();
+  const size_t reduced_size = session->EstimateMemoryUsage();
+  if (reduced_size <= session_memory_cap_) {
+    reduced_memory_usage_.erase(id);
+  } else {
+    reduced_memory_usage_[id] = reduced_size;
+  }
+}
 }  // namespace mozc
@@ -32,11 +32,15 @@
 #ifndef MOZC_SESSION_SESSION_HANDLER_H_
 #define MOZC_SESSION_SESSION_HANDLER_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "base/executor.h"
 #include "base/port.h"
 #include "composer/table.h"
 #include "engine/engine_builder_interface.h"
@@ -44,6 +48,7 @@
 #include "session/common.h"
 #include "session/session_handler_interface.h"
 #include "storage/lru_cache.h"
+#include "absl/synchronization/mutex.h"
 // for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
 
@@ -78,6 +83,7 @@ class SessionHandler : public SessionHandlerInterface {
 
   // Returns true if SessionHandle is available.
   bool IsAvailable() const override;
+  bool IsReady() const override;
 
   bool EvalCommand(commands::Command *command) override;
 
@@ -97,6 +103,12 @@ class SessionHandler : public SessionHandlerInterface {
 
  private:
   FRIEND_TEST(SessionHandlerTest, StorageTest);
+  FRIEND_TEST(SessionHandlerTest, RetiredSessionsAreDeletedInBackground);
+  FRIEND_TEST(SessionHandlerTest, SessionMemoryBudget);
+  FRIEND_TEST(SessionHandlerTest, SessionMemoryCapHysteresis);
+  FRIEND_TEST(SessionHandlerTest, WarmUp);
+  FRIEND_TEST(SessionHandlerTest, WarmUpCancelledByCommand);
+  FRIEND_TEST(SessionHandlerTest, WarmUpWithMockDataEngine);
 
   using SessionMap =
       mozc::storage::LruCache<SessionID, session::SessionInterface *>;
@@ -144,16 +156,66 @@ class SessionHandler : public SessionHandlerInterface {
   bool NoOperation(commands::Command *command);
   bool CheckSpelling(commands::Command *command);
   bool ReloadSpellChecker(commands::Command *command);
+  bool GetSessionMemoryUsage(commands::Command *command);
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
+  // Takes the ownership of |session|, which is already removed from
+  // |session_map_|, and deletes it on a background task.  Deleting a session
+  // releases its composer and converter state, which is too costly to do on
+  // the request thread.
+  void RetireSession(session::SessionInterface *session);
+  // Deletes the retired sessions for a bounded time and reposts itself while
+  // some remain, so that a command never waits for a long sweep.
+  void DeleteRetiredSessionsStep();
+  // Deletes all the retired sessions on the calling thread.  The engine mutex
+  // must be held.
+  void DeleteRetiredSessions();
+  // Blocks until the background task deletes all the retired sessions.
+  void WaitForRetiredSessions();
+
+  // Returns the estimated memory usage of the live sessions.
+  size_t EstimateSessionMemoryUsage() const;
+  // Retires the least recently used sessions while the estimated memory usage
+  // exceeds the budget.  The most recently used session is always kept.
+  void EvictSessionsOverMemoryBudget();
+  // Calls MaybeReduceMemoryUsage() once in every few commands of |session|.
+  void MaybeReduceMemoryUsageAfterCommand(SessionID id,
+                                          session::SessionInterface *session);
+  // Releases the caches of |session| if it exceeds the per session cap and
+  // has grown enough since the last reduction.
+  void MaybeReduceMemoryUsage(SessionID id,
+                              session::SessionInterface *session);
+
+  // Returns true if a background task may be using |engine_|, i.e., a
+  // speculative conversion, the warm-up or the deletion of retired sessions.
+  bool MayUseEngineInBackground();
+
+  // Starts warming up |engine_| in the background if --warm_up_engine is set.
+  // IsReady() returns false until it completes.
+  void StartWarmUp();
+  // Warms up the engine with one key and reposts itself while keys remain.
+  void WarmUpStep();
+  // Blocks until the warm-up completes.
+  void WaitForWarmUp();
+
   std::unique_ptr<SessionMap> session_map_;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::unique_ptr<SessionWatchDog> session_watch_dog_;
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
   bool is_available_ = false;
   uint32_t max_session_size_ = 0;
+  // Budget of the estimated memory usage of the sessions.  0 disables it.
+  size_t session_memory_budget_ = 0;
+  // Cap of the estimated memory usage of each session.  0 disables it.
+  size_t session_memory_cap_ = 0;
+  // Estimated memory usage of the sessions that stayed over the cap after
+  // their last reduction.
+  std::map<SessionID, size_t> reduced_memory_usage_;
+  // Number of the commands of each session since its last check against the
+  // cap.
+  std::map<SessionID, uint32_t> num_commands_since_memory_check_;
   uint64_t last_session_empty_time_ = 0;
   uint64_t last_cleanup_time_ = 0;
   uint64_t last_create_session_time_ = 0;
@@ -168,6 +230,20 @@ class SessionHandler : public SessionHandlerInterface {
   std::unique_ptr<const commands::Request> request_;
   std::unique_ptr<const config::Config> config_;
 
+  absl::Mutex retired_mutex_;
+  std::deque<std::unique_ptr<session::SessionInterface>> retired_sessions_
+      ABSL_GUARDED_BY(retired_mutex_);
+  Executor::TaskHandle retire_task_ ABSL_GUARDED_BY(retired_mutex_);
+  bool retire_task_scheduled_ ABSL_GUARDED_BY(retired_mutex_) = false;
+  bool stopping_ ABSL_GUARDED_BY(retired_mutex_) = false;
+
+  mutable absl::Mutex warm_up_mutex_;
+  std::vector<std::string> warm_up_keys_ ABSL_GUARDED_BY(warm_up_mutex_);
+  size_t warm_up_index_ ABSL_GUARDED_BY(warm_up_mutex_) = 0;
+  Executor::TaskHandle warm_up_task_ ABSL_GUARDED_BY(warm_up_mutex_);
+  bool warm_up_task_scheduled_ ABSL_GUARDED_BY(warm_up_mutex_) = false;
+  bool is_ready_ ABSL_GUARDED_BY(warm_up_mutex_) = false;
+
   DISALLOW_COPY_AND_ASSIGN(SessionHandler);
 };
 
@@ -56,6 +56,10 @@ class SessionHandlerInterface {
   // Returns true if SessionHandle is available.
   virtual bool IsAvailable() const = 0;
 
+  // Returns true if SessionHandle is available and the engine has finished
+  // warming up, i.e., the first requests are as fast as later ones.
+  virtual bool IsReady() const { return IsAvailable(); }
+
   virtual bool EvalCommand(commands::Command *command) = 0;
 
   // Starts watch dog timer to cleanup sessions.
@@ -30,6 +30,7 @@
 #include "session/session_handler.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -50,6 +51,7 @@
 #include "engine/user_data_manager_mock.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/session.h"
 #include "session/session_handler_test_util.h"
 #include "testing/base/public/gmock.h"
 #include "testing/base/public/googletest.h"
@@ -58,16 +60,24 @@
 #include "usage_stats/usage_stats_testing_util.h"
 #include "absl/flags/declare.h"
 #include "absl/flags/flag.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 
 ABSL_DECLARE_FLAG(int32_t, max_session_size);
 ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
 ABSL_DECLARE_FLAG(int32_t, last_create_session_timeout);
+ABSL_DECLARE_FLAG(int32_t, session_memory_budget_kb);
+ABSL_DECLARE_FLAG(int32_t, session_memory_cap_kb);
+ABSL_DECLARE_FLAG(bool, warm_up_engine);
 
 namespace mozc {
 namespace {
 
 using ::mozc::session::testing::SessionHandlerTestBase;
+using ::testing::_;
 using ::testing::Return;
 
 // Used to test interaction between SessionHandler and EngineBuilder in engine
@@ -169,6 +179,23 @@ bool CleanUp(SessionHandlerInterface *handler, uint64_t id) {
   return handler->EvalCommand(&command);
 }
 
+// Types the characters of |keys| and returns the memory usage of the session.
+commands::SessionMemoryUsage SendKeysAndGetMemoryUsage(
+    SessionHandlerInterface *handler, uint64_t id, const std::string &keys) {
+  for (const char key : keys) {
+    commands::Command command;
+    command.mutable_input()->set_id(id);
+    command.mutable_input()->set_type(commands::Input::SEND_KEY);
+    command.mutable_input()->mutable_key()->set_key_code(key);
+    handler->EvalCommand(&command);
+  }
+  commands::Command command;
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->set_type(commands::Input::GET_SESSION_MEMORY_USAGE);
+  handler->EvalCommand(&command);
+  return command.output().session_memory_usage();
+}
+
 bool IsGoodSession(SessionHandlerInterface *handler, uint64_t id) {
   commands::Command command;
   command.mutable_input()->set_id(id);
@@ -181,6 +208,28 @@ bool IsGoodSession(SessionHandlerInterface *handler, uint64_t id) {
 
 }  // namespace
 
+// Session whose memory usage is set by the test.
+class FakeMemorySession : public session::Session {
+ public:
+  explicit FakeMemorySession(EngineInterface *engine)
+      : session::Session(engine) {}
+
+  size_t EstimateMemoryUsage() const override { return size_; }
+  void ReduceMemoryUsage() override {
+    ++reduce_count_;
+    size_ = reduced_size_;
+  }
+
+  void set_size(size_t size) { size_ = size; }
+  void set_reduced_size(size_t size) { reduced_size_ = size; }
+  int reduce_count() const { return reduce_count_; }
+
+ private:
+  size_t size_ = 0;
+  size_t reduced_size_ = 0;
+  int reduce_count_ = 0;
+};
+
 class SessionHandlerTest : public SessionHandlerTestBase {
  protected:
   void SetUp() override {
@@ -329,6 +378,253 @@ TEST_F(SessionHandlerTest, LastCommandTimeout) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+TEST_F(SessionHandlerTest, RetiredSessionsAreDeletedInBackground) {
+  SessionHandler handler(CreateMockDataEngine());
+
+  uint64_t id1 = 0;
+  uint64_t id2 = 0;
+  uint64_t id3 = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id1));
+  ASSERT_TRUE(CreateSession(&handler, &id2));
+  ASSERT_TRUE(CreateSession(&handler, &id3));
+
+  // The deleted session is not accessible even before it is destroyed.
+  EXPECT_TRUE(DeleteSession(&handler, id1));
+  EXPECT_FALSE(IsGoodSession(&handler, id1));
+  EXPECT_TRUE(IsGoodSession(&handler, id2));
+
+  handler.WaitForRetiredSessions();
+  {
+    absl::MutexLock lock(&handler.retired_mutex_);
+    EXPECT_TRUE(handler.retired_sessions_.empty());
+  }
+
+  // The handler can be destroyed while some sessions are retired.
+  EXPECT_TRUE(DeleteSession(&handler, id2));
+  EXPECT_TRUE(IsGoodSession(&handler, id3));
+}
+
+TEST_F(SessionHandlerTest, SessionMemoryBudget) {
+  {
+    SessionHandler handler(CreateMockDataEngine());
+    uint64_t id = 0;
+    ASSERT_TRUE(CreateSession(&handler, &id));
+    ASSERT_TRUE(IsGoodSession(&handler, id));
+    // Two sessions exceed the budget of 1 KB below.
+    EXPECT_GT(handler.EstimateSessionMemoryUsage(), 512);
+  }
+
+  absl::SetFlag(&FLAGS_session_memory_budget_kb, 1);
+  SessionHandler handler(CreateMockDataEngine());
+
+  uint64_t id1 = 0;
+  uint64_t id2 = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id1));
+  // The most recently used session is kept even over the budget.
+  EXPECT_TRUE(IsGoodSession(&handler, id1));
+
+  ASSERT_TRUE(CreateSession(&handler, &id2));
+  EXPECT_FALSE(IsGoodSession(&handler, id1));
+  EXPECT_TRUE(IsGoodSession(&handler, id2));
+}
+
+TEST_F(SessionHandlerTest, GetSessionMemoryUsage) {
+  SessionHandler handler(CreateMockDataEngine());
+
+  uint64_t id1 = 0;
+  uint64_t id2 = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id1));
+  ASSERT_TRUE(CreateSession(&handler, &id2));
+
+  const commands::SessionMemoryUsage usage =
+      SendKeysAndGetMemoryUsage(&handler, id1, "aiueo");
+  EXPECT_EQ(id1, usage.id());
+  EXPECT_GT(usage.composer_bytes(), 0);
+  EXPECT_GT(usage.converter_bytes(), 0);
+  EXPECT_GT(usage.total_bytes(),
+            usage.composer_bytes() + usage.converter_bytes() +
+                usage.undo_context_bytes());
+
+  // Other sessions are not listed without id.
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_SESSION_MEMORY_USAGE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(commands::Output::SESSION_FAILURE, command.output().error_code());
+  EXPECT_FALSE(command.output().has_session_memory_usage());
+
+  command.Clear();
+  command.mutable_input()->set_id(id2);
+  command.mutable_input()->set_type(commands::Input::GET_SESSION_MEMORY_USAGE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(id2, command.output().session_memory_usage().id());
+}
+
+TEST_F(SessionHandlerTest, GetSessionMemoryUsageKeepsLruOrder) {
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+  absl::SetFlag(&FLAGS_max_session_size, 2);
+  SessionHandler handler(CreateMockDataEngine());
+
+  uint64_t id1 = 0;
+  uint64_t id2 = 0;
+  uint64_t id3 = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id1));
+  clock.PutClockForward(10, 0);
+  ASSERT_TRUE(CreateSession(&handler, &id2));
+  clock.PutClockForward(10, 0);
+
+  // The query is not a use of the session, so id1 stays the oldest one.
+  commands::Command command;
+  command.mutable_input()->set_id(id1);
+  command.mutable_input()->set_type(commands::Input::GET_SESSION_MEMORY_USAGE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(id1, command.output().session_memory_usage().id());
+
+  ASSERT_TRUE(CreateSession(&handler, &id3));
+  EXPECT_FALSE(IsGoodSession(&handler, id1));
+  EXPECT_TRUE(IsGoodSession(&handler, id2));
+  EXPECT_TRUE(IsGoodSession(&handler, id3));
+}
+
+TEST_F(SessionHandlerTest, SessionMemoryCap) {
+  // The usage is checked once in every 8 commands.
+  constexpr char kKeys[] = "kyouhaiitenki";
+  uint64_t total_bytes = 0;
+  {
+    SessionHandler handler(CreateMockDataEngine());
+    uint64_t id = 0;
+    ASSERT_TRUE(CreateSession(&handler, &id));
+    total_bytes = SendKeysAndGetMemoryUsage(&handler, id, kKeys).total_bytes();
+  }
+
+  absl::SetFlag(&FLAGS_session_memory_cap_kb, 1);
+  SessionHandler handler(CreateMockDataEngine());
+  uint64_t id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id));
+  const commands::SessionMemoryUsage usage =
+      SendKeysAndGetMemoryUsage(&handler, id, kKeys);
+  EXPECT_LT(usage.total_bytes(), total_bytes);
+  EXPECT_EQ(0, usage.undo_context_bytes());
+  // The session still works.
+  EXPECT_TRUE(IsGoodSession(&handler, id));
+}
+
+TEST_F(SessionHandlerTest, SessionMemoryCapHysteresis) {
+  absl::SetFlag(&FLAGS_session_memory_cap_kb, 4);
+  SessionHandler handler(CreateMockDataEngine());
+  constexpr size_t kCap = 4 << 10;
+  FakeMemorySession session(handler.engine_.get());
+  constexpr SessionID kId = 1;
+
+  // The reduction cannot go under the cap, e.g. while converting.
+  session.set_size(kCap + 100);
+  session.set_reduced_size(kCap + 10);
+  handler.MaybeReduceMemoryUsage(kId, &session);
+  EXPECT_EQ(1, session.reduce_count());
+
+  // Not reduced again until the session grows by a quarter of the cap.
+  session.set_size(kCap + 100);
+  handler.MaybeReduceMemoryUsage(kId, &session);
+  EXPECT_EQ(1, session.reduce_count());
+  session.set_size(kCap + 10 + kCap / 4);
+  handler.MaybeReduceMemoryUsage(kId, &session);
+  EXPECT_EQ(2, session.reduce_count());
+
+  // Going under the cap resets the state.
+  session.set_size(kCap / 2);
+  handler.MaybeReduceMemoryUsage(kId, &session);
+  EXPECT_EQ(2, session.reduce_count());
+  session.set_size(kCap + 1);
+  handler.MaybeReduceMemoryUsage(kId, &session);
+  EXPECT_EQ(3, session.reduce_count());
+
+  // Other sessions have their own state.
+  session.set_size(kCap + 1);
+  handler.MaybeReduceMemoryUsage(kId + 1, &session);
+  EXPECT_EQ(4, session.reduce_count());
+}
+
+TEST_F(SessionHandlerTest, WarmUp) {
+  {
+    // The engine is ready from the beginning without --warm_up_engine.
+    auto engine = std::make_unique<MockEngine>();
+    EXPECT_CALL(*engine, GetWarmUpKeys()).Times(0);
+    SessionHandler handler(std::move(engine));
+    EXPECT_TRUE(handler.IsReady());
+  }
+
+  absl::SetFlag(&FLAGS_warm_up_engine, true);
+  absl::Notification first_key_started;
+  absl::Notification resume;
+  auto engine = std::make_unique<MockEngine>();
+  EXPECT_CALL(*engine, GetWarmUpKeys())
+      .WillOnce(Return(std::vector<std::string>{"わたし", "にほんご"}));
+  EXPECT_CALL(*engine, WarmUp(absl::string_view("わたし"), _))
+      .WillOnce([&](absl::string_view, const std::atomic<bool> *) {
+        first_key_started.Notify();
+        resume.WaitForNotification();
+        return true;
+      });
+  EXPECT_CALL(*engine, WarmUp(absl::string_view("にほんご"), _))
+      .WillOnce(Return(true));
+  SessionHandler handler(std::move(engine));
+  EXPECT_TRUE(handler.IsAvailable());
+
+  first_key_started.WaitForNotification();
+  EXPECT_FALSE(handler.IsReady());
+  resume.Notify();
+  handler.WaitForWarmUp();
+  EXPECT_TRUE(handler.IsReady());
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::NO_OPERATION);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_TRUE(command.output().engine_ready());
+}
+
+TEST_F(SessionHandlerTest, WarmUpCancelledByCommand) {
+  absl::SetFlag(&FLAGS_warm_up_engine, true);
+  absl::Notification first_key_started;
+  auto engine = std::make_unique<MockEngine>();
+  EXPECT_CALL(*engine, GetWarmUpKeys())
+      .WillOnce(Return(std::vector<std::string>{"わたし", "にほんご"}));
+  // The key cancelled by the command is warmed up again after it.
+  EXPECT_CALL(*engine, WarmUp(absl::string_view("わたし"), _))
+      .WillOnce([&](absl::string_view, const std::atomic<bool> *cancel_flag) {
+        first_key_started.Notify();
+        while (!cancel_flag->load()) {
+          absl::SleepFor(absl::Milliseconds(1));
+        }
+        return false;
+      })
+      .WillOnce(Return(true));
+  EXPECT_CALL(*engine, WarmUp(absl::string_view("にほんご"), _))
+      .WillOnce(Return(true));
+  SessionHandler handler(std::move(engine));
+
+  // The command doesn't wait for the warm-up of the whole key.
+  first_key_started.WaitForNotification();
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::NO_OPERATION);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_FALSE(command.output().engine_ready());
+
+  handler.WaitForWarmUp();
+  EXPECT_TRUE(handler.IsReady());
+}
+
+TEST_F(SessionHandlerTest, WarmUpWithMockDataEngine) {
+  absl::SetFlag(&FLAGS_warm_up_engine, true);
+  SessionHandler handler(CreateMockDataEngine());
+  handler.WaitForWarmUp();
+  EXPECT_TRUE(handler.IsReady());
+
+  // Requests are served as usual after the warm-up.
+  uint64_t id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id));
+  EXPECT_TRUE(IsGoodSession(&handler, id));
+}
+
 TEST_F(SessionHandlerTest, ShutdownTest) {
   SessionHandler handler(CreateMockDataEngine());
 
@@ -55,6 +55,9 @@ ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, watch_dog_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
 ABSL_DECLARE_FLAG(int32_t, last_create_session_timeout);
+ABSL_DECLARE_FLAG(int32_t, session_memory_budget_kb);
+ABSL_DECLARE_FLAG(int32_t, session_memory_cap_kb);
+ABSL_DECLARE_FLAG(bool, warm_up_engine);
 ABSL_DECLARE_FLAG(bool, restricted);
 
 namespace mozc {
@@ -120,6 +123,11 @@ void SessionHandlerTestBase::SetUp() {
       absl::GetFlag(FLAGS_last_command_timeout);
   flags_last_create_session_timeout_backup_ =
       absl::GetFlag(FLAGS_last_create_session_timeout);
+  flags_session_memory_budget_kb_backup_ =
+      absl::GetFlag(FLAGS_session_memory_budget_kb);
+  flags_session_memory_cap_kb_backup_ =
+      absl::GetFlag(FLAGS_session_memory_cap_kb);
+  flags_warm_up_engine_backup_ = absl::GetFlag(FLAGS_warm_up_engine);
   flags_restricted_backup_ = absl::GetFlag(FLAGS_restricted);
 
   user_profile_directory_backup_ = SystemUtil::GetUserProfileDirectory();
@@ -141,6 +149,11 @@ void SessionHandlerTestBase::TearDown() {
                 flags_last_command_timeout_backup_);
   absl::SetFlag(&FLAGS_last_create_session_timeout,
                 flags_last_create_session_timeout_backup_);
+  absl::SetFlag(&FLAGS_session_memory_budget_kb,
+                flags_session_memory_budget_kb_backup_);
+  absl::SetFlag(&FLAGS_session_memory_cap_kb,
+                flags_session_memory_cap_kb_backup_);
+  absl::SetFlag(&FLAGS_warm_up_engine, flags_warm_up_engine_backup_);
   absl::SetFlag(&FLAGS_restricted, flags_restricted_backup_);
 }
 
@@ -85,6 +85,9 @@ class SessionHandlerTestBase : public ::testing::Test {
   int32_t flags_watch_dog_interval_backup_;
   int32_t flags_last_command_timeout_backup_;
   int32_t flags_last_create_session_timeout_backup_;
+  int32_t flags_session_memory_budget_kb_backup_;
+  int32_t flags_session_memory_cap_kb_backup_;
+  bool flags_warm_up_engine_backup_;
   bool flags_restricted_backup_;
   usage_stats::scoped_usage_stats_enabler usage_stats_enabler_;
 
@@ -32,6 +32,7 @@
 #ifndef MOZC_SESSION_SESSION_INTERFACE_H_
 #define MOZC_SESSION_SESSION_INTERFACE_H_
 
+#include <cstddef>
 #include <cstdint>
 
 #include "base/port.h"
@@ -44,6 +45,7 @@ class ApplicationInfo;
 class Capability;
 class Command;
 class Request;
+class SessionMemoryUsage;
 }  // namespace commands
 
 namespace composer {
@@ -87,6 +89,17 @@ class SessionInterface {
 
   // return 0 (default value) if no command is executed in this session.
   virtual uint64_t last_command_time() const = 0;
+
+  // Returns the estimated number of bytes held by this session.  Used to
+  // evict sessions under a memory budget.
+  virtual size_t EstimateMemoryUsage() const { return 0; }
+
+  // Fills the breakdown of EstimateMemoryUsage() except for the session id.
+  virtual void FillMemoryUsage(commands::SessionMemoryUsage *usage) const {}
+
+  // Releases the caches and the undo context of this session.  Called when
+  // the session exceeds its memory cap.
+  virtual void ReduceMemoryUsage() {}
 };
 
 }  // namespace session
@@ -55,14 +55,19 @@
 #include "rewriter/transliteration_rewriter.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
+#include "session/internal/prediction_cache.h"
 #include "session/request_test_util.h"
 #include "session/session_converter_interface.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/reflection.h"
 #include "absl/strings/str_format.h"
 
+ABSL_DECLARE_FLAG(int32_t, prediction_cache_size);
+
 namespace mozc {
 
 class ConverterInterface;
@@ -387,6 +392,9 @@ class SessionTest : public ::testing::Test {
  protected:
   void SetUp() override {
     UsageStats::ClearAllStatsForTest();
+    // The tests expect the converter to be called for every suggestion.  The
+    // prediction cache is tested in SuggestFromPredictionCache.
+    absl::SetFlag(&FLAGS_prediction_cache_size, 0);
 
     mobile_request_ = std::make_unique<Request>();
     commands::RequestForUnitTest::FillMobileRequest(mobile_request_.get());
@@ -698,6 +706,7 @@ class SessionTest : public ::testing::Test {
 
  private:
   const testing::ScopedTmpUserProfileDirectory scoped_profile_dir_;
+  absl::FlagSaver flag_saver_;
 };
 
 // This test is intentionally defined at this location so that this
@@ -4201,6 +4210,78 @@ TEST_F(SessionTest, Suggest) {
   EXPECT_EQ("MOCHA", command.output().candidates().candidate(0).value());
 }
 
+TEST_F(SessionTest, SuggestFromPredictionCache) {
+  absl::SetFlag(&FLAGS_prediction_cache_size, 8);
+  Segments segments_mo;
+  {
+    Segment *segment = segments_mo.add_segment();
+    segment->set_key("MO");
+    segment->add_candidate()->value = "MOCHA";
+    segment->add_candidate()->value = "MOZUKU";
+  }
+
+  Segments segments_moz;
+  {
+    Segment *segment = segments_moz.add_segment();
+    segment->set_key("MOZ");
+    segment->add_candidate()->value = "MOZUKU";
+  }
+
+  MockConverter converter;
+  MockEngine engine;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+
+  Session session(&engine);
+  InitSessionToPrecomposition(&session);
+  commands::Command command;
+  SendKey("M", &session, &command);
+
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments_mo), Return(true)));
+  SendKey("O", &session, &command);
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // moz|
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments_moz), Return(true)));
+  SendKey("Z", &session, &command);
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ(1, command.output().candidates().candidate_size());
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // mo|
+  // The same input as "O" is served from the cache.
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _)).Times(0);
+  SendKey("Backspace", &session, &command);
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ(2, command.output().candidates().candidate_size());
+  EXPECT_EQ("MOCHA", command.output().candidates().candidate(0).value());
+
+  // m|o
+  // The cursor is a part of the key.
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments_mo), Return(true)));
+  command.Clear();
+  EXPECT_TRUE(session.MoveCursorLeft(&command));
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // mo|
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _)).Times(0);
+  command.Clear();
+  EXPECT_TRUE(session.MoveCursorRight(&command));
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ(2, command.output().candidates().candidate_size());
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // The results are discarded when the engine may have learned something.
+  PredictionCache::InvalidateAll();
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments_moz), Return(true)));
+  SendKey("Z", &session, &command);
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ(1, command.output().candidates().candidate_size());
+}
+
 TEST_F(SessionTest, CommitCandidateTypingCorrection) {
   commands::Request request;
   request = *mobile_request_;
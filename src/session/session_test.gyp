@@ -129,6 +129,7 @@
       'type': 'executable',
       'sources': [
         'session_converter_test.cc',
+        'speculative_converter_test.cc',
       ],
       'dependencies': [
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
@@ -214,11 +215,13 @@
         'internal/ime_context_test.cc',
         'internal/keymap_test.cc',
         'internal/keymap_factory_test.cc',
+        'internal/prediction_cache_test.cc',
         'internal/session_output_test.cc',
         'internal/key_event_transformer_test.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base_test.gyp:clock_mock',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../testing/testing.gyp:gtest_main',
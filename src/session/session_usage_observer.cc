@@ -88,6 +88,7 @@ uint32_t GetDuration(uint64_t base_value) {
 bool IsSessionIndependentCommand(commands::Input::CommandType type) {
   switch (type) {
     case commands::Input::NO_OPERATION:
+    case commands::Input::GET_SESSION_MEMORY_USAGE:
     case commands::Input::SET_CONFIG:
     case commands::Input::GET_CONFIG:
     case commands::Input::SET_IMPOSED_CONFIG:
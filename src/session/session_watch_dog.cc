@@ -32,18 +32,22 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/cpu_stats.h"
+#include "base/executor.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/system_util.h"
-#include "base/unnamed_event.h"
 #include "client/client_interface.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 namespace {
@@ -63,16 +67,33 @@ constexpr float kMinimumAllCPULoad = 0.33f;
 // Average CPU load for last 10secs.
 // If the load > kMinimumLatestCPULoad, don't send Cleanup
 constexpr float kMinimumLatestCPULoad = 0.66f;
+
+
+// The first (interval_sec - 60) sec: -> Do nothing
+int32_t GetIdleIntervalMsec(int32_t interval_sec) {
+  return std::max(0, (interval_sec - 60)) * 1000;
+}
+
+// last 60 sec: -> check CPU usage
+int32_t GetCPUCheckIntervalMsec(int32_t interval_sec) {
+  return std::min(60, interval_sec) * 1000;
+}
+
+// for every 5 second, get CPU load percentage
+int32_t GetCPUCheckDurationMsec(int32_t interval_sec) {
+  return std::min(5, interval_sec) * 1000;
+}
 }  // namespace
 
 SessionWatchDog::SessionWatchDog(int32_t interval_sec)
     : interval_sec_(interval_sec),
       client_(nullptr),
       cpu_stats_(nullptr),
-      event_(new UnnamedEvent) {
+      cpu_loads_index_(0),
+      last_cleanup_time_(0),
+      running_(false) {
   // allow [1..600].
   interval_sec_ = std::max(1, std::min(interval_sec_, 600));
-  DCHECK(event_->IsAvailable()) << "Unnamed event is not available";
 }
 
 SessionWatchDog::~SessionWatchDog() { Terminate(); }
@@ -85,148 +106,168 @@ void SessionWatchDog::SetCPUStatsInterface(CPUStatsInterface *cpu_stats) {
   cpu_stats_ = cpu_stats;
 }
 
-void SessionWatchDog::Terminate() {
-  if (!IsRunning()) {
-    return;
-  }
-
-  if (!event_->Notify()) {
-    LOG(ERROR) << "UnnamedEvent::Notify() failed";
-    Thread::Terminate();
+void SessionWatchDog::Start(const std::string &thread_name) {
+  {
+    absl::MutexLock l(&mutex_);
+    if (running_) {
+      return;
+    }
   }
 
-  Join();
-}
-
-void SessionWatchDog::Run() {
-  std::unique_ptr<client::ClientInterface> client_impl;
   if (client_ == nullptr) {
     VLOG(2) << "default client is used";
-    client_impl.reset(client::ClientFactory::NewClient());
-    client_ = client_impl.get();
+    client_impl_.reset(client::ClientFactory::NewClient());
+    client_ = client_impl_.get();
   }
 
-  std::unique_ptr<CPUStatsInterface> cpu_stats_impl;
   if (cpu_stats_ == nullptr) {
     VLOG(2) << "default cpu_stats is used";
-    cpu_stats_impl = std::make_unique<CPUStats>();
-    cpu_stats_ = cpu_stats_impl.get();
-  }
-
-  if (!event_->IsAvailable()) {
-    LOG(ERROR) << "Unnamed event is not available";
-    return;
+    cpu_stats_impl_ = std::make_unique<CPUStats>();
+    cpu_stats_ = cpu_stats_impl_.get();
   }
 
-  // CPU load check
-  // add volatile to store this array in stack
-  volatile float cpu_loads[16];  // 60/5 = 12 is the minimal size
-  volatile float total_cpu_load = 0.0;
-  volatile float current_process_cpu_load = 0.0;
-  const volatile size_t number_of_processors =
-      cpu_stats_->GetNumberOfProcessors();
-
-  DCHECK_GE(number_of_processors, 1);
-
-  // the first (interval_sec_ - 60) sec: -> Do nothing
-  const int32_t idle_interval_msec = std::max(0, (interval_sec_ - 60)) * 1000;
-
-  // last 60 sec: -> check CPU usage
-  const int32_t cpu_check_interval_msec = std::min(60, interval_sec_) * 1000;
+  DCHECK_GE(cpu_stats_->GetNumberOfProcessors(), 1);
+  std::fill(cpu_loads_, cpu_loads_ + std::size(cpu_loads_), 0.0);
+  cpu_loads_index_ = 0;
+  last_cleanup_time_ = Clock::GetTime();
 
-  // for every 5 second, get CPU load percentage
-  const int32_t cpu_check_duration_msec = std::min(5, interval_sec_) * 1000;
-
-  std::fill(cpu_loads, cpu_loads + std::size(cpu_loads), 0.0);
+  VLOG(1) << "Starting " << thread_name;
+  {
+    absl::MutexLock l(&mutex_);
+    running_ = true;
+  }
+  ScheduleTick(GetIdleIntervalMsec(interval_sec_) +
+               GetCPUCheckDurationMsec(interval_sec_));
+}
 
-  uint64_t last_cleanup_time = Clock::GetTime();
+bool SessionWatchDog::IsRunning() const {
+  absl::MutexLock l(&mutex_);
+  return running_;
+}
 
-  while (true) {
-    VLOG(1) << "Start sleeping " << idle_interval_msec;
-    if (event_->Wait(idle_interval_msec)) {
-      VLOG(1) << "Received stop signal";
+void SessionWatchDog::Terminate() {
+  Executor::TaskHandle task;
+  {
+    absl::MutexLock l(&mutex_);
+    if (!running_) {
       return;
     }
-    VLOG(1) << "Finish sleeping " << idle_interval_msec;
-
-    int32_t cpu_loads_index = 0;
-    for (int n = 0; n < cpu_check_interval_msec; n += cpu_check_duration_msec) {
-      if (event_->Wait(cpu_check_duration_msec)) {
-        VLOG(1) << "Received stop signal";
-        return;
-      }
-      // save them in stack for debugging
-      total_cpu_load = cpu_stats_->GetSystemCPULoad();
-      current_process_cpu_load = cpu_stats_->GetCurrentProcessCPULoad();
-      VLOG(1) << "total=" << total_cpu_load
-              << " current=" << current_process_cpu_load
-              << " normalized_current="
-              << current_process_cpu_load / number_of_processors;
-      // subtract the CPU load of my process from total CPU load.
-      // This is required for running stress test.
-      const float extracted_cpu_load =
-          total_cpu_load - current_process_cpu_load / number_of_processors;
-      cpu_loads[cpu_loads_index++] = std::max(0.0f, extracted_cpu_load);
-    }
-
-    DCHECK_GT(cpu_loads_index, 0);
+    running_ = false;
+    task = task_;
+    task_ = Executor::TaskHandle();
+  }
 
-    const uint64_t current_cleanup_time = Clock::GetTime();
-    if (!CanSendCleanupCommand(cpu_loads, cpu_loads_index, current_cleanup_time,
-                               last_cleanup_time)) {
-      VLOG(1) << "CanSendCleanupCommand returned false";
-      last_cleanup_time = current_cleanup_time;
-      continue;
-    }
+  task.Cancel();
+  task.Wait();
+}
 
-    last_cleanup_time = current_cleanup_time;
+void SessionWatchDog::ScheduleTick(int32_t delay_msec) {
+  Schedule([this]() { Tick(); }, delay_msec);
+}
 
-    VLOG(2) << "Sending Cleanup command";
-    client_->set_timeout(kCleanupTimeout);
-    if (client_->Cleanup()) {
-      VLOG(2) << "Cleanup command succeeded";
-      continue;
-    }
+void SessionWatchDog::Schedule(std::function<void()> step,
+                               int32_t delay_msec) {
+  absl::MutexLock l(&mutex_);
+  if (!running_) {
+    VLOG(1) << "Received stop signal";
+    return;
+  }
+  VLOG(1) << "Start sleeping " << delay_msec;
+  task_ = Executor::Get()->PostDelayed(std::move(step),
+                                       absl::Milliseconds(delay_msec),
+                                       Executor::LOW);
+}
 
-    LOG(WARNING) << "Cleanup failed "
-                 << "execute PingCommand to check server is running";
+void SessionWatchDog::Tick() {
+  const int32_t cpu_check_interval_msec = GetCPUCheckIntervalMsec(interval_sec_);
+  const int32_t cpu_check_duration_msec =
+      GetCPUCheckDurationMsec(interval_sec_);
+  const size_t number_of_processors = cpu_stats_->GetNumberOfProcessors();
+
+  const float total_cpu_load = cpu_stats_->GetSystemCPULoad();
+  const float current_process_cpu_load =
+      cpu_stats_->GetCurrentProcessCPULoad();
+  VLOG(1) << "total=" << total_cpu_load
+          << " current=" << current_process_cpu_load
+          << " normalized_current="
+          << current_process_cpu_load / number_of_processors;
+  // subtract the CPU load of my process from total CPU load.
+  // This is required for running stress test.
+  const float extracted_cpu_load =
+      total_cpu_load - current_process_cpu_load / number_of_processors;
+  cpu_loads_[cpu_loads_index_++] = std::max(0.0f, extracted_cpu_load);
+
+  if (cpu_loads_index_ * cpu_check_duration_msec < cpu_check_interval_msec) {
+    ScheduleTick(cpu_check_duration_msec);
+    return;
+  }
 
-    bool failed = true;
+  const int32_t cpu_loads_index = cpu_loads_index_;
+  cpu_loads_index_ = 0;
+
+  const uint64_t current_cleanup_time = Clock::GetTime();
+  const bool can_send =
+      CanSendCleanupCommand(cpu_loads_, cpu_loads_index, current_cleanup_time,
+                            last_cleanup_time_);
+  last_cleanup_time_ = current_cleanup_time;
+  if (!can_send) {
+    VLOG(1) << "CanSendCleanupCommand returned false";
+  } else if (!SendCleanupCommand()) {
+    // Checks the server by the pings, which schedule the next tick.
     client_->Reset();
     client_->set_timeout(kPingTimeout);
-    for (int i = 0; i < kPingTrial; ++i) {
-      if (event_->Wait(kPingInterval)) {
-        VLOG(1) << "Received stop signal";
-        return;
-      }
-      if (client_->PingServer()) {
-        VLOG(2) << "Ping command succeeded";
-        failed = false;
-        break;
-      }
-      LOG(ERROR) << "Ping command failed, waiting " << kPingInterval
-                 << " msec, trial: " << i;
-    }
+    Schedule([this]() { Ping(0); }, kPingInterval);
+    return;
+  }
+
+  // Must be the last statement; |this| can be deleted once the next step is
+  // scheduled and Terminate() is called.
+  ScheduleTick(GetIdleIntervalMsec(interval_sec_) + cpu_check_duration_msec);
+}
 
-    if (failed) {
-      if (event_->Wait(100)) {
-        VLOG(1) << "Parent thread is already terminated";
-        return;
-      }
+bool SessionWatchDog::SendCleanupCommand() {
+  VLOG(2) << "Sending Cleanup command";
+  client_->set_timeout(kCleanupTimeout);
+  if (client_->Cleanup()) {
+    VLOG(2) << "Cleanup command succeeded";
+    return true;
+  }
+
+  LOG(WARNING) << "Cleanup failed "
+               << "execute PingCommand to check server is running";
+  return false;
+}
+
+void SessionWatchDog::Ping(int trial) {
+  if (client_->PingServer()) {
+    VLOG(2) << "Ping command succeeded";
+    ScheduleTick(GetIdleIntervalMsec(interval_sec_) +
+                 GetCPUCheckDurationMsec(interval_sec_));
+    return;
+  }
+  LOG(ERROR) << "Ping command failed, waiting " << kPingInterval
+             << " msec, trial: " << trial;
+  if (trial + 1 < kPingTrial) {
+    Schedule([this, trial]() { Ping(trial + 1); }, kPingInterval);
+    return;
+  }
+
+  if (!IsRunning()) {
+    VLOG(1) << "Parent thread is already terminated";
+    return;
+  }
 #ifndef MOZC_NO_LOGGING
-      // We have received crash dumps caused by the following LOG(FATAL).
-      // Unfortunately, we cannot investigate the cause of this error,
-      // as the crash dump doesn't contain any logging information.
-      // Here we temporary save the user name into stack in order
-      // to obtain the log file before the LOG(FATAL).
-      char user_name[32];
-      const std::string tmp = SystemUtil::GetUserNameAsString();
-      strncpy(user_name, tmp.c_str(), sizeof(user_name));
-      VLOG(1) << "user_name: " << user_name;
+  // We have received crash dumps caused by the following LOG(FATAL).
+  // Unfortunately, we cannot investigate the cause of this error,
+  // as the crash dump doesn't contain any logging information.
+  // Here we temporary save the user name into stack in order
+  // to obtain the log file before the LOG(FATAL).
+  char user_name[32];
+  const std::string tmp = SystemUtil::GetUserNameAsString();
+  strncpy(user_name, tmp.c_str(), sizeof(user_name));
+  VLOG(1) << "user_name: " << user_name;
 #endif  // !MOZC_NO_LOGGING
-      LOG(FATAL) << "Cleanup commands failed. Rasing exception...";
-    }
-  }
+  LOG(FATAL) << "Cleanup commands failed. Rasing exception...";
 }
 
 bool SessionWatchDog::CanSendCleanupCommand(const volatile float *cpu_loads,
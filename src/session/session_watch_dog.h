@@ -33,21 +33,25 @@
 #define MOZC_SESSION_SESSION_WATCH_DOG_H_
 
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 
+#include "base/executor.h"
 #include "base/port.h"
-#include "base/thread.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 class CPUStatsInterface;
-class UnnamedEvent;
 namespace client {
 class ClientInterface;
 }
 
 // SessionWatchDog class sends Cleanup command to Sessionhandler
 // for every some specified seconds.
-class SessionWatchDog : public Thread {
+// The watch dog doesn't own a thread; each step of the timer is run as a
+// delayed task on the background executor.
+class SessionWatchDog {
  public:
   // return the interval sec of watch dog timer
   int32_t interval() const { return interval_sec_; }
@@ -61,14 +65,17 @@ class SessionWatchDog : public Thread {
   void SetCPUStatsInterface(CPUStatsInterface *cpu_stats);
 
   explicit SessionWatchDog(int32_t interval_sec);
-  ~SessionWatchDog() override;
+  ~SessionWatchDog();
 
-  // inherited from Thread class
-  void Terminate();
+  // start watch dog timer and return immediately.
+  // |thread_name| is only used for logging.
+  void Start(const std::string &thread_name);
+
+  // return true if the watch dog timer is started and not terminated.
+  bool IsRunning() const;
 
-  // inherited from Thread class
-  // start watch dog timer and return immediately
-  // virtual void Start();
+  // stop watch dog timer and wait for the running step.
+  void Terminate();
 
   // return true if watch dog can send CleanupCommand:
   // |cpu_loads|: An array of cpu loads.
@@ -80,12 +87,39 @@ class SessionWatchDog : public Thread {
                              uint64_t last_cleanup_time) const;
 
  private:
-  void Run() override;
+  // Posts Tick() after |delay_msec|.  Does nothing after Terminate().
+  void ScheduleTick(int32_t delay_msec);
+  // Posts |step| after |delay_msec|.  Does nothing after Terminate().
+  void Schedule(std::function<void()> step, int32_t delay_msec);
+
+  // One step of the watch dog timer.  Samples the CPU load, and sends
+  // Cleanup command when a whole interval is sampled.
+  void Tick();
+
+  // Sends Cleanup command.  Returns false if the command failed.
+  bool SendCleanupCommand();
+
+  // Pings the server after Cleanup command failed.  Each failed ping is
+  // retried by a delayed task, so that no worker of the executor sleeps
+  // between the trials.  Crashes if all the trials fail.
+  void Ping(int trial);
 
   int32_t interval_sec_;
   client::ClientInterface *client_;
   CPUStatsInterface *cpu_stats_;
-  std::unique_ptr<UnnamedEvent> event_;
+
+  // Default implementations used when not set by the setters above.
+  std::unique_ptr<client::ClientInterface> client_impl_;
+  std::unique_ptr<CPUStatsInterface> cpu_stats_impl_;
+
+  // States of the timer.  Only accessed by Tick().
+  float cpu_loads_[16];  // 60/5 = 12 is the minimal size
+  int cpu_loads_index_;
+  uint64_t last_cleanup_time_;
+
+  mutable absl::Mutex mutex_;
+  bool running_ ABSL_GUARDED_BY(mutex_);
+  Executor::TaskHandle task_ ABSL_GUARDED_BY(mutex_);
 
   DISALLOW_COPY_AND_ASSIGN(SessionWatchDog);
 };
@@ -122,6 +122,33 @@ TEST_F(SessionWatchDogTest, SessionWatchDogTest) {
   watchdog.Terminate();
 }
 
+TEST_F(SessionWatchDogTest, PingAfterCleanupFailure) {
+  static const int32_t kInterval = 1;  // for every 1sec
+  mozc::SessionWatchDog watchdog(kInterval);
+
+  mozc::client::ClientMock client;
+  InitializeClient(&client);
+  client.SetBoolFunctionReturn("Cleanup", false);
+  mozc::TestCPUStats stats;
+  stats.SetCPULoads(std::vector<float>(20, 0.0));
+
+  watchdog.SetClientInterface(&client);
+  watchdog.SetCPUStatsInterface(&stats);
+  watchdog.Start("PingAfterCleanupFailure");
+
+  // Cleanup at 1 sec fails, and the ping at 2 sec succeeds.  The next
+  // Cleanup is at 3 sec and its ping is at 4 sec.
+  mozc::Util::Sleep(4500);
+  EXPECT_EQ(2, client.GetFunctionCallCount("Cleanup"));
+  EXPECT_EQ(2, client.GetFunctionCallCount("PingServer"));
+
+  // Terminate() doesn't wait for the pending ping.
+  mozc::Util::Sleep(700);
+  watchdog.Terminate();
+  EXPECT_FALSE(watchdog.IsRunning());
+  EXPECT_EQ(2, client.GetFunctionCallCount("PingServer"));
+}
+
 TEST_F(SessionWatchDogTest, SessionWatchDogCPUStatsTest) {
   static const int32_t kInterval = 1;  // for every 1sec
   mozc::SessionWatchDog watchdog(kInterval);
@@ -0,0 +1,279 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/speculative_converter.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/executor.h"
+#include "base/logging.h"
+#include "composer/composer.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mozc {
+namespace session {
+
+namespace {
+
+// The cancel flag of the background conversion holding the engine mutex, and
+// the number of the commands waiting for the mutex.
+absl::Mutex *GetRunningMutex() {
+  static absl::Mutex *mutex = new absl::Mutex();
+  return mutex;
+}
+
+std::atomic<bool> *running_cancel_flag ABSL_GUARDED_BY(GetRunningMutex()) =
+    nullptr;
+int num_waiting_commands ABSL_GUARDED_BY(GetRunningMutex()) = 0;
+
+// Only the thread evaluating the commands creates SpeculativeConverter.
+std::atomic<int> num_instances{0};
+
+void SetRunningCancelFlag(std::atomic<bool> *flag) {
+  absl::MutexLock lock(GetRunningMutex());
+  running_cancel_flag = flag;
+  if (flag != nullptr && num_waiting_commands > 0) {
+    flag->store(true);
+  }
+}
+
+}  // namespace
+
+struct SpeculativeConverter::Speculation {
+  // Copies of the input, as the originals are modified by the following
+  // commands.
+  composer::Composer composer;
+  commands::Request request;
+  config::Config config;
+  bool use_history = true;
+  std::string fingerprint;
+
+  // Raised when the result is no longer needed.  The conversion doesn't hold
+  // |mutex|, so that the flag can be raised without waiting for it.
+  std::atomic<bool> cancelled{false};
+
+  absl::Mutex mutex;
+  bool done ABSL_GUARDED_BY(mutex) = false;
+  bool succeeded ABSL_GUARDED_BY(mutex) = false;
+  Segments segments ABSL_GUARDED_BY(mutex);
+};
+
+SpeculativeConverter::SpeculativeConverter(const ConverterInterface *converter)
+    : converter_(converter) {
+  DCHECK(converter_);
+  ++num_instances;
+}
+
+SpeculativeConverter::~SpeculativeConverter() {
+  Cancel();
+  --num_instances;
+}
+
+// static
+absl::Mutex *SpeculativeConverter::GetEngineMutex() {
+  static absl::Mutex *mutex = new absl::Mutex();
+  return mutex;
+}
+
+// static
+bool SpeculativeConverter::IsInUse() { return num_instances.load() > 0; }
+
+SpeculativeConverter::ScopedEngineLock::ScopedEngineLock(bool enabled)
+    : locked_(enabled) {
+  if (!locked_) {
+    return;
+  }
+  {
+    absl::MutexLock lock(GetRunningMutex());
+    ++num_waiting_commands;
+    if (running_cancel_flag != nullptr) {
+      running_cancel_flag->store(true);
+    }
+  }
+  GetEngineMutex()->Lock();
+  absl::MutexLock lock(GetRunningMutex());
+  --num_waiting_commands;
+}
+
+SpeculativeConverter::ScopedEngineLock::~ScopedEngineLock() {
+  if (locked_) {
+    GetEngineMutex()->Unlock();
+  }
+}
+
+SpeculativeConverter::ScopedCancellableTask::ScopedCancellableTask(
+    std::atomic<bool> *cancel_flag) {
+  SetRunningCancelFlag(cancel_flag);
+}
+
+SpeculativeConverter::ScopedCancellableTask::~ScopedCancellableTask() {
+  SetRunningCancelFlag(nullptr);
+}
+
+// static
+std::string SpeculativeConverter::GetInputFingerprint(
+    const composer::Composer &composer, const commands::Request &request,
+    const config::Config &config, bool use_history, size_t max_history_size,
+    const Segments &segments) {
+  std::string query, raw;
+  composer.GetQueryForConversion(&query);
+  composer.GetRawString(&raw);
+  std::string fingerprint = absl::StrCat(query, "\t", raw, "\t", use_history,
+                                         "\t", max_history_size);
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &segment = segments.history_segment(i);
+    absl::StrAppend(&fingerprint, "\t", segment.key());
+    if (segment.candidates_size() > 0) {
+      absl::StrAppend(&fingerprint, "\t", segment.candidate(0).value);
+    }
+  }
+  absl::StrAppend(&fingerprint, "\t", request.SerializeAsString(),
+                  config.SerializeAsString());
+  return fingerprint;
+}
+
+void SpeculativeConverter::Start(const composer::Composer &composer,
+                                 const commands::Request &request,
+                                 const config::Config &config,
+                                 bool use_history, size_t max_history_size,
+                                 const Segments &segments) {
+  if (composer.Empty()) {
+    Cancel();
+    return;
+  }
+  std::string fingerprint = GetInputFingerprint(
+      composer, request, config, use_history, max_history_size, segments);
+  if (speculation_ != nullptr && speculation_->fingerprint == fingerprint) {
+    // The running or finished conversion is for the same input.
+    return;
+  }
+  Cancel();
+
+  auto speculation = std::make_shared<Speculation>();
+  speculation->composer = composer;
+  speculation->request = request;
+  speculation->config = config;
+  speculation->composer.SetRequest(&speculation->request);
+  speculation->composer.SetConfig(&speculation->config);
+  speculation->use_history = use_history;
+  speculation->fingerprint = std::move(fingerprint);
+  {
+    absl::MutexLock lock(&speculation->mutex);
+    Segments &history = speculation->segments;
+    history.set_max_history_segments_size(max_history_size);
+    for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+      *history.add_segment() = segments.history_segment(i);
+    }
+  }
+  speculation_ = speculation;
+
+  const ConverterInterface *converter = converter_;
+  task_ = Executor::Get()->Post(
+      [converter, speculation]() {
+        absl::MutexLock engine_lock(GetEngineMutex());
+        if (speculation->cancelled.load()) {
+          return;
+        }
+        Segments segments;
+        {
+          absl::MutexLock lock(&speculation->mutex);
+          segments = std::move(speculation->segments);
+        }
+        ConversionRequest conversion_request(&speculation->composer,
+                                             &speculation->request,
+                                             &speculation->config);
+        conversion_request.set_enable_user_history_for_conversion(
+            speculation->use_history);
+        conversion_request.set_request_type(ConversionRequest::CONVERSION);
+        conversion_request.set_cancel_flag(&speculation->cancelled);
+        bool succeeded;
+        {
+          ScopedCancellableTask running(&speculation->cancelled);
+          succeeded = converter->StartConversionForRequest(conversion_request,
+                                                           &segments);
+        }
+        if (speculation->cancelled.load()) {
+          return;
+        }
+        absl::MutexLock lock(&speculation->mutex);
+        speculation->segments = std::move(segments);
+        speculation->succeeded = succeeded;
+        speculation->done = true;
+      },
+      Executor::LOW);
+}
+
+void SpeculativeConverter::Cancel() {
+  if (speculation_ == nullptr) {
+    return;
+  }
+  task_.Cancel();
+  speculation_->cancelled.store(true);
+  speculation_.reset();
+  task_ = Executor::TaskHandle();
+}
+
+bool SpeculativeConverter::TakeResult(const composer::Composer &composer,
+                                      const commands::Request &request,
+                                      const config::Config &config,
+                                      bool use_history, Segments *segments) {
+  DCHECK(segments);
+  if (speculation_ == nullptr) {
+    return false;
+  }
+  bool taken = false;
+  if (speculation_->fingerprint ==
+      GetInputFingerprint(composer, request, config, use_history,
+                          segments->max_history_segments_size(), *segments)) {
+    // Doesn't wait for the running conversion, as the caller may hold the
+    // engine mutex.
+    absl::MutexLock lock(&speculation_->mutex);
+    if (speculation_->done && speculation_->succeeded) {
+      *segments = speculation_->segments;
+      taken = true;
+    }
+  }
+  Cancel();
+  return taken;
+}
+
+void SpeculativeConverter::WaitForTesting() { task_.Wait(); }
+
+}  // namespace session
+}  // namespace mozc
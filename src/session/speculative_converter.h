@@ -0,0 +1,152 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Converts the current composition in background while the user is typing,
+// so that the conversion result is ready when the user presses the
+// conversion key.
+
+#ifndef MOZC_SESSION_SPECULATIVE_CONVERTER_H_
+#define MOZC_SESSION_SPECULATIVE_CONVERTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "base/executor.h"
+#include "composer/composer.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mozc {
+namespace session {
+
+// The conversion engine is not thread safe, e.g., the connector and the
+// rewriters have caches without locks.  The background conversion holds
+// GetEngineMutex() while converting, and the session handler holds it while
+// evaluating a command.  Background conversions are posted as low priority
+// tasks of Executor, which don't start while a command is evaluated.  A
+// command arriving during a background conversion takes the mutex with
+// ScopedEngineLock, which cancels the conversion; the converter checks the
+// cancellation between its stages, so the command waits only for the
+// current stage.  No conversion runs in background while no
+// SpeculativeConverter exists, so commands don't need the mutex then.
+//
+// The result is reused only when the input, i.e., the composition, the
+// history segments, the conversion preferences, the request and the config,
+// is the same as the one at the start.
+class SpeculativeConverter {
+ public:
+  // |converter| must outlive the background conversions.  It is guaranteed
+  // when this object is destroyed while GetEngineMutex() is held.
+  explicit SpeculativeConverter(const ConverterInterface *converter);
+  SpeculativeConverter(const SpeculativeConverter &) = delete;
+  SpeculativeConverter &operator=(const SpeculativeConverter &) = delete;
+  // Cancels the background conversion without waiting for it.
+  ~SpeculativeConverter();
+
+  static absl::Mutex *GetEngineMutex();
+
+  // Returns true while a SpeculativeConverter exists.
+  static bool IsInUse();
+
+  // Locks GetEngineMutex() for a command if |enabled| is true, cancelling the
+  // running background conversion, if any, instead of waiting for its end.
+  class ScopedEngineLock {
+   public:
+    explicit ScopedEngineLock(bool enabled);
+    ~ScopedEngineLock();
+
+    ScopedEngineLock(const ScopedEngineLock &) = delete;
+    ScopedEngineLock &operator=(const ScopedEngineLock &) = delete;
+
+   private:
+    const bool locked_;
+  };
+
+  // Registers |cancel_flag| of a background task holding GetEngineMutex(),
+  // e.g., the engine warm-up, so that ScopedEngineLock raises it as it does
+  // for the background conversion.  The flag is raised at once if a command
+  // is already waiting.
+  class ScopedCancellableTask {
+   public:
+    explicit ScopedCancellableTask(std::atomic<bool> *cancel_flag);
+    ~ScopedCancellableTask();
+
+    ScopedCancellableTask(const ScopedCancellableTask &) = delete;
+    ScopedCancellableTask &operator=(const ScopedCancellableTask &) = delete;
+  };
+
+  // Starts converting |composer| in background, cancelling the previous one.
+  // The history segments of |segments| are copied only when a conversion is
+  // started, i.e., the composition is not empty and differs from the one of
+  // the previous conversion.
+  void Start(const composer::Composer &composer,
+             const commands::Request &request, const config::Config &config,
+             bool use_history, size_t max_history_size,
+             const Segments &segments);
+
+  // Cancels the background conversion and discards the result.
+  void Cancel();
+
+  // If the background conversion for the same input has finished, copies
+  // the result to |segments| and returns true.  The result is discarded in
+  // any case.
+  bool TakeResult(const composer::Composer &composer,
+                  const commands::Request &request,
+                  const config::Config &config, bool use_history,
+                  Segments *segments);
+
+  // Waits for the background conversion.  Must not be called while
+  // GetEngineMutex() is held.
+  void WaitForTesting();
+
+ private:
+  struct Speculation;
+
+  static std::string GetInputFingerprint(const composer::Composer &composer,
+                                         const commands::Request &request,
+                                         const config::Config &config,
+                                         bool use_history,
+                                         size_t max_history_size,
+                                         const Segments &segments);
+
+  const ConverterInterface *converter_;
+  std::shared_ptr<Speculation> speculation_;
+  Executor::TaskHandle task_;
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_SPECULATIVE_CONVERTER_H_
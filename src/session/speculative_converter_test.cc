@@ -0,0 +1,226 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/speculative_converter.h"
+
+#include <string>
+
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/base/public/gmock.h"
+#include "testing/base/public/gunit.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+bool FillResult(const ConversionRequest &request, Segments *segments) {
+  std::string key;
+  request.composer().GetQueryForConversion(&key);
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  segment->add_candidate()->value = "結果";
+  return true;
+}
+
+class SpeculativeConverterTest : public ::testing::Test {
+ protected:
+  SpeculativeConverterTest()
+      : composer_(&table_, &request_, &config_) {}
+
+  composer::Table table_;
+  commands::Request request_;
+  config::Config config_;
+  composer::Composer composer_;
+  MockConverter mock_converter_;
+};
+
+TEST_F(SpeculativeConverterTest, TakeResult) {
+  EXPECT_CALL(mock_converter_, StartConversionForRequest(_, _))
+      .WillOnce(Invoke(FillResult));
+  SpeculativeConverter converter(&mock_converter_);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+
+  ASSERT_TRUE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+  ASSERT_EQ(1, segments.conversion_segments_size());
+  EXPECT_EQ("abc", segments.conversion_segment(0).key());
+  EXPECT_EQ("結果", segments.conversion_segment(0).candidate(0).value);
+
+  // The result is taken only once.
+  segments.Clear();
+  EXPECT_FALSE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+}
+
+TEST_F(SpeculativeConverterTest, InputChanged) {
+  EXPECT_CALL(mock_converter_, StartConversionForRequest(_, _))
+      .WillRepeatedly(Invoke(FillResult));
+  SpeculativeConverter converter(&mock_converter_);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  composer_.InsertCharacter("d");
+  EXPECT_FALSE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+  EXPECT_EQ(0, segments.segments_size());
+
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  EXPECT_FALSE(
+      converter.TakeResult(composer_, request_, config_, false, &segments));
+
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  config_.set_incognito_mode(true);
+  EXPECT_FALSE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+  config_.set_incognito_mode(false);
+
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  Segment *history = segments.add_segment();
+  history->set_segment_type(Segment::HISTORY);
+  history->set_key("きのう");
+  history->add_candidate()->value = "昨日";
+  EXPECT_FALSE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+}
+
+TEST_F(SpeculativeConverterTest, StartedOnlyForNewInput) {
+  EXPECT_CALL(mock_converter_, StartConversionForRequest(_, _))
+      .WillOnce(Invoke(FillResult));
+  EXPECT_FALSE(SpeculativeConverter::IsInUse());
+  SpeculativeConverter converter(&mock_converter_);
+  EXPECT_TRUE(SpeculativeConverter::IsInUse());
+  Segments segments;
+  // Nothing to convert.
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+
+  composer_.InsertCharacter("abc");
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  // The finished conversion is kept for the same input.
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  EXPECT_TRUE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+}
+
+TEST_F(SpeculativeConverterTest, NotReady) {
+  EXPECT_CALL(mock_converter_, StartConversionForRequest(_, _)).Times(0);
+  SpeculativeConverter converter(&mock_converter_);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  {
+    // The conversion doesn't run while the engine is in use.
+    absl::MutexLock lock(SpeculativeConverter::GetEngineMutex());
+    converter.Start(composer_, request_, config_, true,
+                    segments.max_history_segments_size(), segments);
+    EXPECT_FALSE(
+        converter.TakeResult(composer_, request_, config_, true, &segments));
+  }
+  // Cancelled by TakeResult().
+  converter.WaitForTesting();
+}
+
+TEST_F(SpeculativeConverterTest, CancelledByCommand) {
+  absl::Notification started;
+  bool cancelled = false;
+  EXPECT_CALL(mock_converter_, StartConversionForRequest(_, _))
+      .WillOnce(Invoke([&](const ConversionRequest &request,
+                           Segments *segments) {
+        started.Notify();
+        // The converter checks the flag between its stages.
+        while (!request.IsCancelled()) {
+          absl::SleepFor(absl::Milliseconds(1));
+        }
+        cancelled = true;
+        return FillResult(request, segments);
+      }));
+  SpeculativeConverter converter(&mock_converter_);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  started.WaitForNotification();
+  {
+    // Doesn't wait for the end of the conversion forever.
+    SpeculativeConverter::ScopedEngineLock lock(true);
+    EXPECT_TRUE(cancelled);
+    EXPECT_FALSE(
+        converter.TakeResult(composer_, request_, config_, true, &segments));
+  }
+  converter.WaitForTesting();
+}
+
+TEST_F(SpeculativeConverterTest, ConversionFailed) {
+  EXPECT_CALL(mock_converter_, StartConversionForRequest(_, _))
+      .WillOnce(Return(false));
+  SpeculativeConverter converter(&mock_converter_);
+  composer_.InsertCharacter("abc");
+  Segments segments;
+  converter.Start(composer_, request_, config_, true,
+                  segments.max_history_segments_size(), segments);
+  converter.WaitForTesting();
+  EXPECT_FALSE(
+      converter.TakeResult(composer_, request_, config_, true, &segments));
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
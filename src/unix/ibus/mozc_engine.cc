@@ -251,6 +251,8 @@ CandidateWindowHandlerInterface *createGtkCandidateWindowHandler(
   }
 #endif  // !ENABLE_QT_RENDERER
 
+  // Don't block the key handling while the renderer draws the window.
+  renderer_client->EnableAsyncUpdates();
   auto *handler = new GtkCandidateWindowHandler(renderer_client);
   handler->RegisterGSettingsObserver();
   return handler;